@@ -0,0 +1,324 @@
+// bench_kanaly.c - przesyłanie komunikatów między procesami: kolejka System V vs kanał
+// Przepustowość: jeden nadawca wysyła KOMUNIKATY komunikatów, odbiorca w drugim procesie
+// odbiera je (blokująco: msgrcv / kanaly_czekaj). Ping-pong: żądanie i odpowiedź w pętli,
+// odpowiedź w kolejce adresowana mtype = PID jak dawniej odpowiedzi do turystów.
+// Odpowiedzi: mtype = PID przy ZALEGLE nieodebranych odpowiedziach do innych adresatów
+// w tej samej kolejce (msgrcv przeszukuje je liniowo) vs skrzynka odpowiedzi.
+// Krzesełko: wsiadanie i dotarcie na górę CHAIR_CAPACITY pasażerów - odpowiedź do każdej
+// skrzynki vs grupa powiadomień (dwa pokolenia rekordu).
+// Kolejki przenoszą dawny komunikat pełnego rozmiaru (StaryKomunikat), kanały i skrzynki
+// - Komunikat z nagłówkiem i ładunkiem swojego typu (KOMUNIKAT_ROZMIAR).
+// Zasoby tworzone w katalogu tymczasowym - klucz ftok różny od działającej symulacji.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include "struktury.h"
+#include "utils.h"
+#include "kanaly.h"
+#include "skrzynki.h"
+
+#define KOMUNIKATY       1000000
+#define PING_PONG        100000
+#define ZALEGLE          100     // Domyślny limit kolejki (msgmnb 16 KiB) mieści ok. 200
+
+// Dawny format komunikatu (jedna struktura dla wszystkich typów) - porównanie rozmiaru
+typedef struct {
+    long mtype;
+    pid_t sender_pid;
+    int reply_box;
+    int tourist_id;
+    int data;
+    int data2;
+    TouristType tourist_type;
+    int age;
+    bool is_vip;
+    int children_count;
+    int child_ids[CHAIR_CAPACITY];
+    int passenger_ids[CHAIR_CAPACITY];
+    TicketType ticket_type;
+} StaryKomunikat;
+
+#define STARY_ROZMIAR (sizeof(StaryKomunikat) - sizeof(long))
+
+static long long teraz_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void wypisz(const char* nazwa, long long czas_ns, long long operacje) {
+    printf("%-44s %10.1f ns/op\n", nazwa, (double)czas_ns / operacje);
+}
+
+static void msg_wyslij(int msg_id, StaryKomunikat* msg) {
+    while (msgsnd(msg_id, msg, STARY_ROZMIAR, 0) == -1 && errno == EINTR) {
+    }
+}
+
+static void msg_odbierz(int msg_id, StaryKomunikat* msg, long mtype) {
+    while (msgrcv(msg_id, msg, STARY_ROZMIAR, mtype, 0) == -1 && errno == EINTR) {
+    }
+}
+
+// Odbiór z kanału - sen na dzwonku odbiorcy, gdy pusty
+static void kanal_odbierz_czekaj(KanalId kanal, OdbiorcaKanalu odbiorca, SharedMemory* shm, Komunikat* msg) {
+    while (!kanal_odbierz(kanal, msg)) {
+        kanaly_czekaj(odbiorca, stan_odczytaj(shm), -1);
+    }
+}
+
+static void bench_kolejka(void) {
+    int msg_id = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msg_id == -1) {
+        perror("Błąd msgget");
+        return;
+    }
+    StaryKomunikat msg;
+    memset(&msg, 0, sizeof(msg));
+
+    long long start = teraz_ns();
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < KOMUNIKATY; i++) {
+            msg_odbierz(msg_id, &msg, MSG_TOURIST_TO_PLATFORM);
+        }
+        _exit(0);
+    }
+    msg.mtype = MSG_TOURIST_TO_PLATFORM;
+    for (int i = 0; i < KOMUNIKATY; i++) {
+        msg.tourist_id = i;
+        msg_wyslij(msg_id, &msg);
+    }
+    waitpid(pid, NULL, 0);
+    wypisz("kolejka System V: przepustowosc", teraz_ns() - start, KOMUNIKATY);
+
+    pid_t rodzic = getpid();
+    pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            msg_odbierz(msg_id, &msg, MSG_TOURIST_TO_PLATFORM);
+            msg.mtype = rodzic;
+            msg_wyslij(msg_id, &msg);
+        }
+        _exit(0);
+    }
+    start = teraz_ns();
+    for (int i = 0; i < PING_PONG; i++) {
+        msg.mtype = MSG_TOURIST_TO_PLATFORM;
+        msg_wyslij(msg_id, &msg);
+        msg_odbierz(msg_id, &msg, rodzic);
+    }
+    wypisz("kolejka System V: ping-pong (runda)", teraz_ns() - start, PING_PONG);
+    waitpid(pid, NULL, 0);
+
+    msgctl(msg_id, IPC_RMID, NULL);
+}
+
+static void bench_kanal(SharedMemory* shm) {
+    Komunikat msg;
+    memset(&msg, 0, sizeof(msg));
+
+    long long start = teraz_ns();
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < KOMUNIKATY; i++) {
+            kanal_odbierz_czekaj(KANAL_PERON, ODBIORCA_WORKER1, shm, &msg);
+        }
+        _exit(0);
+    }
+    for (int i = 0; i < KOMUNIKATY; i++) {
+        msg.tourist_id = i;
+        kanal_wyslij(KANAL_PERON, &msg, -1);
+    }
+    waitpid(pid, NULL, 0);
+    wypisz("kanal w pamieci dzielonej: przepustowosc", teraz_ns() - start, KOMUNIKATY);
+
+    // Żądanie kanałem peronu, odpowiedź kanałem przyjazdów (inny odbiorca)
+    pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            kanal_odbierz_czekaj(KANAL_PERON, ODBIORCA_WORKER1, shm, &msg);
+            kanal_wyslij(KANAL_PRZYJAZDY, &msg, -1);
+        }
+        _exit(0);
+    }
+    start = teraz_ns();
+    for (int i = 0; i < PING_PONG; i++) {
+        kanal_wyslij(KANAL_PERON, &msg, -1);
+        kanal_odbierz_czekaj(KANAL_PRZYJAZDY, ODBIORCA_WORKER2, shm, &msg);
+    }
+    wypisz("kanal w pamieci dzielonej: ping-pong (runda)", teraz_ns() - start, PING_PONG);
+    waitpid(pid, NULL, 0);
+}
+
+static void bench_odpowiedzi_kolejka(void) {
+    int msg_id = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msg_id == -1) {
+        perror("Błąd msgget");
+        return;
+    }
+    StaryKomunikat msg;
+    memset(&msg, 0, sizeof(msg));
+
+    // Nieodebrane odpowiedzi innych turystów (mtype = nieistniejące PID-y)
+    for (int i = 0; i < ZALEGLE; i++) {
+        msg.mtype = 1000000 + i;
+        msg_wyslij(msg_id, &msg);
+    }
+
+    pid_t rodzic = getpid();
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            msg_odbierz(msg_id, &msg, MSG_TOURIST_TO_PLATFORM);
+            msg.mtype = rodzic;
+            msg_wyslij(msg_id, &msg);
+        }
+        _exit(0);
+    }
+    long long start = teraz_ns();
+    for (int i = 0; i < PING_PONG; i++) {
+        msg.mtype = MSG_TOURIST_TO_PLATFORM;
+        msg_wyslij(msg_id, &msg);
+        msg_odbierz(msg_id, &msg, rodzic);
+    }
+    wypisz("kolejka mtype=PID (100 zaleglych): runda", teraz_ns() - start, PING_PONG);
+    waitpid(pid, NULL, 0);
+
+    msgctl(msg_id, IPC_RMID, NULL);
+}
+
+static void zapamietaj(const Komunikat* msg, void* arg) {
+    *(Komunikat*)arg = *msg;
+}
+
+static void bench_odpowiedzi_skrzynka(SharedMemory* shm) {
+    Komunikat msg;
+    memset(&msg, 0, sizeof(msg));
+    skrzynki_zarejestruj();
+    int skrzynka = skrzynka_przydziel();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            kanal_odbierz_czekaj(KANAL_PERON, ODBIORCA_WORKER1, shm, &msg);
+            msg.typ = MSG_PLATFORM_TO_TOURIST;
+            skrzynka_wyslij(msg.reply_box, &msg);
+        }
+        _exit(0);
+    }
+    long long start = teraz_ns();
+    for (int i = 0; i < PING_PONG; i++) {
+        msg.reply_box = skrzynka;
+        msg.tourist_id = i;
+        kanal_wyslij(KANAL_PERON, &msg, -1);
+        while (skrzynki_zbierz(zapamietaj, &msg) == 0) {
+            skrzynki_czekaj(-1);
+        }
+    }
+    wypisz("kanal + skrzynka odpowiedzi: runda", teraz_ns() - start, PING_PONG);
+    waitpid(pid, NULL, 0);
+
+    skrzynka_zwolnij(skrzynka);
+    skrzynki_wyrejestruj();
+}
+
+static void policz(const Komunikat* msg, void* arg) {
+    (void)msg;
+    (*(int*)arg)++;
+}
+
+// Runda: żądanie kanałem, odpowiedź 2 x CHAIR_CAPACITY powiadomień dla pasażerów
+static void bench_krzeselko(SharedMemory* shm, bool grupa) {
+    Komunikat msg;
+    memset(&msg, 0, sizeof(msg));
+    skrzynki_zarejestruj();
+    PasazerKrzeselka pasazerowie[CHAIR_CAPACITY];
+    for (int i = 0; i < CHAIR_CAPACITY; i++) {
+        pasazerowie[i].tourist_id = i;
+        pasazerowie[i].reply_box = skrzynka_przydziel();
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            kanal_odbierz_czekaj(KANAL_PERON, ODBIORCA_WORKER1, shm, &msg);
+            if (grupa) {
+                int nr = grupa_utworz(pasazerowie, CHAIR_CAPACITY);
+                grupa_powiadom(nr, MSG_PLATFORM_TO_TOURIST);
+                grupa_powiadom(nr, MSG_TOP_ARRIVAL);
+            } else {
+                for (int etap = 0; etap < 2; etap++) {
+                    for (int p = 0; p < CHAIR_CAPACITY; p++) {
+                        msg.typ = etap == 0 ? MSG_PLATFORM_TO_TOURIST : MSG_TOP_ARRIVAL;
+                        msg.tourist_id = pasazerowie[p].tourist_id;
+                        skrzynka_wyslij(pasazerowie[p].reply_box, &msg);
+                    }
+                }
+            }
+        }
+        _exit(0);
+    }
+    long long start = teraz_ns();
+    for (int i = 0; i < PING_PONG; i++) {
+        kanal_wyslij(KANAL_PERON, &msg, -1);
+        int odebrane = 0;
+        while (odebrane < 2 * CHAIR_CAPACITY) {
+            if (skrzynki_zbierz(policz, &odebrane) == 0) {
+                skrzynki_czekaj(-1);
+            }
+        }
+    }
+    wypisz(grupa ? "krzeselko: grupa powiadomien (runda)" : "krzeselko: skrzynka kazdego pasazera (runda)",
+           teraz_ns() - start, PING_PONG);
+    waitpid(pid, NULL, 0);
+
+    for (int i = 0; i < CHAIR_CAPACITY; i++) {
+        skrzynka_zwolnij(pasazerowie[i].reply_box);
+    }
+    skrzynki_wyrejestruj();
+}
+
+int main(void) {
+    char katalog[] = "/tmp/bench_kanalyXXXXXX";
+    char poprzedni[4096];
+    if (!getcwd(poprzedni, sizeof(poprzedni)) || !mkdtemp(katalog) || chdir(katalog) == -1) {
+        perror("Błąd katalogu tymczasowego");
+        return 1;
+    }
+
+    int shm_id = utworz_pamiec();
+    SharedMemory* shm = dolacz_pamiec(shm_id);
+    memset(shm->dzwonki, 0, sizeof(shm->dzwonki));
+    int kanaly_id = kanaly_utworz();
+    kanaly_dolacz(shm);
+    int skrzynki_id = skrzynki_utworz();
+
+    printf("Dawny komunikat: %zu B (msgsz %zu B)\n", sizeof(StaryKomunikat), STARY_ROZMIAR);
+    printf("Komunikat: naglowek %zu B, zadanie biletu %zu B, bilet %zu B, peron %zu B, "
+           "przyjazd %zu B, wyjscie %zu B\n",
+           KOMUNIKAT_NAGLOWEK, KOMUNIKAT_ROZMIAR(zadanie), KOMUNIKAT_ROZMIAR(bilet),
+           KOMUNIKAT_ROZMIAR(peron), KOMUNIKAT_ROZMIAR(przyjazd), KOMUNIKAT_ROZMIAR(wyjscie));
+    bench_kolejka();
+    bench_kanal(shm);
+    bench_odpowiedzi_kolejka();
+    bench_odpowiedzi_skrzynka(shm);
+    bench_krzeselko(shm, false);
+    bench_krzeselko(shm, true);
+
+    skrzynki_usun(skrzynki_id);
+    kanaly_usun(kanaly_id);
+    odlacz_pamiec(shm);
+    usun_pamiec(shm_id);
+    if (chdir(poprzedni) == -1 || rmdir(katalog) == -1) {
+        perror("Błąd sprzątania katalogu tymczasowego");
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// bench_kolejka_kasy.c - przepustowość sprzedaży przy stałej głębokości kolejki kasjera
+// Porównanie: bufory cykliczne (kolejka_kasy.c) vs dawne przesuwanie tablicy.
+// Stan ustalony: każda sprzedaż (pobranie) jest uzupełniana nowym przybyciem (dodanie),
+// 10% przybyć to VIP.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "kolejka_kasy.h"
+
+#define CZAS_POMIARU_NS  300000000LL    // Minimalny czas pomiaru jednej głębokości
+#define PROCENT_VIP      10
+
+static const int glebokosci[] = {100, 1000, 15000};
+
+// Dawna kolejka kasjera - pobranie przesuwa całą tablicę o jeden element
+static QueuedTourist stara_vip[MAX_QUEUE];
+static int stara_vip_size = 0;
+static QueuedTourist stara_zwykla[MAX_QUEUE];
+static int stara_zwykla_size = 0;
+
+static bool stara_dodaj(const QueuedTourist* tourist) {
+    if (tourist->is_vip) {
+        if (stara_vip_size < MAX_QUEUE) {
+            stara_vip[stara_vip_size++] = *tourist;
+            return true;
+        }
+    } else {
+        if (stara_zwykla_size < MAX_QUEUE) {
+            stara_zwykla[stara_zwykla_size++] = *tourist;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool stara_pobierz(QueuedTourist* tourist) {
+    if (stara_vip_size > 0) {
+        *tourist = stara_vip[0];
+        for (int i = 0; i < stara_vip_size - 1; i++) {
+            stara_vip[i] = stara_vip[i + 1];
+        }
+        stara_vip_size--;
+        return true;
+    }
+    if (stara_zwykla_size > 0) {
+        *tourist = stara_zwykla[0];
+        for (int i = 0; i < stara_zwykla_size - 1; i++) {
+            stara_zwykla[i] = stara_zwykla[i + 1];
+        }
+        stara_zwykla_size--;
+        return true;
+    }
+    return false;
+}
+
+static KolejkaKasy nowa;
+
+static bool nowa_dodaj(const QueuedTourist* tourist) {
+    return kolejka_kasy_dodaj(&nowa, tourist);
+}
+
+static bool nowa_pobierz(QueuedTourist* tourist) {
+    return kolejka_kasy_pobierz(&nowa, tourist);
+}
+
+static long long teraz_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void nowy_turysta(QueuedTourist* t, int id) {
+    memset(t, 0, sizeof(*t));
+    t->tourist_id = id;
+    t->age = 18 + id % 50;
+    t->is_vip = (id % 100) < PROCENT_VIP;
+}
+
+// Sprzedaże na sekundę przy stałej głębokości kolejki
+static double zmierz(int glebokosc, bool (*dodaj)(const QueuedTourist*),
+                     bool (*pobierz)(QueuedTourist*), long long* suma_kontrolna) {
+    QueuedTourist t;
+    int id = 0;
+    for (int i = 0; i < glebokosc; i++) {
+        nowy_turysta(&t, id++);
+        dodaj(&t);
+    }
+
+    long long sprzedaze = 0;
+    long long start = teraz_ns();
+    long long czas;
+    do {
+        for (int i = 0; i < 256; i++) {
+            pobierz(&t);
+            *suma_kontrolna += t.tourist_id;
+            nowy_turysta(&t, id++);
+            dodaj(&t);
+        }
+        sprzedaze += 256;
+        czas = teraz_ns() - start;
+    } while (czas < CZAS_POMIARU_NS);
+
+    while (pobierz(&t)) {
+    }
+
+    return sprzedaze * 1e9 / czas;
+}
+
+int main(void) {
+    long long suma_kontrolna = 0;
+    kolejka_kasy_init(&nowa);
+
+    printf("Kolejka kasjera - sprzedaze/s przy stalej glebokosci (%d%% VIP)\n", PROCENT_VIP);
+    printf("%-10s %18s %18s %10s\n", "glebokosc", "bufor cykliczny", "przesuwanie", "krotnosc");
+
+    for (size_t i = 0; i < sizeof(glebokosci) / sizeof(glebokosci[0]); i++) {
+        int g = glebokosci[i];
+        double cykliczny = zmierz(g, nowa_dodaj, nowa_pobierz, &suma_kontrolna);
+        double przesuwanie = zmierz(g, stara_dodaj, stara_pobierz, &suma_kontrolna);
+        printf("%-10d %18.0f %18.0f %9.1fx\n", g, cykliczny, przesuwanie, cykliczny / przesuwanie);
+    }
+
+    printf("(suma kontrolna %lld)\n", suma_kontrolna);
+    return 0;
+}
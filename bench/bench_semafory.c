@@ -0,0 +1,104 @@
+// bench_semafory.c - koszt operacji semaforów z utils.h
+// Budowany dwa razy (make bench): bench_semafory_sysv (semop) i bench_semafory_futex
+// (-DKOLEJ_SEM_FUTEX). Mierzy opuszczenie+podniesienie bez rywalizacji (z korektą
+// SEM_UNDO i bez), próbę opuszczenia oraz przekazanie między dwoma procesami (ping-pong).
+// Semafory tworzone w katalogu tymczasowym - klucz ftok różny od działającej symulacji.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "struktury.h"
+#include "utils.h"
+
+#define POWTORZENIA      1000000
+#define PING_PONG        100000
+
+#ifdef KOLEJ_SEM_FUTEX
+#define IMPLEMENTACJA "futex"
+#else
+#define IMPLEMENTACJA "sysv"
+#endif
+
+static long long teraz_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void wypisz(const char* nazwa, long long czas_ns, long long operacje) {
+    printf("%-8s %-34s %10.1f ns/op\n", IMPLEMENTACJA, nazwa, (double)czas_ns / operacje);
+}
+
+int main(void) {
+    char katalog[] = "/tmp/bench_semaforyXXXXXX";
+    char poprzedni[4096];
+    if (!getcwd(poprzedni, sizeof(poprzedni)) || !mkdtemp(katalog) || chdir(katalog) == -1) {
+        perror("Błąd katalogu tymczasowego");
+        return 1;
+    }
+
+    int sem_id = utworz_semafory();
+    long long start;
+
+    start = teraz_ns();
+    for (int i = 0; i < POWTORZENIA; i++) {
+        sem_opusc(sem_id, SEM_MAIN);
+        sem_podnies(sem_id, SEM_MAIN);
+    }
+    wypisz("opusc+podnies (SEM_UNDO)", teraz_ns() - start, POWTORZENIA);
+
+    start = teraz_ns();
+    for (int i = 0; i < POWTORZENIA; i++) {
+        sem_opusc_bez_undo(sem_id, SEM_MAIN);
+        sem_podnies_bez_undo(sem_id, SEM_MAIN);
+    }
+    wypisz("opusc+podnies bez undo", teraz_ns() - start, POWTORZENIA);
+
+    start = teraz_ns();
+    for (int i = 0; i < POWTORZENIA; i++) {
+        if (sem_probuj_opusc_bez_undo(sem_id, SEM_MAIN) == 1) {
+            sem_podnies_bez_undo(sem_id, SEM_MAIN);
+        }
+    }
+    wypisz("probuj_opusc+podnies", teraz_ns() - start, POWTORZENIA);
+
+    start = teraz_ns();
+    for (int i = 0; i < POWTORZENIA; i++) {
+        sem_opusc_timeout_bez_undo(sem_id, SEM_MAIN, SEM_WAIT_MS);
+        sem_podnies_bez_undo(sem_id, SEM_MAIN);
+    }
+    wypisz("opusc_timeout+podnies", teraz_ns() - start, POWTORZENIA);
+
+    // Ping-pong: dwa semafory o wartości 0, każda strona budzi drugą
+    sem_ustaw_wartosc(sem_id, SEM_WORKER_SYNC, 0);
+    sem_ustaw_wartosc(sem_id, SEM_POOL_ITEMS, 0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < PING_PONG; i++) {
+            sem_opusc_bez_undo(sem_id, SEM_WORKER_SYNC);
+            sem_podnies_bez_undo(sem_id, SEM_POOL_ITEMS);
+        }
+        _exit(0);
+    }
+    if (pid == -1) {
+        perror("Błąd fork");
+    } else {
+        start = teraz_ns();
+        for (int i = 0; i < PING_PONG; i++) {
+            sem_podnies_bez_undo(sem_id, SEM_WORKER_SYNC);
+            sem_opusc_bez_undo(sem_id, SEM_POOL_ITEMS);
+        }
+        wypisz("ping-pong miedzy procesami (runda)", teraz_ns() - start, PING_PONG);
+        waitpid(pid, NULL, 0);
+    }
+
+    usun_semafory(sem_id);
+    if (chdir(poprzedni) == -1 || rmdir(katalog) == -1) {
+        perror("Błąd sprzątania katalogu tymczasowego");
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+// bench_shm_uklad.c - rywalizacja o linie pamięci podręcznej w SharedMemory
+// Porównanie: układ wg linii (struktury.h) vs dawny układ, w którym flagi czytane przez
+// turystów sąsiadowały z licznikami zapisywanymi przez pracowników i kasjera.
+// Wątki czytające odpytują flagi stanu jak pętle turystów; wątki piszące zwiększają
+// po jednym liczniku z różnych domen semaforów (SEM_QUEUE, SEM_STATS, SEM_CHAIR_OPS).
+// Sam zapis jest atomowy - mierzony jest koszt przerzucania linii między rdzeniami.
+// Druga część: procesy piszące statystyki do jednej komórki vs każdy do własnego shardu.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "struktury.h"
+
+#define CZAS_POMIARU_NS  500000000LL
+#define CZYTAJACE        2
+
+// Rozmiary tablic dawnego układu (dziś za stałą częścią segmentu, z konfiguracji)
+#define MAX_TICKETS      20000
+#define MAX_GATE_ENTRIES 50000
+
+// Dawny układ pamięci dzielonej (przed wyrównaniem do linii)
+typedef struct {
+    // Stan systemu
+    bool is_running;
+    bool emergency_stop;
+    bool gates_closed;          // Tk osiągnięte - bramki zamknięte
+    bool cashier_open;          // Kasa otwarta (po WORK_START_TIME)
+    time_t simulation_start;
+    time_t simulation_end;
+    unsigned int state_seq;     // Licznik zmian stanu (słowo futex - stan_czekaj/stan_powiadom)
+    struct timespec sim_clock_origin; // Początek zegara symulacji (CLOCK_MONOTONIC)
+    long sim_second_ns;         // Skala czasu - ns rzeczywiste na sekundę symulacji
+    
+    // Statystyki sprzedaży
+    int tickets_sold[TICKET_TYPE_COUNT];
+    int total_revenue;
+    
+    // Statystyki przejazdów
+    int chair_departures;
+    int passengers_transported;
+    int cyclists_transported;
+    int pedestrians_transported;
+
+    // Pakowanie krzesełek (worker1)
+    int packing_policy;                         // PackingPolicy
+    int chair_occupancy[CHAIR_CAPACITY + 1];    // Odjazdy wg liczby osób na krzesełku
+    int platform_boarded;                       // Dorośli, którzy wsiedli z peronu
+    long long platform_wait_total_ms;           // Suma czekania na peronie (ms symulacji)
+    long long platform_wait_max_ms;
+    int packing_skips;                          // Wyprzedzenia czekających przez późniejszych
+    
+    // Kategorie specjalne
+    int vip_served;
+    int children_with_guardian;
+    int rejected_expired;       // Odrzuceni z wygasłym karnetem
+    
+    // Trasy
+    int trail_usage[TRAIL_COUNT];
+    
+    // Statystyki per bilet (liczba zjazdów)
+    int ticket_rides[MAX_TICKETS];  // ticket_rides[ticket_id] = liczba zjazdów
+    
+    // Rejestracja przejść przez bramki (id karnetu - godzina)
+    struct {
+        int ticket_id;
+        time_t entry_time;
+        int gate_number;
+    } gate_entries[MAX_GATE_ENTRIES];
+    int gate_entries_count;
+    
+    // Kolejki i liczniki
+    int tourists_in_station;    // Na dolnej stacji
+    int tourists_on_platform;   // Na peronie (dolna stacja)
+    int tourists_at_top;        // Na górnej stacji (czekający na wyjście/zjazd)
+    int active_chairs;          // Krzesełka w ruchu
+    int tourists_waiting_entry; // Czekający przed bramkami
+    int tourists_at_cashier;    // Czekający na bilet przy kasie
+    int tourists_descending;    // W trakcie zjazdu trasą
+    
+    // PIDy procesów
+    pid_t main_pid;
+    pid_t cashier_pid;
+    pid_t worker1_pid;
+    pid_t worker2_pid;
+    
+    // Flagi awaryjne
+    int emergency_initiator;    // 1 lub 2 (który pracownik)
+    bool worker1_ready;
+    bool worker2_ready;
+    
+    // Kolejny ID
+    int next_tourist_id;
+    int next_ticket_id;
+    int next_chair_id;
+    
+    // Liczniki do zakończenia
+    int total_tourists_created;
+    int total_tourists_finished;
+    
+    // Krzesełka
+    Chair chairs[MAX_CHAIRS];
+    
+    // rozmiar kolejki VIP
+    int vip_queue_size;
+
+    // Pierścień deskryptorów turystów (tryb puli) - SEM_POOL_*
+    TouristDescriptor tourist_ring[TOURIST_POOL_RING];
+    int tourist_ring_head;      // Indeks do odczytu (gospodarze)
+    int tourist_ring_tail;      // Indeks do zapisu (main)
+} StaraPamiec;
+
+typedef struct {
+    const char* nazwa;
+    const char* domena;
+    size_t stary;
+    size_t nowy;
+} Pole;
+
+#define POLE(pole, domena) {#pole, domena, offsetof(StaraPamiec, pole), offsetof(SharedMemory, pole)}
+#define POLE_SHARDU(pole, shard, domena) \
+    {#pole, domena, offsetof(StaraPamiec, pole), offsetof(SharedMemory, stat_shardy[shard].pole)}
+
+static const Pole pola[] = {
+    POLE(is_running, "flagi"),
+    POLE(gates_closed, "flagi"),
+    POLE(state_seq, "futex"),
+    POLE(tourists_on_platform, "oblozenie"),
+    POLE(tourists_at_top, "oblozenie"),
+    POLE(active_chairs, "krzeselka"),
+    POLE(chair_departures, "krzeselka"),
+    POLE_SHARDU(passengers_transported, STAT_SHARD_WORKER1, "shard worker1"),
+    POLE_SHARDU(total_revenue, STAT_SHARD_KASJER, "shard kasjera"),
+    POLE(next_ticket_id, "SEM_TICKETS"),
+};
+
+// Pola zapisywane przez wątki piszące (po jednym na domenę)
+static const char* zapisywane[] = {"tourists_on_platform", "passengers_transported", "active_chairs"};
+#define PISZACE (int)(sizeof(zapisywane) / sizeof(zapisywane[0]))
+
+typedef struct {
+    char* baza;
+    size_t przesuniecie[4];     // Czytające: is_running, gates_closed, state_seq; piszące: [0]
+    volatile int* stop;
+    long long operacje;
+} ArgWatku;
+
+static long long teraz_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void* watek_czytajacy(void* arg) {
+    ArgWatku* a = arg;
+    volatile bool* is_running = (volatile bool*)(a->baza + a->przesuniecie[0]);
+    volatile bool* gates_closed = (volatile bool*)(a->baza + a->przesuniecie[1]);
+    volatile unsigned int* seq = (volatile unsigned int*)(a->baza + a->przesuniecie[2]);
+    long long n = 0;
+    unsigned int suma = 0;
+    while (!*a->stop) {
+        for (int i = 0; i < 256; i++) {
+            suma += *is_running + *gates_closed + *seq;
+        }
+        n += 256;
+    }
+    a->operacje = n + (suma == 0xFFFFFFFFu);
+    return NULL;
+}
+
+static void* watek_piszacy(void* arg) {
+    ArgWatku* a = arg;
+    int* licznik = (int*)(a->baza + a->przesuniecie[0]);
+    long long n = 0;
+    while (!*a->stop) {
+        for (int i = 0; i < 256; i++) {
+            __atomic_add_fetch(licznik, 1, __ATOMIC_RELAXED);
+        }
+        n += 256;
+    }
+    a->operacje = n;
+    return NULL;
+}
+
+static size_t przesuniecie_pola(const char* nazwa, bool nowy) {
+    for (size_t i = 0; i < sizeof(pola) / sizeof(pola[0]); i++) {
+        if (strcmp(pola[i].nazwa, nazwa) == 0) return nowy ? pola[i].nowy : pola[i].stary;
+    }
+    return 0;
+}
+
+// Odczyty i zapisy na sekundę dla jednego układu
+static void zmierz(bool nowy, double* odczyty, double* zapisy) {
+    size_t rozmiar = nowy ? sizeof(SharedMemory) : sizeof(StaraPamiec);
+    char* baza = aligned_alloc(4096, (rozmiar + 4095) & ~(size_t)4095);
+    if (!baza) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    memset(baza, 0, rozmiar);
+    *(bool*)(baza + przesuniecie_pola("is_running", nowy)) = true;
+
+    volatile int stop = 0;
+    pthread_t watki[CZYTAJACE + PISZACE];
+    ArgWatku argumenty[CZYTAJACE + PISZACE];
+
+    for (int i = 0; i < CZYTAJACE + PISZACE; i++) {
+        ArgWatku* a = &argumenty[i];
+        memset(a, 0, sizeof(*a));
+        a->baza = baza;
+        a->stop = &stop;
+        if (i < CZYTAJACE) {
+            a->przesuniecie[0] = przesuniecie_pola("is_running", nowy);
+            a->przesuniecie[1] = przesuniecie_pola("gates_closed", nowy);
+            a->przesuniecie[2] = przesuniecie_pola("state_seq", nowy);
+            pthread_create(&watki[i], NULL, watek_czytajacy, a);
+        } else {
+            a->przesuniecie[0] = przesuniecie_pola(zapisywane[i - CZYTAJACE], nowy);
+            pthread_create(&watki[i], NULL, watek_piszacy, a);
+        }
+    }
+
+    long long start = teraz_ns();
+    struct timespec sen = {0, CZAS_POMIARU_NS};
+    nanosleep(&sen, NULL);
+    stop = 1;
+    long long czas = teraz_ns() - start;
+
+    long long r = 0, w = 0;
+    for (int i = 0; i < CZYTAJACE + PISZACE; i++) {
+        pthread_join(watki[i], NULL);
+        if (i < CZYTAJACE) r += argumenty[i].operacje;
+        else w += argumenty[i].operacje;
+    }
+    free(baza);
+
+    *odczyty = r * 1e9 / czas;
+    *zapisy = w * 1e9 / czas;
+}
+
+// Zapisy/s statystyki passengers_transported: wszyscy do jednej komórki albo
+// każdy piszący do własnego shardu (jak kasjer, pracownicy i gospodarze turystów)
+#define PISZACE_STAT 4
+
+static double zmierz_statystyki(bool shardy) {
+    static const int numery[PISZACE_STAT] = {
+        STAT_SHARD_KASJER, STAT_SHARD_WORKER1, STAT_SHARD_WORKER2, STAT_SHARD_TURYSCI
+    };
+    char* baza = aligned_alloc(4096, (sizeof(SharedMemory) + 4095) & ~(size_t)4095);
+    if (!baza) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    memset(baza, 0, sizeof(SharedMemory));
+
+    volatile int stop = 0;
+    pthread_t watki[PISZACE_STAT];
+    ArgWatku argumenty[PISZACE_STAT];
+    for (int i = 0; i < PISZACE_STAT; i++) {
+        ArgWatku* a = &argumenty[i];
+        memset(a, 0, sizeof(*a));
+        a->baza = baza;
+        a->stop = &stop;
+        int shard = shardy ? numery[i] : STAT_SHARD_WORKER1;
+        a->przesuniecie[0] = offsetof(SharedMemory, stat_shardy) + shard * sizeof(StatystykiShard) +
+                             offsetof(StatystykiShard, passengers_transported);
+        pthread_create(&watki[i], NULL, watek_piszacy, a);
+    }
+
+    long long start = teraz_ns();
+    struct timespec sen = {0, CZAS_POMIARU_NS};
+    nanosleep(&sen, NULL);
+    stop = 1;
+    long long czas = teraz_ns() - start;
+
+    long long w = 0;
+    for (int i = 0; i < PISZACE_STAT; i++) {
+        pthread_join(watki[i], NULL);
+        w += argumenty[i].operacje;
+    }
+    free(baza);
+    return w * 1e9 / czas;
+}
+
+int main(void) {
+    long rdzenie = sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("Uklad SharedMemory - linia pamieci podrecznej kazdego pola (%d B)\n", CACHE_LINE);
+    printf("%-24s %-14s %8s %8s\n", "pole", "domena", "dawny", "nowy");
+    for (size_t i = 0; i < sizeof(pola) / sizeof(pola[0]); i++) {
+        printf("%-24s %-14s %8zu %8zu\n", pola[i].nazwa, pola[i].domena,
+               pola[i].stary / CACHE_LINE, pola[i].nowy / CACHE_LINE);
+    }
+    printf("rozmiar: dawny %zu B, nowy %zu B\n\n", sizeof(StaraPamiec), sizeof(SharedMemory));
+
+    printf("Rywalizacja: %d watki czytajace flagi, %d piszace liczniki (rdzenie: %ld)\n",
+           CZYTAJACE, PISZACE, rdzenie);
+    if (rdzenie < 2) {
+        printf("UWAGA: jeden rdzen - watki nie dziela linii rownolegle, wynik nie pokazuje false sharing\n");
+    }
+    printf("%-8s %18s %18s\n", "uklad", "odczyty/s", "zapisy/s");
+
+    double r_stary, w_stary, r_nowy, w_nowy;
+    zmierz(false, &r_stary, &w_stary);
+    zmierz(true, &r_nowy, &w_nowy);
+    printf("%-8s %18.0f %18.0f\n", "dawny", r_stary, w_stary);
+    printf("%-8s %18.0f %18.0f\n", "nowy", r_nowy, w_nowy);
+    printf("%-8s %17.2fx %17.2fx\n", "zysk", r_nowy / r_stary, w_nowy / w_stary);
+
+    printf("\nStatystyki: %d piszacych (kasjer, worker1, worker2, gospodarz) - jedna komorka vs shardy\n",
+           PISZACE_STAT);
+    double w_wspolna = zmierz_statystyki(false);
+    double w_shardy = zmierz_statystyki(true);
+    printf("%-8s %18.0f\n", "wspolna", w_wspolna);
+    printf("%-8s %18.0f\n", "shardy", w_shardy);
+    printf("%-8s %17.2fx\n", "zysk", w_shardy / w_wspolna);
+    return 0;
+}
@@ -0,0 +1,287 @@
+// bench_symulacja.c - przebiegi całej symulacji dla macierzy parametrów (make bench-sim)
+// Każdy argument to plik konfiguracji wariantu (./kolej -c, np. TOTAL_TOURISTS,
+// STATION_CAPACITY, MAX_ACTIVE_CHAIRS, SIM_SECOND_NS) - wszystkie warianty korzystają
+// z jednej kompilacji w katalogu -d (LOG_ENABLED 0). Tam uruchamiany jest ./kolej -c plik
+// bez wyjścia na terminal, ze stałym ziarnem (KOLEJ_SEED) i plikiem metryk
+// (KOLEJ_METRYKI). Czas CPU i szczytowe RSS pochodzą z wait4: CPU to suma procesu
+// głównego i odebranych przez niego potomków - bez kolektora logów, który po podwójnym
+// forku nie jest potomkiem ./kolej (przy LOG_ENABLED 0 prawie bezczynny); RSS to
+// maksimum pojedynczego procesu, nie suma drzewa.
+// Wyniki (mediana z -n powtórzeń) trafiają do CSV; gdy istnieje plik bazy w tym samym
+// formacie, każdy wariant jest porównany z wierszem bazy o tej samej nazwie.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "metryki.h"
+
+#define MAX_WARIANTOW   64
+#define MAX_POWTORZEN   15
+#define PLIK_METRYK     "metryki_bench.txt"
+
+typedef struct {
+    char nazwa[64];
+    int turysci;
+    int stacja;
+    int krzeselka;
+    double w[LICZBA_KOLUMN];
+} Wynik;
+
+// Jeden przebieg ./kolej -c konfiguracja w katalogu programów
+static int uruchom(const char* katalog, const char* konfiguracja, const char* ziarno, Wynik* wynik) {
+    char sciezka[512];
+    snprintf(sciezka, sizeof(sciezka), "%s/%s", katalog, PLIK_METRYK);
+    unlink(sciezka);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        if (chdir(katalog) != 0) {
+            perror("chdir");
+            _exit(127);
+        }
+        setenv("KOLEJ_SEED", ziarno, 1);
+        setenv("KOLEJ_METRYKI", PLIK_METRYK, 1);
+        int nic = open("/dev/null", O_WRONLY);
+        if (nic >= 0) {
+            dup2(nic, STDOUT_FILENO);
+            dup2(nic, STDERR_FILENO);
+            close(nic);
+        }
+        execl("./kolej", "kolej", "-c", konfiguracja, (char*)NULL);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) {
+        perror("wait4");
+        return -1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s: ./kolej zakończony niepowodzeniem (status %d)\n", konfiguracja, status);
+        return -1;
+    }
+    ParametryPrzebiegu p = {0, 0, 0};
+    if (metryki_wczytaj(sciezka, wynik->w, &p) != 0) {
+        fprintf(stderr, "%s: brak metryk w %s\n", konfiguracja, sciezka);
+        return -1;
+    }
+
+    wynik->turysci = p.turysci;
+    wynik->stacja = p.stacja;
+    wynik->krzeselka = p.krzeselka;
+    metryki_zuzycie(wynik->w, &ru);
+    return 0;
+}
+
+static int porownaj_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Mediana każdej kolumny z powtórzeń (konfiguracja z pierwszego przebiegu)
+static void mediana(Wynik* przebiegi, int n, Wynik* wynik) {
+    *wynik = przebiegi[0];
+    for (int k = 0; k < LICZBA_KOLUMN; k++) {
+        double v[MAX_POWTORZEN];
+        for (int i = 0; i < n; i++) v[i] = przebiegi[i].w[k];
+        qsort(v, n, sizeof(double), porownaj_double);
+        wynik->w[k] = (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+    }
+}
+
+static int zapisz_csv(const char* plik, const Wynik* wyniki, int n) {
+    FILE* f = fopen(plik, "w");
+    if (f == NULL) {
+        perror(plik);
+        return -1;
+    }
+    fprintf(f, "wariant,turysci,stacja,krzeselka");
+    for (int k = 0; k < LICZBA_KOLUMN; k++) fprintf(f, ",%s", KOLUMNY[k]);
+    fprintf(f, "\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "%s,%d,%d,%d", wyniki[i].nazwa, wyniki[i].turysci, wyniki[i].stacja,
+                wyniki[i].krzeselka);
+        for (int k = 0; k < LICZBA_KOLUMN; k++) fprintf(f, ",%.3f", wyniki[i].w[k]);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return 0;
+}
+
+// Baza w formacie zapisz_csv - kolumny dopasowane po nagłówku (brakujące = nieznane)
+static int wczytaj_csv(const char* plik, Wynik* wyniki, bool znane[][LICZBA_KOLUMN]) {
+    FILE* f = fopen(plik, "r");
+    if (f == NULL) return -1;
+
+    char linia[1024];
+    int mapa[LICZBA_KOLUMN + 8];
+    int pola = 0, n = 0;
+
+    if (fgets(linia, sizeof(linia), f) != NULL) {
+        for (char* pole = strtok(linia, ",\n"); pole != NULL && pola < LICZBA_KOLUMN + 8;
+             pole = strtok(NULL, ",\n")) {
+            mapa[pola] = -1;
+            for (int k = 0; k < LICZBA_KOLUMN; k++) {
+                if (strcmp(pole, KOLUMNY[k]) == 0) mapa[pola] = k;
+            }
+            pola++;
+        }
+    }
+    while (n < MAX_WARIANTOW && fgets(linia, sizeof(linia), f) != NULL) {
+        memset(&wyniki[n], 0, sizeof(Wynik));
+        memset(znane[n], 0, sizeof(znane[n]));
+        int i = 0;
+        for (char* pole = strtok(linia, ",\n"); pole != NULL && i < pola;
+             pole = strtok(NULL, ",\n"), i++) {
+            if (i == 0) snprintf(wyniki[n].nazwa, sizeof(wyniki[n].nazwa), "%s", pole);
+            else if (mapa[i] >= 0) {
+                wyniki[n].w[mapa[i]] = strtod(pole, NULL);
+                znane[n][mapa[i]] = true;
+            }
+        }
+        if (i > 0) n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static void wypisz_tabele(const Wynik* wyniki, int n) {
+    printf("%-20s", "wariant");
+    for (int k = 0; k < LICZBA_KOLUMN; k++) printf(" %9s", SKROTY[k]);
+    printf("\n");
+    for (int i = 0; i < n; i++) {
+        printf("%-20s", wyniki[i].nazwa);
+        for (int k = 0; k < LICZBA_KOLUMN; k++) printf(" %9.1f", wyniki[i].w[k]);
+        printf("\n");
+    }
+}
+
+// Zmiana względem bazy w % ("*" - pogorszenie ponad prog_proc)
+static void wypisz_porownanie(const Wynik* wyniki, int n, const char* plik, double prog_proc) {
+    static Wynik baza[MAX_WARIANTOW];
+    static bool znane[MAX_WARIANTOW][LICZBA_KOLUMN];
+    int nb = wczytaj_csv(plik, baza, znane);
+    if (nb < 0) {
+        printf("\nBrak bazy %s (make bench-sim-baza zapisuje bieżące wyniki jako bazę)\n", plik);
+        return;
+    }
+
+    printf("\nPorównanie z bazą %s (zmiana %%, * - pogorszenie > %.0f%%):\n", plik, prog_proc);
+    printf("%-20s", "wariant");
+    for (int k = 0; k < LICZBA_KOLUMN; k++) printf(" %9s", SKROTY[k]);
+    printf("\n");
+    for (int i = 0; i < n; i++) {
+        int j = 0;
+        while (j < nb && strcmp(baza[j].nazwa, wyniki[i].nazwa) != 0) j++;
+        printf("%-20s", wyniki[i].nazwa);
+        if (j == nb) {
+            printf(" (brak w bazie)\n");
+            continue;
+        }
+        for (int k = 0; k < LICZBA_KOLUMN; k++) {
+            if (!znane[j][k] || baza[j].w[k] == 0) {
+                printf(" %9s", "-");
+                continue;
+            }
+            double zmiana = (wyniki[i].w[k] - baza[j].w[k]) / baza[j].w[k] * 100.0;
+            bool gorzej = WIECEJ_LEPIEJ[k] ? zmiana < -prog_proc : zmiana > prog_proc;
+            printf(" %+8.1f%s", zmiana, gorzej ? "*" : " ");
+        }
+        printf("\n");
+    }
+}
+
+static void uzycie(const char* prog) {
+    fprintf(stderr, "Użycie: %s [-d katalog_programów] [-s ziarno] [-n powtórzeń] [-o wyniki.csv] "
+                    "[-b baza.csv] [-p próg %%] konfiguracja_wariantu...\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    const char* katalog = ".";
+    const char* ziarno = "12345";
+    const char* plik_wynikow = NULL;
+    const char* plik_bazy = NULL;
+    int powtorzen = 1;
+    double prog_proc = 5.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:s:n:o:b:p:")) != -1) {
+        switch (opt) {
+            case 'd': katalog = optarg; break;
+            case 's': ziarno = optarg; break;
+            case 'n': powtorzen = atoi(optarg); break;
+            case 'o': plik_wynikow = optarg; break;
+            case 'b': plik_bazy = optarg; break;
+            case 'p': prog_proc = atof(optarg); break;
+            default: uzycie(argv[0]); return 2;
+        }
+    }
+    int warianty = argc - optind;
+    if (warianty <= 0 || warianty > MAX_WARIANTOW || powtorzen < 1 || powtorzen > MAX_POWTORZEN) {
+        uzycie(argv[0]);
+        return 2;
+    }
+
+    printf("Symulacja: %d wariantów x %d powtórzeń, ziarno %s\n", warianty, powtorzen, ziarno);
+    fflush(stdout);
+
+    static Wynik wyniki[MAX_WARIANTOW];
+    int gotowe = 0;
+    int bledy = 0;
+    for (int i = 0; i < warianty; i++) {
+        // ./kolej działa w katalogu programów - ścieżka konfiguracji bezwzględna
+        char konfiguracja[PATH_MAX];
+        if (realpath(argv[optind + i], konfiguracja) == NULL) {
+            perror(argv[optind + i]);
+            bledy++;
+            continue;
+        }
+        Wynik przebiegi[MAX_POWTORZEN];
+        memset(przebiegi, 0, sizeof(przebiegi));
+
+        int udane = 0;
+        for (int p = 0; p < powtorzen; p++) {
+            if (uruchom(katalog, konfiguracja, ziarno, &przebiegi[udane]) == 0) udane++;
+        }
+        if (udane == 0) {
+            bledy++;
+            continue;
+        }
+        mediana(przebiegi, udane, &wyniki[gotowe]);
+
+        // Nazwa wariantu - nazwa pliku bez rozszerzenia
+        char kopia[PATH_MAX];
+        snprintf(kopia, sizeof(kopia), "%s", argv[optind + i]);
+        char* nazwa = basename(kopia);
+        char* kropka = strrchr(nazwa, '.');
+        if (kropka != NULL && kropka != nazwa) *kropka = '\0';
+        snprintf(wyniki[gotowe].nazwa, sizeof(wyniki[gotowe].nazwa), "%s", nazwa);
+        printf("  %s: %.0f turystów/s, %.2f s CPU\n", wyniki[gotowe].nazwa,
+                wyniki[gotowe].w[K_TURYSCI_NA_S], wyniki[gotowe].w[K_CPU_S]);
+        fflush(stdout);
+        gotowe++;
+    }
+
+    printf("\n");
+    wypisz_tabele(wyniki, gotowe);
+    metryki_legenda(stdout);
+
+    if (plik_wynikow != NULL && zapisz_csv(plik_wynikow, wyniki, gotowe) == 0) {
+        printf("\nWyniki zapisane do: %s\n", plik_wynikow);
+    }
+    if (plik_bazy != NULL) wypisz_porownanie(wyniki, gotowe, plik_bazy, prog_proc);
+
+    return bledy > 0 ? 1 : 0;
+}
@@ -7,10 +7,13 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
-#include <sys/msg.h>
 #include "struktury.h"
 #include "utils.h"
 #include "logger.h"
+#include "zdarzenia.h"
+#include "kolejka_kasy.h"
+#include "kanaly.h"
+#include "skrzynki.h"
 
 // Flagi sygnałów
 static volatile sig_atomic_t shutdown_flag = 0;
@@ -27,63 +30,41 @@ void cashier_signal_handler(int sig) {
     }
 }
 
-// Struktura turysty w kolejce
-typedef struct {
-    pid_t pid;
-    int tourist_id;
-    int age;
-    TouristType type;
-    bool is_vip;
-    int children_count;
-    int child_ids[2];
-    TicketType ticket_type;
-} QueuedTourist;
-
-// Kolejka priorytetowa (VIP na początku)
-#define MAX_QUEUE 15000
-static QueuedTourist normal_queue[MAX_QUEUE];
-static int normal_queue_size = 0;
-static QueuedTourist vip_queue[MAX_QUEUE];
-static int vip_queue_size = 0;
+// Kolejka priorytetowa (VIP na początku) - bufory cykliczne O(1)
+static KolejkaKasy kolejka;
 
 // Dodawanie do kolejki - zwraca true jeśli dodano, false jeśli kolejka pełna
 bool add_to_queue(QueuedTourist* tourist) {
-    if (tourist->is_vip) {
-        if (vip_queue_size < MAX_QUEUE) {
-            vip_queue[vip_queue_size++] = *tourist;
-            return true;
-        }
-    } else {
-        if (normal_queue_size < MAX_QUEUE) {
-            normal_queue[normal_queue_size++] = *tourist;
-            return true;
-        }
-    }
-    return false;
+    return kolejka_kasy_dodaj(&kolejka, tourist);
 }
 
 // Pobieranie z kolejki (VIP ma priorytet)
 bool get_from_queue(QueuedTourist* tourist) {
-    if (vip_queue_size > 0) {
-        *tourist = vip_queue[0];
-        // Przesunięcie kolejki
-        for (int i = 0; i < vip_queue_size - 1; i++) {
-            vip_queue[i] = vip_queue[i + 1];
-        }
-        vip_queue_size--;
-        return true;
-    }
-    
-    if (normal_queue_size > 0) {
-        *tourist = normal_queue[0];
-        for (int i = 0; i < normal_queue_size - 1; i++) {
-            normal_queue[i] = normal_queue[i + 1];
-        }
-        normal_queue_size--;
-        return true;
-    }
-    
-    return false;
+    return kolejka_kasy_pobierz(&kolejka, tourist);
+}
+
+// Odpowiedź kasjera - ticket_id = -1 oznacza odmowę
+static void wyslij_odpowiedz(int reply_box, int tourist_id, int ticket_id, TicketType ticket_type) {
+    Komunikat response;
+    response.typ = MSG_CASHIER_TO_TOURIST;
+    response.reply_box = reply_box;
+    response.tourist_id = tourist_id;
+    response.u.bilet.ticket_id = ticket_id;
+    response.u.bilet.ticket_type = ticket_type;
+    skrzynka_wyslij(reply_box, &response);
+}
+
+// Żądanie biletu z kanału -> wpis kolejki kasy
+static void do_kolejki(const Komunikat* msg, QueuedTourist* qt) {
+    qt->reply_box = msg->reply_box;
+    qt->tourist_id = msg->tourist_id;
+    qt->age = msg->u.zadanie.age;
+    qt->type = (TouristType)msg->u.zadanie.tourist_type;
+    qt->is_vip = msg->u.zadanie.is_vip;
+    qt->children_count = msg->u.zadanie.children_count;
+    qt->child_ages[0] = msg->u.zadanie.child_ages[0];
+    qt->child_ages[1] = msg->u.zadanie.child_ages[1];
+    qt->ticket_type = (TicketType)msg->u.zadanie.ticket_type;
 }
 
 int main(void) {
@@ -100,28 +81,20 @@ int main(void) {
     sigaction(SIGUSR2, &sa, NULL);
     
     // Połączenie z zasobami IPC
-    int msg_id = polacz_kolejke();
     int sem_id = polacz_semafory();
     int shm_id = polacz_pamiec();
     SharedMemory* shm = dolacz_pamiec(shm_id);
+    StatystykiShard* shard = statystyki_shard(shm, STAT_SHARD_KASJER);
+    kanaly_dolacz(shm);
+    skrzynki_dolacz();
     
-    srand(time(NULL) ^ getpid());
-    
-    // Pobranie czasu rozpoczęcia symulacji
-    sem_opusc(sem_id, SEM_MAIN);
-    time_t sim_start = shm->simulation_start;
-    sem_podnies(sem_id, SEM_MAIN);
+    kolejka_kasy_init(&kolejka);
     
     // Opóźnienie rozpoczęcia pracy kasjera o WORK_START_TIME sekund
     logger(LOG_CASHIER, "Czekam %d sekund przed rozpoczęciem pracy...", WORK_START_TIME);
     
-    while (!shutdown_flag) {
-        time_t now = time(NULL);
-        time_t elapsed = now - sim_start;
-        
-        if (elapsed >= WORK_START_TIME) {
-            break;
-        }
+    // Blokujący sen do czasu Tp na zegarze symulacji (SIGTERM przerywa sen)
+    while (!shutdown_flag && zegar_uspij_do(shm, WORK_START_TIME * 1000LL) != 0) {
     }
     
     if (shutdown_flag) {
@@ -134,17 +107,21 @@ int main(void) {
     sem_opusc(sem_id, SEM_MAIN);
     shm->cashier_open = true;
     sem_podnies(sem_id, SEM_MAIN);
+    stan_powiadom(shm);
     
     logger(LOG_CASHIER, "Rozpoczynam pracę - kasa otwarta!");
     
-    Message msg;
+    Komunikat msg;
     
     while (!shutdown_flag) {
+        unsigned int seq = stan_odczytaj(shm);
+
         // Sprawdzenie awarii
         if (emergency_flag) {
             logger(LOG_CASHIER, "AWARIA - wstrzymuję sprzedaż biletów!");
             while (emergency_flag && !shutdown_flag) {
-                // Aktywne czekanie na wznowienie
+                // Blokujące czekanie na wznowienie (SIGUSR2 przerywa czekanie)
+                stan_czekaj(shm, stan_odczytaj(shm), SEM_WAIT_MS);
             }
             if (!shutdown_flag) {
                 logger(LOG_CASHIER, "Wznawiam sprzedaż biletów");
@@ -159,110 +136,70 @@ int main(void) {
         
         // Gdy bramki zamknięte - opróżnienie kolejek i odrzucenie wszystkich czekających
         if (gates_closed) {
-            // Opróżnij kolejkę VIP komunikatów
-            while (odbierz_komunikat(msg_id, &msg, MSG_VIP_PRIORITY + MSG_TOURIST_TO_CASHIER, false)) {
-                // Wysłanie odmowy
-                Message response;
-                response.mtype = msg.sender_pid;
-                response.sender_pid = getpid();
-                response.tourist_id = msg.tourist_id;
-                response.data = -1; // Odmowa
-                response.data2 = -1;
-                wyslij_komunikat(msg_id, &response);
+            // Opróżnij kanał VIP
+            while (kanal_odbierz(KANAL_KASA_VIP, &msg)) {
+                wyslij_odpowiedz(msg.reply_box, msg.tourist_id, -1, 0); // Odmowa
                 logger(LOG_CASHIER, "Bramki zamknięte - odmowa dla VIP #%d", msg.tourist_id);
             }
 
-            // Opróżnij kolejkę zwykłych komunikatów
-            while (odbierz_komunikat(msg_id, &msg, MSG_TOURIST_TO_CASHIER, false)) {
-                Message response;
-                response.mtype = msg.sender_pid;
-                response.sender_pid = getpid();
-                response.tourist_id = msg.tourist_id;
-                response.data = -1;
-                response.data2 = -1;
-                wyslij_komunikat(msg_id, &response);
+            // Opróżnij kanał zwykłych turystów
+            while (kanal_odbierz(KANAL_KASA, &msg)) {
+                wyslij_odpowiedz(msg.reply_box, msg.tourist_id, -1, 0);
                 logger(LOG_CASHIER, "Bramki zamknięte - odmowa dla turysty #%d", msg.tourist_id);
             }
             
             // Opróżnij wewnętrzną kolejkę - odrzuć tych co czekają
             QueuedTourist qt;
             while (get_from_queue(&qt)) {
-                Message response;
-                response.mtype = qt.pid;
-                response.sender_pid = getpid();
-                response.tourist_id = qt.tourist_id;
-                response.data = -1;
-                response.data2 = -1;
-                wyslij_komunikat(msg_id, &response);
+                wyslij_odpowiedz(qt.reply_box, qt.tourist_id, -1, 0);
                 logger(LOG_CASHIER, "Bramki zamknięte - odmowa dla turysty #%d (z kolejki wewnętrznej)", qt.tourist_id);
             }
             
-            // Aktywne czekanie gdy bramki zamknięte
+            // Sen gdy bramki zamknięte - do spóźnionego komunikatu lub SIGTERM
+            kanaly_czekaj(ODBIORCA_KASJER, seq, SEM_WAIT_MS);
             continue;
         }
         
         // Odbieranie komunikatów od turystów chcących kupić bilet
-        // Najpierw VIP (mtype = MSG_VIP_PRIORITY + MSG_TOURIST_TO_CASHIER)
-        while (odbierz_komunikat(msg_id, &msg, MSG_VIP_PRIORITY + MSG_TOURIST_TO_CASHIER, false)) {
+        // Najpierw VIP (osobny kanał KANAL_KASA_VIP)
+        while (kanal_odbierz(KANAL_KASA_VIP, &msg)) {
             if (shutdown_flag || gates_closed) break;
             
             QueuedTourist qt;
-            qt.pid = msg.sender_pid;
-            qt.tourist_id = msg.tourist_id;
-            qt.age = msg.age;
-            qt.type = msg.tourist_type;
-            qt.is_vip = true;
-            qt.children_count = msg.children_count;
-            qt.child_ids[0] = msg.child_ids[0];
-            qt.child_ids[1] = msg.child_ids[1];
-            qt.ticket_type = msg.ticket_type;
+            do_kolejki(&msg, &qt);
             
             if (add_to_queue(&qt)) {
                 logger(LOG_VIP, "VIP #%d dołączył do kolejki priorytetowej!", qt.tourist_id);
             } else {
                 // Kolejka pełna - wyślij odmowę
-                Message response;
-                response.mtype = qt.pid;
-                response.sender_pid = getpid();
-                response.tourist_id = qt.tourist_id;
-                response.data = -1;
-                response.data2 = -1;
-                wyslij_komunikat(msg_id, &response);
+                wyslij_odpowiedz(qt.reply_box, qt.tourist_id, -1, 0);
                 logger(LOG_CASHIER, "Kolejka pełna - odmowa dla VIP #%d", qt.tourist_id);
             }
         }
 
         // zwykli turyści
-        while (odbierz_komunikat(msg_id, &msg, MSG_TOURIST_TO_CASHIER, false)) {
+        while (kanal_odbierz(KANAL_KASA, &msg)) {
             if (shutdown_flag || gates_closed) break;
 
             QueuedTourist qt;
-            qt.pid = msg.sender_pid;
-            qt.tourist_id = msg.tourist_id;
-            qt.age = msg.age;
-            qt.type = msg.tourist_type;
-            qt.is_vip = false;
-            qt.children_count = msg.children_count;
-            qt.child_ids[0] = msg.child_ids[0];
-            qt.child_ids[1] = msg.child_ids[1];
-            qt.ticket_type = msg.ticket_type;
+            do_kolejki(&msg, &qt);
 
             if (!add_to_queue(&qt)) {
                 // Kolejka pełna - wyślij odmowę
-                Message response;
-                response.mtype = qt.pid;
-                response.sender_pid = getpid();
-                response.tourist_id = qt.tourist_id;
-                response.data = -1;
-                response.data2 = -1;
-                wyslij_komunikat(msg_id, &response);
+                wyslij_odpowiedz(qt.reply_box, qt.tourist_id, -1, 0);
                 logger(LOG_CASHIER, "Kolejka pełna - odmowa dla turysty #%d", qt.tourist_id);
             }
         }
         
-        // Obsługa klientów z kolejki
+        // Brak klientów - sen do komunikatu w kanale kasy lub zmiany stanu
+        if (kolejka_kasy_rozmiar(&kolejka) == 0) {
+            kanaly_czekaj(ODBIORCA_KASJER, seq, SEM_WAIT_MS);
+            continue;
+        }
+
+        // Obsługa klientów z kolejki (flagi przed pobraniem - awaria nie gubi klienta)
         QueuedTourist tourist;
-        while (get_from_queue(&tourist) && !shutdown_flag && !emergency_flag) {
+        while (!shutdown_flag && !emergency_flag && get_from_queue(&tourist)) {
             // Typ biletu z żądania turysty
             TicketType ticket_type = tourist.ticket_type;
             
@@ -275,36 +212,26 @@ int main(void) {
             int ticket_id = ++shm->next_ticket_id;
             sem_podnies(sem_id, SEM_TICKETS);
 
-            // Aktualizacja statystyk sprzedaży (SEM_STATS)
-            sem_opusc(sem_id, SEM_STATS);
-            shm->tickets_sold[ticket_type]++;
-            shm->total_revenue += price;
-
+            // Aktualizacja statystyk sprzedaży (shard kasjera, jedna sekcja migawki)
+            int sprzedane = 1 + tourist.children_count;
+            int przychod = price + tourist.children_count * cena_biletu(ticket_type, true); // zniżka dla dziecka
+            statystyki_zapis_start(shard);
+            licznik_dodaj(shard->tickets_sold[ticket_type], sprzedane);
+            licznik_dodaj(shard->total_revenue, przychod);
             if (tourist.is_vip) {
-                shm->vip_served++;
+                licznik_dodaj(shard->vip_served, 1);
             }
-
             // Dzieci z opiekunem
             if (tourist.children_count > 0) {
-                shm->children_with_guardian += tourist.children_count;
-                for (int i = 0; i < tourist.children_count; i++) {
-                    shm->tickets_sold[ticket_type]++;
-                    int child_price = cena_biletu(ticket_type, true); // zniżka dla dziecka
-                    shm->total_revenue += child_price;
-                }
+                licznik_dodaj(shard->children_with_guardian, tourist.children_count);
             }
-            sem_podnies(sem_id, SEM_STATS);
+            statystyki_zapis_koniec(shard);
             
-            // Wysłanie potwierdzenia do turysty
-            Message response;
-            response.mtype = tourist.pid; // Adresowanie do konkretnego turysty
-            response.sender_pid = getpid();
-            response.tourist_id = tourist.tourist_id;
-            response.data = ticket_id;
-            response.data2 = ticket_type;
+            // Wysłanie potwierdzenia do skrzynki turysty
+            wyslij_odpowiedz(tourist.reply_box, tourist.tourist_id, ticket_id, ticket_type);
 
-            // Wysłanie potwierdzenia do turysty
-            wyslij_komunikat(msg_id, &response);
+            zapisz_zdarzenie(ZD_BILET_SPRZEDANY, ticket_type, tourist.tourist_id, ticket_id,
+                      price, tourist.children_count);
 
             if (!shutdown_flag) {
                 const char* ticket_name = nazwa_biletu(ticket_type);
@@ -0,0 +1,150 @@
+// generator_sladu.c - generator śladów przybyć turystów (kolej-slad)
+// Użycie: ./kolej-slad [-r poisson|szczyt|paczki] [-l przybyć/s] [-p od-do] [-g grupa]
+//                      [-n turystów] [-s ziarno] plik.csv|plik.bin
+//   -r  proces przybyć (domyślnie poisson):
+//       poisson - jednorodny proces Poissona o intensywności -l
+//       szczyt  - niejednorodny (przerzedzanie): poranny szczyt do 4x -l w 25% okna,
+//                 popołudniowy spadek do 0.2x -l w 70% okna
+//       paczki  - grupy (autokary, rodziny) przybywające procesem Poissona -l / -g,
+//                 liczność geometryczna o średniej -g, członkowie w odstępach do 50 ms
+//   -l  średnia intensywność (przybyć na sekundę symulacji, domyślnie 50)
+//   -p  okno przybyć w sekundach symulacji (domyślnie 0-WORK_END_TIME)
+//   -g  średnia liczność grupy dla -r paczki (domyślnie 8)
+//   -n  maks. liczba turystów (domyślnie TOTAL_TOURISTS)
+//   -s  ziarno - parametry turystów jak w symulacji z tym ziarnem (przybycie_losuj)
+// Format pliku wg rozszerzenia (harmonogram.h); ./kolej -r plik odtwarza ślad.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "struktury.h"
+#include "utils.h"
+#include "harmonogram.h"
+
+typedef enum {
+    PROCES_POISSON = 0,
+    PROCES_SZCZYT,
+    PROCES_PACZKI
+} ProcesPrzybyc;
+
+// Liczba z (0, 1) ze strumienia generatora
+static double jednostajna(StrumienLosowy* los) {
+    return (strumien_losuj(los) + 0.5) / 4294967296.0;
+}
+
+static double wykladnicza(StrumienLosowy* los, double intensywnosc) {
+    return -log(jednostajna(los)) / intensywnosc;
+}
+
+// Profil dnia dla -r szczyt (x - pozycja w oknie 0..1), wartości ok. 0.2-4
+#define SZCZYT_MAKS 4.0
+static double profil_dnia(double x) {
+    double rano = (x - 0.25) / 0.08;
+    double popoludnie = (x - 0.70) / 0.10;
+    double m = 1.0 + 3.0 * exp(-rano * rano) - 0.8 * exp(-popoludnie * popoludnie);
+    return m < 0.05 ? 0.05 : m;
+}
+
+static void uzycie(const char* prog) {
+    fprintf(stderr, "Użycie: %s [-r poisson|szczyt|paczki] [-l przybyć/s] [-p od-do] [-g grupa] "
+                    "[-n turystów] [-s ziarno] plik.csv|plik.bin\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    ProcesPrzybyc proces = PROCES_POISSON;
+    double intensywnosc = 50.0;
+    double od_s = 0, do_s = WORK_END_TIME;
+    double grupa = 8.0;
+    int limit = TOTAL_TOURISTS;
+    unsigned long long ziarno = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:l:p:g:n:s:")) != -1) {
+        switch (opt) {
+            case 'r':
+                if (strcmp(optarg, "poisson") == 0) proces = PROCES_POISSON;
+                else if (strcmp(optarg, "szczyt") == 0) proces = PROCES_SZCZYT;
+                else if (strcmp(optarg, "paczki") == 0) proces = PROCES_PACZKI;
+                else { uzycie(argv[0]); return 2; }
+                break;
+            case 'l': intensywnosc = atof(optarg); break;
+            case 'p':
+                if (sscanf(optarg, "%lf-%lf", &od_s, &do_s) != 2) { uzycie(argv[0]); return 2; }
+                break;
+            case 'g': grupa = atof(optarg); break;
+            case 'n': limit = atoi(optarg); break;
+            case 's': ziarno = strtoull(optarg, NULL, 10); break;
+            default: uzycie(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 1 || intensywnosc <= 0 || do_s <= od_s || grupa < 1 || limit <= 0) {
+        uzycie(argv[0]);
+        return 2;
+    }
+
+    ZapisSladu zapis;
+    if (slad_utworz(argv[optind], ziarno, &zapis) != 0) return 1;
+
+    StrumienLosowy los;
+    strumien_init(&los, ziarno, STRUMIEN_GENERATOR, proces);
+
+    // Histogram przybyć na sekundę - podsumowanie szczytu
+    int sekundy = (int)ceil(do_s - od_s);
+    int* na_sekunde = calloc(sekundy, sizeof(int));
+    if (na_sekunde == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    int liczba = 0;
+    double ostatni = od_s;
+    int w_grupie = 0;           // Pozostali członkowie bieżącej grupy (paczki)
+    double t_grupy = od_s;      // Przybycie ostatniej grupy - proces grup niezależny od członków
+    double t = od_s;
+    while (liczba < limit) {
+        if (proces == PROCES_PACZKI && w_grupie > 0) {
+            t += jednostajna(&los) * 0.05;
+            w_grupie--;
+        } else if (proces == PROCES_SZCZYT) {
+            // Przerzedzanie (Lewis-Shedler): kandydaci z intensywnością maksymalną
+            do {
+                t += wykladnicza(&los, intensywnosc * SZCZYT_MAKS);
+            } while (t < do_s &&
+                     jednostajna(&los) * SZCZYT_MAKS > profil_dnia((t - od_s) / (do_s - od_s)));
+        } else if (proces == PROCES_PACZKI) {
+            // Ślad musi być uporządkowany - grupa nie wyprzedza członków poprzedniej
+            t_grupy += wykladnicza(&los, intensywnosc / grupa);
+            if (t_grupy > t) t = t_grupy;
+            // Liczność geometryczna o średniej grupa (1 + reszta członków)
+            w_grupie = (int)floor(log(jednostajna(&los)) / log(1.0 - 1.0 / grupa));
+        } else {
+            t += wykladnicza(&los, intensywnosc);
+        }
+        if (t >= do_s) break;
+
+        Przybycie p;
+        p.czas_ms = (long long)(t * 1000.0);
+        przybycie_losuj(ziarno, liczba + 1, &p.d);
+        slad_dopisz(&zapis, &p);
+        na_sekunde[(int)(t - od_s)]++;
+        liczba++;
+        ostatni = t;
+    }
+    slad_zamknij(&zapis);
+
+    int maks = 0, maks_s = 0;
+    for (int i = 0; i < sekundy; i++) {
+        if (na_sekunde[i] > maks) {
+            maks = na_sekunde[i];
+            maks_s = i;
+        }
+    }
+    free(na_sekunde);
+
+    double czas = ostatni > od_s ? ostatni - od_s : 1.0;
+    printf("Ślad %s: %d przybyć w %.1f-%.1f s (średnio %.1f/s, szczyt %d/s w %.0f s), ziarno %llu\n",
+           argv[optind], liczba, od_s, ostatni, liczba / czas, maks, od_s + maks_s, ziarno);
+    return 0;
+}
@@ -0,0 +1,251 @@
+// harmonogram.c - parametry przybywających turystów i plik śladu przybyć
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "struktury.h"
+#include "utils.h"
+#include "harmonogram.h"
+
+void przybycie_losuj(unsigned long long ziarno, int tourist_id, TouristDescriptor* d) {
+    StrumienLosowy los;
+    strumien_init(&los, ziarno, STRUMIEN_PRZYBYCIE, tourist_id);
+
+    d->tourist_id = tourist_id;
+
+    int age_roll = strumien_zakres(&los, 100);
+    if (age_roll < 15) {
+        d->age = 8 + strumien_zakres(&los, 2);     // 8-9 lat (dzieci samodzielne)
+    } else if (age_roll < 25) {
+        d->age = 10 + strumien_zakres(&los, 8);    // 10-17 lat (młodzież)
+    } else if (age_roll < 85) {
+        d->age = 18 + strumien_zakres(&los, 47);   // 18-64 lat (dorośli)
+    } else {
+        d->age = 65 + strumien_zakres(&los, 20);   // 65-84 lat (seniorzy)
+    }
+
+    d->type = strumien_zakres(&los, 2) ? TOURIST_CYCLIST : TOURIST_PEDESTRIAN;
+    d->is_vip = strumien_zakres(&los, 100) < VIP_PERCENT;
+
+    // Dzieci z opiekunem (dorośli 18-64 lat mogą mieć dzieci)
+    d->children_count = 0;
+    if (d->age >= 18 && d->age < 65 && strumien_zakres(&los, 100) < ADULT_WITH_CHILDREN_PERCENT) {
+        if (d->type == TOURIST_CYCLIST) {
+            d->children_count = 1;                      // Rowerzysta może mieć max 1 dziecko
+        } else {
+            d->children_count = 1 + strumien_zakres(&los, 2);   // Pieszy może mieć 1-2 dzieci
+        }
+    }
+
+    d->ticket_type = strumien_zakres(&los, TICKET_TYPE_COUNT);
+}
+
+// zapis śladu
+
+static bool konczy_sie(const char* tekst, const char* koncowka) {
+    size_t n = strlen(tekst), k = strlen(koncowka);
+    return n >= k && strcmp(tekst + n - k, koncowka) == 0;
+}
+
+int slad_utworz(const char* plik, unsigned long long ziarno, ZapisSladu* z) {
+    z->binarny = konczy_sie(plik, ".bin");
+    z->f = fopen(plik, z->binarny ? "wb" : "w");
+    if (z->f == NULL) {
+        perror("Błąd tworzenia pliku śladu");
+        return -1;
+    }
+
+    if (z->binarny) {
+        NaglowekSladu n;
+        memset(&n, 0, sizeof(n));
+        memcpy(n.magia, SLAD_MAGIA, sizeof(n.magia));
+        n.wersja = SLAD_WERSJA;
+        n.rozmiar_rekordu = sizeof(RekordSladu);
+        n.ziarno = ziarno;
+        n.ma_ziarno = 1;
+        fwrite(&n, sizeof(n), 1, z->f);
+    } else {
+        fprintf(z->f, "%s ziarno=%llu\n%s\n", SLAD_NAGLOWEK, ziarno, SLAD_KOLUMNY);
+    }
+    return 0;
+}
+
+void slad_dopisz(ZapisSladu* z, const Przybycie* p) {
+    if (z->binarny) {
+        RekordSladu r;
+        r.czas_ms = p->czas_ms;
+        r.tourist_id = p->d.tourist_id;
+        r.wiek = (uint8_t)p->d.age;
+        r.typ = (uint8_t)p->d.type;
+        r.flagi = p->d.is_vip ? 1 : 0;
+        r.dzieci_bilet = (uint8_t)((p->d.children_count & 3) | ((p->d.ticket_type + 1) << 2));
+        fwrite(&r, sizeof(r), 1, z->f);
+    } else {
+        fprintf(z->f, "%lld,%d,%d,%d,%d,%d,%d\n", p->czas_ms, p->d.tourist_id, p->d.age,
+                (int)p->d.type, p->d.is_vip ? 1 : 0, p->d.children_count, p->d.ticket_type);
+    }
+}
+
+void slad_zamknij(ZapisSladu* z) {
+    if (z->f != NULL) fclose(z->f);
+    z->f = NULL;
+}
+
+// odczyt śladu (mmap)
+
+// Koniec bieżącego wiersza CSV (znak '\n' lub koniec pliku)
+static size_t koniec_wiersza(const OdczytSladu* s) {
+    const char* nl = memchr(s->dane + s->pozycja, '\n', s->rozmiar - s->pozycja);
+    return nl ? (size_t)(nl - s->dane) : s->rozmiar;
+}
+
+// Liczba całkowita z pola CSV - plik nie kończy się zerem, więc bez strtoll
+static bool czytaj_pole(const char** p, const char* koniec, long long* wartosc) {
+    const char* c = *p;
+    bool ujemna = false;
+    if (c < koniec && *c == '-') {
+        ujemna = true;
+        c++;
+    }
+    if (c >= koniec || *c < '0' || *c > '9') return false;
+
+    long long v = 0;
+    while (c < koniec && *c >= '0' && *c <= '9') v = v * 10 + (*c++ - '0');
+    if (c < koniec && *c == ',') c++;
+    *p = c;
+    *wartosc = ujemna ? -v : v;
+    return true;
+}
+
+static int nastepny_csv(OdczytSladu* s, Przybycie* p) {
+    while (s->pozycja < s->rozmiar) {
+        size_t koniec = koniec_wiersza(s);
+        const char* c = s->dane + s->pozycja;
+        const char* kw = s->dane + koniec;
+        s->pozycja = koniec + 1;
+        s->wiersz++;
+        if (kw > c && kw[-1] == '\r') kw--;
+
+        // Komentarze, wiersz nazw kolumn i puste wiersze
+        if (c == kw || *c == '#' || (*c >= 'a' && *c <= 'z')) continue;
+
+        long long pola[7];
+        int n = 0;
+        while (n < 7 && czytaj_pole(&c, kw, &pola[n])) n++;
+        if (n < 6 || c != kw) {
+            fprintf(stderr, "Błędny wiersz %d pliku śladu\n", s->wiersz);
+            return -1;
+        }
+        p->czas_ms = pola[0];
+        p->d.tourist_id = (int)pola[1];
+        p->d.age = (int)pola[2];
+        p->d.type = (TouristType)pola[3];
+        p->d.is_vip = pola[4] != 0;
+        p->d.children_count = (int)pola[5];
+        p->d.ticket_type = n > 6 ? (int)pola[6] : -1;
+        return 1;
+    }
+    return 0;
+}
+
+static int nastepny_bin(OdczytSladu* s, Przybycie* p) {
+    if (s->pozycja + sizeof(RekordSladu) > s->rozmiar) return 0;
+    RekordSladu r;
+    memcpy(&r, s->dane + s->pozycja, sizeof(r));
+    s->pozycja += sizeof(r);
+    s->wiersz++;
+
+    p->czas_ms = r.czas_ms;
+    p->d.tourist_id = r.tourist_id;
+    p->d.age = r.wiek;
+    p->d.type = (TouristType)r.typ;
+    p->d.is_vip = (r.flagi & 1) != 0;
+    p->d.children_count = r.dzieci_bilet & 3;
+    p->d.ticket_type = (r.dzieci_bilet >> 2) - 1;
+    return 1;
+}
+
+int slad_otworz(const char* plik, OdczytSladu* s) {
+    memset(s, 0, sizeof(*s));
+    int fd = open(plik, O_RDONLY);
+    if (fd == -1) {
+        perror("Błąd otwarcia pliku śladu");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Pusty lub niedostępny plik śladu %s\n", plik);
+        close(fd);
+        return -1;
+    }
+    s->rozmiar = (size_t)st.st_size;
+    void* dane = mmap(NULL, s->rozmiar, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dane == MAP_FAILED) {
+        perror("Błąd mmap pliku śladu");
+        return -1;
+    }
+    s->dane = dane;
+    madvise(dane, s->rozmiar, MADV_SEQUENTIAL);
+
+    // Ziarno z nagłówka potrzebne przed startem procesów - odczyt od razu
+    if (s->rozmiar >= sizeof(NaglowekSladu) && memcmp(s->dane, SLAD_MAGIA, 8) == 0) {
+        NaglowekSladu n;
+        memcpy(&n, s->dane, sizeof(n));
+        if (n.wersja != SLAD_WERSJA || n.rozmiar_rekordu != sizeof(RekordSladu)) {
+            fprintf(stderr, "Nieobsługiwana wersja pliku śladu %s\n", plik);
+            slad_zakoncz(s);
+            return -1;
+        }
+        s->binarny = true;
+        s->ziarno = n.ziarno;
+        s->ma_ziarno = n.ma_ziarno != 0;
+        s->pozycja = sizeof(n);
+    } else if (s->dane[0] == '#') {
+        size_t koniec = koniec_wiersza(s);
+        const char* z = memmem(s->dane, koniec, "ziarno=", 7);
+        if (z != NULL) {
+            const char* c = z + 7;
+            long long v;
+            s->ma_ziarno = czytaj_pole(&c, s->dane + koniec, &v);
+            s->ziarno = (unsigned long long)v;
+        }
+    }
+    return 0;
+}
+
+int slad_nastepny(OdczytSladu* s, Przybycie* p) {
+    int wynik = s->binarny ? nastepny_bin(s, p) : nastepny_csv(s, p);
+    if (wynik != 1) return wynik;
+
+    // Te same ograniczenia co przybycie_losuj: wiek od 8 lat (młodsze dzieci tylko
+    // w children_count), dzieci tylko u opiekuna 18-64 lat, rowerzysta z najwyżej 1 dzieckiem.
+    // Górna granica wieku mieści się w polu wiek (uint8_t) śladu binarnego.
+    // Odpowiedzi trafiają do turysty po tourist_id, więc numery muszą być dodatnie
+    // i niepowtarzalne (rosnące)
+    if ((p->d.type != TOURIST_PEDESTRIAN && p->d.type != TOURIST_CYCLIST) ||
+        p->d.children_count < 0 || p->d.children_count > 2 ||
+        (p->d.children_count > 0 && (p->d.age < 18 || p->d.age >= 65)) ||
+        (p->d.type == TOURIST_CYCLIST && p->d.children_count > 1) ||
+        p->d.age < 8 || p->d.age > 120 ||
+        p->d.ticket_type < -1 || p->d.ticket_type >= TICKET_TYPE_COUNT) {
+        fprintf(stderr, "Błędne przybycie w wierszu/rekordzie %d pliku śladu\n", s->wiersz);
+        return -1;
+    }
+    if (p->d.tourist_id <= s->ostatni_id) {
+        fprintf(stderr, "Wiersz/rekord %d pliku śladu: tourist_id %d nie jest większy od "
+                        "poprzedniego (%d)\n", s->wiersz, p->d.tourist_id, s->ostatni_id);
+        return -1;
+    }
+    s->ostatni_id = p->d.tourist_id;
+    return 1;
+}
+
+void slad_zakoncz(OdczytSladu* s) {
+    if (s->dane != NULL) munmap((void*)s->dane, s->rozmiar);
+    s->dane = NULL;
+}
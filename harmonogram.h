@@ -0,0 +1,86 @@
+#ifndef HARMONOGRAM_H
+#define HARMONOGRAM_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "struktury.h"
+
+// Harmonogram przybyć turystów
+// Parametry turysty (wiek, typ, VIP, dzieci, bilet) losowane są ze strumienia przybyć
+// o numerze turysty, więc to samo ziarno daje tych samych turystów. Harmonogram można
+// zapisać do pliku śladu i odtworzyć - te same przybycia w tych samych chwilach
+// symulacji, a ziarno z nagłówka odtwarza też decyzje turystów i pracowników.
+// Ślad może też pochodzić z generatora (kolej-slad: proces Poissona, szczyty ruchu).
+//
+// Formaty (odczyt rozpoznaje format po magii, zapis po rozszerzeniu .bin):
+// - CSV: wiersz "# kolej slad przybyc v2 ziarno=N", nazwy kolumn, potem
+//   czas_ms,tourist_id,wiek,typ,vip,dzieci,bilet (bilet -1 - wybiera turysta;
+//   wiersze v1 bez kolumny bilet są przyjmowane z biletem -1)
+// - binarny: NaglowekSladu i rekordy RekordSladu stałej długości
+
+#define SLAD_NAGLOWEK   "# kolej slad przybyc v2"
+#define SLAD_KOLUMNY    "czas_ms,tourist_id,wiek,typ,vip,dzieci,bilet"
+#define SLAD_MAGIA      "KOLEJSL1"
+#define SLAD_WERSJA     1
+
+// Nagłówek pliku binarnego (32 B)
+typedef struct {
+    char magia[8];
+    uint32_t wersja;
+    uint32_t rozmiar_rekordu;
+    uint64_t ziarno;
+    uint32_t ma_ziarno;
+    uint32_t zarezerwowane;
+} NaglowekSladu;
+
+// Rekord pliku binarnego (16 B)
+typedef struct {
+    int64_t czas_ms;            // Chwila symulacji przybycia (ms)
+    int32_t tourist_id;
+    uint8_t wiek;
+    uint8_t typ;                // TouristType
+    uint8_t flagi;              // Bit 0 - VIP
+    uint8_t dzieci_bilet;       // Bity 0-1 - dzieci, bity 2-7 - bilet + 1 (0 - wybiera turysta)
+} RekordSladu;
+
+// Jedno przybycie: chwila symulacji przekazania turysty (ms) i jego deskryptor
+typedef struct {
+    long long czas_ms;
+    TouristDescriptor d;
+} Przybycie;
+
+// Losowanie parametrów turysty tourist_id (strumień STRUMIEN_PRZYBYCIE)
+void przybycie_losuj(unsigned long long ziarno, int tourist_id, TouristDescriptor* d);
+
+// Zapis śladu - nagłówek z ziarnem, potem jeden wiersz/rekord na przybycie
+typedef struct {
+    FILE* f;
+    bool binarny;
+} ZapisSladu;
+
+int slad_utworz(const char* plik, unsigned long long ziarno, ZapisSladu* z);
+void slad_dopisz(ZapisSladu* z, const Przybycie* p);
+void slad_zamknij(ZapisSladu* z);
+
+// Odczyt śladu przez mmap - plik zmapowany w całości, wiersze/rekordy czytane kursorem
+// bez kopiowania. Ziarno z nagłówka znane po slad_otworz (ma_ziarno false, gdy brak).
+typedef struct {
+    const char* dane;
+    size_t rozmiar;
+    size_t pozycja;             // Kursor (bajty od początku pliku)
+    bool binarny;
+    unsigned long long ziarno;
+    bool ma_ziarno;
+    int wiersz;
+    int ostatni_id;             // tourist_id poprzedniego przybycia (rosnące, od 1)
+} OdczytSladu;
+
+int slad_otworz(const char* plik, OdczytSladu* s);
+// Zwraca: 1 = kolejne przybycie, 0 = koniec pliku, -1 = błędny wiersz/rekord
+// (m.in. tourist_id < 1 lub nie większy od poprzedniego, wiek < 8, rowerzysta z 2 dzieci)
+int slad_nastepny(OdczytSladu* s, Przybycie* p);
+void slad_zakoncz(OdczytSladu* s);
+
+#endif // HARMONOGRAM_H
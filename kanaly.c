@@ -0,0 +1,301 @@
+// kanaly.c - kanały komunikatów: pierścienie MPSC w pamięci dzielonej z budzeniem futeksem
+// Każda komórka ma numer sekwencyjny (jak pierścień loggera): seq == pozycja - wolna dla
+// nadawcy, seq == pozycja + 1 - opublikowana dla odbiorcy. Nadawca rezerwuje pozycję CAS-em
+// na liczniku zapisu, kopiuje komunikat i publikuje; odbiorca (jeden na kanał) kopiuje
+// komunikat i zwalnia komórkę (seq += pojemność). Wywołanie systemowe tylko gdy druga
+// strona śpi: odbiorca na dzwonku, nadawca pełnego pierścienia na słowie miejsce.
+// Komórka mieści tylko nagłówek i ładunek typu komunikatu danego kanału (rozmiar_komunikatu).
+// Pojemności wyznacza proces główny z konfiguracji uruchomienia i zapisuje w nagłówku
+// segmentu - dołączający odczytują je stamtąd.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "kanaly.h"
+#include "utils.h"
+#include "konfig.h"
+
+typedef struct {
+    volatile unsigned long seq;
+    unsigned char dane[];       // Nagłówek + ładunek (rozmiar_komunikatu[kanal])
+} KomorkaKanalu;
+
+typedef struct {
+    NOWA_LINIA volatile unsigned long zapis;    // Następna pozycja do rezerwacji (nadawcy)
+    NOWA_LINIA volatile unsigned long odczyt;   // Następna pozycja odbiorcy
+    volatile unsigned int miejsce;              // Futex - odbiorca zwolnił komórki
+    volatile unsigned int czekajacy;            // Nadawcy czekający na miejsce
+} Kanal;
+
+// Segment: nagłówki kanałów, za nimi komórki kolejnych kanałów
+typedef struct {
+    Kanal kanaly[KANAL_COUNT];
+    unsigned long pojemnosc[KANAL_COUNT];       // Komórki kanału (potęga 2)
+} SegmentKanalow;
+
+// Pojemności domyślne - kanał kasy i przyjazdów powiększany do liczby nadawców z konfiguracji
+static const unsigned long pojemnosc_domyslna[KANAL_COUNT] = {
+    [KANAL_KASA_VIP]  = CHANNEL_CASHIER_SLOTS,
+    [KANAL_KASA]      = CHANNEL_CASHIER_SLOTS,
+    [KANAL_PERON]     = CHANNEL_PLATFORM_SLOTS,
+    [KANAL_PRZYJAZDY] = CHANNEL_ARRIVAL_SLOTS,
+    [KANAL_WYJSCIA]   = CHANNEL_EXIT_SLOTS,
+};
+
+static const size_t rozmiar_komunikatu[KANAL_COUNT] = {
+    [KANAL_KASA_VIP]  = KOMUNIKAT_ROZMIAR(zadanie),
+    [KANAL_KASA]      = KOMUNIKAT_ROZMIAR(zadanie),
+    [KANAL_PERON]     = KOMUNIKAT_ROZMIAR(peron),
+    [KANAL_PRZYJAZDY] = KOMUNIKAT_ROZMIAR(przyjazd),
+    [KANAL_WYJSCIA]   = KOMUNIKAT_ROZMIAR(wyjscie),
+};
+
+static const OdbiorcaKanalu odbiorca_kanalu[KANAL_COUNT] = {
+    [KANAL_KASA_VIP]  = ODBIORCA_KASJER,
+    [KANAL_KASA]      = ODBIORCA_KASJER,
+    [KANAL_PERON]     = ODBIORCA_WORKER1,
+    [KANAL_PRZYJAZDY] = ODBIORCA_WORKER2,
+    [KANAL_WYJSCIA]   = ODBIORCA_WORKER2,
+};
+
+#if (CHANNEL_CASHIER_SLOTS & (CHANNEL_CASHIER_SLOTS - 1)) != 0 || \
+    (CHANNEL_PLATFORM_SLOTS & (CHANNEL_PLATFORM_SLOTS - 1)) != 0 || \
+    (CHANNEL_ARRIVAL_SLOTS & (CHANNEL_ARRIVAL_SLOTS - 1)) != 0 || \
+    (CHANNEL_EXIT_SLOTS & (CHANNEL_EXIT_SLOTS - 1)) != 0
+#error "Pojemności kanałów CHANNEL_*_SLOTS muszą być potęgami 2"
+#endif
+
+static SegmentKanalow* g_seg = NULL;
+static unsigned char* g_komorki[KANAL_COUNT];
+static unsigned long pojemnosc[KANAL_COUNT];   // Kopia z nagłówka segmentu
+static SharedMemory* g_shm = NULL;
+
+// Odstęp komórek kanału - numer sekwencyjny wyrównany do 8 bajtów
+static size_t krok_komorki(int kanal) {
+    return (sizeof(KomorkaKanalu) + rozmiar_komunikatu[kanal] + 7) & ~(size_t)7;
+}
+
+static KomorkaKanalu* komorka(int kanal, unsigned long pozycja) {
+    return (KomorkaKanalu*)(g_komorki[kanal] + (pozycja & (pojemnosc[kanal] - 1)) * krok_komorki(kanal));
+}
+
+// Najmniejsza potęga 2 nie mniejsza niż n
+static unsigned long potega_dwojki(unsigned long n) {
+    unsigned long p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Kanał kasy i przyjazdów musi pomieścić wszystkich nadawców naraz
+// (SEM_CASHIER_QUEUE i SEM_CHAIRS ograniczają ich liczbę)
+static void wyznacz_pojemnosci(const Konfiguracja* k) {
+    for (int i = 0; i < KANAL_COUNT; i++) {
+        pojemnosc[i] = pojemnosc_domyslna[i];
+    }
+    unsigned long kasa = potega_dwojki((unsigned long)k->cashier_queue_limit);
+    unsigned long przyjazdy = potega_dwojki((unsigned long)k->max_active_chairs);
+    if (pojemnosc[KANAL_KASA] < kasa) {
+        pojemnosc[KANAL_KASA] = pojemnosc[KANAL_KASA_VIP] = kasa;
+    }
+    if (pojemnosc[KANAL_PRZYJAZDY] < przyjazdy) {
+        pojemnosc[KANAL_PRZYJAZDY] = przyjazdy;
+    }
+}
+
+static size_t rozmiar_segmentu(void) {
+    size_t rozmiar = sizeof(SegmentKanalow);
+    for (int i = 0; i < KANAL_COUNT; i++) {
+        rozmiar += pojemnosc[i] * krok_komorki(i);
+    }
+    return rozmiar;
+}
+
+// Nowy segment: nagłówek z pojemnościami wyznaczonymi przez twórcę, inaczej odczyt z nagłówka
+static void mapuj(int kanaly_id, bool nowy) {
+    SegmentKanalow* seg = (SegmentKanalow*)shmat(kanaly_id, NULL, 0);
+    if (seg == (SegmentKanalow*)-1) {
+        perror("Błąd shmat (kanały)");
+        exit(1);
+    }
+    g_seg = seg;
+    if (nowy) {
+        memset(seg, 0, sizeof(SegmentKanalow));
+        memcpy(seg->pojemnosc, pojemnosc, sizeof(pojemnosc));
+    }
+
+    unsigned char* komorki = (unsigned char*)(seg + 1);
+    for (int i = 0; i < KANAL_COUNT; i++) {
+        pojemnosc[i] = seg->pojemnosc[i];
+        g_komorki[i] = komorki;
+        komorki += pojemnosc[i] * krok_komorki(i);
+    }
+}
+
+int kanaly_utworz(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_CHANNELS);
+    wyznacz_pojemnosci(konfig());
+    size_t rozmiar = rozmiar_segmentu();
+    int kanaly_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
+
+    if (kanaly_id == -1) {
+        if (errno == EEXIST) {
+            kanaly_id = shmget(klucz, 0, 0600);
+            if (kanaly_id != -1) {
+                shmctl(kanaly_id, IPC_RMID, NULL);
+            }
+            kanaly_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
+        }
+        if (kanaly_id == -1) {
+            perror("Błąd shmget (kanały)");
+            exit(1);
+        }
+    }
+
+    mapuj(kanaly_id, true);
+    for (int i = 0; i < KANAL_COUNT; i++) {
+        for (unsigned long p = 0; p < pojemnosc[i]; p++) {
+            komorka(i, p)->seq = p;
+        }
+    }
+    return kanaly_id;
+}
+
+void kanaly_usun(int kanaly_id) {
+    if (shmctl(kanaly_id, IPC_RMID, NULL) == -1) {
+        perror("Błąd shmctl IPC_RMID (kanały)");
+    }
+}
+
+void kanaly_dolacz(SharedMemory* shm) {
+    g_shm = shm;
+    if (g_seg != NULL) return;
+
+    key_t klucz = utworz_klucz(IPC_KEY_CHANNELS);
+    int kanaly_id = shmget(klucz, 0, 0600);
+    if (kanaly_id == -1) {
+        perror("Błąd shmget (połączenie z kanałami)");
+        exit(1);
+    }
+    mapuj(kanaly_id, false);
+}
+
+// Dzwonek tylko do śpiącego odbiorcy (fence: publikacja przed odczytem flagi)
+void kanaly_zadzwon(OdbiorcaKanalu odbiorca) {
+    DzwonekOdbiorcy* dz = &g_shm->dzwonki[odbiorca];
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&dz->spi, __ATOMIC_RELAXED)) {
+        powiadom_o_zmianie(&dz->slowo);
+    }
+}
+
+static bool pelny(Kanal* k, KanalId kanal) {
+    unsigned long pozycja = __atomic_load_n(&k->zapis, __ATOMIC_RELAXED);
+    KomorkaKanalu* c = komorka(kanal, pozycja);
+    return (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pozycja) < 0;
+}
+
+// Sen nadawcy do zwolnienia komórki - false po terminie lub sygnale
+static bool czekaj_na_miejsce(Kanal* k, KanalId kanal, const struct timespec* termin) {
+    unsigned int miejsce = odczytaj_slowo(&k->miejsce);
+    __atomic_add_fetch(&k->czekajacy, 1, __ATOMIC_SEQ_CST);
+    int wynik = 1;
+    if (pelny(k, kanal)) {
+        wynik = czekaj_na_zmiane(&k->miejsce, miejsce, termin);
+    }
+    __atomic_sub_fetch(&k->czekajacy, 1, __ATOMIC_SEQ_CST);
+    return wynik == 1;
+}
+
+bool kanal_wyslij(KanalId kanal, const Komunikat* msg, int timeout_ms) {
+    Kanal* k = &g_seg->kanaly[kanal];
+    struct timespec termin;
+    bool termin_ustawiony = false;
+
+    while (1) {
+        unsigned long pozycja = __atomic_load_n(&k->zapis, __ATOMIC_RELAXED);
+        KomorkaKanalu* c = komorka(kanal, pozycja);
+        long roznica = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pozycja);
+
+        if (roznica == 0) {
+            if (!__atomic_compare_exchange_n(&k->zapis, &pozycja, pozycja + 1, false,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                continue;
+            }
+            memcpy(c->dane, msg, rozmiar_komunikatu[kanal]);
+            __atomic_store_n(&c->seq, pozycja + 1, __ATOMIC_RELEASE);
+            kanaly_zadzwon(odbiorca_kanalu[kanal]);
+            return true;
+        }
+
+        if (roznica < 0) {
+            // Pełny pierścień
+            if (timeout_ms == 0) return false;
+            if (timeout_ms > 0 && !termin_ustawiony) {
+                termin_za_ms(&termin, timeout_ms);
+                termin_ustawiony = true;
+            }
+            if (!czekaj_na_miejsce(k, kanal, termin_ustawiony ? &termin : NULL)) {
+                return false;
+            }
+        }
+        // roznica > 0 - pozycję zajął inny nadawca, ponów z nowym licznikiem
+    }
+}
+
+bool kanal_odbierz(KanalId kanal, Komunikat* msg) {
+    Kanal* k = &g_seg->kanaly[kanal];
+    unsigned long pozycja = k->odczyt;
+    KomorkaKanalu* c = komorka(kanal, pozycja);
+    if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != pozycja + 1) {
+        return false;
+    }
+
+    memcpy(msg, c->dane, rozmiar_komunikatu[kanal]);
+    __atomic_store_n(&c->seq, pozycja + pojemnosc[kanal], __ATOMIC_RELEASE);
+    __atomic_store_n(&k->odczyt, pozycja + 1, __ATOMIC_RELEASE);
+
+    // Budzenie nadawców tylko gdy ktoś czeka na miejsce - zwykle bez wywołania systemowego
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&k->czekajacy, __ATOMIC_RELAXED) > 0) {
+        powiadom_o_zmianie(&k->miejsce);
+    }
+    return true;
+}
+
+static bool ma_komunikaty(OdbiorcaKanalu odbiorca) {
+    for (int i = 0; i < KANAL_COUNT; i++) {
+        if (odbiorca_kanalu[i] != odbiorca) continue;
+        Kanal* k = &g_seg->kanaly[i];
+        unsigned long pozycja = k->odczyt;
+        KomorkaKanalu* c = komorka(i, pozycja);
+        if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) == pozycja + 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Flaga snu przed ponownym sprawdzeniem kanałów i stanu - nadawca, który opublikował
+// komunikat po sprawdzeniu, widzi flagę i dzwoni (zmienia słowo przed futex wait)
+int kanaly_czekaj(OdbiorcaKanalu odbiorca, unsigned int seq, int timeout_ms) {
+    DzwonekOdbiorcy* dz = &g_shm->dzwonki[odbiorca];
+    unsigned int dzwonek = odczytaj_slowo(&dz->slowo);
+    __atomic_store_n(&dz->spi, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int wynik = 1;
+    if (!ma_komunikaty(odbiorca) && stan_odczytaj(g_shm) == seq) {
+        if (timeout_ms < 0) {
+            wynik = czekaj_na_zmiane(&dz->slowo, dzwonek, NULL);
+        } else {
+            struct timespec termin;
+            termin_za_ms(&termin, timeout_ms);
+            wynik = czekaj_na_zmiane(&dz->slowo, dzwonek, &termin);
+        }
+    }
+    __atomic_store_n(&dz->spi, 0, __ATOMIC_SEQ_CST);
+    return wynik;
+}
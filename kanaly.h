@@ -0,0 +1,45 @@
+#ifndef KANALY_H
+#define KANALY_H
+
+#include <stdbool.h>
+#include "struktury.h"
+
+// Kanały komunikatów w pamięci dzielonej (klucz IPC_KEY_CHANNELS)
+// Ograniczone pierścienie wielu producentów i jednego odbiorcy zamiast kolejek System V:
+// nadawca kopiuje komunikat wprost do komórki pierścienia, odbiorca kopiuje go z niej -
+// bez wywołań systemowych, dopóki nikt nie śpi. Odbiorca śpi na dzwonku w SharedMemory
+// (jeden na wszystkie jego kanały), nadawca przy pełnym pierścieniu - na słowie miejsca.
+// Kanał przenosi jeden typ komunikatu - komórka ma rozmiar nagłówka i tego ładunku.
+
+typedef enum {
+    KANAL_KASA_VIP,     // Turysta VIP -> kasjer (ZadanieBiletu, obsługiwany przed zwykłym)
+    KANAL_KASA,         // Turysta -> kasjer (ZadanieBiletu)
+    KANAL_PERON,        // Turysta -> worker1 (ZgloszenieNaPeron)
+    KANAL_PRZYJAZDY,    // Wątek liny worker1 -> worker2 (PrzyjazdKrzeselka)
+    KANAL_WYJSCIA,      // Turysta -> worker2 (ProsbaWyjscia)
+    KANAL_COUNT
+} KanalId;
+
+// Utworzenie segmentu (proces główny, przed uruchomieniem pozostałych procesów)
+int kanaly_utworz(void);
+void kanaly_usun(int kanaly_id);
+
+// Dołączenie do segmentu - każdy proces nadawcy/odbiorcy, po dolacz_pamiec
+void kanaly_dolacz(SharedMemory* shm);
+
+// Wysłanie komunikatu: timeout_ms == 0 - bez czekania, < 0 - czekanie do skutku
+// Zwraca false gdy pierścień pełny (po terminie) lub czekanie przerwał sygnał
+bool kanal_wyslij(KanalId kanal, const Komunikat* msg, int timeout_ms);
+
+// Odbiór bez czekania (tylko odbiorca kanału) - false gdy pusty
+bool kanal_odbierz(KanalId kanal, Komunikat* msg);
+
+// Sen odbiorcy do komunikatu w którymś z jego kanałów, zmiany stanu symulacji
+// (seq z stan_odczytaj) lub timeout_ms (< 0 - bez limitu)
+// Zwraca: 1 = wybudzenie, 0 = timeout, -1 = przerwane sygnałem
+int kanaly_czekaj(OdbiorcaKanalu odbiorca, unsigned int seq, int timeout_ms);
+
+// Obudzenie odbiorcy, jeśli śpi (np. zwolniło się krzesełko)
+void kanaly_zadzwon(OdbiorcaKanalu odbiorca);
+
+#endif // KANALY_H
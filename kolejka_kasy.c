@@ -0,0 +1,47 @@
+// kolejka_kasy.c - kolejka priorytetowa kasjera na buforach cyklicznych
+
+#include "kolejka_kasy.h"
+
+void kolejka_kasy_init(KolejkaKasy* k) {
+    k->vip.glowa = 0;
+    k->vip.liczba = 0;
+    k->zwykly.glowa = 0;
+    k->zwykly.liczba = 0;
+}
+
+static bool pas_dodaj(PasKolejki* pas, const QueuedTourist* tourist) {
+    if (pas->liczba == MAX_QUEUE) {
+        return false;
+    }
+    int ogon = pas->glowa + pas->liczba;
+    if (ogon >= MAX_QUEUE) {
+        ogon -= MAX_QUEUE;
+    }
+    pas->elementy[ogon] = *tourist;
+    pas->liczba++;
+    return true;
+}
+
+static bool pas_pobierz(PasKolejki* pas, QueuedTourist* tourist) {
+    if (pas->liczba == 0) {
+        return false;
+    }
+    *tourist = pas->elementy[pas->glowa];
+    if (++pas->glowa == MAX_QUEUE) {
+        pas->glowa = 0;
+    }
+    pas->liczba--;
+    return true;
+}
+
+bool kolejka_kasy_dodaj(KolejkaKasy* k, const QueuedTourist* tourist) {
+    return pas_dodaj(tourist->is_vip ? &k->vip : &k->zwykly, tourist);
+}
+
+bool kolejka_kasy_pobierz(KolejkaKasy* k, QueuedTourist* tourist) {
+    return pas_pobierz(&k->vip, tourist) || pas_pobierz(&k->zwykly, tourist);
+}
+
+int kolejka_kasy_rozmiar(const KolejkaKasy* k) {
+    return k->vip.liczba + k->zwykly.liczba;
+}
@@ -0,0 +1,47 @@
+#ifndef KOLEJKA_KASY_H
+#define KOLEJKA_KASY_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "struktury.h"
+
+// Kolejka kasjera: dwa bufory cykliczne (pas VIP i pas zwykły), kolejność FIFO
+// w obrębie pasa, VIP zawsze obsługiwany pierwszy. Dodanie i pobranie O(1).
+
+#define MAX_QUEUE 15000     // Pojemność jednego pasa
+
+// Struktura turysty w kolejce
+typedef struct {
+    int reply_box;      // Skrzynka odpowiedzi turysty
+    int tourist_id;
+    int age;
+    TouristType type;
+    bool is_vip;
+    int children_count;
+    int child_ages[2];
+    TicketType ticket_type;
+} QueuedTourist;
+
+// Bufor cykliczny jednego pasa
+typedef struct {
+    QueuedTourist elementy[MAX_QUEUE];
+    int glowa;          // Indeks najdłużej czekającego
+    int liczba;
+} PasKolejki;
+
+typedef struct {
+    PasKolejki vip;
+    PasKolejki zwykly;
+} KolejkaKasy;
+
+void kolejka_kasy_init(KolejkaKasy* k);
+
+// Dodanie na koniec pasa (VIP wg is_vip) - false gdy pas pełny
+bool kolejka_kasy_dodaj(KolejkaKasy* k, const QueuedTourist* tourist);
+
+// Pobranie pierwszego czekającego (najpierw VIP) - false gdy obie puste
+bool kolejka_kasy_pobierz(KolejkaKasy* k, QueuedTourist* tourist);
+
+int kolejka_kasy_rozmiar(const KolejkaKasy* k);
+
+#endif // KOLEJKA_KASY_H
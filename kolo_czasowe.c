@@ -0,0 +1,162 @@
+// kolo_czasowe.c - hierarchiczne koło czasowe dla pętli zdarzeń
+
+#include <string.h>
+#include "kolo_czasowe.h"
+
+void kolo_init(KoloCzasowe* kolo, long long teraz) {
+    memset(kolo, 0, sizeof(KoloCzasowe));
+    kolo->teraz = teraz;
+}
+
+void timer_init(TimerKola* timer, void* dane) {
+    timer->nastepny = NULL;
+    timer->poprzedni = NULL;
+    timer->termin = 0;
+    timer->dane = dane;
+}
+
+bool timer_aktywny(const TimerKola* timer) {
+    return timer->poprzedni != NULL;
+}
+
+// Wstawienie do listy właściwej dla terminu względem kolo->teraz
+// Poziom l obejmuje odległości < 64^(l+1), slot wyznaczają bity terminu tego poziomu
+static void wstaw(KoloCzasowe* kolo, TimerKola* timer) {
+    long long delta = timer->termin - kolo->teraz;
+    TimerKola** lista = &kolo->przepelnienie;
+
+    if (delta < 0) {
+        // Termin minął - obsługa przy najbliższym ticku
+        lista = &kolo->sloty[0][kolo->teraz & KOLO_MASKA];
+    } else {
+        for (int l = 0; l < KOLO_POZIOMY; l++) {
+            if (delta < (1LL << (KOLO_BITY * (l + 1)))) {
+                lista = &kolo->sloty[l][(timer->termin >> (KOLO_BITY * l)) & KOLO_MASKA];
+                break;
+            }
+        }
+    }
+
+    timer->nastepny = *lista;
+    if (*lista) {
+        (*lista)->poprzedni = &timer->nastepny;
+    }
+    *lista = timer;
+    timer->poprzedni = lista;
+}
+
+static void odlacz(TimerKola* timer) {
+    *timer->poprzedni = timer->nastepny;
+    if (timer->nastepny) {
+        timer->nastepny->poprzedni = timer->poprzedni;
+    }
+    timer->nastepny = NULL;
+    timer->poprzedni = NULL;
+}
+
+void kolo_dodaj(KoloCzasowe* kolo, TimerKola* timer, long long termin) {
+    if (timer_aktywny(timer)) {
+        odlacz(timer);
+    } else {
+        kolo->liczba++;
+    }
+    timer->termin = termin;
+    wstaw(kolo, timer);
+}
+
+void kolo_usun(KoloCzasowe* kolo, TimerKola* timer) {
+    if (!timer_aktywny(timer)) return;
+    odlacz(timer);
+    kolo->liczba--;
+}
+
+// Przeniesienie listy wyższego poziomu do niższych (termin bliższy niż zasięg poziomu)
+static void kaskada(KoloCzasowe* kolo, TimerKola** lista) {
+    TimerKola* timer = *lista;
+    *lista = NULL;
+    while (timer) {
+        TimerKola* nastepny = timer->nastepny;
+        wstaw(kolo, timer);
+        timer = nastepny;
+    }
+}
+
+int kolo_przesun(KoloCzasowe* kolo, long long teraz, ObslugaTimera obsluga, void* arg) {
+    int wywolane = 0;
+
+    while (kolo->teraz <= teraz) {
+        if (kolo->liczba == 0) {
+            // Puste koło - przeskok bez przechodzenia po tickach
+            kolo->teraz = teraz + 1;
+            break;
+        }
+
+        long long tick = kolo->teraz;
+
+        // Początek bloku poziomu 0 - kaskady z wyższych poziomów
+        if ((tick & KOLO_MASKA) == 0) {
+            for (int l = 1; l < KOLO_POZIOMY; l++) {
+                int idx = (tick >> (KOLO_BITY * l)) & KOLO_MASKA;
+                kaskada(kolo, &kolo->sloty[l][idx]);
+                if (idx != 0) break;
+                if (l == KOLO_POZIOMY - 1) {
+                    kaskada(kolo, &kolo->przepelnienie);
+                }
+            }
+        }
+
+        // Odłączenie slotu przed obsługą - timery dodane w obsłudze trafią do kolejnych ticków
+        kolo->teraz = tick + 1;
+        TimerKola* lokalna = kolo->sloty[0][tick & KOLO_MASKA];
+        kolo->sloty[0][tick & KOLO_MASKA] = NULL;
+        if (lokalna) {
+            lokalna->poprzedni = &lokalna;
+        }
+
+        while (lokalna) {
+            TimerKola* timer = lokalna;
+            kolo_usun(kolo, timer);
+            obsluga(timer, arg);
+            wywolane++;
+        }
+    }
+
+    return wywolane;
+}
+
+long long kolo_najblizszy(const KoloCzasowe* kolo) {
+    if (kolo->liczba == 0) return -1;
+
+    long long wynik = -1;
+
+    // Poziom 0 - terminy dokładne w oknie [teraz, teraz + 63]
+    for (int j = 0; j < KOLO_SLOTY; j++) {
+        if (kolo->sloty[0][(kolo->teraz + j) & KOLO_MASKA]) {
+            wynik = kolo->teraz + j;
+            break;
+        }
+    }
+
+    // Wyższe poziomy - początek bloku pierwszego niepustego slotu
+    for (int l = 1; l < KOLO_POZIOMY; l++) {
+        int przesuniecie = KOLO_BITY * l;
+        long long blok = kolo->teraz >> przesuniecie;
+        // Blok bieżący jest już skaskadowany, chyba że teraz wskazuje dokładnie jego początek
+        int start = (kolo->teraz & ((1LL << przesuniecie) - 1)) != 0 ? 1 : 0;
+
+        for (int j = start; j < start + KOLO_SLOTY; j++) {
+            if (kolo->sloty[l][(blok + j) & KOLO_MASKA]) {
+                long long granica = (blok + j) << przesuniecie;
+                if (wynik < 0 || granica < wynik) wynik = granica;
+                break;
+            }
+        }
+    }
+
+    for (const TimerKola* timer = kolo->przepelnienie; timer; timer = timer->nastepny) {
+        if (wynik < 0 || timer->termin < wynik) wynik = timer->termin;
+    }
+
+    if (wynik < kolo->teraz) wynik = kolo->teraz;
+    return wynik;
+}
@@ -0,0 +1,47 @@
+#ifndef KOLO_CZASOWE_H
+#define KOLO_CZASOWE_H
+
+#include <stdbool.h>
+
+// Hierarchiczne koło czasowe (timer wheel)
+// Jednostka czasu: 1 ms symulacji. Dodanie/usunięcie O(1), przesunięcie
+// O(liczba wygasłych + kaskady). Nie jest bezpieczne wątkowo - koło należy
+// do jednego wątku (pętli zdarzeń).
+
+#define KOLO_BITY      6
+#define KOLO_SLOTY     (1 << KOLO_BITY)    // Sloty na poziom
+#define KOLO_MASKA     (KOLO_SLOTY - 1)
+#define KOLO_POZIOMY   4                   // Zasięg 64^4 ms (~4.6 h symulacji), dalej - lista przepełnienia
+
+// Timer osadzany w strukturze właściciela
+typedef struct TimerKola {
+    struct TimerKola* nastepny;
+    struct TimerKola** poprzedni;   // Pole wskazujące na ten timer (NULL - nieaktywny)
+    long long termin;               // Chwila wygaśnięcia (ms)
+    void* dane;                     // Właściciel (dla funkcji obsługi)
+} TimerKola;
+
+typedef struct {
+    long long teraz;                // Następny tick do obsłużenia
+    int liczba;                     // Aktywne timery
+    TimerKola* sloty[KOLO_POZIOMY][KOLO_SLOTY];
+    TimerKola* przepelnienie;
+} KoloCzasowe;
+
+typedef void (*ObslugaTimera)(TimerKola* timer, void* arg);
+
+void kolo_init(KoloCzasowe* kolo, long long teraz);
+void timer_init(TimerKola* timer, void* dane);
+bool timer_aktywny(const TimerKola* timer);
+
+// Dodanie (lub przestawienie aktywnego) timera na chwilę termin
+void kolo_dodaj(KoloCzasowe* kolo, TimerKola* timer, long long termin);
+void kolo_usun(KoloCzasowe* kolo, TimerKola* timer);
+
+// Obsługa wszystkich timerów z terminem <= teraz, zwraca liczbę wywołań
+int kolo_przesun(KoloCzasowe* kolo, long long teraz, ObslugaTimera obsluga, void* arg);
+
+// Najbliższa chwila, w której trzeba przesunąć koło (dolne ograniczenie), -1 gdy puste
+long long kolo_najblizszy(const KoloCzasowe* kolo);
+
+#endif // KOLO_CZASOWE_H
@@ -0,0 +1,208 @@
+// konfig.c - konfiguracja uruchomienia: wartości domyślne, plik, opcje -o i segment tylko do odczytu
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "konfig.h"
+#include "utils.h"
+
+// Wartości semaforów System V są ograniczone przez SEMVMX
+#define MAKS_SEMAFOR 32767
+
+// Klucze konfiguracji - pole struktury i dopuszczalny zakres
+typedef struct {
+    const char* klucz;
+    size_t pole;
+    bool dlugi;                 // Pole long (inaczej int)
+    long long min;
+    long long max;
+} OpisKlucza;
+
+#define POLE_INT(nazwa, pole, min, max)  {nazwa, offsetof(Konfiguracja, pole), false, min, max}
+#define POLE_LONG(nazwa, pole, min, max) {nazwa, offsetof(Konfiguracja, pole), true, min, max}
+
+static const OpisKlucza klucze[] = {
+    POLE_INT("TOTAL_TOURISTS", total_tourists, 0, 10000000),
+    POLE_INT("STATION_CAPACITY", station_capacity, 1, MAKS_SEMAFOR),
+    POLE_INT("MAX_ACTIVE_CHAIRS", max_active_chairs, 1, MAX_CHAIRS),
+    POLE_INT("ENTRY_GATES", entry_gates, 1, 64),
+    POLE_INT("PLATFORM_GATES", platform_gates, 1, 64),
+    POLE_INT("EXIT_GATES", exit_gates, 1, 64),
+    POLE_INT("CASHIER_QUEUE_LIMIT", cashier_queue_limit, 1, MAKS_SEMAFOR),
+    POLE_INT("PLATFORM_QUEUE_LIMIT", platform_queue_limit, 1, MAKS_SEMAFOR),
+    POLE_INT("TRAIL_T1_TIME", trail_time[TRAIL_T1], 0, 3600),
+    POLE_INT("TRAIL_T2_TIME", trail_time[TRAIL_T2], 0, 3600),
+    POLE_INT("TRAIL_T3_TIME", trail_time[TRAIL_T3], 0, 3600),
+    POLE_INT("EMERGENCY_CHANCE", emergency_chance, 0, 100),
+    POLE_LONG("SIM_SECOND_NS", sim_second_ns, 1000, 10000000000L),
+};
+
+#define LICZBA_KLUCZY (int)(sizeof(klucze) / sizeof(klucze[0]))
+
+static Konfiguracja g_domyslna;
+static bool g_domyslna_gotowa = false;
+static const Konfiguracja* g_konfig = NULL;
+
+void konfig_domyslna(Konfiguracja* k) {
+    memset(k, 0, sizeof(*k));
+    k->total_tourists = TOTAL_TOURISTS;
+    k->station_capacity = STATION_CAPACITY;
+    k->max_active_chairs = MAX_ACTIVE_CHAIRS;
+    k->entry_gates = ENTRY_GATES;
+    k->platform_gates = PLATFORM_GATES;
+    k->exit_gates = EXIT_GATES;
+    k->cashier_queue_limit = CASHIER_QUEUE_LIMIT;
+    k->platform_queue_limit = PLATFORM_QUEUE_LIMIT;
+    k->trail_time[TRAIL_T1] = TRAIL_T1_TIME;
+    k->trail_time[TRAIL_T2] = TRAIL_T2_TIME;
+    k->trail_time[TRAIL_T3] = TRAIL_T3_TIME;
+    k->emergency_chance = EMERGENCY_CHANCE;
+    k->sim_second_ns = SIM_SECOND_NS;
+}
+
+// Przycięcie białych znaków z obu stron (w miejscu)
+static char* przytnij(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* koniec = s + strlen(s);
+    while (koniec > s && isspace((unsigned char)koniec[-1])) koniec--;
+    *koniec = '\0';
+    return s;
+}
+
+// Ustawienie klucza; zrodlo i wiersz tylko do komunikatu o błędzie
+static int ustaw(Konfiguracja* k, char* przypisanie, const char* zrodlo, int wiersz) {
+    char* rownosc = strchr(przypisanie, '=');
+    if (rownosc == NULL) {
+        fprintf(stderr, "%s:%d: oczekiwano KLUCZ=wartość\n", zrodlo, wiersz);
+        return -1;
+    }
+    *rownosc = '\0';
+    char* klucz = przytnij(przypisanie);
+    char* wartosc = przytnij(rownosc + 1);
+
+    for (int i = 0; i < LICZBA_KLUCZY; i++) {
+        const OpisKlucza* o = &klucze[i];
+        if (strcmp(klucz, o->klucz) != 0) continue;
+
+        char* koniec;
+        errno = 0;
+        long long v = strtoll(wartosc, &koniec, 10);
+        if (errno != 0 || koniec == wartosc || *koniec != '\0' || v < o->min || v > o->max) {
+            fprintf(stderr, "%s:%d: %s = '%s' poza zakresem %lld..%lld\n",
+                    zrodlo, wiersz, o->klucz, wartosc, o->min, o->max);
+            return -1;
+        }
+        char* pole = (char*)k + o->pole;
+        if (o->dlugi) {
+            *(long*)pole = (long)v;
+        } else {
+            *(int*)pole = (int)v;
+        }
+        return 0;
+    }
+    fprintf(stderr, "%s:%d: nieznany klucz konfiguracji '%s'\n", zrodlo, wiersz, klucz);
+    return -1;
+}
+
+int konfig_wczytaj_plik(Konfiguracja* k, const char* plik) {
+    FILE* f = fopen(plik, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Nie można otworzyć pliku konfiguracji %s: %s\n", plik, strerror(errno));
+        return -1;
+    }
+
+    char linia[256];
+    int wiersz = 0;
+    int wynik = 0;
+    while (fgets(linia, sizeof(linia), f) != NULL) {
+        wiersz++;
+        char* komentarz = strchr(linia, '#');
+        if (komentarz != NULL) *komentarz = '\0';
+        char* tresc = przytnij(linia);
+        if (*tresc == '\0') continue;
+        if (ustaw(k, tresc, plik, wiersz) != 0) wynik = -1;
+    }
+    fclose(f);
+    return wynik;
+}
+
+int konfig_ustaw(Konfiguracja* k, const char* przypisanie) {
+    char kopia[256];
+    snprintf(kopia, sizeof(kopia), "%s", przypisanie);
+    return ustaw(k, kopia, "-o", 1);
+}
+
+void konfig_wypisz(const Konfiguracja* k, FILE* f) {
+    for (int i = 0; i < LICZBA_KLUCZY; i++) {
+        const char* pole = (const char*)k + klucze[i].pole;
+        long long v = klucze[i].dlugi ? *(const long*)pole : *(const int*)pole;
+        fprintf(f, "%s=%lld\n", klucze[i].klucz, v);
+    }
+}
+
+int konfig_opublikuj(const Konfiguracja* k) {
+    key_t klucz = utworz_klucz(IPC_KEY_CONFIG);
+    int konfig_id = shmget(klucz, sizeof(Konfiguracja), IPC_CREAT | IPC_EXCL | 0600);
+
+    if (konfig_id == -1) {
+        if (errno == EEXIST) {
+            konfig_id = shmget(klucz, 0, 0600);
+            if (konfig_id != -1) {
+                shmctl(konfig_id, IPC_RMID, NULL);
+            }
+            konfig_id = shmget(klucz, sizeof(Konfiguracja), IPC_CREAT | IPC_EXCL | 0600);
+        }
+        if (konfig_id == -1) {
+            perror("Błąd shmget (konfiguracja)");
+            exit(1);
+        }
+    }
+
+    // Zapis jedyny raz, potem również main widzi konfigurację tylko do odczytu
+    Konfiguracja* zapis = (Konfiguracja*)shmat(konfig_id, NULL, 0);
+    if (zapis == (Konfiguracja*)-1) {
+        perror("Błąd shmat (konfiguracja)");
+        exit(1);
+    }
+    *zapis = *k;
+    shmdt(zapis);
+
+    konfig_dolacz();
+    return konfig_id;
+}
+
+void konfig_usun(int konfig_id) {
+    if (shmctl(konfig_id, IPC_RMID, NULL) == -1) {
+        perror("Błąd shmctl IPC_RMID (konfiguracja)");
+    }
+}
+
+void konfig_dolacz(void) {
+    if (g_konfig != NULL) return;
+
+    key_t klucz = utworz_klucz(IPC_KEY_CONFIG);
+    int konfig_id = shmget(klucz, sizeof(Konfiguracja), 0600);
+    if (konfig_id == -1) {
+        perror("Błąd shmget (połączenie z konfiguracją)");
+        exit(1);
+    }
+    const Konfiguracja* k = (const Konfiguracja*)shmat(konfig_id, NULL, SHM_RDONLY);
+    if (k == (const Konfiguracja*)-1) {
+        perror("Błąd shmat (konfiguracja)");
+        exit(1);
+    }
+    g_konfig = k;
+}
+
+const Konfiguracja* konfig(void) {
+    if (g_konfig != NULL) return g_konfig;
+    if (!g_domyslna_gotowa) {
+        konfig_domyslna(&g_domyslna);
+        g_domyslna_gotowa = true;
+    }
+    return &g_domyslna;
+}
@@ -0,0 +1,36 @@
+#ifndef KONFIG_H
+#define KONFIG_H
+
+#include <stdio.h>
+#include "struktury.h"
+
+// Konfiguracja uruchomienia (klucz IPC_KEY_CONFIG)
+// Proces główny składa ją raz przed utworzeniem zasobów: wartości domyślne ze struktury.h,
+// potem plik (-c), potem przypisania z linii poleceń (-o) - późniejsze wygrywa. Gotową
+// konfigurację publikuje w osobnym segmencie; pozostałe procesy dołączają go tylko do
+// odczytu, więc nikt poza main nie może jej zmienić w trakcie przebiegu.
+//
+// Plik: wiersze KLUCZ = wartość (nazwy jak #define w struktury.h, np. STATION_CAPACITY),
+// puste wiersze i komentarze od '#' pomijane. Wartość spoza zakresu klucza to błąd.
+
+void konfig_domyslna(Konfiguracja* k);
+
+// Zwracają 0 lub -1 (komunikat na stderr); przy błędzie k bez zmian dla danego klucza
+int konfig_wczytaj_plik(Konfiguracja* k, const char* plik);
+int konfig_ustaw(Konfiguracja* k, const char* przypisanie);    // "KLUCZ=wartość"
+
+// Wszystkie klucze jako wiersze KLUCZ=wartość (format pliku -c)
+void konfig_wypisz(const Konfiguracja* k, FILE* f);
+
+// Publikacja (proces główny, przed uruchomieniem pozostałych procesów) i usunięcie
+int konfig_opublikuj(const Konfiguracja* k);
+void konfig_usun(int konfig_id);
+
+// Dołączenie opublikowanej konfiguracji tylko do odczytu - każdy proces potomny
+void konfig_dolacz(void);
+
+// Bieżąca konfiguracja: opublikowana, a przed publikacją/dołączeniem - domyślna
+// (np. mikrobenchmarki korzystające z kanałów i semaforów bez ./kolej)
+const Konfiguracja* konfig(void);
+
+#endif // KONFIG_H
@@ -0,0 +1,175 @@
+// logdump.c - dekoder binarnego dziennika zdarzeń (kolej-logdump)
+// Użycie: ./kolej-logdump [-f text|csv|json] [-n] [plik]
+//   -f  format wyjścia (domyślnie text)
+//   -n  bez sortowania - kolejność zapisu (partie procesów)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "struktury.h"
+#include "zdarzenia.h"
+#include "utils.h"
+
+typedef enum {
+    FORMAT_TEXT = 0,
+    FORMAT_CSV,
+    FORMAT_JSON
+} FormatWyjscia;
+
+// Sortowanie po czasie; przy równym czasie kolejność w pliku (qsort nie jest stabilny)
+typedef struct {
+    ZdarzenieBin z;
+    long indeks;
+} ZdarzenieIdx;
+
+static int porownaj_czas(const void* a, const void* b) {
+    const ZdarzenieIdx* za = a;
+    const ZdarzenieIdx* zb = b;
+    if (za->z.czas_ns != zb->z.czas_ns) return za->z.czas_ns < zb->z.czas_ns ? -1 : 1;
+    return za->indeks < zb->indeks ? -1 : (za->indeks > zb->indeks);
+}
+
+static int32_t wartosc_pola(const ZdarzenieBin* z, int pole) {
+    switch (pole) {
+        case 0: return z->nr;
+        case 1: return z->id;
+        case 2: return z->id2;
+        case 3: return z->wartosc;
+        default: return z->wartosc2;
+    }
+}
+
+// Czas zegara ściennego HH:MM:SS.uuuuuu z nagłówka i czasu monotonicznego
+static void format_czasu(const NaglowekZdarzen* nag, int64_t czas_ns, char* buf, size_t size) {
+    int64_t real_ns = nag->start_realtime_ns + (czas_ns - nag->start_monotonic_ns);
+    time_t sekundy = (time_t)(real_ns / 1000000000LL);
+    struct tm tm;
+    localtime_r(&sekundy, &tm);
+    snprintf(buf, size, "%02d:%02d:%02d.%06lld", tm.tm_hour, tm.tm_min, tm.tm_sec,
+             (long long)(real_ns % 1000000000LL) / 1000);
+}
+
+static void wypisz(const NaglowekZdarzen* nag, const ZdarzenieBin* z, FormatWyjscia format) {
+    double od_startu = (z->czas_ns - nag->start_monotonic_ns) / 1e9;
+
+    switch (format) {
+        case FORMAT_TEXT: {
+            char czas[32];
+            format_czasu(nag, z->czas_ns, czas, sizeof(czas));
+            printf("[%s] +%.6f %d %s", czas, od_startu, z->pid, nazwa_zdarzenia(z->typ));
+            for (int p = 0; p < 5; p++) {
+                const char* pole = nazwa_pola_zdarzenia(z->typ, p);
+                if (pole) printf(" %s=%d", pole, wartosc_pola(z, p));
+            }
+            putchar('\n');
+            break;
+        }
+        case FORMAT_CSV:
+            printf("%.6f,%d,%s,%u,%d,%d,%d,%d\n", od_startu, z->pid, nazwa_zdarzenia(z->typ),
+                   z->nr, z->id, z->id2, z->wartosc, z->wartosc2);
+            break;
+        case FORMAT_JSON:
+            printf("{\"t\":%.6f,\"pid\":%d,\"typ\":\"%s\"", od_startu, z->pid, nazwa_zdarzenia(z->typ));
+            for (int p = 0; p < 5; p++) {
+                const char* pole = nazwa_pola_zdarzenia(z->typ, p);
+                if (pole) printf(",\"%s\":%d", pole, wartosc_pola(z, p));
+            }
+            printf("}\n");
+            break;
+    }
+}
+
+static void uzycie(const char* nazwa) {
+    fprintf(stderr, "Użycie: %s [-f text|csv|json] [-n] [plik]\n", nazwa);
+    fprintf(stderr, "  plik domyślnie %s, przy %s=N - plik instancji N\n", EVENT_LOG_FILE, ENV_INSTANCJA);
+}
+
+int main(int argc, char* argv[]) {
+    FormatWyjscia format = FORMAT_TEXT;
+    bool sortuj = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:nh")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "text") == 0) format = FORMAT_TEXT;
+                else if (strcmp(optarg, "csv") == 0) format = FORMAT_CSV;
+                else if (strcmp(optarg, "json") == 0) format = FORMAT_JSON;
+                else {
+                    uzycie(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                sortuj = false;
+                break;
+            default:
+                uzycie(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    char domyslny[64];
+    plik_instancji(EVENT_LOG_FILE, domyslny, sizeof(domyslny));
+    const char* sciezka = optind < argc ? argv[optind] : domyslny;
+
+    FILE* plik = fopen(sciezka, "rb");
+    if (!plik) {
+        perror(sciezka);
+        return 1;
+    }
+
+    NaglowekZdarzen nag;
+    if (fread(&nag, sizeof(nag), 1, plik) != 1 ||
+        memcmp(nag.magia, ZDARZENIA_MAGIA, sizeof(nag.magia)) != 0) {
+        fprintf(stderr, "%s: to nie jest dziennik zdarzeń kolei\n", sciezka);
+        fclose(plik);
+        return 1;
+    }
+    if (nag.wersja != ZDARZENIA_WERSJA || nag.rozmiar_rekordu != sizeof(ZdarzenieBin)) {
+        fprintf(stderr, "%s: nieobsługiwana wersja %u (rekord %u B)\n",
+                sciezka, nag.wersja, nag.rozmiar_rekordu);
+        fclose(plik);
+        return 1;
+    }
+
+    // Wczytanie wszystkich rekordów (niepełny rekord na końcu - pominięty)
+    long pojemnosc = 4096, liczba = 0;
+    ZdarzenieIdx* rekordy = malloc(pojemnosc * sizeof(ZdarzenieIdx));
+    ZdarzenieBin z;
+    while (rekordy && fread(&z, sizeof(z), 1, plik) == 1) {
+        if (liczba == pojemnosc) {
+            pojemnosc *= 2;
+            ZdarzenieIdx* nowe = realloc(rekordy, pojemnosc * sizeof(ZdarzenieIdx));
+            if (!nowe) {
+                free(rekordy);
+                rekordy = NULL;
+                break;
+            }
+            rekordy = nowe;
+        }
+        rekordy[liczba].z = z;
+        rekordy[liczba].indeks = liczba;
+        liczba++;
+    }
+    fclose(plik);
+    if (!rekordy) {
+        perror("Błąd malloc");
+        return 1;
+    }
+
+    if (sortuj) {
+        qsort(rekordy, liczba, sizeof(ZdarzenieIdx), porownaj_czas);
+    }
+
+    if (format == FORMAT_CSV) {
+        printf("t,pid,typ,nr,id,id2,wartosc,wartosc2\n");
+    }
+    for (long i = 0; i < liczba; i++) {
+        wypisz(&nag, &rekordy[i].z, format);
+    }
+
+    free(rekordy);
+    return 0;
+}
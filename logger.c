@@ -1,4 +1,4 @@
-// logger.c - kolorowe logi ANSI, sekwencyjny zapis do pliku
+// logger.c - kolorowe logi ANSI; zapis synchroniczny albo przez pierścień w shm i proces kolektora
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,13 +11,33 @@
 #include <pthread.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/shm.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <stddef.h>
 #include "logger.h"
+#include "zdarzenia.h"
 #include "struktury.h"
 #include "utils.h"
+#include "konfig.h"
 
 #define LOG_FILE "kolej_log.txt"
 #define REPORT_FILE "raport_karnetow.txt"
 
+// Nazwy plików bieżącej instancji (plik_instancji)
+static const char* plik_logu(void) {
+    static char nazwa[64];
+    if (nazwa[0] == '\0') plik_instancji(LOG_FILE, nazwa, sizeof(nazwa));
+    return nazwa;
+}
+
+static const char* plik_raportu(void) {
+    static char nazwa[64];
+    if (nazwa[0] == '\0') plik_instancji(REPORT_FILE, nazwa, sizeof(nazwa));
+    return nazwa;
+}
+
 static int log_fd = -1;        // Deskryptor pliku logów
 static int report_fd = -1;     // Deskryptor pliku raportu
 
@@ -66,26 +86,398 @@ static int safe_write(int fd, const char* data, size_t len) {
     return 0;
 }
 
+// Zapis całej tablicy iovec (writev może zapisać część)
+static int safe_writev(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t ret = writev(fd, iov, count);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return 0;
+}
+
+// Znacznik czasu HH:MM:SS.mmm - localtime tylko przy zmianie sekundy
+static void format_timestamp(long long czas_us, char* buffer, size_t size) {
+    static __thread time_t ostatnia_sekunda = -1;
+    static __thread struct tm ostatni_tm;
+
+    time_t sekunda = (time_t)(czas_us / 1000000);
+    if (sekunda != ostatnia_sekunda) {
+        localtime_r(&sekunda, &ostatni_tm);
+        ostatnia_sekunda = sekunda;
+    }
+    snprintf(buffer, size, "%02d:%02d:%02d.%03lld",
+             ostatni_tm.tm_hour, ostatni_tm.tm_min, ostatni_tm.tm_sec,
+             (czas_us % 1000000) / 1000);
+}
+
+static long long czas_monotoniczny_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static long long czas_teraz_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
 // Pobierz timestamp
 static void get_timestamp(char* buffer, size_t size) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    struct tm* tm_info = localtime(&tv.tv_sec);
-    
-    snprintf(buffer, size, "%02d:%02d:%02d.%03ld",
-             tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec,
-             tv.tv_usec / 1000);
+    format_timestamp(czas_teraz_us(), buffer, size);
+}
+
+// === Pierścień rekordów (LOG_ASYNC) ===
+// Ograniczona kolejka wielu producentów (wszystkie procesy) i jednego konsumenta
+// (kolektor). Każdy rekord ma numer sekwencyjny: seq == pozycja - wolny dla producenta,
+// seq == pozycja + 1 - opublikowany dla kolektora. Producent rezerwuje pozycję CAS-em
+// na liczniku zapisu, formatuje tekst w miejscu i publikuje; kolektor formatuje linie,
+// zwalnia rekord (seq += LOG_RING_SIZE) i zapisuje całą partię jednym writev.
+// Producent formatuje wpis przed rezerwacją, a do rekordu pisze dopiero po przejęciu
+// go CAS-em na seq (seq == LOG_ZAPIS | pid - zapis w toku). Rekord zarezerwowany, ale
+// nieprzejęty kolektor pomija po LOG_SLOT_TIMEOUT_MS (pomin_porzucony); spóźniony
+// producent nie przejmie już rekordu i niczego w nim nie zapisze. Rekord w trakcie
+// zapisu kolektor zwalnia tylko po śmierci producenta - zatrzymany może jeszcze pisać.
+
+#define LOG_TEKST_MAX 488
+#define LOG_ZAPIS (1UL << 63)           // seq rekordu w trakcie zapisu (młodsze bity - pid)
+
+typedef struct {
+    volatile unsigned long seq;
+    long long czas_us;          // CLOCK_REALTIME
+    pid_t pid;
+    unsigned short sender;      // LogSender
+    unsigned short dlugosc;
+    char tekst[LOG_TEKST_MAX];
+} RekordLogu;
+
+typedef struct {
+    volatile unsigned long zapis;       // Następna pozycja do rezerwacji przez producenta
+    volatile unsigned long odczyt;      // Następna pozycja kolektora
+    volatile unsigned long utracone;    // Odrzucone przy pełnym pierścieniu (LOG_FULL_DROP)
+    volatile unsigned int dzwonek;      // Futex - budzi śpiący kolektor
+    volatile unsigned int kolektor_spi;
+    volatile unsigned int postep;       // Futex - kolektor zwolnił rekordy
+    volatile unsigned int oczekujacy;   // Producenci/flush czekający na postep
+    volatile unsigned int koniec;       // Proces główny kończy logger
+    volatile unsigned int zakonczony;   // Futex - kolektor opróżnił pierścień i wyszedł
+    volatile pid_t kolektor_pid;
+    RekordLogu rekordy[LOG_RING_SIZE];
+} PierscienLogu;
+
+static PierscienLogu* g_ring = NULL;
+static int g_ring_id = -1;
+static bool g_collector = false;    // Proces główny uruchomił kolektor
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0
+#error "LOG_RING_SIZE musi być potęgą 2"
+#endif
+
+// Czy kolektor jeszcze działa (np. nie został zabity z zewnątrz)
+static bool kolektor_zyje(void) {
+    pid_t pid = g_ring->kolektor_pid;
+    if (g_ring->zakonczony) return false;
+    return pid == 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// Budzenie czekających na postep tylko gdy ktoś czeka - zwykle bez wywołania systemowego
+static void oglos_postep(void) {
+    __atomic_add_fetch(&g_ring->postep, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_ring->oczekujacy, __ATOMIC_SEQ_CST) > 0) {
+        powiadom_o_zmianie(&g_ring->postep);
+    }
+}
+
+static void czekaj_na_postep(void) {
+    unsigned int postep = odczytaj_slowo(&g_ring->postep);
+    __atomic_add_fetch(&g_ring->oczekujacy, 1, __ATOMIC_SEQ_CST);
+    powiadom_o_zmianie(&g_ring->dzwonek);
+    struct timespec termin;
+    termin_za_ms(&termin, LOG_FLUSH_MS);
+    czekaj_na_zmiane(&g_ring->postep, postep, &termin);
+    __atomic_sub_fetch(&g_ring->oczekujacy, 1, __ATOMIC_SEQ_CST);
+}
+
+// Wstawienie rekordu - false gdy odrzucony (pełny pierścień przy LOG_FULL_DROP, koniec)
+static bool pierscien_wstaw(LogSender sender, const char* format, va_list args) {
+    char tekst[LOG_TEKST_MAX];
+    int len = vsnprintf(tekst, sizeof(tekst), format, args);
+    if (len < 0) len = 0;
+    if (len >= (int)sizeof(tekst)) len = sizeof(tekst) - 1;
+    long long czas_us = czas_teraz_us();
+    pid_t pid = getpid();
+
+    while (!g_ring->koniec) {
+        unsigned long pozycja = __atomic_load_n(&g_ring->zapis, __ATOMIC_RELAXED);
+        RekordLogu* r = &g_ring->rekordy[pozycja & (LOG_RING_SIZE - 1)];
+        unsigned long seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pozycja) {
+            if (!__atomic_compare_exchange_n(&g_ring->zapis, &pozycja, pozycja + 1, false,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                continue;
+            }
+            unsigned long oczekiwany = pozycja;
+            if (!__atomic_compare_exchange_n(&r->seq, &oczekiwany, LOG_ZAPIS | (unsigned long)pid, false,
+                                             __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return false;   // Kolektor uznał rekord za porzucony (policzony w utracone)
+            }
+            r->pid = pid;
+            r->czas_us = czas_us;
+            r->sender = (unsigned short)sender;
+            r->dlugosc = (unsigned short)len;
+            memcpy(r->tekst, tekst, len);
+            __atomic_store_n(&r->seq, pozycja + 1, __ATOMIC_RELEASE);
+
+            // Dzwonek tylko do śpiącego kolektora (fence: publikacja przed odczytem flagi)
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (g_ring->kolektor_spi) {
+                powiadom_o_zmianie(&g_ring->dzwonek);
+            }
+            return true;
+        }
+
+        // Zapis w toku: pozycję zajął inny producent (licznik zapisu już dalej) albo
+        // rekord poprzedniego okrążenia jeszcze nie opublikowany - pełny pierścień
+        bool pelny = (seq & LOG_ZAPIS) ? __atomic_load_n(&g_ring->zapis, __ATOMIC_RELAXED) == pozycja
+                                       : (long)(seq - pozycja) < 0;
+        if (pelny) {
+            if (LOG_FULL_POLICY == LOG_FULL_DROP) {
+                __atomic_add_fetch(&g_ring->utracone, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+            if (!kolektor_zyje()) return false;
+            czekaj_na_postep();
+        }
+        // Inaczej pozycję zajął inny producent - ponów z nowym licznikiem
+    }
+    return false;
+}
+
+// Linie konsoli (z kolorami) i pliku dla jednego wpisu
+static int format_console_line(char* buf, size_t size, const char* timestamp,
+                               LogSender sender, pid_t pid, const char* message) {
+    int len = snprintf(buf, size, "%s[%s] %s(%d): %s%s\n",
+                       get_color(sender), timestamp, get_sender_name(sender), pid, message, ANSI_RESET);
+    return len < (int)size ? len : (int)size - 1;
+}
+
+static int format_file_line(char* buf, size_t size, const char* timestamp,
+                            LogSender sender, pid_t pid, const char* message) {
+    int len = snprintf(buf, size, "[%s] %s(%d): %s\n",
+                       timestamp, get_sender_name(sender), pid, message);
+    return len < (int)size ? len : (int)size - 1;
+}
+
+#define LOG_LINE_MAX (LOG_TEKST_MAX + 96)
+
+// Rekord na pozycji zarezerwowany, ale nieprzejęty przez producenta: zwolniony bez zapisu
+// po LOG_SLOT_TIMEOUT_MS i policzony w utracone. Rekord w trakcie zapisu - dopiero po
+// LOG_FLUSH_MS, gdy proces producenta już nie istnieje.
+// *od_us - chwila pierwszego zauważenia (0 - rekord nie czeka).
+static bool pomin_porzucony(unsigned long pozycja, long long* od_us) {
+    RekordLogu* r = &g_ring->rekordy[pozycja & (LOG_RING_SIZE - 1)];
+    unsigned long seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&g_ring->zapis, __ATOMIC_ACQUIRE) <= pozycja ||
+        (seq != pozycja && !(seq & LOG_ZAPIS))) {
+        *od_us = 0;
+        return false;
+    }
+    long long teraz = czas_monotoniczny_us();
+    if (*od_us == 0) {
+        *od_us = teraz;
+        return false;
+    }
+    long long czeka_ms = (teraz - *od_us) / 1000;
+    if (seq & LOG_ZAPIS) {
+        pid_t pid = (pid_t)(seq & ~LOG_ZAPIS);
+        if (czeka_ms < LOG_FLUSH_MS || kill(pid, 0) == 0 || errno != ESRCH) return false;
+    } else if (czeka_ms < LOG_SLOT_TIMEOUT_MS) {
+        return false;
+    }
+
+    if (!__atomic_compare_exchange_n(&r->seq, &seq, pozycja + LOG_RING_SIZE, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return false;   // Producent właśnie przejął lub opublikował rekord
+    }
+    __atomic_add_fetch(&g_ring->utracone, 1, __ATOMIC_RELAXED);
+    *od_us = 0;
+    return true;
+}
+
+// Proces kolektora: partie do LOG_BATCH rekordów, writev na konsolę i do pliku
+static void kolektor_logow(pid_t rodzic) {
+    static char konsola[LOG_BATCH + 1][LOG_LINE_MAX];
+    static char plik[LOG_BATCH + 1][LOG_LINE_MAX];
+    struct iovec iov_konsola[LOG_BATCH + 1];
+    struct iovec iov_plik[LOG_BATCH + 1];
+    char timestamp[32];
+
+    g_ring->kolektor_pid = getpid();
+    unsigned long pozycja = g_ring->odczyt;
+    long long porzucony_od = 0;
+    while (true) {
+        int n = 0;
+        while (n < LOG_BATCH) {
+            RekordLogu* r = &g_ring->rekordy[pozycja & (LOG_RING_SIZE - 1)];
+            if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != pozycja + 1) {
+                if (!pomin_porzucony(pozycja, &porzucony_od)) break;
+                pozycja++;
+                continue;
+            }
+            porzucony_od = 0;
+
+            r->tekst[r->dlugosc] = '\0';
+            format_timestamp(r->czas_us, timestamp, sizeof(timestamp));
+            iov_konsola[n].iov_base = konsola[n];
+            iov_konsola[n].iov_len = format_console_line(konsola[n], LOG_LINE_MAX, timestamp,
+                                                         (LogSender)r->sender, r->pid, r->tekst);
+            iov_plik[n].iov_base = plik[n];
+            iov_plik[n].iov_len = format_file_line(plik[n], LOG_LINE_MAX, timestamp,
+                                                   (LogSender)r->sender, r->pid, r->tekst);
+
+            __atomic_store_n(&r->seq, pozycja + LOG_RING_SIZE, __ATOMIC_RELEASE);
+            pozycja++;
+            n++;
+        }
+
+        unsigned long utracone = __atomic_exchange_n(&g_ring->utracone, 0, __ATOMIC_RELAXED);
+        if (utracone > 0) {
+            char message[128];
+            snprintf(message, sizeof(message), "Utracono %lu wpisów logu (pełny pierścień lub przerwany zapis)",
+                     utracone);
+            get_timestamp(timestamp, sizeof(timestamp));
+            iov_konsola[n].iov_base = konsola[n];
+            iov_konsola[n].iov_len = format_console_line(konsola[n], LOG_LINE_MAX, timestamp,
+                                                         LOG_SYSTEM, getpid(), message);
+            iov_plik[n].iov_base = plik[n];
+            iov_plik[n].iov_len = format_file_line(plik[n], LOG_LINE_MAX, timestamp,
+                                                   LOG_SYSTEM, getpid(), message);
+            n++;
+        }
+
+        if (n > 0) {
+            __atomic_store_n(&g_ring->odczyt, pozycja, __ATOMIC_RELEASE);
+            oglos_postep();
+            safe_writev(STDOUT_FILENO, iov_konsola, n);
+            if (log_fd >= 0) {
+                safe_writev(log_fd, iov_plik, n);
+            }
+            continue;
+        }
+
+        if (g_ring->koniec || (kill(rodzic, 0) == -1 && errno == ESRCH)) {
+            break;
+        }
+
+        // Sen do dzwonka - flaga przed ponownym sprawdzeniem, żeby nie zgubić wpisu
+        unsigned int dzwonek = odczytaj_slowo(&g_ring->dzwonek);
+        __atomic_store_n(&g_ring->kolektor_spi, 1, __ATOMIC_SEQ_CST);
+        RekordLogu* nastepny = &g_ring->rekordy[pozycja & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&nastepny->seq, __ATOMIC_ACQUIRE) != pozycja + 1 && !g_ring->koniec) {
+            struct timespec termin;
+            termin_za_ms(&termin, LOG_FLUSH_MS);
+            czekaj_na_zmiane(&g_ring->dzwonek, dzwonek, &termin);
+        }
+        __atomic_store_n(&g_ring->kolektor_spi, 0, __ATOMIC_SEQ_CST);
+    }
+
+    __atomic_store_n(&g_ring->zakonczony, 1, __ATOMIC_SEQ_CST);
+    powiadom_o_zmianie(&g_ring->zakonczony);
+}
+
+// Utworzenie pierścienia i procesu kolektora (proces główny)
+// Zwraca false gdy się nie udało - logger zostaje synchroniczny
+static bool uruchom_kolektor(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_LOG);
+    g_ring_id = shmget(klucz, sizeof(PierscienLogu), IPC_CREAT | 0600);
+    if (g_ring_id == -1) {
+        perror("Błąd shmget (pierścień loggera)");
+        return false;
+    }
+    g_ring = (PierscienLogu*)shmat(g_ring_id, NULL, 0);
+    if (g_ring == (PierscienLogu*)-1) {
+        perror("Błąd shmat (pierścień loggera)");
+        g_ring = NULL;
+        return false;
+    }
+
+    memset(g_ring, 0, offsetof(PierscienLogu, rekordy));
+    for (unsigned long i = 0; i < LOG_RING_SIZE; i++) {
+        g_ring->rekordy[i].seq = i;
+    }
+
+    // Podwójny fork - kolektor nie jest dzieckiem procesu głównego, więc nie blokuje
+    // wątku sprzątającego (waitpid(-1)); zakończenie sygnalizuje flaga w pierścieniu
+    fflush(stdout);
+    pid_t rodzic = getpid();
+    pid_t posrednik = fork();
+    if (posrednik == -1) {
+        perror("Błąd fork() kolektora logów");
+        shmdt(g_ring);
+        shmctl(g_ring_id, IPC_RMID, NULL);
+        g_ring = NULL;
+        return false;
+    }
+    if (posrednik == 0) {
+        if (fork() == 0) {
+            // Kolektor kończy na koniec loggera (lub śmierć rodzica), nie na sygnały symulacji
+            signal(SIGINT, SIG_IGN);
+            signal(SIGTERM, SIG_IGN);
+            signal(SIGUSR1, SIG_IGN);
+            signal(SIGUSR2, SIG_IGN);
+            kolektor_logow(rodzic);
+        }
+        _exit(0);
+    }
+    waitpid(posrednik, NULL, 0);
+    g_collector = true;
+    return true;
+}
+
+// Dołączenie do pierścienia utworzonego przez proces główny (procesy potomne)
+static bool dolacz_pierscien(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_LOG);
+    int id = shmget(klucz, sizeof(PierscienLogu), 0600);
+    if (id == -1) return false;
+    PierscienLogu* ring = (PierscienLogu*)shmat(id, NULL, 0);
+    if (ring == (PierscienLogu*)-1) return false;
+    g_ring = ring;
+    return true;
+}
+
+void logger_flush(void) {
+    if (g_ring == NULL) return;
+    // Termin całkowity - kolektor zatrzymany na porzuconym rekordzie nie blokuje końca
+    unsigned long cel = __atomic_load_n(&g_ring->zapis, __ATOMIC_ACQUIRE);
+    long long termin_us = czas_monotoniczny_us() + LOG_FLUSH_DEADLINE_MS * 1000LL;
+    while (__atomic_load_n(&g_ring->odczyt, __ATOMIC_ACQUIRE) < cel && kolektor_zyje() &&
+           czas_monotoniczny_us() < termin_us) {
+        czekaj_na_postep();
+    }
 }
 
 void logger_init(void) {
     // Otwórz plik logów
-    log_fd = open(LOG_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    log_fd = open(plik_logu(), O_WRONLY | O_CREAT | O_APPEND, 0644);
     if (log_fd < 0) {
         perror("Nie można otworzyć pliku logów");
     }
     
     // Otwórz plik raportu
-    report_fd = open(REPORT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    report_fd = open(plik_raportu(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (report_fd < 0) {
         perror("Nie można otworzyć pliku raportu");
     }
@@ -98,6 +490,12 @@ void logger_init(void) {
             safe_write(log_fd, header, strlen(header));
         }
     }
+
+    zdarzenia_init(true);
+
+    if (LOG_ASYNC) {
+        uruchom_kolektor();
+    }
 }
 
 void logger_init_child(void) {
@@ -110,19 +508,43 @@ void logger_init_child(void) {
         close(report_fd);
         report_fd = -1;
     }
+
+    zdarzenia_init(false);
+
+    // Tryb asynchroniczny - pliki obsługuje kolektor
+    if (LOG_ASYNC && dolacz_pierscien()) {
+        return;
+    }
     
-    log_fd = open(LOG_FILE, O_WRONLY | O_APPEND);
+    log_fd = open(plik_logu(), O_WRONLY | O_APPEND);
     if (log_fd < 0) {
         perror("Nie można otworzyć pliku logów (child)");
     }
     
-    report_fd = open(REPORT_FILE, O_WRONLY | O_APPEND);
+    report_fd = open(plik_raportu(), O_WRONLY | O_APPEND);
     if (report_fd < 0) {
         perror("Nie można otworzyć pliku raportu (child)");
     }
 }
 
 void logger_close(void) {
+    zdarzenia_zamknij();
+
+    if (g_ring != NULL && g_collector) {
+        // Kolektor opróżnia pierścień i kończy
+        __atomic_store_n(&g_ring->koniec, 1, __ATOMIC_SEQ_CST);
+        powiadom_o_zmianie(&g_ring->dzwonek);
+        while (kolektor_zyje()) {
+            struct timespec termin;
+            termin_za_ms(&termin, LOG_FLUSH_MS);
+            czekaj_na_zmiane(&g_ring->zakonczony, 0, &termin);
+        }
+        shmdt(g_ring);
+        shmctl(g_ring_id, IPC_RMID, NULL);
+        g_ring = NULL;
+        g_collector = false;
+    }
+
     if (log_fd >= 0) {
         const char* footer = "========== KONIEC SYMULACJI ==========\n";
         safe_write(log_fd, footer, strlen(footer));
@@ -137,6 +559,19 @@ void logger_close(void) {
 }
 
 void logger(LogSender sender, const char* format, ...) {
+    va_list args;
+
+    // Pomiary (LOG_ENABLED 0) - bez formatowania i zapisu
+    if (!LOG_ENABLED) return;
+
+    // Tryb asynchroniczny - rekord do pierścienia (odrzucony przy pełnym przy LOG_FULL_DROP)
+    if (g_ring != NULL && !g_ring->koniec) {
+        va_start(args, format);
+        pierscien_wstaw(sender, format, args);
+        va_end(args);
+        return;
+    }
+
     char timestamp[32];
     char message[1024];
     char console_line[2048];
@@ -145,33 +580,27 @@ void logger(LogSender sender, const char* format, ...) {
     get_timestamp(timestamp, sizeof(timestamp));
     
     // Formatowanie
-    va_list args;
     va_start(args, format);
     vsnprintf(message, sizeof(message), format, args);
     va_end(args);
     
     pid_t pid = getpid();
-    const char* color = get_color(sender);
-    const char* name = get_sender_name(sender);
     
     // Linia do konsoli (z kolorami)
-    snprintf(console_line, sizeof(console_line),
-             "%s[%s] %s(%d): %s%s\n",
-             color, timestamp, name, pid, message, ANSI_RESET);
-    
-    write(STDOUT_FILENO, console_line, strlen(console_line));
+    int len = format_console_line(console_line, sizeof(console_line), timestamp, sender, pid, message);
+    write(STDOUT_FILENO, console_line, len);
     
     // Linia do pliku (bez kolorów)
-    int len = snprintf(file_line, sizeof(file_line),
-             "[%s] %s(%d): %s\n",
-             timestamp, name, pid, message);
-    
+    len = format_file_line(file_line, sizeof(file_line), timestamp, sender, pid, message);
     if (log_fd >= 0 && len > 0) {
         safe_write(log_fd, file_line, len);
     }
 }
 
 void logger_report(const char* format, ...) {
+    // Raport po wpisach, które są jeszcze w pierścieniu
+    logger_flush();
+
     char line[1024];
     char file_line[1100];
     char timestamp[32];
@@ -220,10 +649,10 @@ void logger_report_file_only(const char* format, ...) {
 }
 
 void logger_clear_files(void) {
-    FILE* fd = fopen(LOG_FILE, "w");
+    FILE* fd = fopen(plik_logu(), "w");
     if (fd != NULL) fclose(fd);
     
-    fd = fopen(REPORT_FILE, "w");
+    fd = fopen(plik_raportu(), "w");
     if (fd != NULL) fclose(fd);
 }
 
@@ -240,11 +669,14 @@ void rejestruj_przejscie_bramki(int ticket_id, int gate_number) {
 
     // Użycie SEM_GATES dla rejestrowania przejść przez bramki
     sem_opusc(sem_id, SEM_GATES);
-    if (shm->gate_entries_count < MAX_GATE_ENTRIES) {
-        shm->gate_entries[shm->gate_entries_count].ticket_id = ticket_id;
-        shm->gate_entries[shm->gate_entries_count].entry_time = time(NULL);
-        shm->gate_entries[shm->gate_entries_count].gate_number = gate_number;
+    if (shm->gate_entries_count < shm->max_gate_entries) {
+        WpisBramki* wpis = &przejscia_bramek(shm)[shm->gate_entries_count];
+        wpis->ticket_id = ticket_id;
+        wpis->entry_time = time(NULL);
+        wpis->gate_number = gate_number;
         shm->gate_entries_count++;
+    } else {
+        shm->gate_entries_dropped++;
     }
     sem_podnies(sem_id, SEM_GATES);
 
@@ -257,35 +689,35 @@ void generuj_raport_koncowy(void) {
     SharedMemory* shm = dolacz_pamiec(shm_id);
     int sem_id = polacz_semafory();
 
-    // Kopiuj dane o zjazdach per bilet (SEM_STATS)
-    sem_opusc(sem_id, SEM_STATS);
-    int max_ticket_id = shm->next_ticket_id;
+    // Spójna kopia statystyk (seqlock) i liczniki zjazdów per bilet
+    MigawkaStatystyk m;
+    statystyki_migawka(shm, &m);
+    // Karnety poza tablicą przejazdów (więcej sprzedanych niż max_tickets) pominięte
+    int max_ticket_id = shm->next_ticket_id + 1;
+    if (max_ticket_id > shm->max_tickets) {
+        max_ticket_id = shm->max_tickets;
+    }
     int* ticket_rides = NULL;
     if (max_ticket_id > 0) {
         ticket_rides = malloc(max_ticket_id * sizeof(int));
         if (ticket_rides) {
-            memcpy(ticket_rides, shm->ticket_rides, max_ticket_id * sizeof(int));
+            _Atomic int* przejazdy = przejazdy_karnetow(shm);
+            for (int i = 0; i < max_ticket_id; i++) {
+                ticket_rides[i] = licznik_odczytaj(przejazdy[i]);
+            }
         }
     }
-    sem_podnies(sem_id, SEM_STATS);
 
     // Kopiowanie danych o przejściach przez bramki (SEM_GATES)
     sem_opusc(sem_id, SEM_GATES);
     int gate_entries_count = shm->gate_entries_count;
-    struct {
-        int ticket_id;
-        time_t entry_time;
-        int gate_number;
-    } *gate_entries = NULL;
+    int gate_entries_dropped = shm->gate_entries_dropped;
+    WpisBramki* gate_entries = NULL;
 
     if (gate_entries_count > 0) {
         gate_entries = malloc(gate_entries_count * sizeof(*gate_entries));
         if (gate_entries) {
-            for (int i = 0; i < gate_entries_count; i++) {
-                gate_entries[i].ticket_id = shm->gate_entries[i].ticket_id;
-                gate_entries[i].entry_time = shm->gate_entries[i].entry_time;
-                gate_entries[i].gate_number = shm->gate_entries[i].gate_number;
-            }
+            memcpy(gate_entries, przejscia_bramek(shm), gate_entries_count * sizeof(*gate_entries));
         }
     }
     sem_podnies(sem_id, SEM_GATES);
@@ -311,6 +743,10 @@ void generuj_raport_koncowy(void) {
     } else {
         logger_report_file_only("Brak zarejestrowanych przejsc.");
     }
+    if (gate_entries_dropped > 0) {
+        logger_report_file_only("Pominieto %d przejsc (pelny rejestr: %d wpisow)",
+                                gate_entries_dropped, gate_entries_count);
+    }
     
     logger_report_file_only("");
     logger_report_file_only("============================================================");
@@ -340,13 +776,15 @@ void generuj_raport_koncowy(void) {
     
     int total_tickets = 0;
     for (int i = 0; i < TICKET_TYPE_COUNT; i++) {
-        total_tickets += shm->tickets_sold[i];
+        total_tickets += m.tickets_sold[i];
     }
 
-    double avg_per_chair = shm->chair_departures > 0 ?
-        (double)shm->passengers_transported / shm->chair_departures : 0.0;
+    double avg_per_chair = m.chair_departures > 0 ?
+        (double)m.passengers_transported / m.chair_departures : 0.0;
+    double avg_wait_s = m.platform_boarded > 0 ?
+        m.platform_wait_total_ms / 1000.0 / m.platform_boarded : 0.0;
 
-    int total_trail = shm->trail_usage[TRAIL_T1] + shm->trail_usage[TRAIL_T2] + shm->trail_usage[TRAIL_T3];
+    int total_trail = m.trail_usage[TRAIL_T1] + m.trail_usage[TRAIL_T2] + m.trail_usage[TRAIL_T3];
 
     logger_report("");
     logger_report("============================================================");
@@ -354,34 +792,50 @@ void generuj_raport_koncowy(void) {
     logger_report("============================================================");
     logger_report("");
     logger_report("1. SPRZEDAZ BILETOW:");
-    logger_report("   Jednorazowe (SINGLE):     %d szt.", shm->tickets_sold[TICKET_SINGLE]);
-    logger_report("   Czasowe TK1 (1h):         %d szt.", shm->tickets_sold[TICKET_TK1]);
-    logger_report("   Czasowe TK2 (2h):         %d szt.", shm->tickets_sold[TICKET_TK2]);
-    logger_report("   Czasowe TK3 (3h):         %d szt.", shm->tickets_sold[TICKET_TK3]);
-    logger_report("   Dzienne (DAILY):          %d szt.", shm->tickets_sold[TICKET_DAILY]);
+    logger_report("   Jednorazowe (SINGLE):     %d szt.", m.tickets_sold[TICKET_SINGLE]);
+    logger_report("   Czasowe TK1 (1h):         %d szt.", m.tickets_sold[TICKET_TK1]);
+    logger_report("   Czasowe TK2 (2h):         %d szt.", m.tickets_sold[TICKET_TK2]);
+    logger_report("   Czasowe TK3 (3h):         %d szt.", m.tickets_sold[TICKET_TK3]);
+    logger_report("   Dzienne (DAILY):          %d szt.", m.tickets_sold[TICKET_DAILY]);
     logger_report("   RAZEM:                    %d szt.", total_tickets);
     logger_report("");
     logger_report("2. STATYSTYKI PRZEJAZDOW:");
-    logger_report("   Odjazdy krzeselek:        %d", shm->chair_departures);
-    logger_report("   Przewiezione osoby:       %d", shm->passengers_transported);
-    logger_report("   - Rowerzysci:             %d", shm->cyclists_transported);
-    logger_report("   - Piesi:                  %d", shm->pedestrians_transported);
+    logger_report("   Odjazdy krzeselek:        %d", m.chair_departures);
+    logger_report("   Przewiezione osoby:       %d", m.passengers_transported);
+    logger_report("   - Rowerzysci:             %d", m.cyclists_transported);
+    logger_report("   - Piesi:                  %d", m.pedestrians_transported);
     logger_report("   Sr. osob/krzeslo:         %.2f", avg_per_chair);
+    for (int i = 1; i <= CHAIR_CAPACITY; i++) {
+        logger_report("   - Krzeselka z %d os.:      %d", i, m.chair_occupancy[i]);
+    }
+    logger_report("   Polityka pakowania:       %s",
+                  nazwa_polityki_pakowania((PackingPolicy)shm->packing_policy));
+    logger_report("   Sr. czekanie na peronie:  %.1f s (maks. %.1f s)",
+                  avg_wait_s, m.platform_wait_max_ms / 1000.0);
+    logger_report("   Wyprzedzenia w kolejce:   %d", m.packing_skips);
+    logger_report("   Do wsiadania p50/p95/p99: %.1f / %.1f / %.1f ms",
+                  histogram_percentyl(m.czas_do_wsiadania, 50) / 1000.0,
+                  histogram_percentyl(m.czas_do_wsiadania, 95) / 1000.0,
+                  histogram_percentyl(m.czas_do_wsiadania, 99) / 1000.0);
+    logger_report("   Na szczyt p50/p95/p99:    %.1f / %.1f / %.1f ms",
+                  histogram_percentyl(m.czas_na_szczyt, 50) / 1000.0,
+                  histogram_percentyl(m.czas_na_szczyt, 95) / 1000.0,
+                  histogram_percentyl(m.czas_na_szczyt, 99) / 1000.0);
     logger_report("");
     logger_report("3. KATEGORIE SPECJALNE:");
-    logger_report("   VIP obsluzeni:            %d", shm->vip_served);
-    logger_report("   Dzieci z opiekunem:       %d", shm->children_with_guardian);
-    logger_report("   Odrzuceni (wygasly):      %d", shm->rejected_expired);
+    logger_report("   VIP obsluzeni:            %d", m.vip_served);
+    logger_report("   Dzieci z opiekunem:       %d", m.children_with_guardian);
+    logger_report("   Odrzuceni (wygasly):      %d", m.rejected_expired);
     logger_report("");
     logger_report("4. TRASY ZJAZDOWE:");
-    logger_report("   T1 (latwa, %ds):          %d turystow", TRAIL_T1_TIME, shm->trail_usage[TRAIL_T1]);
-    logger_report("   T2 (srednia, %ds):        %d turystow", TRAIL_T2_TIME, shm->trail_usage[TRAIL_T2]);
-    logger_report("   T3 (trudna, %ds):         %d turystow", TRAIL_T3_TIME, shm->trail_usage[TRAIL_T3]);
+    logger_report("   T1 (latwa, %ds):          %d turystow", konfig()->trail_time[TRAIL_T1], m.trail_usage[TRAIL_T1]);
+    logger_report("   T2 (srednia, %ds):        %d turystow", konfig()->trail_time[TRAIL_T2], m.trail_usage[TRAIL_T2]);
+    logger_report("   T3 (trudna, %ds):         %d turystow", konfig()->trail_time[TRAIL_T3], m.trail_usage[TRAIL_T3]);
     logger_report("   RAZEM na trasach:         %d turystow", total_trail);
     logger_report("");
     logger_report("5. PODSUMOWANIE TURYSTOW:");
-    logger_report("   Utworzonych turystow:     %d", shm->total_tourists_created);
-    logger_report("   Zakonczonych wizyt:       %d", shm->total_tourists_finished);
+    logger_report("   Utworzonych turystow:     %d", m.total_tourists_created);
+    logger_report("   Zakonczonych wizyt:       %d", m.total_tourists_finished);
     logger_report("");
     logger_report("============================================================");
     logger_report("");
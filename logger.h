@@ -16,15 +16,24 @@ typedef enum {
     LOG_REPORT
 } LogSender;
 
+// Zachowanie przy pełnym pierścieniu (LOG_FULL_POLICY)
+typedef enum {
+    LOG_FULL_DROP = 0,      // Rekord odrzucony, kolektor raportuje liczbę utraconych
+    LOG_FULL_WAIT           // Producent czeka na zwolnienie miejsca przez kolektor
+} LogFullPolicy;
+
 // Inicjalizacja i zamykanie loggera
 void logger_init(void);
 
 // inicjalizacja dla procesów potomnych
 void logger_init_child(void);
 
-// Zamknięcie loggera
+// Zamknięcie loggera (proces główny - kończy też kolektor)
 void logger_close(void);
 
+// Czekanie aż kolektor zapisze wszystkie rekordy z pierścienia (LOG_ASYNC)
+void logger_flush(void);
+
 // Główna funkcja logowania
 void logger(LogSender sender, const char* format, ...);
 
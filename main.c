@@ -5,22 +5,40 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
+#include <limits.h>
+#include <libgen.h>
 #include <sys/wait.h>
-#include <sys/msg.h>
 #include <pthread.h>
 #include "struktury.h"
 #include "utils.h"
 #include "logger.h"
+#include "kanaly.h"
+#include "skrzynki.h"
+#include "harmonogram.h"
+#include "konfig.h"
+#include "metryki.h"
 
 // Globalne zmienne
 static volatile sig_atomic_t shutdown_flag = 0;
 static volatile sig_atomic_t interrupt_flag = 0;
 
 static int g_sem_id = -1;
-static int g_msg_id = -1;
-static int g_msg_worker_id = -1;
+static int g_kanaly_id = -1;
+static int g_skrzynki_id = -1;
+static int g_konfig_id = -1;
 static int g_shm_id = -1;
 static SharedMemory* g_shm = NULL;
+static StatystykiShard* g_stat = NULL;
+
+// Ziarno strumieni losowych i ślad przybyć (-e zapis, -r odtworzenie)
+static unsigned long long g_ziarno = 0;
+static ZapisSladu g_slad_zapis;
+static OdczytSladu g_slad_odczyt;
+static bool g_odtwarzanie = false;
+
+// Katalog programów potomnych - ten sam co ./kolej, niezależnie od katalogu roboczego
+// (przegląd parametrów uruchamia instancje w osobnych katalogach roboczych)
+static char g_katalog_programow[PATH_MAX] = ".";
 
 static pid_t cashier_pid = 0;
 static pid_t worker1_pid = 0;
@@ -31,6 +49,7 @@ static pid_t worker2_pid = 0;
 static pid_t tourist_pids[MAX_TOURIST_PROCESSES];
 static int tourist_pid_count = 0;
 static pthread_mutex_t tourist_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tourist_cond = PTHREAD_COND_INITIALIZER;   // Zmiana tourist_pid_count
 
 // Handler sygnałów
 void main_signal_handler(int sig) {
@@ -48,27 +67,41 @@ void* reaper_thread(void* arg) {
     
     while (!shutdown_flag || tourist_pid_count > 0) {
         int status;
-        pid_t finished_pid;
-        
-        while ((finished_pid = waitpid(-1, &status, WNOHANG)) > 0) {
-            if (finished_pid == worker1_pid || finished_pid == worker2_pid || finished_pid == cashier_pid) {
-                continue;
+        // Blokujące czekanie na dowolne dziecko
+        pid_t finished_pid = waitpid(-1, &status, 0);
+
+        if (finished_pid == -1) {
+            if (errno == ECHILD) {
+                // Brak dzieci - krótka drzemka zamiast aktywnego czekania
+                struct timespec termin;
+                termin_za_ms(&termin, IDLE_WAIT_MS);
+                uspij_do(&termin);
             }
-            
-            pthread_mutex_lock(&tourist_mutex);
-            
-            // Usunięcie z listy turystów
-            for (int i = 0; i < tourist_pid_count; i++) {
-                if (tourist_pids[i] == finished_pid) {
-                    tourist_pids[i] = tourist_pids[tourist_pid_count - 1];
-                    tourist_pid_count--;
-                    break;
-                }
+            continue;
+        }
+
+        // Proces zabity sygnałem nie cofnął swoich operacji z korektą (KOLEJ_SEM_FUTEX)
+        if (WIFSIGNALED(status)) {
+            sem_odzyskaj_proces(g_sem_id, finished_pid);
+        }
+
+        if (finished_pid == worker1_pid || finished_pid == worker2_pid || finished_pid == cashier_pid) {
+            continue;
+        }
+        
+        pthread_mutex_lock(&tourist_mutex);
+        
+        // Usunięcie z listy turystów
+        for (int i = 0; i < tourist_pid_count; i++) {
+            if (tourist_pids[i] == finished_pid) {
+                tourist_pids[i] = tourist_pids[tourist_pid_count - 1];
+                tourist_pid_count--;
+                break;
             }
-            
-            pthread_mutex_unlock(&tourist_mutex);
         }
+        pthread_cond_broadcast(&tourist_cond);
         
+        pthread_mutex_unlock(&tourist_mutex);
     }
     
     return NULL;
@@ -89,8 +122,23 @@ void send_signal_to_all(int sig) {
     pthread_mutex_unlock(&tourist_mutex);
 }
 
+static void ustal_katalog_programow(void) {
+    char sciezka[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", sciezka, sizeof(sciezka) - 1);
+    if (n <= 0) return;
+    sciezka[n] = '\0';
+    snprintf(g_katalog_programow, sizeof(g_katalog_programow), "%s", dirname(sciezka));
+}
+
+// Ścieżka programu potomnego (wywoływane po fork, bufor procesu potomnego)
+static const char* program(const char* nazwa) {
+    static char sciezka[PATH_MAX + 32];
+    snprintf(sciezka, sizeof(sciezka), "%s/%s", g_katalog_programow, nazwa);
+    return sciezka;
+}
+
 // Utworzenie procesu turysty
-pid_t create_tourist(int tourist_id, int age, TouristType type, bool is_vip, int children_count) {
+pid_t create_tourist(const TouristDescriptor* d) {
     pid_t pid = fork();
     
     if (pid == -1) {
@@ -99,16 +147,16 @@ pid_t create_tourist(int tourist_id, int age, TouristType type, bool is_vip, int
     }
 
     if (pid == 0) {
-        //logger(LOG_SYSTEM,"TURYSTA #%d!",tourist_id);
         // Proces potomny
-        char id_str[16], age_str[16], type_str[16], vip_str[16], children_str[16];
-        snprintf(id_str, sizeof(id_str), "%d", tourist_id);
-        snprintf(age_str, sizeof(age_str), "%d", age);
-        snprintf(type_str, sizeof(type_str), "%d", type);
-        snprintf(vip_str, sizeof(vip_str), "%d", is_vip ? 1 : 0);
-        snprintf(children_str, sizeof(children_str), "%d", children_count);
+        char id_str[16], age_str[16], type_str[16], vip_str[16], children_str[16], ticket_str[16];
+        snprintf(id_str, sizeof(id_str), "%d", d->tourist_id);
+        snprintf(age_str, sizeof(age_str), "%d", d->age);
+        snprintf(type_str, sizeof(type_str), "%d", d->type);
+        snprintf(vip_str, sizeof(vip_str), "%d", d->is_vip ? 1 : 0);
+        snprintf(children_str, sizeof(children_str), "%d", d->children_count);
+        snprintf(ticket_str, sizeof(ticket_str), "%d", d->ticket_type);
         
-        execl("./tourist", "tourist", id_str, age_str, type_str, vip_str, children_str, NULL);
+        execl(program("tourist"), "tourist", id_str, age_str, type_str, vip_str, children_str, ticket_str, NULL);
         perror("Błąd execl() przy uruchamianiu turysty");
         _exit(1);
     }
@@ -116,6 +164,41 @@ pid_t create_tourist(int tourist_id, int age, TouristType type, bool is_vip, int
     return pid;
 }
 
+// Uruchomienie gospodarzy puli turystów (./tourist --host nr - nr wybiera shard statystyk)
+// Zwraca liczbę uruchomionych gospodarzy
+int create_tourist_hosts(void) {
+    int hosts = TOURIST_POOL_HOSTS;
+    if (hosts <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        hosts = cores > 0 ? (int)cores : 1;
+    }
+
+    int started = 0;
+    for (int i = 0; i < hosts; i++) {
+        // fork pod blokadą listy - jak przy pojedynczych turystach
+        pthread_mutex_lock(&tourist_mutex);
+        pid_t pid = fork();
+        if (pid == 0) {
+            char nr[16];
+            snprintf(nr, sizeof(nr), "%d", i);
+            execl(program("tourist"), "tourist", "--host", nr, NULL);
+            perror("Błąd execl() przy uruchamianiu gospodarza turystów");
+            _exit(1);
+        }
+        if (pid > 0 && tourist_pid_count < MAX_TOURIST_PROCESSES) {
+            tourist_pids[tourist_pid_count++] = pid;
+        }
+        pthread_mutex_unlock(&tourist_mutex);
+
+        if (pid == -1) {
+            perror("Błąd fork() przy tworzeniu gospodarza turystów");
+            continue;
+        }
+        started++;
+    }
+    return started;
+}
+
 // Inicjalizacja pamięci dzielonej
 void init_shared_memory(void) {
     memset(g_shm, 0, sizeof(SharedMemory));
@@ -126,6 +209,8 @@ void init_shared_memory(void) {
     g_shm->cashier_open = false;  // Kasa zamknięta na początku
     g_shm->simulation_start = time(NULL);
     g_shm->simulation_end = 0;
+    zegar_start(g_shm, konfig()->sim_second_ns);
+    g_shm->ziarno = g_ziarno;
     
     // Inicjalizacja krzesełek
     for (int i = 0; i < MAX_CHAIRS; i++) {
@@ -144,9 +229,67 @@ void init_shared_memory(void) {
     g_shm->next_ticket_id = 0;
     g_shm->next_chair_id = 0;
     g_shm->gate_entries_count = 0;
+    pamiec_ustaw_tablice(g_shm);
+}
+
+// Metryki przebiegu (KOLEJ_METRYKI, format w metryki.h) - czasy rzeczywiste,
+// percentyle z histogramów turystów w ms; na końcu pełna konfiguracja
+static void zapisz_metryki(const char* plik, const struct timespec* start) {
+    struct timespec koniec;
+    clock_gettime(CLOCK_MONOTONIC, &koniec);
+    double czas_s = (koniec.tv_sec - start->tv_sec) + (koniec.tv_nsec - start->tv_nsec) / 1e9;
+
+    MigawkaStatystyk m;
+    statystyki_migawka(g_shm, &m);
+
+    FILE* f = fopen(plik, "w");
+    if (f == NULL) {
+        perror("fopen metryki");
+        return;
+    }
+    const Konfiguracja* k = konfig();
+    fprintf(f, METRYKA_TURYSCI "=%d\n", k->total_tourists);
+    fprintf(f, METRYKA_STACJA "=%d\n", k->station_capacity);
+    fprintf(f, METRYKA_KRZESELKA "=%d\n", k->max_active_chairs);
+    fprintf(f, METRYKA_CZAS "=%.3f\n", czas_s);
+    fprintf(f, METRYKA_UTWORZENI "=%d\n", m.total_tourists_created);
+    fprintf(f, METRYKA_ZAKONCZENI "=%d\n", m.total_tourists_finished);
+    fprintf(f, METRYKA_ODJAZDY "=%d\n", m.chair_departures);
+    fprintf(f, METRYKA_PRZEWIEZIENI "=%d\n", m.passengers_transported);
+    // Kolumny percentyli: wsiadanie p50/p95/p99, potem szczyt
+    const int* histogramy[] = {m.czas_do_wsiadania, m.czas_na_szczyt};
+    for (int kol = K_WSIADANIE_P50; kol <= K_SZCZYT_P99; kol++) {
+        int etap = (kol - K_WSIADANIE_P50) / LICZBA_PERCENTYLI;
+        int percentyl = PERCENTYLE_METRYK[(kol - K_WSIADANIE_P50) % LICZBA_PERCENTYLI];
+        fprintf(f, "%s=%.3f\n", KOLUMNY[kol], histogram_percentyl(histogramy[etap], percentyl) / 1000.0);
+    }
+    konfig_wypisz(k, f);
+    fclose(f);
+}
+
+// Wiersz śladu (-e) z chwilą symulacji przekazania turysty
+static void zapisz_przybycie(Przybycie* p) {
+    if (g_slad_zapis.f == NULL) return;
+    p->czas_ms = zegar_teraz_ms(g_shm);
+    slad_dopisz(&g_slad_zapis, p);
+}
+
+static void uzycie(const char* prog) {
+    fprintf(stderr, "Użycie: %s [-c plik_konfiguracji] [-o KLUCZ=wartość]... [-s ziarno] "
+                    "[-e zapis_sladu] [-r slad_przybyc] [-i instancja]\n", prog);
+    fprintf(stderr, "  -c  konfiguracja z pliku (wiersze KLUCZ = wartość, komentarze od #)\n");
+    fprintf(stderr, "  -o  nadpisanie jednego klucza (po pliku -c, można powtarzać), klucze:\n");
+    fprintf(stderr, "      TOTAL_TOURISTS STATION_CAPACITY MAX_ACTIVE_CHAIRS ENTRY_GATES PLATFORM_GATES\n");
+    fprintf(stderr, "      EXIT_GATES CASHIER_QUEUE_LIMIT PLATFORM_QUEUE_LIMIT TRAIL_T1_TIME TRAIL_T2_TIME\n");
+    fprintf(stderr, "      TRAIL_T3_TIME EMERGENCY_CHANCE SIM_SECOND_NS\n");
+    fprintf(stderr, "  -s  ziarno strumieni losowych (domyślnie KOLEJ_SEED, ziarno śladu -r lub czas)\n");
+    fprintf(stderr, "  -e  zapis harmonogramu przybyć do pliku śladu (.bin - binarny, inaczej CSV)\n");
+    fprintf(stderr, "  -r  przybycia z pliku śladu (CSV lub binarny, np. z kolej-slad) w zapisanych chwilach\n");
+    fprintf(stderr, "  -i  numer instancji 0..%d (domyślnie %s lub 0) - własne klucze IPC i pliki logów,\n"
+                    "      kilka symulacji może działać jednocześnie w jednym katalogu\n", MAX_INSTANCJA, ENV_INSTANCJA);
 }
 
-int main(void) {
+int main(int argc, char* argv[]) {
     // Konfiguracja sygnałów
     struct sigaction sa;
     sa.sa_handler = main_signal_handler;
@@ -160,30 +303,97 @@ int main(void) {
     signal(SIGUSR1, SIG_IGN);
     signal(SIGUSR2, SIG_IGN);
     
-    srand(time(NULL));
+    // Pomiary (bench/bench_symulacja): stałe ziarno i plik metryk ze zmiennych środowiska
+    const char* ziarno = getenv("KOLEJ_SEED");
+    const char* plik_metryk = getenv("KOLEJ_METRYKI");
+    const char* plik_zapisu = NULL;
+    const char* plik_odczytu = NULL;
+    const char* plik_konfiguracji = NULL;
+    const char* nadpisania[64];
+    int liczba_nadpisan = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:o:s:e:r:i:")) != -1) {
+        switch (opt) {
+            case 'c': plik_konfiguracji = optarg; break;
+            case 'o':
+                if (liczba_nadpisan == (int)(sizeof(nadpisania) / sizeof(nadpisania[0]))) {
+                    fprintf(stderr, "Za dużo opcji -o\n");
+                    return 2;
+                }
+                nadpisania[liczba_nadpisan++] = optarg;
+                break;
+            case 's': ziarno = optarg; break;
+            case 'e': plik_zapisu = optarg; break;
+            case 'r': plik_odczytu = optarg; break;
+            case 'i':
+                if (ustaw_instancje(optarg) != 0) return 2;
+                break;
+            default: uzycie(argv[0]); return 2;
+        }
+    }
+
+    // Konfiguracja: domyślna, plik -c, potem -o w kolejności podania
+    Konfiguracja k;
+    konfig_domyslna(&k);
+    if (plik_konfiguracji != NULL && konfig_wczytaj_plik(&k, plik_konfiguracji) != 0) return 2;
+    for (int i = 0; i < liczba_nadpisan; i++) {
+        if (konfig_ustaw(&k, nadpisania[i]) != 0) return 2;
+    }
+
+    // Ziarno: -s / KOLEJ_SEED, potem ziarno zapisane w śladzie, na końcu czas i PID
+    if (plik_odczytu != NULL) {
+        if (slad_otworz(plik_odczytu, &g_slad_odczyt) != 0) return 1;
+        g_odtwarzanie = true;
+    }
+    if (ziarno != NULL) {
+        g_ziarno = strtoull(ziarno, NULL, 10);
+    } else if (g_odtwarzanie && g_slad_odczyt.ma_ziarno) {
+        g_ziarno = g_slad_odczyt.ziarno;
+    } else {
+        g_ziarno = ((unsigned long long)time(NULL) << 20) ^ (unsigned long long)getpid();
+    }
+    if (plik_zapisu != NULL) {
+        if (slad_utworz(plik_zapisu, g_ziarno, &g_slad_zapis) != 0) return 1;
+    }
     
     printf("\n");
     printf("============================================================\n");
     printf("        SYMULACJA KOLEI LINOWEJ - START\n");
     printf("============================================================\n");
-    printf("Liczba turystów: %d\n", TOTAL_TOURISTS);
-    printf("Max osób na stacji: %d\n", STATION_CAPACITY);
-    printf("Krzesełka aktywne: %d / %d\n", MAX_ACTIVE_CHAIRS, MAX_CHAIRS);
+    printf("Liczba turystów: %d\n", k.total_tourists);
+    printf("Max osób na stacji: %d\n", k.station_capacity);
+    printf("Krzesełka aktywne: %d / %d\n", k.max_active_chairs, MAX_CHAIRS);
+    printf("Bramki: wejście %d, peron %d, wyjście %d\n", k.entry_gates, k.platform_gates, k.exit_gates);
+    printf("Skala czasu: 1 s symulacji = %.3f ms\n", k.sim_second_ns / 1e6);
+    if (plik_konfiguracji != NULL) printf("Konfiguracja z pliku: %s\n", plik_konfiguracji);
+    if (liczba_nadpisan > 0) printf("Nadpisane klucze (-o): %d\n", liczba_nadpisan);
+    if (instancja() > 0) printf("Instancja: %d (klucze IPC i pliki logów instancji)\n", instancja());
+    printf("Turyści: %s\n", TOURIST_POOL_MODE ? "pula procesów-gospodarzy" : "proces na turystę");
+    printf("Ziarno: %llu%s%s\n", g_ziarno, g_odtwarzanie ? ", przybycia z pliku " : "",
+           g_odtwarzanie ? plik_odczytu : "");
     printf("============================================================\n\n");
     
-    // czyszczenie starych zasobów
+    ustal_katalog_programow();
+
+    // czyszczenie starych zasobów tej instancji (klucze IPC z katalogu roboczego i numeru instancji)
     czysc_zasoby();
     logger_clear_files();
     
-    // Utworzenie zasobów IPC
+    // Utworzenie zasobów IPC - konfiguracja pierwsza, od niej zależą wartości
+    // semaforów i rozmiary segmentów kanałów i skrzynek
+    g_konfig_id = konfig_opublikuj(&k);
     g_sem_id = utworz_semafory();
     g_shm_id = utworz_pamiec();
-    g_msg_id = utworz_kolejke();
-    g_msg_worker_id = utworz_kolejke_worker();
+    g_kanaly_id = kanaly_utworz();
+    g_skrzynki_id = skrzynki_utworz();
 
 
     g_shm = dolacz_pamiec(g_shm_id);
     init_shared_memory();
+    g_stat = statystyki_shard(g_shm, STAT_SHARD_MAIN);
     
     // Inicjalizacja loggera
     logger_init();
@@ -193,7 +403,7 @@ int main(void) {
     // Uruchomienie procesów pracowników
     worker1_pid = fork();
     if (worker1_pid == 0) {
-        execl("./worker", "worker", NULL);
+        execl(program("worker"), "worker", NULL);
         perror("Błąd execl() przy uruchamianiu worker1");
         _exit(1);
     }
@@ -201,7 +411,7 @@ int main(void) {
     
     worker2_pid = fork();
     if (worker2_pid == 0) {
-        execl("./worker2", "worker2", NULL);
+        execl(program("worker2"), "worker2", NULL);
         perror("Błąd execl() przy uruchamianiu worker2");
         _exit(1);
     }
@@ -210,7 +420,7 @@ int main(void) {
     // Uruchom proces kasjera
     cashier_pid = fork();
     if (cashier_pid == 0) {
-        execl("./cashier", "cashier", NULL);
+        execl(program("cashier"), "cashier", NULL);
         perror("Błąd execl() przy uruchamianiu kasjera");
         _exit(1);
     }
@@ -226,88 +436,110 @@ int main(void) {
     // Uruchomienie wątku sprzątającego
     pthread_t reaper;
     pthread_create(&reaper, NULL, reaper_thread, NULL);
+
+    // Tryb puli - gospodarze turystów pobierają deskryptory z pierścienia w pamięci dzielonej
+    if (TOURIST_POOL_MODE) {
+        int hosts = create_tourist_hosts();
+        logger(LOG_SYSTEM, "Uruchomiono %d gospodarzy turystów (tryb puli)", hosts);
+    }
     
     // generowanie turystów
     int tourists_created = 0;
-    time_t sim_start = time(NULL);
     
     logger(LOG_SYSTEM, "Rozpoczynam generowanie turystów...");
     
     while (!shutdown_flag) {
         // Sprawdzanie czy nie minął czas pracy
-        time_t now = time(NULL);
-        if (now - sim_start >= WORK_END_TIME) {
+        if (zegar_teraz_ms(g_shm) >= WORK_END_TIME * 1000LL) {
             logger(LOG_SYSTEM, "Osiągnięto czas Tk - zamykam bramki wejściowe");
             
             sem_opusc(g_sem_id, SEM_MAIN);
             g_shm->gates_closed = true;
             sem_podnies(g_sem_id, SEM_MAIN);
+            stan_powiadom(g_shm);
             
             break;
         }
         
         // Sprawdzanie czy możemy utworzyć więcej procesów
-        if(tourists_created < TOTAL_TOURISTS){
+        if(tourists_created < k.total_tourists){
+            // Limit procesów - czekaj aż wątek sprzątający zwolni miejsce
+            // (w trybie puli liczbę procesów wyznaczają gospodarze)
             pthread_mutex_lock(&tourist_mutex);
-            int current_count = tourist_pid_count;
+            int current_count = TOURIST_POOL_MODE ? 0 : tourist_pid_count;
+            if (current_count >= MAX_TOURIST_PROCESSES) {
+                struct timespec termin;
+                clock_gettime(CLOCK_REALTIME, &termin);
+                termin.tv_sec += 1;
+                pthread_cond_timedwait(&tourist_cond, &tourist_mutex, &termin);
+            }
             pthread_mutex_unlock(&tourist_mutex);
 
             if (current_count >= MAX_TOURIST_PROCESSES) {
                 continue;
             }
 
-            // Generowanie turysty
-            tourists_created++;
-            
-            int tourist_id = tourists_created;
-            
-            // Losowe parametry turysty
-            int age;
-            int age_roll = rand() % 100;
-            if (age_roll < 15) {
-                age = 8 + rand() % 2; // 8-9 lat (dzieci samodzielne)
-            } else if (age_roll < 25) {
-                age = 10 + rand() % 8; // 10-17 lat (młodzież)
-            } else if (age_roll < 85) {
-                age = 18 + rand() % 47; // 18-64 lat (dorośli)
+            // Parametry turysty - kolejny wiersz śladu albo strumień przybyć
+            Przybycie p;
+            if (g_odtwarzanie) {
+                int wynik = slad_nastepny(&g_slad_odczyt, &p);
+                if (wynik != 1) {
+                    logger(LOG_SYSTEM, "Koniec śladu przybyć po %d turystach", tourists_created);
+                    g_odtwarzanie = false;
+                    tourists_created = k.total_tourists;
+                    continue;
+                }
+                // Przybycie w zapisanej chwili symulacji (SIGINT przerywa sen)
+                long long termin_ms = p.czas_ms < WORK_END_TIME * 1000LL ? p.czas_ms : WORK_END_TIME * 1000LL;
+                while (!shutdown_flag && zegar_teraz_ms(g_shm) < termin_ms) {
+                    zegar_uspij_do(g_shm, termin_ms);
+                }
+                if (shutdown_flag || p.czas_ms >= WORK_END_TIME * 1000LL) continue;
+                tourists_created++;
             } else {
-                age = 65 + rand() % 20; // 65-84 lat (seniorzy)
+                tourists_created++;
+                przybycie_losuj(g_ziarno, tourists_created, &p.d);
             }
+
+            int tourist_id = p.d.tourist_id;
+            int children_count = p.d.children_count;
             
-            TouristType type = (rand() % 2) ? TOURIST_CYCLIST : TOURIST_PEDESTRIAN;
-            bool is_vip = (rand() % 100) < VIP_PERCENT;
-            
-            // Dzieci z opiekunem (dorośli 18-64 lat mogą mieć dzieci)
-            int children_count = 0;
-            if (age >= 18 && age < 65 && rand() % 100 < ADULT_WITH_CHILDREN_PERCENT) {
-                if (type == TOURIST_CYCLIST) {
-                    children_count = 1;  // Rowerzysta może mieć max 1 dziecko
-                } else {
-                    children_count = 1 + rand() % 2;  // Pieszy może mieć 1-2 dzieci
+            // Tryb puli - deskryptor do pierścienia (czekanie na miejsce do czasu Tk)
+            if (TOURIST_POOL_MODE) {
+                int result = 0;
+                while (!shutdown_flag && zegar_teraz_ms(g_shm) < WORK_END_TIME * 1000LL) {
+                    result = pula_wstaw(g_sem_id, g_shm, &p.d, SEM_WAIT_MS);
+                    if (result != 0) break;
                 }
+                if (result == 1) {
+                    licznik_dodaj(g_stat->total_tourists_created, 1 + children_count);
+                    zapisz_przybycie(&p);
+                } else if (result == -1) {
+                    logger(LOG_SYSTEM, "Błąd przekazania turysty #%d do puli", tourist_id);
+                }
+                continue;
             }
-            
-            pid_t pid = create_tourist(tourist_id, age, type, is_vip, children_count);
+
+            // fork pod blokadą listy - wątek sprzątający nie może zebrać procesu
+            // zanim jego PID trafi na listę (inaczej licznik nigdy nie spadnie do 0)
+            pthread_mutex_lock(&tourist_mutex);
+            pid_t pid = create_tourist(&p.d);
+            if (pid > 0 && tourist_pid_count < MAX_TOURIST_PROCESSES) {
+                tourist_pids[tourist_pid_count++] = pid;
+            }
+            pthread_mutex_unlock(&tourist_mutex);
             
             if (pid > 0) {
-                pthread_mutex_lock(&tourist_mutex);
-                if (tourist_pid_count < MAX_TOURIST_PROCESSES) {
-                    tourist_pids[tourist_pid_count++] = pid;
-                }
-                pthread_mutex_unlock(&tourist_mutex);
 
-                g_shm->total_tourists_created += 1 + children_count;
+                licznik_dodaj(g_stat->total_tourists_created, 1 + children_count);
+                zapisz_przybycie(&p);
 
             } else if (pid == -1) {
                 logger(LOG_SYSTEM, "Błąd tworzenia turysty #%d", tourist_id);
             }
-            
-            
-            
-           
-            
-            
-            
+        } else {
+            // Wszyscy turyści utworzeni - śpij do czasu Tk (SIGINT przerywa sen)
+            zegar_uspij_do(g_shm, WORK_END_TIME * 1000LL);
         }
     }
 
@@ -316,6 +548,14 @@ int main(void) {
     while(!shutdown_flag) {
         pthread_mutex_lock(&tourist_mutex);
         int remaining = tourist_pid_count;
+        if (remaining > 0) {
+            // Blokujące czekanie na zmianę liczby turystów (max 1s - sprawdzenie Ctrl+C)
+            struct timespec termin;
+            clock_gettime(CLOCK_REALTIME, &termin);
+            termin.tv_sec += 1;
+            pthread_cond_timedwait(&tourist_cond, &tourist_mutex, &termin);
+            remaining = tourist_pid_count;
+        }
         pthread_mutex_unlock(&tourist_mutex);
         
         if (remaining == 0) {
@@ -334,8 +574,9 @@ int main(void) {
     // Opóźnienie przed wyłączeniem
     if (!interrupt_flag) {
         logger(LOG_SYSTEM, "Oczekiwanie %d sekund przed wyłączeniem...", SHUTDOWN_DELAY);
-        time_t delay_start = time(NULL);
-        while ((time(NULL) - delay_start) < SHUTDOWN_DELAY && !interrupt_flag) {
+        long long koniec = zegar_teraz_ms(g_shm) + SHUTDOWN_DELAY * 1000LL;
+        while (zegar_uspij_do(g_shm, koniec) != 0 && !interrupt_flag) {
+            // Przerwane sygnałem (np. SIGCHLD) - śpij dalej do terminu
         }
     }
     logger(LOG_SYSTEM, "Zamykanie symulacji...");
@@ -344,6 +585,7 @@ int main(void) {
     g_shm->is_running = false;
     g_shm->simulation_end = time(NULL);
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
 
     
     send_signal_to_all(SIGTERM);
@@ -353,21 +595,25 @@ int main(void) {
     if (worker1_pid > 0) waitpid(worker1_pid, &status, 0);
     if (worker2_pid > 0) waitpid(worker2_pid, &status, 0);
 
-    // Odczyt liczników - rozdzielone semafory
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    int in_station = g_shm->tourists_in_station;
-    int on_platform = g_shm->tourists_on_platform;
-    int at_top = g_shm->tourists_at_top;
-    int at_cashier = g_shm->tourists_at_cashier;
-    int descending = g_shm->tourists_descending;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-
-    sem_opusc(g_sem_id, SEM_CHAIR_OPS);
-    int active_chairs = g_shm->active_chairs;
-    sem_podnies(g_sem_id, SEM_CHAIR_OPS);
+    // Odczyt liczników - spójna migawka (bez blokowania piszących)
+    MigawkaStatystyk m;
+    statystyki_migawka(g_shm, &m);
             
     logger(LOG_SYSTEM, "(kasa: %d, stacja: %d, peron: %d, krzesełka: %d, góra: %d, zjazd: %d)", 
-                        at_cashier, in_station, on_platform, active_chairs, at_top, descending);
+                        m.tourists_at_cashier, m.tourists_in_station, m.tourists_on_platform,
+                        m.active_chairs, m.tourists_at_top, m.tourists_descending);
+
+    // Gospodarze puli kończą po SIGTERM, gdy ich turyści zauważą shutdown (maks. 1s)
+    if (TOURIST_POOL_MODE) {
+        struct timespec termin;
+        clock_gettime(CLOCK_REALTIME, &termin);
+        termin.tv_sec += 1;
+        pthread_mutex_lock(&tourist_mutex);
+        while (tourist_pid_count > 0) {
+            if (pthread_cond_timedwait(&tourist_cond, &tourist_mutex, &termin) == ETIMEDOUT) break;
+        }
+        pthread_mutex_unlock(&tourist_mutex);
+    }
 
     // Dobicie pozostałych procesów turystów
     int killed_count = 0;
@@ -386,31 +632,43 @@ int main(void) {
     shutdown_flag = 1;
     pthread_join(reaper, NULL);
     
+    // Zabity gospodarz niesie wielu turystów - niezakończeni to różnica liczników
+    if (TOURIST_POOL_MODE && killed_count > 0) {
+        statystyki_migawka(g_shm, &m);
+        killed_count = m.total_tourists_created - m.total_tourists_finished;
+        if (killed_count < 0) killed_count = 0;
+    }
+
     if (killed_count > 0) {
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->total_tourists_finished += killed_count;
-        sem_podnies(g_sem_id, SEM_STATS);
+        licznik_dodaj(g_stat->total_tourists_finished, killed_count);
         logger(LOG_SYSTEM, "Wymuszono zakończenie %d turystów", killed_count);
     }
 
     logger(LOG_SYSTEM, "Generowanie raportu końcowego...");
     generuj_raport_koncowy();
+    if (plik_metryk != NULL) zapisz_metryki(plik_metryk, &start);
     
     logger(LOG_SYSTEM, "Sprzątanie zasobów...");
     
     odlacz_pamiec(g_shm);
     usun_pamiec(g_shm_id);
     usun_semafory(g_sem_id);
-    usun_kolejke(g_msg_id);
-    usun_kolejke(g_msg_worker_id);
+    kanaly_usun(g_kanaly_id);
+    skrzynki_usun(g_skrzynki_id);
+    konfig_usun(g_konfig_id);
     
     logger_close();
+    slad_zamknij(&g_slad_zapis);
+    if (plik_odczytu != NULL) slad_zakoncz(&g_slad_odczyt);
     
     printf("\n============================================================\n");
     printf("        SYMULACJA ZAKOŃCZONA\n");
     printf("============================================================\n");
-    printf("Logi zapisane do: kolej_log.txt\n");
-    printf("Raport zapisany do: raport_karnetow.txt\n");
+    char plik_logu[64], plik_raportu[64];
+    plik_instancji("kolej_log.txt", plik_logu, sizeof(plik_logu));
+    plik_instancji("raport_karnetow.txt", plik_raportu, sizeof(plik_raportu));
+    printf("Logi zapisane do: %s\n", plik_logu);
+    printf("Raport zapisany do: %s\n", plik_raportu);
     printf("============================================================\n\n");
 
 
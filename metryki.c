@@ -0,0 +1,67 @@
+// metryki.c - kolumny i odczyt pliku metryk przebiegu (bench_symulacja, kolej-przeglad)
+
+#include <stdlib.h>
+#include <string.h>
+#include "metryki.h"
+
+const char* const KOLUMNY[LICZBA_KOLUMN] = {
+    "turysci_na_s", "odjazdy_na_s",
+    "wsiadanie_p50_ms", "wsiadanie_p95_ms", "wsiadanie_p99_ms",
+    "szczyt_p50_ms", "szczyt_p95_ms", "szczyt_p99_ms",
+    "czas_s", "cpu_s", "rss_kb"
+};
+
+const char* const SKROTY[LICZBA_KOLUMN] = {
+    "tur/s", "odj/s", "ws50", "ws95", "ws99", "sz50", "sz95", "sz99", "czas", "cpu", "rss"
+};
+
+const bool WIECEJ_LEPIEJ[LICZBA_KOLUMN] = {
+    true, true, false, false, false, false, false, false, false, false, false
+};
+
+const int PERCENTYLE_METRYK[LICZBA_PERCENTYLI] = {50, 95, 99};
+
+int metryki_wczytaj(const char* sciezka, double w[LICZBA_KOLUMN], ParametryPrzebiegu* p) {
+    FILE* f = fopen(sciezka, "r");
+    if (f == NULL) return -1;
+
+    double czas_s = 0, zakonczeni = 0, odjazdy = 0;
+    char linia[128];
+    while (fgets(linia, sizeof(linia), f) != NULL) {
+        char* rownosc = strchr(linia, '=');
+        if (rownosc == NULL) continue;
+        *rownosc = '\0';
+        double v = strtod(rownosc + 1, NULL);
+
+        if (strcmp(linia, METRYKA_CZAS) == 0) czas_s = v;
+        else if (strcmp(linia, METRYKA_ZAKONCZENI) == 0) zakonczeni = v;
+        else if (strcmp(linia, METRYKA_ODJAZDY) == 0) odjazdy = v;
+        else if (p != NULL && strcmp(linia, METRYKA_TURYSCI) == 0) p->turysci = (int)v;
+        else if (p != NULL && strcmp(linia, METRYKA_STACJA) == 0) p->stacja = (int)v;
+        else if (p != NULL && strcmp(linia, METRYKA_KRZESELKA) == 0) p->krzeselka = (int)v;
+        else {
+            for (int k = K_WSIADANIE_P50; k <= K_SZCZYT_P99; k++) {
+                if (strcmp(linia, KOLUMNY[k]) == 0) w[k] = v;
+            }
+        }
+    }
+    fclose(f);
+
+    if (czas_s <= 0) return -1;
+    w[K_CZAS_S] = czas_s;
+    w[K_TURYSCI_NA_S] = zakonczeni / czas_s;
+    w[K_ODJAZDY_NA_S] = odjazdy / czas_s;
+    return 0;
+}
+
+void metryki_zuzycie(double w[LICZBA_KOLUMN], const struct rusage* ru) {
+    w[K_CPU_S] = ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6 +
+                 ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+    w[K_RSS_KB] = ru->ru_maxrss;
+}
+
+void metryki_legenda(FILE* f) {
+    fprintf(f, "(tur/s, odj/s - zakończone wizyty i odjazdy krzesełek na sekundę; ws/sz - p50/p95/p99\n"
+               " przybycie -> wsiadanie / szczyt w ms; czas, cpu - s, cpu bez kolektora logów;\n"
+               " rss - maks. RSS pojedynczego procesu w KiB)\n");
+}
@@ -0,0 +1,56 @@
+#ifndef METRYKI_H
+#define METRYKI_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/resource.h>
+
+// Metryki przebiegu (KOLEJ_METRYKI) - jeden opis dla zapisu w ./kolej (main.c,
+// zapisz_metryki) i odczytu w bench/bench_symulacja oraz kolej-przeglad.
+// Plik: wiersze klucz=wartość - parametry, liczniki, percentyle w ms, na końcu pełna
+// konfiguracja (konfig_wypisz, pomijana przy odczycie).
+
+// Klucze pliku metryk
+#define METRYKA_TURYSCI      "turysci"
+#define METRYKA_STACJA       "stacja"
+#define METRYKA_KRZESELKA    "krzeselka"
+#define METRYKA_CZAS         "czas_s"
+#define METRYKA_UTWORZENI    "utworzeni"
+#define METRYKA_ZAKONCZENI   "zakonczeni"
+#define METRYKA_ODJAZDY      "odjazdy"
+#define METRYKA_PRZEWIEZIENI "przewiezieni"
+
+// Kolumny wyników (kolejność w CSV); percentyle K_WSIADANIE_P50..K_SZCZYT_P99 mają w pliku
+// klucze równe nazwom kolumn - etap (wsiadanie, szczyt) x PERCENTYLE_METRYK
+enum {
+    K_TURYSCI_NA_S, K_ODJAZDY_NA_S,
+    K_WSIADANIE_P50, K_WSIADANIE_P95, K_WSIADANIE_P99,
+    K_SZCZYT_P50, K_SZCZYT_P95, K_SZCZYT_P99,
+    K_CZAS_S, K_CPU_S, K_RSS_KB,
+    LICZBA_KOLUMN
+};
+
+#define LICZBA_PERCENTYLI 3
+
+extern const char* const KOLUMNY[LICZBA_KOLUMN];
+extern const char* const SKROTY[LICZBA_KOLUMN];
+extern const bool WIECEJ_LEPIEJ[LICZBA_KOLUMN];
+extern const int PERCENTYLE_METRYK[LICZBA_PERCENTYLI];
+
+typedef struct {
+    int turysci;
+    int stacja;
+    int krzeselka;
+} ParametryPrzebiegu;
+
+// Odczyt pliku metryk do w[] (bez K_CPU_S, K_RSS_KB); p może być NULL. 0 lub -1.
+int metryki_wczytaj(const char* sciezka, double w[LICZBA_KOLUMN], ParametryPrzebiegu* p);
+
+// K_CPU_S i K_RSS_KB z wait4: CPU procesu głównego i odebranych potomków (bez kolektora
+// logów - po podwójnym forku nie jest potomkiem ./kolej), RSS - maks. pojedynczego procesu
+void metryki_zuzycie(double w[LICZBA_KOLUMN], const struct rusage* ru);
+
+// Objaśnienie skrótów kolumn pod tabelą
+void metryki_legenda(FILE* f);
+
+#endif // METRYKI_H
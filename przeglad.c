@@ -0,0 +1,427 @@
+// przeglad.c - przegląd parametrów: wiele instancji symulacji równolegle (kolej-przeglad)
+// Użycie: ./kolej-przeglad [-j równolegle] [-c baza.konf] [-s ziarno] [-k katalog]
+//                          [-o wyniki.csv] KLUCZ=w1,w2,... [KLUCZ=...]...
+//   KLUCZ=w1,w2  klucz konfiguracji (konfig.h) i jego wartości; przeglądany jest iloczyn
+//                kartezjański wszystkich list (klucz z jedną wartością - stały dla wszystkich)
+//   -j  liczba instancji jednocześnie (domyślnie liczba rdzeni)
+//   -c  konfiguracja bazowa (./kolej -c), listy nadpisują ją przez -o
+//   -s  ziarno wszystkich instancji (KOLEJ_SEED, domyślnie 12345)
+//   -k  katalog instancji (domyślnie przeglad)
+//   -o  wyniki wszystkich instancji w CSV
+// Każda instancja to ./kolej z numerem instancji nr (KOLEJ_INSTANCJA) w katalogu roboczym
+// <katalog>/<nr>: klucze IPC wynikają z katalogu i numeru (utworz_klucz), więc
+// czysc_zasoby innej instancji ich nie dotyka, a logi, raport, wyjście terminala
+// (wyjscie.txt) i metryki (metryki.txt) zostają w tym katalogu. ./kolej uruchamiany
+// jest z katalogu kolej-przeglad.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/ipc.h>
+#include "struktury.h"
+#include "konfig.h"
+#include "utils.h"
+#include "metryki.h"
+
+#define MAX_KLUCZY      16
+#define MAX_WARTOSCI    32
+#define MAX_INSTANCJI   512
+#define PLIK_METRYK     "metryki.txt"
+#define PLIK_WYJSCIA    "wyjscie.txt"
+
+// Kolumny tabeli na terminalu (CSV zawiera wszystkie)
+static const int TABELA[] = {
+    K_TURYSCI_NA_S, K_ODJAZDY_NA_S, K_WSIADANIE_P50, K_WSIADANIE_P95, K_WSIADANIE_P99,
+    K_SZCZYT_P95, K_CZAS_S, K_CPU_S
+};
+#define KOLUMN_TABELI (int)(sizeof(TABELA) / sizeof(TABELA[0]))
+
+// Przeglądany klucz i jego wartości
+typedef struct {
+    char klucz[64];
+    char* wartosci[MAX_WARTOSCI];
+    int liczba;
+} Wymiar;
+
+typedef enum {
+    I_CZEKA = 0,
+    I_DZIALA,
+    I_GOTOWA,
+    I_BLAD
+} StanInstancji;
+
+typedef struct {
+    int wybor[MAX_KLUCZY];      // Indeks wartości w każdym wymiarze
+    char katalog[PATH_MAX];
+    pid_t pid;
+    StanInstancji stan;
+    int status;
+    double w[LICZBA_KOLUMN];
+} Instancja;
+
+static Wymiar wymiary[MAX_KLUCZY];
+static int liczba_wymiarow = 0;
+static Instancja instancje[MAX_INSTANCJI];
+static int liczba_instancji = 0;
+
+static volatile sig_atomic_t przerwanie = 0;
+
+static void obsluga_sygnalu(int sig) {
+    (void)sig;
+    przerwanie = 1;
+}
+
+// Wartości instancji jako "KLUCZ=w KLUCZ=w" (tylko wymiary z więcej niż jedną wartością)
+static void opis_instancji(const Instancja* in, char* bufor, size_t rozmiar) {
+    size_t dl = 0;
+    bufor[0] = '\0';
+    for (int d = 0; d < liczba_wymiarow && dl < rozmiar; d++) {
+        if (wymiary[d].liczba < 2) continue;
+        dl += snprintf(bufor + dl, rozmiar - dl, "%s%s=%s", dl > 0 ? " " : "",
+                       wymiary[d].klucz, wymiary[d].wartosci[in->wybor[d]]);
+    }
+}
+
+// Uruchomienie ./kolej w katalogu instancji: -c baza, potem -o dla każdego wymiaru
+static pid_t uruchom(const Instancja* in, const char* kolej, const char* baza, const char* ziarno) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    if (chdir(in->katalog) != 0) {
+        perror(in->katalog);
+        _exit(127);
+    }
+    unlink(PLIK_METRYK);
+    char nr[16];
+    snprintf(nr, sizeof(nr), "%d", (int)(in - instancje) + 1);
+    setenv(ENV_INSTANCJA, nr, 1);
+    setenv("KOLEJ_SEED", ziarno, 1);
+    setenv("KOLEJ_METRYKI", PLIK_METRYK, 1);
+    int wyjscie = open(PLIK_WYJSCIA, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (wyjscie >= 0) {
+        dup2(wyjscie, STDOUT_FILENO);
+        dup2(wyjscie, STDERR_FILENO);
+        close(wyjscie);
+    }
+
+    static char przypisania[MAX_KLUCZY][128];
+    char* argumenty[4 + 2 * MAX_KLUCZY];
+    int n = 0;
+    argumenty[n++] = "kolej";
+    if (baza != NULL) {
+        argumenty[n++] = "-c";
+        argumenty[n++] = (char*)baza;
+    }
+    for (int d = 0; d < liczba_wymiarow; d++) {
+        snprintf(przypisania[d], sizeof(przypisania[d]), "%s=%s", wymiary[d].klucz,
+                 wymiary[d].wartosci[in->wybor[d]]);
+        argumenty[n++] = "-o";
+        argumenty[n++] = przypisania[d];
+    }
+    argumenty[n] = NULL;
+    execv(kolej, argumenty);
+    perror(kolej);
+    _exit(127);
+}
+
+// Zakończenie instancji: status, metryki i zużycie z wait4 (metryki_zuzycie)
+static void zakoncz(Instancja* in, int status, const struct rusage* ru) {
+    in->status = status;
+    in->stan = I_BLAD;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        char sciezka[PATH_MAX + 32];
+        snprintf(sciezka, sizeof(sciezka), "%s/%s", in->katalog, PLIK_METRYK);
+        if (metryki_wczytaj(sciezka, in->w, NULL) == 0) in->stan = I_GOTOWA;
+    }
+    metryki_zuzycie(in->w, ru);
+}
+
+// Lista "KLUCZ=w1,w2,..." - klucz i wartości sprawdzone na kopii konfiguracji bazowej
+static int dodaj_wymiar(char* argument, const Konfiguracja* baza) {
+    if (liczba_wymiarow == MAX_KLUCZY) {
+        fprintf(stderr, "Najwyżej %d kluczy\n", MAX_KLUCZY);
+        return -1;
+    }
+    char* rownosc = strchr(argument, '=');
+    if (rownosc == NULL || rownosc == argument || rownosc[1] == '\0') {
+        fprintf(stderr, "Oczekiwano KLUCZ=w1,w2,...: %s\n", argument);
+        return -1;
+    }
+    Wymiar* w = &wymiary[liczba_wymiarow];
+    *rownosc = '\0';
+    snprintf(w->klucz, sizeof(w->klucz), "%s", argument);
+    w->liczba = 0;
+
+    for (char* v = strtok(rownosc + 1, ","); v != NULL; v = strtok(NULL, ",")) {
+        if (w->liczba == MAX_WARTOSCI) {
+            fprintf(stderr, "%s: najwyżej %d wartości\n", w->klucz, MAX_WARTOSCI);
+            return -1;
+        }
+        char przypisanie[128];
+        Konfiguracja proba = *baza;
+        snprintf(przypisanie, sizeof(przypisanie), "%s=%s", w->klucz, v);
+        if (konfig_ustaw(&proba, przypisanie) != 0) return -1;
+        w->wartosci[w->liczba++] = v;
+    }
+    if (w->liczba == 0) {
+        fprintf(stderr, "%s: brak wartości\n", w->klucz);
+        return -1;
+    }
+    liczba_wymiarow++;
+    return 0;
+}
+
+// Katalogi instancji; dwie instancje o tym samym kluczu (ftok bierze tylko 16 młodszych
+// bitów i-węzła) dzieliłyby zasoby IPC - wtedy przegląd się nie rozpoczyna
+static int przygotuj_katalogi(const char* katalog) {
+    if (mkdir(katalog, 0755) != 0 && errno != EEXIST) {
+        perror(katalog);
+        return -1;
+    }
+    for (int i = 0; i < liczba_instancji; i++) {
+        Instancja* in = &instancje[i];
+        snprintf(in->katalog, sizeof(in->katalog), "%s/%d", katalog, i + 1);
+        if (mkdir(in->katalog, 0755) != 0 && errno != EEXIST) {
+            perror(in->katalog);
+            return -1;
+        }
+    }
+    for (int i = 0; i < liczba_instancji; i++) {
+        key_t ki = klucz_ipc(instancje[i].katalog, IPC_KEY_SEM, i + 1);
+        for (int j = 0; j < i; j++) {
+            if (ki != -1 && ki == klucz_ipc(instancje[j].katalog, IPC_KEY_SEM, j + 1)) {
+                fprintf(stderr, "Katalogi %s i %s dają ten sam klucz IPC (ftok) - użyj innego -k\n",
+                        instancje[j].katalog, instancje[i].katalog);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void wypisz_tabele(void) {
+    printf("%4s", "nr");
+    for (int d = 0; d < liczba_wymiarow; d++) {
+        if (wymiary[d].liczba > 1) printf(" %*s", (int)strlen(wymiary[d].klucz), wymiary[d].klucz);
+    }
+    for (int c = 0; c < KOLUMN_TABELI; c++) printf(" %8s", SKROTY[TABELA[c]]);
+    printf("\n");
+
+    for (int i = 0; i < liczba_instancji; i++) {
+        const Instancja* in = &instancje[i];
+        printf("%4d", i + 1);
+        for (int d = 0; d < liczba_wymiarow; d++) {
+            if (wymiary[d].liczba > 1) {
+                printf(" %*s", (int)strlen(wymiary[d].klucz), wymiary[d].wartosci[in->wybor[d]]);
+            }
+        }
+        if (in->stan == I_GOTOWA) {
+            for (int c = 0; c < KOLUMN_TABELI; c++) printf(" %8.1f", in->w[TABELA[c]]);
+            printf("\n");
+        } else if (in->stan == I_BLAD) {
+            printf(" błąd (status %d, %s/%s)\n", in->status, in->katalog, PLIK_WYJSCIA);
+        } else {
+            printf(" nie uruchomiono\n");
+        }
+    }
+    metryki_legenda(stdout);
+}
+
+// Najlepsza instancja wg kolumny (wiecej_lepiej - maksimum, inaczej minimum)
+static void wypisz_najlepsza(const char* opis, int kolumna, bool wiecej_lepiej) {
+    int najlepsza = -1;
+    for (int i = 0; i < liczba_instancji; i++) {
+        if (instancje[i].stan != I_GOTOWA) continue;
+        double v = instancje[i].w[kolumna];
+        if (najlepsza < 0 || (wiecej_lepiej ? v > instancje[najlepsza].w[kolumna]
+                                            : v < instancje[najlepsza].w[kolumna])) {
+            najlepsza = i;
+        }
+    }
+    if (najlepsza < 0) return;
+    char wartosci[512];
+    opis_instancji(&instancje[najlepsza], wartosci, sizeof(wartosci));
+    printf("%s: nr %d (%.1f) %s\n", opis, najlepsza + 1, instancje[najlepsza].w[kolumna], wartosci);
+}
+
+static int zapisz_csv(const char* plik) {
+    FILE* f = fopen(plik, "w");
+    if (f == NULL) {
+        perror(plik);
+        return -1;
+    }
+    fprintf(f, "nr");
+    for (int d = 0; d < liczba_wymiarow; d++) fprintf(f, ",%s", wymiary[d].klucz);
+    for (int k = 0; k < LICZBA_KOLUMN; k++) fprintf(f, ",%s", KOLUMNY[k]);
+    fprintf(f, "\n");
+    for (int i = 0; i < liczba_instancji; i++) {
+        const Instancja* in = &instancje[i];
+        if (in->stan != I_GOTOWA) continue;
+        fprintf(f, "%d", i + 1);
+        for (int d = 0; d < liczba_wymiarow; d++) fprintf(f, ",%s", wymiary[d].wartosci[in->wybor[d]]);
+        for (int k = 0; k < LICZBA_KOLUMN; k++) fprintf(f, ",%.3f", in->w[k]);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return 0;
+}
+
+static void uzycie(const char* prog) {
+    fprintf(stderr, "Użycie: %s [-j równolegle] [-c baza.konf] [-s ziarno] [-k katalog] "
+                    "[-o wyniki.csv] KLUCZ=w1,w2,... [KLUCZ=...]...\n", prog);
+    fprintf(stderr, "  np. %s -j 4 -c kolej.konf ENTRY_GATES=4,5 MAX_ACTIVE_CHAIRS=36,40 "
+                    "SIM_SECOND_NS=10000000\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    long rdzenie = sysconf(_SC_NPROCESSORS_ONLN);
+    int rownolegle = rdzenie > 0 ? (int)rdzenie : 1;
+    const char* plik_bazy = NULL;
+    const char* ziarno = "12345";
+    const char* katalog = "przeglad";
+    const char* plik_wynikow = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:c:s:k:o:")) != -1) {
+        switch (opt) {
+            case 'j': rownolegle = atoi(optarg); break;
+            case 'c': plik_bazy = optarg; break;
+            case 's': ziarno = optarg; break;
+            case 'k': katalog = optarg; break;
+            case 'o': plik_wynikow = optarg; break;
+            default: uzycie(argv[0]); return 2;
+        }
+    }
+    if (optind >= argc || rownolegle < 1) {
+        uzycie(argv[0]);
+        return 2;
+    }
+
+    // Konfiguracja bazowa - tylko do sprawdzenia kluczy i wartości przed uruchomieniem
+    Konfiguracja baza;
+    konfig_domyslna(&baza);
+    char baza_sciezka[PATH_MAX];
+    if (plik_bazy != NULL) {
+        if (konfig_wczytaj_plik(&baza, plik_bazy) != 0) return 2;
+        if (realpath(plik_bazy, baza_sciezka) == NULL) {
+            perror(plik_bazy);
+            return 2;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        if (dodaj_wymiar(argv[i], &baza) != 0) return 2;
+    }
+
+    // Iloczyn kartezjański - ostatni klucz zmienia się najszybciej
+    long iloczyn = 1;
+    for (int d = 0; d < liczba_wymiarow; d++) {
+        iloczyn *= wymiary[d].liczba;
+        if (iloczyn > MAX_INSTANCJI) {
+            fprintf(stderr, "Przegląd przekracza %d instancji\n", MAX_INSTANCJI);
+            return 2;
+        }
+    }
+    liczba_instancji = (int)iloczyn;
+    for (int i = 0; i < liczba_instancji; i++) {
+        int reszta = i;
+        for (int d = liczba_wymiarow - 1; d >= 0; d--) {
+            instancje[i].wybor[d] = reszta % wymiary[d].liczba;
+            reszta /= wymiary[d].liczba;
+        }
+    }
+    if (przygotuj_katalogi(katalog) != 0) return 1;
+
+    // ./kolej z katalogu przeglądu (jak programy potomne ./kolej)
+    char kolej[PATH_MAX + 32];
+    char wlasna[PATH_MAX];
+    ssize_t dl = readlink("/proc/self/exe", wlasna, sizeof(wlasna) - 1);
+    if (dl > 0) {
+        wlasna[dl] = '\0';
+        snprintf(kolej, sizeof(kolej), "%s/kolej", dirname(wlasna));
+    } else {
+        snprintf(kolej, sizeof(kolej), "./kolej");
+    }
+
+    // Ctrl-C: żadnych nowych instancji, uruchomione kończą się same (też dostają SIGINT)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = obsluga_sygnalu;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Przegląd: %d instancji, %d jednocześnie, ziarno %s, katalog %s\n",
+           liczba_instancji, rownolegle, ziarno, katalog);
+    fflush(stdout);
+
+    int nastepna = 0, dzialajace = 0, zakonczone = 0;
+    while (nastepna < liczba_instancji || dzialajace > 0) {
+        while (!przerwanie && dzialajace < rownolegle && nastepna < liczba_instancji) {
+            Instancja* in = &instancje[nastepna++];
+            in->pid = uruchom(in, kolej, plik_bazy != NULL ? baza_sciezka : NULL, ziarno);
+            if (in->pid < 0) {
+                perror("fork");
+                in->stan = I_BLAD;
+                continue;
+            }
+            in->stan = I_DZIALA;
+            dzialajace++;
+        }
+        if (dzialajace == 0) break;
+
+        int status;
+        struct rusage ru;
+        pid_t pid = wait4(-1, &status, 0, &ru);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            perror("wait4");
+            break;
+        }
+        for (int i = 0; i < liczba_instancji; i++) {
+            Instancja* in = &instancje[i];
+            if (in->stan != I_DZIALA || in->pid != pid) continue;
+            zakoncz(in, status, &ru);
+            dzialajace--;
+            zakonczone++;
+
+            char wartosci[512];
+            opis_instancji(in, wartosci, sizeof(wartosci));
+            if (in->stan == I_GOTOWA) {
+                printf("  [%d/%d] nr %d %s: %.0f turystów/s, %.1f s\n", zakonczone, liczba_instancji,
+                       i + 1, wartosci, in->w[K_TURYSCI_NA_S], in->w[K_CZAS_S]);
+            } else {
+                printf("  [%d/%d] nr %d %s: błąd, zob. %s/%s\n", zakonczone, liczba_instancji,
+                       i + 1, wartosci, in->katalog, PLIK_WYJSCIA);
+            }
+            fflush(stdout);
+            break;
+        }
+    }
+
+    printf("\n");
+    wypisz_tabele();
+    printf("\n");
+    wypisz_najlepsza("Najwięcej turystów/s", K_TURYSCI_NA_S, true);
+    wypisz_najlepsza("Najkrótsze czekanie na wsiadanie p95", K_WSIADANIE_P95, false);
+    wypisz_najlepsza("Najkrótsza droga na szczyt p95", K_SZCZYT_P95, false);
+
+    if (plik_wynikow != NULL && zapisz_csv(plik_wynikow) == 0) {
+        printf("\nWyniki zapisane do: %s\n", plik_wynikow);
+    }
+
+    int bledy = 0;
+    for (int i = 0; i < liczba_instancji; i++) {
+        if (instancje[i].stan != I_GOTOWA) bledy++;
+    }
+    return bledy > 0 ? 1 : 0;
+}
@@ -0,0 +1,455 @@
+// semafory_futex.c - semafory zliczające na futeksach w pamięci dzielonej (-DKOLEJ_SEM_FUTEX)
+// To samo API co semafory System V w utils.c: sem_id to identyfikator segmentu
+// z tablicą semaforów (klucz IPC_KEY_SEM). Operacje bez rywalizacji to jeden CAS
+// w przestrzeni użytkownika - do jądra wchodzi tylko czekający i budzący czekającego.
+//
+// SEM_UNDO: każdy proces, który użył wersji z korektą, zajmuje slot z licznikiem
+// zmian (jak semadj w jądrze). Przy normalnym wyjściu korekta jest cofana w atexit,
+// a po śmierci od sygnału - przez proces główny (sem_odzyskaj_proces po waitpid).
+// Wyjście przez _exit() pomija atexit - w symulacji używane tylko po nieudanym exec.
+//
+// Zmiana semafora i korekty to dwa zapisy, więc proces zabity między nimi zostawiłby
+// korektę niezgodną z semaforem. Operacja z korektą najpierw publikuje w slocie zamiar
+// (semafor, zmiana korekty, korekta sprzed operacji), potem zmienia słowo semafora,
+// wpisując do niego swojego autora, i dopiero wtedy dolicza korektę. Kto nadpisuje słowo
+// z autorem oczekującego zamiaru, najpierw oznacza zamiar jako wykonany. Odzyskanie
+// slotu rozstrzyga więc przerwany zamiar: wykonany, gdy słowo nadal nosi jego autora
+// albo zamiar jest oznaczony, a korektę dolicza, jeśli proces nie zdążył.
+
+#ifdef KOLEJ_SEM_FUTEX
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "struktury.h"
+#include "utils.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "semafory_futex.c: słowo futex musi być młodszą połową słowa semafora"
+#endif
+#if SEM_UNDO_SLOTS >= 0xFFFF
+#error "SEM_UNDO_SLOTS nie mieści się w autorze operacji (16 bitów)"
+#endif
+
+// Słowo semafora: młodsza połowa to wartość (słowo futex), starsza - autor ostatniej
+// zmiany: slot korekty + 1 w starszych 16 bitach i numer operacji slotu (0 - bez korekty)
+typedef struct {
+    NOWA_LINIA union {
+        volatile unsigned long long slowo;
+        struct {
+            volatile unsigned int wartosc;      // Słowo futex - wartość semafora
+            volatile unsigned int autor;
+        };
+    };
+    unsigned int czekajacy;                     // Śpiący w sem_opusc*
+    unsigned int czekajacy_zero;                // Śpiący w sem_czekaj_na_zero
+} SemaforFutex;
+
+#define SLOWO(wartosc, autor)   (((unsigned long long)(autor) << 32) | (unsigned int)(wartosc))
+#define SLOWO_WARTOSC(slowo)    ((unsigned int)(slowo))
+#define SLOWO_AUTOR(slowo)      ((unsigned int)((slowo) >> 32))
+
+// Zamiar: autor operacji w starszej połowie, stan w młodszej (0 - brak zamiaru)
+#define ZAMIAR_OCZEKUJE  1u
+#define ZAMIAR_WYKONANY  2u
+#define ZAMIAR(autor, stan)  (((unsigned long long)(autor) << 32) | (stan))
+
+typedef struct {
+    pid_t pid;                      // 0 - wolny
+    unsigned int znacznik;          // Kolejność zajęcia (ten sam PID użyty ponownie)
+    int korekta[SEM_COUNT];         // Do dodania przy śmierci procesu (semadj)
+    volatile unsigned long long zamiar;     // Operacja w toku (ZAMIAR)
+    int zamiar_sem;
+    int zamiar_delta;               // Zmiana korekty po wykonaniu
+    int zamiar_korekta;             // korekta[zamiar_sem] przed operacją
+    unsigned int operacje;          // Numer ostatniej operacji slotu (młodsza część autora)
+} SlotUndo;
+
+typedef struct {
+    SemaforFutex sem[SEM_COUNT];
+    NOWA_LINIA unsigned int znacznik;
+    SlotUndo undo[SEM_UNDO_SLOTS];
+} TablicaSemaforow;
+
+static TablicaSemaforow* g_tablica = NULL;
+static int g_tablica_id = -1;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_mutex_korekty = PTHREAD_MUTEX_INITIALIZER;   // Jeden zamiar slotu naraz
+static int g_slot = -1;             // Slot korekty tego procesu
+static bool g_slot_gotowy = false;  // Slot przydzielony (po fork dziecko zajmuje własny)
+static pid_t g_slot_pid = 0;
+static bool g_zarejestrowane = false;
+
+// Dołączenie tablicy (raz na proces; po fork dziedziczona, po exec dołączana ponownie)
+static TablicaSemaforow* tablica(int sem_id) {
+    TablicaSemaforow* t = __atomic_load_n(&g_tablica, __ATOMIC_ACQUIRE);
+    if (t && g_tablica_id == sem_id) return t;
+
+    pthread_mutex_lock(&g_mutex);
+    if (!g_tablica || g_tablica_id != sem_id) {
+        void* adres = shmat(sem_id, NULL, 0);
+        if (adres == (void*)-1) {
+            perror("Błąd shmat (semafory futex)");
+            exit(1);
+        }
+        g_tablica_id = sem_id;
+        __atomic_store_n(&g_tablica, (TablicaSemaforow*)adres, __ATOMIC_RELEASE);
+    }
+    t = g_tablica;
+    pthread_mutex_unlock(&g_mutex);
+    return t;
+}
+
+static void obudz(SemaforFutex* s, int ile) {
+    if (syscall(SYS_futex, &s->wartosc, FUTEX_WAKE, ile, NULL, NULL, 0) == -1) {
+        perror("Błąd futex (wybudzenie semafora)");
+    }
+}
+
+// Słowo z autorem oczekującego zamiaru - oznaczenie zamiaru przed nadpisaniem autora
+static void oznacz_wykonany(TablicaSemaforow* t, int sem_num, unsigned int autor) {
+    if (autor == 0) return;
+    SlotUndo* slot = &t->undo[(autor >> 16) - 1];
+    unsigned long long oczekuje = ZAMIAR(autor, ZAMIAR_OCZEKUJE);
+    if (__atomic_load_n(&slot->zamiar, __ATOMIC_ACQUIRE) == oczekuje && slot->zamiar_sem == sem_num) {
+        __atomic_compare_exchange_n(&slot->zamiar, &oczekuje, ZAMIAR(autor, ZAMIAR_WYKONANY), false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    }
+}
+
+// CAS słowa semafora na (nowa, autor); przy porażce *slowo to bieżące słowo
+static bool zamien(TablicaSemaforow* t, int sem_num, unsigned long long* slowo,
+                   unsigned int nowa, unsigned int autor) {
+    oznacz_wykonany(t, sem_num, SLOWO_AUTOR(*slowo));
+    return __atomic_compare_exchange_n(&t->sem[sem_num].slowo, slowo, SLOWO(nowa, autor), true,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// Zmiana wartości o delta (ujemna obcinana do 0 - jak korekta SEM_UNDO w jądrze)
+static void zmien_wartosc(TablicaSemaforow* t, int sem_num, int delta, unsigned int autor) {
+    SemaforFutex* s = &t->sem[sem_num];
+    unsigned long long slowo = __atomic_load_n(&s->slowo, __ATOMIC_RELAXED);
+    unsigned int v, nowa;
+    do {
+        v = SLOWO_WARTOSC(slowo);
+        long wynik = (long)v + delta;
+        nowa = wynik > 0 ? (unsigned int)wynik : 0;
+    } while (!zamien(t, sem_num, &slowo, nowa, autor));
+
+    if (nowa > v && __atomic_load_n(&s->czekajacy, __ATOMIC_SEQ_CST) > 0) {
+        obudz(s, (int)(nowa - v));
+    }
+    if (nowa == 0 && v != 0 && __atomic_load_n(&s->czekajacy_zero, __ATOMIC_SEQ_CST) > 0) {
+        obudz(s, INT_MAX);
+    }
+}
+
+static bool probuj(TablicaSemaforow* t, int sem_num, unsigned int autor) {
+    SemaforFutex* s = &t->sem[sem_num];
+    unsigned long long slowo = __atomic_load_n(&s->slowo, __ATOMIC_RELAXED);
+    while (SLOWO_WARTOSC(slowo) > 0) {
+        unsigned int v = SLOWO_WARTOSC(slowo);
+        if (zamien(t, sem_num, &slowo, v - 1, autor)) {
+            if (v == 1 && __atomic_load_n(&s->czekajacy_zero, __ATOMIC_SEQ_CST) > 0) {
+                obudz(s, INT_MAX);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool operacja_z_korekta(TablicaSemaforow* t, int sem_num, int zmiana);
+
+// Próba opuszczenia - z korektą albo bez
+static bool probuj_opusc(TablicaSemaforow* t, int sem_num, bool korekta) {
+    return korekta ? operacja_z_korekta(t, sem_num, -1) : probuj(t, sem_num, 0);
+}
+
+// Opuszczenie: termin == NULL - bez limitu (sygnał nie przerywa, jak pętla semop)
+// Zwraca: 1 = opuszczono, 0 = minął termin / przerwane sygnałem
+static int opusc(TablicaSemaforow* t, int sem_num, const struct timespec* termin, bool korekta) {
+    SemaforFutex* s = &t->sem[sem_num];
+    while (1) {
+        if (probuj_opusc(t, sem_num, korekta)) return 1;
+
+        // Licznik czekających przed sprawdzeniem słowa w jądrze - podnoszący,
+        // który zwiększył wartość, zobaczy czekającego albo futex zobaczy wartość > 0
+        __atomic_add_fetch(&s->czekajacy, 1, __ATOMIC_SEQ_CST);
+        int ret = czekaj_na_zmiane(&s->wartosc, 0, termin);
+        __atomic_sub_fetch(&s->czekajacy, 1, __ATOMIC_SEQ_CST);
+
+        if (termin && ret <= 0) {
+            return probuj_opusc(t, sem_num, korekta) ? 1 : 0;
+        }
+    }
+}
+
+// === Korekta (odpowiednik SEM_UNDO) ===
+
+// Zamiar przerwany śmiercią procesu. Autor jest w słowie, dopóki nikt go nie nadpisze,
+// a nadpisujący najpierw oznacza zamiar - stąd odczyt słowa przed ponownym odczytem zamiaru.
+// Korekta sprzed operacji mówi, czy proces zdążył ją doliczyć.
+static void rozstrzygnij_zamiar(TablicaSemaforow* t, SlotUndo* slot) {
+    unsigned long long z = __atomic_load_n(&slot->zamiar, __ATOMIC_SEQ_CST);
+    if (z == 0) return;
+
+    unsigned int autor = (unsigned int)(z >> 32);
+    int sem_num = slot->zamiar_sem;
+    bool wykonany = SLOWO_AUTOR(__atomic_load_n(&t->sem[sem_num].slowo, __ATOMIC_SEQ_CST)) == autor ||
+                    __atomic_load_n(&slot->zamiar, __ATOMIC_SEQ_CST) == ZAMIAR(autor, ZAMIAR_WYKONANY);
+    if (wykonany && slot->korekta[sem_num] == slot->zamiar_korekta) {
+        slot->korekta[sem_num] += slot->zamiar_delta;
+    }
+    __atomic_store_n(&slot->zamiar, 0, __ATOMIC_RELEASE);
+}
+
+// Cofnięcie korekty slotu i jego zwolnienie
+static void zastosuj_korekte(TablicaSemaforow* t, SlotUndo* slot) {
+    rozstrzygnij_zamiar(t, slot);
+    for (int i = 0; i < SEM_COUNT; i++) {
+        int k = __atomic_exchange_n(&slot->korekta[i], 0, __ATOMIC_ACQ_REL);
+        if (k != 0) {
+            zmien_wartosc(t, i, k, 0);
+        }
+    }
+    __atomic_store_n(&slot->pid, 0, __ATOMIC_RELEASE);
+}
+
+// Dziecko po fork nie dziedziczy korekty rodzica (jak semadj)
+static void po_fork_dziecko(void) {
+    g_slot = -1;
+    g_slot_gotowy = false;
+}
+
+static void korekta_przy_wyjsciu(void) {
+    if (g_tablica && g_slot >= 0 && g_slot_pid == getpid()) {
+        pthread_mutex_lock(&g_mutex_korekty);
+        zastosuj_korekte(g_tablica, &g_tablica->undo[g_slot]);
+        g_slot = -1;
+        pthread_mutex_unlock(&g_mutex_korekty);
+    }
+}
+
+// Zwolnienie slotów procesów, które już nie istnieją (pełna tablica)
+static void odzyskaj_martwe(TablicaSemaforow* t) {
+    for (int i = 0; i < SEM_UNDO_SLOTS; i++) {
+        pid_t pid = __atomic_load_n(&t->undo[i].pid, __ATOMIC_ACQUIRE);
+        if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+            if (__atomic_compare_exchange_n(&t->undo[i].pid, &pid, -1, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                zastosuj_korekte(t, &t->undo[i]);
+            }
+        }
+    }
+}
+
+static int zajmij_slot(TablicaSemaforow* t, pid_t pid) {
+    for (int proba = 0; proba < 2; proba++) {
+        int start = pid % SEM_UNDO_SLOTS;
+        for (int n = 0; n < SEM_UNDO_SLOTS; n++) {
+            int i = (start + n) % SEM_UNDO_SLOTS;
+            pid_t wolny = 0;
+            if (__atomic_compare_exchange_n(&t->undo[i].pid, &wolny, pid, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                t->undo[i].znacznik = __atomic_add_fetch(&t->znacznik, 1, __ATOMIC_RELAXED);
+                return i;
+            }
+        }
+        odzyskaj_martwe(t);
+    }
+    fprintf(stderr, "Semafory futex: brak wolnego slotu korekty (PID %d) - operacje bez SEM_UNDO\n", pid);
+    return -1;
+}
+
+// Slot korekty procesu (zajmowany przy pierwszej operacji z korektą)
+static SlotUndo* slot_procesu(TablicaSemaforow* t) {
+    if (__atomic_load_n(&g_slot_gotowy, __ATOMIC_ACQUIRE)) {
+        return g_slot >= 0 ? &t->undo[g_slot] : NULL;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    if (!g_slot_gotowy) {
+        g_slot_pid = getpid();
+        g_slot = zajmij_slot(t, g_slot_pid);
+        if (!g_zarejestrowane) {
+            atexit(korekta_przy_wyjsciu);
+            pthread_atfork(NULL, NULL, po_fork_dziecko);
+            g_zarejestrowane = true;
+        }
+        __atomic_store_n(&g_slot_gotowy, true, __ATOMIC_RELEASE);
+    }
+    SlotUndo* slot = g_slot >= 0 ? &t->undo[g_slot] : NULL;
+    pthread_mutex_unlock(&g_mutex);
+    return slot;
+}
+
+// Zmiana semafora o zmiana (-1 - próba opuszczenia, +1 - podniesienie) z korektą -zmiana.
+// Zamiar w slocie obejmuje okno między zmianą słowa a korektą; czekanie jest poza blokadą.
+static bool operacja_z_korekta(TablicaSemaforow* t, int sem_num, int zmiana) {
+    SlotUndo* slot = slot_procesu(t);
+    if (!slot) {
+        if (zmiana < 0) return probuj(t, sem_num, 0);
+        zmien_wartosc(t, sem_num, zmiana, 0);
+        return true;
+    }
+
+    pthread_mutex_lock(&g_mutex_korekty);
+    unsigned int autor = ((unsigned int)(g_slot + 1) << 16) | (++slot->operacje & 0xFFFF);
+    slot->zamiar_sem = sem_num;
+    slot->zamiar_delta = -zmiana;
+    slot->zamiar_korekta = slot->korekta[sem_num];
+    __atomic_store_n(&slot->zamiar, ZAMIAR(autor, ZAMIAR_OCZEKUJE), __ATOMIC_SEQ_CST);
+
+    bool wykonana = true;
+    if (zmiana < 0) {
+        wykonana = probuj(t, sem_num, autor);
+    } else {
+        zmien_wartosc(t, sem_num, zmiana, autor);
+    }
+    if (wykonana) {
+        __atomic_add_fetch(&slot->korekta[sem_num], -zmiana, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&slot->zamiar, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_mutex_korekty);
+    return wykonana;
+}
+
+// === API utils.h ===
+
+int utworz_semafory(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_SEM);
+    int sem_id = shmget(klucz, sizeof(TablicaSemaforow), IPC_CREAT | IPC_EXCL | 0600);
+
+    if (sem_id == -1) {
+        if (errno == EEXIST) {
+            // Usuń stary segment i utwórz nowy
+            sem_id = shmget(klucz, 0, 0600);
+            if (sem_id != -1) {
+                shmctl(sem_id, IPC_RMID, NULL);
+            }
+            sem_id = shmget(klucz, sizeof(TablicaSemaforow), IPC_CREAT | IPC_EXCL | 0600);
+        }
+        if (sem_id == -1) {
+            perror("Błąd shmget (semafory futex)");
+            exit(1);
+        }
+    }
+
+    TablicaSemaforow* t = tablica(sem_id);
+    memset(t, 0, sizeof(TablicaSemaforow));
+    for (int i = 0; i < SEM_COUNT; i++) {
+        t->sem[i].wartosc = sem_wartosc_poczatkowa(i, NULL);
+    }
+    return sem_id;
+}
+
+int polacz_semafory(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_SEM);
+    int sem_id = shmget(klucz, sizeof(TablicaSemaforow), 0600);
+    if (sem_id == -1) {
+        perror("Błąd shmget (połączenie z semaforami futex)");
+        exit(1);
+    }
+    return sem_id;
+}
+
+void usun_semafory(int sem_id) {
+    // Segment znika po odłączeniu przez ostatni proces - kończący się jeszcze działają
+    if (shmctl(sem_id, IPC_RMID, NULL) == -1) {
+        perror("Błąd shmctl IPC_RMID (semafory futex)");
+    }
+}
+
+void sem_podnies(int sem_id, int sem_num) {
+    operacja_z_korekta(tablica(sem_id), sem_num, 1);
+}
+
+void sem_opusc(int sem_id, int sem_num) {
+    opusc(tablica(sem_id), sem_num, NULL, true);
+}
+
+void sem_podnies_bez_undo(int sem_id, int sem_num) {
+    zmien_wartosc(tablica(sem_id), sem_num, 1, 0);
+}
+
+void sem_opusc_bez_undo(int sem_id, int sem_num) {
+    opusc(tablica(sem_id), sem_num, NULL, false);
+}
+
+int sem_probuj_opusc(int sem_id, int sem_num) {
+    return operacja_z_korekta(tablica(sem_id), sem_num, -1) ? 1 : 0;
+}
+
+int sem_probuj_opusc_bez_undo(int sem_id, int sem_num) {
+    return probuj(tablica(sem_id), sem_num, 0) ? 1 : 0;
+}
+
+// Zwraca: 1 = sukces, 0 = timeout lub sygnał
+int sem_opusc_timeout(int sem_id, int sem_num, int timeout_ms) {
+    struct timespec termin;
+    termin_za_ms(&termin, timeout_ms);
+    return opusc(tablica(sem_id), sem_num, &termin, true);
+}
+
+int sem_opusc_timeout_bez_undo(int sem_id, int sem_num, int timeout_ms) {
+    struct timespec termin;
+    termin_za_ms(&termin, timeout_ms);
+    return opusc(tablica(sem_id), sem_num, &termin, false);
+}
+
+void sem_czekaj_na_zero(int sem_id, int sem_num) {
+    SemaforFutex* s = &tablica(sem_id)->sem[sem_num];
+    while (1) {
+        __atomic_add_fetch(&s->czekajacy_zero, 1, __ATOMIC_SEQ_CST);
+        unsigned int v = __atomic_load_n(&s->wartosc, __ATOMIC_SEQ_CST);
+        if (v != 0) {
+            czekaj_na_zmiane(&s->wartosc, v, NULL);
+        }
+        __atomic_sub_fetch(&s->czekajacy_zero, 1, __ATOMIC_SEQ_CST);
+        if (v == 0) return;
+    }
+}
+
+int sem_pobierz_wartosc(int sem_id, int sem_num) {
+    return (int)__atomic_load_n(&tablica(sem_id)->sem[sem_num].wartosc, __ATOMIC_ACQUIRE);
+}
+
+void sem_ustaw_wartosc(int sem_id, int sem_num, int value) {
+    TablicaSemaforow* t = tablica(sem_id);
+    unsigned long long slowo = __atomic_load_n(&t->sem[sem_num].slowo, __ATOMIC_RELAXED);
+    while (!zamien(t, sem_num, &slowo, (unsigned int)(value > 0 ? value : 0), 0)) {
+    }
+    obudz(&t->sem[sem_num], INT_MAX);
+}
+
+// Cofnięcie korekty procesu zabitego sygnałem (wołane po waitpid przez rodzica).
+// Przy powtórzonym PID zwalniany jest najstarszy slot - nowy proces zajmuje własny.
+void sem_odzyskaj_proces(int sem_id, pid_t pid) {
+    TablicaSemaforow* t = tablica(sem_id);
+    int najstarszy = -1;
+    for (int i = 0; i < SEM_UNDO_SLOTS; i++) {
+        if (__atomic_load_n(&t->undo[i].pid, __ATOMIC_ACQUIRE) != pid) continue;
+        if (najstarszy < 0 || (int)(t->undo[i].znacznik - t->undo[najstarszy].znacznik) < 0) {
+            najstarszy = i;
+        }
+    }
+    if (najstarszy < 0) return;
+
+    pid_t oczekiwany = pid;
+    if (__atomic_compare_exchange_n(&t->undo[najstarszy].pid, &oczekiwany, -1, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        zastosuj_korekte(t, &t->undo[najstarszy]);
+    }
+}
+
+#endif // KOLEJ_SEM_FUTEX
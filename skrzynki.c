@@ -0,0 +1,487 @@
+// skrzynki.c - skrzynki odpowiedzi turystów w pamięci dzielonej
+// Skrzynka to pierścień REPLY_MAILBOX_SLOTS odpowiedzi z numerami sekwencyjnymi komórek
+// (jak kanaly.c), odbiorca jeden - proces turysty, któremu przydzielono skrzynkę.
+// Nadawca po publikacji odpowiedzi ustawia flagę w_stosie; kto zmienił ją z 0 na 1,
+// wkłada skrzynkę na stos gotowych gospodarza (wkładanie CAS-em, zdejmowanie całego
+// stosu naraz - bez problemu ABA). Proces turystów śpi na dzwonku swojego rekordu.
+//
+// Zwolnienie skrzynki odroczone, gdy leży na stosie: zwalnia ją zbieranie stosu, więc
+// skrzynka nie trafia do innego procesu, zanim poprzedni właściciel przestanie jej dotykać.
+//
+// Grupa powiadomień (pasażerowie krzesełka) to rekord z listą członków i licznikiem
+// pokoleń. Powiadomienie całej grupy to nowe pokolenie i jeden bit w masce grup każdego
+// gospodarza członków (dzwonek jak dla stosu) - bez odpowiedzi do każdej skrzynki.
+// Gospodarz przekazuje członkom wszystkie pokolenia, których jeszcze nie dostali, więc
+// spóźnione zbieranie niczego nie gubi. Rekord wraca do puli, gdy ostatni członek dostał
+// REPLY_GROUP_STAGES powiadomień; licznik czytających chroni przed ponownym użyciem
+// rekordu w trakcie odczytu przez gospodarza ze spóźnionym bitem.
+//
+// Liczba grup zależy od MAX_ACTIVE_CHAIRS z konfiguracji uruchomienia, więc rekordy grup
+// i maski gospodarzy leżą za stałą częścią segmentu; ich rozmiar zapisuje nagłówek.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "skrzynki.h"
+#include "utils.h"
+#include "logger.h"
+#include "konfig.h"
+
+#if (REPLY_MAILBOX_SLOTS & (REPLY_MAILBOX_SLOTS - 1)) != 0
+#error "REPLY_MAILBOX_SLOTS musi być potęgą 2"
+#endif
+
+// Odpowiedzi mają co najwyżej ładunek PrzydzialBiletu (pozostałe - sam nagłówek)
+#define ROZMIAR_ODPOWIEDZI  KOMUNIKAT_ROZMIAR(bilet)
+
+typedef struct {
+    volatile unsigned long seq;
+    unsigned char dane[ROZMIAR_ODPOWIEDZI];
+} KomorkaSkrzynki;
+
+typedef struct {
+    NOWA_LINIA volatile unsigned long zapis;    // Następna pozycja do rezerwacji (nadawcy)
+    volatile unsigned long odczyt;              // Następna pozycja odbiorcy
+    volatile int zajeta;                        // Przydzielona turyście
+    volatile int gospodarz;                     // Rekord procesu odbierającego
+    volatile int w_stosie;                      // 1 - na stosie gotowych (lub wolna)
+    volatile int nastepna;                      // Następna skrzynka na stosie
+    int do_zwolnienia;                          // Zwolnienie odroczone (tylko odbiorca)
+    KomorkaSkrzynki komorki[REPLY_MAILBOX_SLOTS];
+} Skrzynka;
+
+typedef struct {
+    NOWA_LINIA volatile unsigned int slowo;     // Futex - dzwonek procesu
+    volatile unsigned int spi;
+    volatile int stos;                          // Szczyt stosu gotowych skrzynek (-1 - pusty)
+    volatile int zajety;
+    volatile unsigned long long grupy[];        // Grupy z nowym pokoleniem dla procesu (slowa_grup)
+} RekordGospodarza;
+
+typedef struct {
+    int tourist_id;
+    int reply_box;
+    int gospodarz;
+    int dostarczone;                            // Pokolenia przekazane turyście (tylko gospodarz)
+} CzlonekGrupy;
+
+typedef struct {
+    NOWA_LINIA volatile unsigned int pokolenie; // Opublikowane powiadomienia (0 - rekord wolny lub w przygotowaniu)
+    volatile int zajety;
+    volatile int pozostali;                     // Członkowie bez ostatniego powiadomienia
+    volatile int czytajacy;                     // Gospodarze w trakcie odczytu rekordu
+    int liczba;
+    unsigned char typy[REPLY_GROUP_STAGES];     // MSG_* kolejnych pokoleń
+    CzlonekGrupy czlonkowie[CHAIR_CAPACITY];
+} RekordGrupy;
+
+// Segment: stała część, za nią REPLY_HOSTS rekordów gospodarzy po krok_gospodarza bajtów
+// (maska ma slowa_grup słów) i liczba_grup rekordów grup
+typedef struct {
+    volatile unsigned int podpowiedz;           // Początek szukania wolnej skrzynki
+    int liczba_grup;
+    int slowa_grup;
+    Skrzynka skrzynki[REPLY_MAILBOXES];
+} SegmentSkrzynek;
+
+static SegmentSkrzynek* g_seg = NULL;
+static unsigned char* g_gospodarze = NULL;
+static RekordGrupy* g_grupy = NULL;
+static int g_liczba_grup = 0;
+static int g_slowa_grup = 0;
+static size_t g_krok_gospodarza = 0;
+static int g_gospodarz = -1;
+
+static size_t do_linii(size_t rozmiar) {
+    return (rozmiar + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+}
+
+// Każdy rekord gospodarza zaczyna się na nowej linii (jak rekordy o stałym rozmiarze)
+static size_t krok_gospodarza(int slowa_grup) {
+    return do_linii(offsetof(RekordGospodarza, grupy) + (size_t)slowa_grup * sizeof(unsigned long long));
+}
+
+static size_t rozmiar_segmentu(int liczba_grup, int slowa_grup) {
+    return do_linii(sizeof(SegmentSkrzynek)) + REPLY_HOSTS * krok_gospodarza(slowa_grup) +
+           (size_t)liczba_grup * sizeof(RekordGrupy);
+}
+
+static RekordGospodarza* gospodarz(int nr) {
+    return (RekordGospodarza*)(g_gospodarze + (size_t)nr * g_krok_gospodarza);
+}
+
+// Nowy segment: nagłówek z liczbą grup twórcy, inaczej odczyt z nagłówka
+static void mapuj(int skrzynki_id, int liczba_grup) {
+    SegmentSkrzynek* seg = (SegmentSkrzynek*)shmat(skrzynki_id, NULL, 0);
+    if (seg == (SegmentSkrzynek*)-1) {
+        perror("Błąd shmat (skrzynki)");
+        exit(1);
+    }
+    if (liczba_grup > 0) {
+        seg->liczba_grup = liczba_grup;
+        seg->slowa_grup = (liczba_grup + 63) / 64;
+    }
+    g_seg = seg;
+    g_liczba_grup = seg->liczba_grup;
+    g_slowa_grup = seg->slowa_grup;
+    g_krok_gospodarza = krok_gospodarza(g_slowa_grup);
+    g_gospodarze = (unsigned char*)seg + do_linii(sizeof(SegmentSkrzynek));
+    g_grupy = (RekordGrupy*)(g_gospodarze + REPLY_HOSTS * g_krok_gospodarza);
+}
+
+int skrzynki_utworz(void) {
+    key_t klucz = utworz_klucz(IPC_KEY_MAILBOXES);
+    int liczba_grup = REPLY_GROUPS_PER_CHAIR * konfig()->max_active_chairs;
+    size_t rozmiar = rozmiar_segmentu(liczba_grup, (liczba_grup + 63) / 64);
+    int skrzynki_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
+
+    if (skrzynki_id == -1) {
+        if (errno == EEXIST) {
+            skrzynki_id = shmget(klucz, 0, 0600);
+            if (skrzynki_id != -1) {
+                shmctl(skrzynki_id, IPC_RMID, NULL);
+            }
+            skrzynki_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
+        }
+        if (skrzynki_id == -1) {
+            perror("Błąd shmget (skrzynki)");
+            exit(1);
+        }
+    }
+
+    // Nowy segment shmget jest wyzerowany
+    mapuj(skrzynki_id, liczba_grup);
+    for (int i = 0; i < REPLY_HOSTS; i++) {
+        gospodarz(i)->stos = -1;
+    }
+    for (int i = 0; i < REPLY_MAILBOXES; i++) {
+        Skrzynka* s = &g_seg->skrzynki[i];
+        s->gospodarz = -1;
+        s->w_stosie = 1;    // Wolna - nadawca nie wkłada jej na żaden stos
+        s->nastepna = -1;
+        for (unsigned long p = 0; p < REPLY_MAILBOX_SLOTS; p++) {
+            s->komorki[p].seq = p;
+        }
+    }
+    return skrzynki_id;
+}
+
+void skrzynki_usun(int skrzynki_id) {
+    if (shmctl(skrzynki_id, IPC_RMID, NULL) == -1) {
+        perror("Błąd shmctl IPC_RMID (skrzynki)");
+    }
+}
+
+void skrzynki_dolacz(void) {
+    if (g_seg != NULL) return;
+
+    key_t klucz = utworz_klucz(IPC_KEY_MAILBOXES);
+    int skrzynki_id = shmget(klucz, 0, 0600);
+    if (skrzynki_id == -1) {
+        perror("Błąd shmget (połączenie ze skrzynkami)");
+        exit(1);
+    }
+    mapuj(skrzynki_id, 0);
+}
+
+void skrzynki_zarejestruj(void) {
+    for (int i = 0; i < REPLY_HOSTS; i++) {
+        RekordGospodarza* g = gospodarz(i);
+        int wolny = 0;
+        if (__atomic_compare_exchange_n(&g->zajety, &wolny, 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&g->stos, -1, __ATOMIC_RELAXED);
+            __atomic_store_n(&g->spi, 0, __ATOMIC_RELAXED);
+            for (int w = 0; w < g_slowa_grup; w++) {
+                __atomic_store_n(&g->grupy[w], 0, __ATOMIC_RELAXED);
+            }
+            g_gospodarz = i;
+            return;
+        }
+    }
+    fprintf(stderr, "Brak wolnego rekordu odbiorcy skrzynek (REPLY_HOSTS = %d)\n", REPLY_HOSTS);
+    exit(1);
+}
+
+void skrzynki_wyrejestruj(void) {
+    if (g_gospodarz < 0) return;
+    __atomic_store_n(&gospodarz(g_gospodarz)->zajety, 0, __ATOMIC_RELEASE);
+    g_gospodarz = -1;
+}
+
+// Odbiór opublikowanej odpowiedzi - false gdy skrzynka pusta
+static bool pobierz(Skrzynka* s, Komunikat* msg) {
+    unsigned long pozycja = s->odczyt;
+    KomorkaSkrzynki* c = &s->komorki[pozycja & (REPLY_MAILBOX_SLOTS - 1)];
+    if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != pozycja + 1) {
+        return false;
+    }
+    memcpy(msg, c->dane, ROZMIAR_ODPOWIEDZI);
+    __atomic_store_n(&c->seq, pozycja + REPLY_MAILBOX_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->odczyt, pozycja + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+int skrzynka_przydziel(void) {
+    unsigned int start = __atomic_fetch_add(&g_seg->podpowiedz, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < REPLY_MAILBOXES; i++) {
+        int nr = (int)((start + (unsigned int)i) % REPLY_MAILBOXES);
+        Skrzynka* s = &g_seg->skrzynki[nr];
+        int wolna = 0;
+        if (!__atomic_compare_exchange_n(&s->zajeta, &wolna, 1, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // Spóźnione odpowiedzi do poprzedniego właściciela - odrzucone
+        Komunikat stara;
+        while (pobierz(s, &stara)) {
+        }
+        s->do_zwolnienia = 0;
+        __atomic_store_n(&s->gospodarz, g_gospodarz, __ATOMIC_RELEASE);
+        __atomic_store_n(&s->w_stosie, 0, __ATOMIC_SEQ_CST);
+        return nr;
+    }
+    return -1;
+}
+
+void skrzynka_zwolnij(int skrzynka) {
+    if (skrzynka < 0) return;
+    Skrzynka* s = &g_seg->skrzynki[skrzynka];
+
+    // Flaga w_stosie = 1 blokuje wkładanie na stos; jeśli już leży na stosie,
+    // zwolni ją skrzynki_zbierz
+    int poza_stosem = 0;
+    if (__atomic_compare_exchange_n(&s->w_stosie, &poza_stosem, 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&s->zajeta, 0, __ATOMIC_RELEASE);
+    } else {
+        s->do_zwolnienia = 1;
+    }
+}
+
+// Dzwonek śpiącego odbiorcy - po pierwszej nowości (pusty stos lub słowo maski grup)
+static void zadzwon(RekordGospodarza* g) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g->spi, __ATOMIC_RELAXED)) {
+        powiadom_o_zmianie(&g->slowo);
+    }
+}
+
+static void dodaj_na_stos(Skrzynka* s, int skrzynka) {
+    RekordGospodarza* g = gospodarz(__atomic_load_n(&s->gospodarz, __ATOMIC_ACQUIRE));
+    int szczyt = __atomic_load_n(&g->stos, __ATOMIC_RELAXED);
+    do {
+        s->nastepna = szczyt;
+    } while (!__atomic_compare_exchange_n(&g->stos, &szczyt, skrzynka, false,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    // Dzwonek tylko dla pierwszej skrzynki na stosie i śpiącego odbiorcy
+    if (szczyt == -1) {
+        zadzwon(g);
+    }
+}
+
+// Nowość dla gospodarza: stos skrzynek lub bit w masce grup
+static bool ma_nowosci(RekordGospodarza* g) {
+    if (__atomic_load_n(&g->stos, __ATOMIC_ACQUIRE) != -1) {
+        return true;
+    }
+    for (int w = 0; w < g_slowa_grup; w++) {
+        if (__atomic_load_n(&g->grupy[w], __ATOMIC_ACQUIRE) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int grupa_utworz(const PasazerKrzeselka* pasazerowie, int liczba) {
+    if (liczba <= 0 || liczba > CHAIR_CAPACITY) return -1;
+    for (int i = 0; i < liczba; i++) {
+        if (pasazerowie[i].reply_box < 0 || pasazerowie[i].reply_box >= REPLY_MAILBOXES) return -1;
+    }
+
+    for (int nr = 0; nr < g_liczba_grup; nr++) {
+        RekordGrupy* r = &g_grupy[nr];
+        int wolny = 0;
+        if (!__atomic_compare_exchange_n(&r->zajety, &wolny, 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // Gospodarz ze spóźnionym bitem może jeszcze czytać poprzednie użycie rekordu
+        while (__atomic_load_n(&r->czytajacy, __ATOMIC_SEQ_CST) != 0) {
+            sched_yield();
+        }
+        r->liczba = liczba;
+        r->pozostali = liczba;
+        for (int i = 0; i < liczba; i++) {
+            CzlonekGrupy* c = &r->czlonkowie[i];
+            c->tourist_id = pasazerowie[i].tourist_id;
+            c->reply_box = pasazerowie[i].reply_box;
+            c->gospodarz = __atomic_load_n(&g_seg->skrzynki[c->reply_box].gospodarz, __ATOMIC_ACQUIRE);
+            c->dostarczone = 0;
+        }
+        return nr;
+    }
+    return -1;
+}
+
+void grupa_powiadom(int grupa, unsigned char typ) {
+    if (grupa < 0 || grupa >= g_liczba_grup) return;
+    RekordGrupy* r = &g_grupy[grupa];
+
+    // Gospodarze członków przed publikacją - po ostatnim pokoleniu rekord może wrócić do puli
+    int gospodarze[CHAIR_CAPACITY];
+    int ile = 0;
+    for (int i = 0; i < r->liczba; i++) {
+        int h = r->czlonkowie[i].gospodarz;
+        bool jest = false;
+        for (int j = 0; j < ile; j++) {
+            if (gospodarze[j] == h) jest = true;
+        }
+        if (!jest) gospodarze[ile++] = h;
+    }
+
+    unsigned int pokolenie = r->pokolenie;
+    if (pokolenie >= REPLY_GROUP_STAGES) return;
+    r->typy[pokolenie] = typ;
+    __atomic_store_n(&r->pokolenie, pokolenie + 1, __ATOMIC_SEQ_CST);
+
+    unsigned long long bit = 1ULL << (grupa % 64);
+    for (int i = 0; i < ile; i++) {
+        RekordGospodarza* g = gospodarz(gospodarze[i]);
+        if (__atomic_fetch_or(&g->grupy[grupa / 64], bit, __ATOMIC_SEQ_CST) == 0) {
+            zadzwon(g);
+        }
+    }
+}
+
+// Przekazanie członkom tego procesu pokoleń, których jeszcze nie dostali
+static int zbierz_grupe(int nr, void (*odbierz)(const Komunikat* msg, void* arg), void* arg) {
+    RekordGrupy* r = &g_grupy[nr];
+    int odebrane = 0;
+    int zakonczeni = 0;
+
+    __atomic_fetch_add(&r->czytajacy, 1, __ATOMIC_SEQ_CST);
+    unsigned int pokolenie = __atomic_load_n(&r->pokolenie, __ATOMIC_SEQ_CST);
+    for (int i = 0; pokolenie > 0 && i < r->liczba; i++) {
+        CzlonekGrupy* c = &r->czlonkowie[i];
+        if (c->gospodarz != g_gospodarz) continue;
+        while ((unsigned int)c->dostarczone < pokolenie) {
+            Komunikat msg;
+            msg.typ = r->typy[c->dostarczone];
+            msg.tourist_id = c->tourist_id;
+            msg.reply_box = c->reply_box;
+            if (++c->dostarczone == REPLY_GROUP_STAGES) {
+                zakonczeni++;
+            }
+            odbierz(&msg, arg);
+            odebrane++;
+        }
+    }
+    __atomic_fetch_sub(&r->czytajacy, 1, __ATOMIC_SEQ_CST);
+
+    if (zakonczeni > 0 && __atomic_sub_fetch(&r->pozostali, zakonczeni, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_store_n(&r->pokolenie, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&r->zajety, 0, __ATOMIC_RELEASE);
+    }
+    return odebrane;
+}
+
+void skrzynka_wyslij(int skrzynka, const Komunikat* msg) {
+    if (skrzynka < 0 || skrzynka >= REPLY_MAILBOXES) return;
+    Skrzynka* s = &g_seg->skrzynki[skrzynka];
+    int proby = 0;
+
+    while (1) {
+        unsigned long pozycja = __atomic_load_n(&s->zapis, __ATOMIC_RELAXED);
+        KomorkaSkrzynki* c = &s->komorki[pozycja & (REPLY_MAILBOX_SLOTS - 1)];
+        long roznica = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pozycja);
+
+        if (roznica == 0) {
+            if (!__atomic_compare_exchange_n(&s->zapis, &pozycja, pozycja + 1, false,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                continue;
+            }
+            memcpy(c->dane, msg, ROZMIAR_ODPOWIEDZI);
+            __atomic_store_n(&c->seq, pozycja + 1, __ATOMIC_RELEASE);
+            if (__atomic_exchange_n(&s->w_stosie, 1, __ATOMIC_SEQ_CST) == 0) {
+                dodaj_na_stos(s, skrzynka);
+            }
+            return;
+        }
+
+        if (roznica < 0) {
+            // Pełna skrzynka - turysta nie odbiera (np. proces zakończony); bez budzenia
+            // przez odbiorcę, więc krótkie drzemki ograniczone SEM_WAIT_MS
+            if (++proby > SEM_WAIT_MS) {
+                logger(LOG_SYSTEM, "Skrzynka %d pełna - odpowiedź dla turysty #%d porzucona",
+                       skrzynka, msg->tourist_id);
+                return;
+            }
+            struct timespec drzemka = {0, 1000000L};
+            nanosleep(&drzemka, NULL);
+        }
+        // roznica > 0 - pozycję zajął inny nadawca, ponów z nowym licznikiem
+    }
+}
+
+int skrzynki_czekaj(int timeout_ms) {
+    RekordGospodarza* g = gospodarz(g_gospodarz);
+    unsigned int dzwonek = odczytaj_slowo(&g->slowo);
+    __atomic_store_n(&g->spi, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int wynik = 1;
+    if (!ma_nowosci(g)) {
+        if (timeout_ms < 0) {
+            wynik = czekaj_na_zmiane(&g->slowo, dzwonek, NULL);
+        } else {
+            struct timespec termin;
+            termin_za_ms(&termin, timeout_ms);
+            wynik = czekaj_na_zmiane(&g->slowo, dzwonek, &termin);
+        }
+    }
+    __atomic_store_n(&g->spi, 0, __ATOMIC_SEQ_CST);
+    return wynik;
+}
+
+int skrzynki_zbierz(void (*odbierz)(const Komunikat* msg, void* arg), void* arg) {
+    RekordGospodarza* g = gospodarz(g_gospodarz);
+    int nr = __atomic_exchange_n(&g->stos, -1, __ATOMIC_ACQUIRE);
+    int odebrane = 0;
+
+    while (nr != -1) {
+        Skrzynka* s = &g_seg->skrzynki[nr];
+        int nastepna = s->nastepna;
+
+        if (s->do_zwolnienia) {
+            // Turysta już skończył - w_stosie zostaje 1, resztę odrzuci nowy właściciel
+            s->do_zwolnienia = 0;
+            __atomic_store_n(&s->zajeta, 0, __ATOMIC_RELEASE);
+        } else {
+            // Flaga przed opróżnieniem - odpowiedź zapisana później wraca na stos
+            __atomic_store_n(&s->w_stosie, 0, __ATOMIC_SEQ_CST);
+            Komunikat msg;
+            while (pobierz(s, &msg)) {
+                odbierz(&msg, arg);
+                odebrane++;
+            }
+        }
+        nr = nastepna;
+    }
+
+    for (int w = 0; w < g_slowa_grup; w++) {
+        unsigned long long bity = __atomic_exchange_n(&g->grupy[w], 0, __ATOMIC_SEQ_CST);
+        while (bity != 0) {
+            int grupa = w * 64 + __builtin_ctzll(bity);
+            bity &= bity - 1;
+            odebrane += zbierz_grupe(grupa, odbierz, arg);
+        }
+    }
+    return odebrane;
+}
@@ -0,0 +1,49 @@
+#ifndef SKRZYNKI_H
+#define SKRZYNKI_H
+
+#include <stdbool.h>
+#include "struktury.h"
+
+// Skrzynki odpowiedzi turystów w pamięci dzielonej (klucz IPC_KEY_MAILBOXES)
+// Zamiast wspólnej kolejki adresowanej mtype = PID każdy aktywny turysta ma własną
+// skrzynkę (mały pierścień odpowiedzi). Nadawca (kasjer, worker1, worker2) zapisuje
+// odpowiedź wprost do skrzynki, wkłada skrzynkę na stos gotowych procesu turysty
+// i budzi go futeksem - tylko gdy stos był pusty, a odbiorca śpi.
+
+// Utworzenie segmentu (proces główny, przed uruchomieniem pozostałych procesów)
+int skrzynki_utworz(void);
+void skrzynki_usun(int skrzynki_id);
+
+// Dołączenie do segmentu - nadawcy odpowiedzi i procesy turystów
+void skrzynki_dolacz(void);
+
+// Rejestracja procesu turystów jako odbiorcy (rekord z dzwonkiem i stosem gotowych)
+void skrzynki_zarejestruj(void);
+void skrzynki_wyrejestruj(void);
+
+// Przydział skrzynki turyście procesu (-1 gdy brak wolnych) i jej zwolnienie
+int skrzynka_przydziel(void);
+void skrzynka_zwolnij(int skrzynka);
+
+// Odpowiedź do skrzynki turysty (pełną skrzynkę nadawca czeka najwyżej SEM_WAIT_MS)
+// Kopiowany nagłówek i ładunek PrzydzialBiletu - pozostałe pola unii pominięte
+void skrzynka_wyslij(int skrzynka, const Komunikat* msg);
+
+// Sen procesu turystów do odpowiedzi w którejś z jego skrzynek lub timeout_ms (< 0 - bez limitu)
+// Zwraca: 1 = wybudzenie, 0 = timeout, -1 = przerwane sygnałem
+int skrzynki_czekaj(int timeout_ms);
+
+// Grupa powiadomień dla pasażerów krzesełka - jedno powiadomienie na grupę zamiast
+// odpowiedzi do każdej skrzynki (-1 gdy brak wolnego rekordu lub pasażera bez skrzynki)
+int grupa_utworz(const PasazerKrzeselka* pasazerowie, int liczba);
+
+// Kolejne powiadomienie grupy (typ MSG_*, najwyżej REPLY_GROUP_STAGES) - nowe pokolenie
+// rekordu i jeden bit z dzwonkiem dla każdego procesu turystów z członkami grupy
+void grupa_powiadom(int grupa, unsigned char typ);
+
+// Opróżnienie gotowych skrzynek i grup procesu - każda odpowiedź przekazana do odbierz()
+// Powiadomienie grupy przychodzi jako komunikat bez ładunku do każdego członka procesu
+// Wywołuje ten sam wątek, który zwalnia skrzynki (skrzynka_zwolnij)
+int skrzynki_zbierz(void (*odbierz)(const Komunikat* msg, void* arg), void* arg);
+
+#endif // SKRZYNKI_H
@@ -4,18 +4,30 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <time.h>
+#include <stdatomic.h>
 
 // KONFIGURACJA SYMULACJI
+// Parametry z tabeli konfig.c (Konfiguracja) to tylko wartości domyślne - ./kolej
+// nadpisuje je plikiem (-c) i opcjami -o KLUCZ=wartość bez ponownej kompilacji.
+// Parametry w #ifndef można też nadpisać przy kompilacji (-D...)
+#ifndef TOTAL_TOURISTS
 #define TOTAL_TOURISTS       5000   // Liczba turystów do obsłużenia
+#endif
 #define MAX_CHAIRS           72      // Łączna liczba krzesełek
+#ifndef MAX_ACTIVE_CHAIRS
 #define MAX_ACTIVE_CHAIRS    36      // Maks krzesełek jednocześnie w ruchu
+#endif
 #define CHAIR_CAPACITY       4       // Pojemność jednego krzesełka
 
+#ifndef STATION_CAPACITY
 #define STATION_CAPACITY     50      // N - max osób na dolnej stacji (poczekalni)
+#endif
 #define ENTRY_GATES          4       // Bramki wejściowe (kontrola biletów)
 #define PLATFORM_GATES       3       // Bramki na peron (kontrola grup)
 #define EXIT_GATES           2       // Wyjścia ze stacji górnej
+#define GATE_ENTRIES_PER_TOURIST 4   // Pojemność rejestru przejść przez bramki na turystę (raport karnetów)
 
 // Awaryjne zatrzymanie
 #define EMERGENCY_SAFETY_MARGIN  8   // Czas przed końcem symulacji, kiedy nie inicjujemy awarii (sekundy)
@@ -32,11 +44,67 @@
 #define TRAIL_T3_TIME        3       // Trudna
 #define CHAIR_TRAVEL_TIME    1       // Czas przejazdu krzesełka
 
+// Skala czasu symulacji: ile nanosekund czasu rzeczywistego trwa jedna
+// sekunda symulacji. Wszystkie czasy w tym pliku są w sekundach symulacji.
+// 1000000000 = czas rzeczywisty, 10000000 = symulacja 100x szybsza
+#ifndef SIM_SECOND_NS
+#define SIM_SECOND_NS        1000000000L
+#endif
+
 // Godziny pracy (sekundy)
 #define WORK_START_TIME      20       // Tp - start
 #define WORK_END_TIME        100    // Tk - koniec (sekundy)
 #define SHUTDOWN_DELAY       3       // Opóźnienie przed wyłączeniem po Tk
 
+// Oczekiwanie
+#define IDLE_WAIT_MS         10      // Maks. drzemka procesu bez pracy (ms)
+#define SEM_WAIT_MS          100     // Maks. blokada na semaforze przed ponownym sprawdzeniem flag (ms)
+
+// Pula procesów turystów
+// 1 - stała liczba procesów-gospodarzy (./tourist --host), każdy prowadzi wielu turystów (pętla zdarzeń)
+// 0 - osobny proces (fork+execl) dla każdego turysty
+#define TOURIST_POOL_MODE    1
+#define TOURIST_POOL_HOSTS   0       // Liczba gospodarzy (0 - po jednym na rdzeń)
+#define TOURIST_POOL_RING    1024    // Pojemność pierścienia deskryptorów turystów w pamięci dzielonej
+#define TOURIST_HOST_MAX_ACTIVE 4096 // Maks. turystów prowadzonych jednocześnie przez jednego gospodarza
+
+// Polityka pakowania krzesełek (worker1, PackingPolicy)
+// PACKING_GREEDY_FIFO - kolejno najwcześniej przybyły, który się mieści
+// PACKING_BEST_FIT    - skład o maks. liczbie osób spośród PACKING_LOOKAHEAD najdłużej czekających
+// PACKING_AGING       - jak BEST_FIT, ale pominięty PACKING_MAX_SKIPS razy wsiada obowiązkowo
+#define PACKING_POLICY       PACKING_AGING
+#define PACKING_LOOKAHEAD    16      // Okno wyprzedzania (kolejne numery przybycia)
+#define PACKING_MAX_SKIPS    3       // Maks. odjazdów, które mogą ominąć czekającego
+
+// Logger (logger.c)
+// 1 - procesy wstawiają rekordy do pierścienia w pamięci dzielonej, zapis robi proces kolektora
+// 0 - zapis synchroniczny w procesie logującym (debug)
+#ifndef LOG_ENABLED
+#define LOG_ENABLED          1       // 0 - logger() nic nie zapisuje (pomiary, make bench-sim); raport końcowy zostaje
+#endif
+#define LOG_ASYNC            1
+#define LOG_RING_SIZE        8192    // Rekordy w pierścieniu (potęga 2)
+#define LOG_FULL_POLICY      LOG_FULL_DROP   // Pełny pierścień: LOG_FULL_DROP (odrzuć i policz) / LOG_FULL_WAIT (czekaj)
+#define LOG_BATCH            64      // Maks. rekordów na jeden writev kolektora
+#define LOG_FLUSH_MS         50      // Maks. sen kolektora bez dzwonka (ms rzeczywiste)
+#define LOG_SLOT_TIMEOUT_MS  1000    // Zarezerwowany, nieprzejęty rekord pomijany po tym czasie (zabity producent)
+#define LOG_FLUSH_DEADLINE_MS 3000   // Maks. czekanie logger_flush() na kolektor
+
+// Binarny dziennik zdarzeń (zdarzenia.c) - rekordy stałej długości, dekoder: kolej-logdump
+#define EVENT_LOG            0       // 1 - zapis do EVENT_LOG_FILE obok kolej_log.txt
+#define EVENT_LOG_FILE       "kolej_zdarzenia.bin"
+#define EVENT_BUFFER         128     // Rekordy buforowane w procesie przed jednym write
+#define EVENT_FLUSH_MS       200     // Maks. wiek najstarszego rekordu w buforze (ms rzeczywiste)
+
+// Kanały komunikatów w pamięci dzielonej (kanaly.c) - pojemności pierścieni (potęgi 2)
+#define CHANNEL_CASHIER_SLOTS   128     // Na kanał kasy (VIP i zwykły), co najmniej CASHIER_QUEUE_LIMIT z konfiguracji
+#define CHANNEL_PLATFORM_SLOTS  1024    // Turyści -> worker1 (peron)
+#define CHANNEL_ARRIVAL_SLOTS   64      // Przyjazdy krzesełek -> worker2, co najmniej MAX_ACTIVE_CHAIRS z konfiguracji
+#define CHANNEL_EXIT_SLOTS      1024    // Prośby o wyjście -> worker2
+
+// Skrzynki odpowiedzi turystów w pamięci dzielonej (skrzynki.c)
+#define REPLY_MAILBOX_SLOTS     4       // Odpowiedzi w drodze do jednego turysty (potęga 2)
+
 
 
 
@@ -53,6 +121,14 @@ typedef enum {
     TICKET_TYPE_COUNT
 } TicketType;
 
+// Polityki pakowania krzesełek
+typedef enum {
+    PACKING_GREEDY_FIFO = 0,
+    PACKING_BEST_FIT,
+    PACKING_AGING,
+    PACKING_POLICY_COUNT
+} PackingPolicy;
+
 // Czasy ważności karnetów czasowych (sekundy symulacyjne)
 #define TK1_DURATION         15
 #define TK2_DURATION         30
@@ -80,26 +156,38 @@ typedef enum {
     TRAIL_COUNT
 } TrailType;
 
-// typy komunikatów
-#define MSG_TOURIST_TO_CASHIER    1    // Turysta -> Kasjer (kupno biletu)
-#define MSG_CASHIER_TO_TOURIST    2    // Kasjer -> Turysta (potwierdzenie)
+// typy komunikatów (znacznik Komunikat.typ - wybiera ładunek)
+#define MSG_TOURIST_TO_CASHIER    1    // Turysta -> Kasjer (kupno biletu, ZadanieBiletu)
+#define MSG_CASHIER_TO_TOURIST    2    // Kasjer -> Turysta (bilet lub odmowa, PrzydzialBiletu)
 #define MSG_TOURIST_TO_GATE       3    // Turysta -> Bramka (wejście)
 #define MSG_GATE_TO_TOURIST       4    // Bramka -> Turysta (przepuszczenie)
-#define MSG_TOURIST_TO_PLATFORM   5    // Turysta -> Peron
-#define MSG_PLATFORM_TO_TOURIST   6    // Peron -> Turysta
+#define MSG_TOURIST_TO_PLATFORM   5    // Turysta -> Peron (ZgloszenieNaPeron)
+#define MSG_PLATFORM_TO_TOURIST   6    // Peron -> Turysta (wsiadaj, bez ładunku)
 #define MSG_WORKER_EMERGENCY      7    // Awaryjne zatrzymanie
 #define MSG_WORKER_READY          8    // Gotowość do wznowienia
 #define MSG_CHAIR_DEPARTURE       9    // Odjazd krzesełka
-#define MSG_CHAIR_ARRIVAL         10   // Przyjazd krzesełka
-#define MSG_TOURIST_EXIT          11   // Turysta opuszcza górną stację
-#define MSG_VIP_PRIORITY          100  // Priorytet VIP (offset)
+#define MSG_CHAIR_ARRIVAL         10   // Przyjazd krzesełka (worker1 -> worker2, PrzyjazdKrzeselka)
+#define MSG_TOURIST_EXIT          11   // Turysta opuszcza górną stację (ProsbaWyjscia)
+#define MSG_PLATFORM_REFUSED      12   // Peron -> Turysta (odmowa wejścia lub wsiadania, bez ładunku)
+#define MSG_TOP_ARRIVAL           13   // Worker2 -> Turysta (dotarcie na górę, bez ładunku)
+#define MSG_EXIT_DONE             14   // Worker2 -> Turysta (wyjście zakończone, bez ładunku)
 
 // klucze IPC
 #define IPC_KEY_PATH           "."
 #define IPC_KEY_SEM            'S'
 #define IPC_KEY_SHM            'M'
-#define IPC_KEY_MSG            'Q'
-#define IPC_KEY_MSG_WORKER     'W'
+#define IPC_KEY_CHANNELS       'K'    // Pierścienie kanałów komunikatów (kanaly.c)
+#define IPC_KEY_MAILBOXES      'R'    // Skrzynki odpowiedzi turystów (skrzynki.c)
+#define IPC_KEY_LOG            'L'    // Pierścień rekordów loggera (LOG_ASYNC)
+#define IPC_KEY_CONFIG         'C'    // Konfiguracja uruchomienia, tylko do odczytu (konfig.c)
+
+// Instancja symulacji (./kolej -i N lub zmienna ENV_INSTANCJA, dziedziczona przez procesy
+// potomne). Instancja N > 0 ma własne klucze IPC (utworz_klucz) i pliki kolej_log_N.txt,
+// raport_karnetow_N.txt, kolej_zdarzenia_N.bin (plik_instancji) - kilka symulacji może
+// działać w jednym katalogu, a czysc_zasoby usuwa tylko zasoby swojej instancji.
+// Instancja 0 (domyślna) - klucze i nazwy plików jak dotąd.
+#define ENV_INSTANCJA          "KOLEJ_INSTANCJA"
+#define MAX_INSTANCJA          65535
 
 // indeksy semaforów
 #define SEM_MAIN               0    // Główny mutex - tylko dla krytycznych operacji wielozasobowych
@@ -115,13 +203,25 @@ typedef enum {
 #define SEM_REPORT             10   // Mutex dla raportu
 #define SEM_CASHIER_QUEUE      11   // Limit turystów czekających na kasę
 #define SEM_PLATFORM_QUEUE     12   // Limit turystów czekających na peron
-#define SEM_QUEUE              13   // Mutex dla liczników kolejek (tourists_in_station, on_platform, at_top, itp.)
-#define SEM_STATS              14   // Mutex dla statystyk (tickets_sold, passengers_transported, itp.)
+#define SEM_QUEUE              13   // Nieużywany - liczniki kolejek są atomowe (numer zachowany)
+#define SEM_STATS              14   // Nieużywany - statystyki są atomowe (numer zachowany)
 #define SEM_GATES              15   // Mutex dla rejestrowania przejść przez bramki
 #define SEM_TICKETS            16   // Mutex dla sprzedaży biletów i generowania ID
-#define SEM_CHAIR_OPS          17   // Mutex dla operacji krzesełek (active_chairs, chair_departures)
+#define SEM_CHAIR_OPS          17   // Nieużywany - liczniki krzesełek są atomowe (numer zachowany)
 #define SEM_ACTIVE_TOURISTS    18   // Limit aktywnych procesów turystów (throttling)
-#define SEM_COUNT              19   // Liczba semaforów
+#define SEM_POOL_MUTEX         19   // Mutex pierścienia deskryptorów turystów
+#define SEM_POOL_ITEMS         20   // Liczba deskryptorów w pierścieniu
+#define SEM_POOL_SPACE         21   // Wolne miejsca w pierścieniu
+#define SEM_COUNT              22   // Liczba semaforów
+
+// Semafory na futeksach (make SEM=futex, -DKOLEJ_SEM_FUTEX) - semafory_futex.c
+#define SEM_UNDO_SLOTS         (MAX_ACTIVE_TOURISTS + 64)  // Procesy z korektą (odpowiednik SEM_UNDO)
+
+// Skrzynki odpowiedzi - zapas ponad limit aktywnych na zwolnienia odroczone do odbioru
+#define REPLY_MAILBOXES        (MAX_ACTIVE_TOURISTS + 1024) // Skrzynki (jedna na aktywnego turystę)
+#define REPLY_HOSTS            (MAX_ACTIVE_TOURISTS + 64)   // Procesy turystów odbierające odpowiedzi
+#define REPLY_GROUPS_PER_CHAIR 2                            // Grupy powiadomień na aktywne krzesełko (w drodze i do odbioru)
+#define REPLY_GROUP_STAGES     2                            // Powiadomienia grupy: wsiadanie, dotarcie na górę
 
 // Limit aktywnych turystów (zapobiega przeciążeniu systemu)
 #define MAX_ACTIVE_TOURISTS    10000
@@ -162,6 +262,49 @@ typedef struct {
     TrailType chosen_trail;
 } Tourist;
 
+// Deskryptor turysty przekazywany gospodarzowi puli
+typedef struct {
+    int tourist_id;
+    int age;
+    TouristType type;
+    bool is_vip;
+    int children_count;
+    int ticket_type;            // TicketType (-1 - turysta losuje ze swojego strumienia)
+} TouristDescriptor;
+
+// Strumień liczb losowych (utils.c, strumien_*) - licznikowy: n-ta liczba to funkcja
+// mieszająca (klucz, n), a klucz zależy od ziarna głównego, rodzaju strumienia i id
+// podmiotu. Wyniki turysty nie zależą od procesu, który go prowadzi, ani od kolejności
+// losowań innych turystów.
+typedef struct {
+    unsigned long long klucz;
+    unsigned long long licznik;
+} StrumienLosowy;
+
+typedef enum {
+    STRUMIEN_PRZYBYCIE = 1,     // Parametry przybywającego turysty (main, id turysty)
+    STRUMIEN_TURYSTA,           // Decyzje turysty: bilet, dzieci, trasa, kolejny przejazd
+    STRUMIEN_WORKER1,           // Awarie zgłaszane przez pracownika stacji dolnej
+    STRUMIEN_WORKER2,           // Awarie zgłaszane przez pracownika stacji górnej
+    STRUMIEN_GENERATOR          // Chwile przybyć w generatorze śladów (kolej-slad)
+} RodzajStrumienia;
+
+// Konfiguracja uruchomienia (konfig.c) - wczytana raz przez main z pliku i opcji,
+// opublikowana w osobnym segmencie dołączanym przez pozostałe procesy tylko do odczytu
+typedef struct {
+    int total_tourists;         // TOTAL_TOURISTS
+    int station_capacity;       // STATION_CAPACITY
+    int max_active_chairs;      // MAX_ACTIVE_CHAIRS (<= MAX_CHAIRS)
+    int entry_gates;            // ENTRY_GATES
+    int platform_gates;         // PLATFORM_GATES
+    int exit_gates;             // EXIT_GATES (wątki bramek worker2)
+    int cashier_queue_limit;    // CASHIER_QUEUE_LIMIT
+    int platform_queue_limit;   // PLATFORM_QUEUE_LIMIT
+    int trail_time[TRAIL_COUNT];    // TRAIL_T1_TIME..TRAIL_T3_TIME
+    int emergency_chance;       // EMERGENCY_CHANCE (%)
+    long sim_second_ns;         // SIM_SECOND_NS
+} Konfiguracja;
+
 // Krzesełko
 typedef struct {
     int id;
@@ -174,98 +317,232 @@ typedef struct {
 } Chair;
 
 // Pamięć dzielona
+// Układ wg linii pamięci podręcznej: każda grupa zaczyna się na nowej linii (CACHE_LINE),
+// żeby zapisy liczników jednej domeny semafora nie unieważniały linii czytanych
+// przez inne procesy (false sharing). Kolejność: flagi czytane przez wszystkich,
+// słowo futex, liczniki wg semaforów, a na końcu duże, rzadko używane tablice.
+#define CACHE_LINE 64
+
+// Histogram log-liniowy: 2^HIST_BITY koszyków na każdą potęgę dwójki (błąd względny
+// < 1/16), 512 koszyków obejmuje wartości do ~2^35 µs
+#define HIST_BITY    4
+#define HIST_KOSZYKI 512
+#define NOWA_LINIA _Alignas(CACHE_LINE)
+
+typedef struct {
+    // Statystyki jednego procesu piszącego - osobne linie, więc kasjer, pracownicy
+    // i gospodarze turystów nie zapisują wspólnej komórki. Seqlock shardu:
+    // zapis kilku powiązanych pól otacza statystyki_zapis_start/koniec.
+    NOWA_LINIA _Atomic unsigned int pisarze;    // Zapisy w toku
+    _Atomic unsigned int wersja;                // Zakończone zapisy
+
+    _Atomic int total_tourists_created;
+    _Atomic int total_tourists_finished;
+    _Atomic int tickets_sold[TICKET_TYPE_COUNT];
+    _Atomic int total_revenue;
+    _Atomic int passengers_transported;
+    _Atomic int cyclists_transported;
+    _Atomic int pedestrians_transported;
+    _Atomic int vip_served;
+    _Atomic int children_with_guardian;
+    _Atomic int rejected_expired;       // Odrzuceni z wygasłym karnetem
+    _Atomic int trail_usage[TRAIL_COUNT];
+
+    // Pakowanie krzesełek (worker1)
+    _Atomic int chair_occupancy[CHAIR_CAPACITY + 1];    // Odjazdy wg liczby osób na krzesełku
+    _Atomic int platform_boarded;                       // Dorośli, którzy wsiedli z peronu
+    _Atomic long long platform_wait_total_ms;           // Suma czekania na peronie (ms symulacji)
+    _Atomic long long platform_wait_max_ms;             // Maksimum shardu (przy odczycie - maksimum shardów)
+    _Atomic int packing_skips;                          // Wyprzedzenia czekających przez późniejszych
+
+    // Histogramy opóźnień turystów (µs rzeczywiste, koszyki wg histogram_dodaj)
+    _Atomic int czas_do_wsiadania[HIST_KOSZYKI];        // Przybycie -> wejście na krzesełko
+    _Atomic int czas_na_szczyt[HIST_KOSZYKI];           // Przybycie -> stacja górna
+} StatystykiShard;
+
+// Shardy statystyk: stałe procesy, potem turyści (gospodarz puli wg numeru,
+// pojedynczy proces turysty wg tourist_id)
+#define STAT_SHARD_KASJER       0
+#define STAT_SHARD_WORKER1      1
+#define STAT_SHARD_WORKER2      2
+#define STAT_SHARD_MAIN         3
+#define STAT_SHARD_TURYSCI      4
+#define STAT_SHARDY_TURYSTOW    16
+#define STAT_SHARDS             (STAT_SHARD_TURYSCI + STAT_SHARDY_TURYSTOW)
+
+// Odbiorcy kanałów komunikatów (kanaly.c) - każdy śpi na własnym dzwonku
+typedef enum {
+    ODBIORCA_KASJER,
+    ODBIORCA_WORKER1,
+    ODBIORCA_WORKER2,
+    ODBIORCA_COUNT
+} OdbiorcaKanalu;
+
+typedef struct {
+    NOWA_LINIA volatile unsigned int slowo;     // Futex - zmieniany przy budzeniu
+    volatile unsigned int spi;                  // Odbiorca śpi (lub zaraz zaśnie) na słowie
+} DzwonekOdbiorcy;
+
 typedef struct {
-    // Stan systemu
-    bool is_running;
+    // Stan systemu - zapis rzadko (SEM_MAIN), odczyt w każdej pętli turystów i pracowników
+    NOWA_LINIA bool is_running;
     bool emergency_stop;
     bool gates_closed;          // Tk osiągnięte - bramki zamknięte
     bool cashier_open;          // Kasa otwarta (po WORK_START_TIME)
+    bool worker1_ready;
+    bool worker2_ready;
+    int emergency_initiator;    // 1 lub 2 (który pracownik)
+    int packing_policy;         // PackingPolicy
+    long sim_second_ns;         // Skala czasu - ns rzeczywiste na sekundę symulacji
+    unsigned long long ziarno;  // Ziarno główne strumieni losowych (main, przed startem procesów)
+    struct timespec sim_clock_origin; // Początek zegara symulacji (CLOCK_MONOTONIC)
     time_t simulation_start;
     time_t simulation_end;
-    
-    // Statystyki sprzedaży
-    int tickets_sold[TICKET_TYPE_COUNT];
-    int total_revenue;
-    
-    // Statystyki przejazdów
-    int chair_departures;
-    int passengers_transported;
-    int cyclists_transported;
-    int pedestrians_transported;
-    
-    // Kategorie specjalne
-    int vip_served;
-    int children_with_guardian;
-    int rejected_expired;       // Odrzuceni z wygasłym karnetem
-    
-    // Trasy
-    int trail_usage[TRAIL_COUNT];
-    
-    // Statystyki per bilet (liczba zjazdów)
-    #define MAX_TICKETS 20000
-    int ticket_rides[MAX_TICKETS];  // ticket_rides[ticket_id] = liczba zjazdów
-    
-    // Rejestracja przejść przez bramki (id karnetu - godzina)
-    #define MAX_GATE_ENTRIES 50000
-    struct {
-        int ticket_id;
-        time_t entry_time;
-        int gate_number;
-    } gate_entries[MAX_GATE_ENTRIES];
-    int gate_entries_count;
-    
-    // Kolejki i liczniki
-    int tourists_in_station;    // Na dolnej stacji
-    int tourists_on_platform;   // Na peronie (dolna stacja)
-    int tourists_at_top;        // Na górnej stacji (czekający na wyjście/zjazd)
-    int active_chairs;          // Krzesełka w ruchu
-    int tourists_waiting_entry; // Czekający przed bramkami
-    int tourists_at_cashier;    // Czekający na bilet przy kasie
-    int tourists_descending;    // W trakcie zjazdu trasą
-    
-    // PIDy procesów
+
+    // PIDy procesów (zapis raz przy starcie)
     pid_t main_pid;
     pid_t cashier_pid;
     pid_t worker1_pid;
     pid_t worker2_pid;
-    
-    // Flagi awaryjne
-    int emergency_initiator;    // 1 lub 2 (który pracownik)
-    bool worker1_ready;
-    bool worker2_ready;
-    
-    // Kolejny ID
+
+    // Licznik zmian stanu (słowo futex - stan_czekaj/stan_powiadom) - zapis przy każdym powiadomieniu
+    NOWA_LINIA unsigned int state_seq;
+
+    // Dzwonki odbiorców kanałów - budzi je nadawca komunikatu i stan_powiadom
+    DzwonekOdbiorcy dzwonki[ODBIORCA_COUNT];
+
+    // Liczniki obłożenia - pola atomowe zwiększane bez semaforów (licznik_dodaj)
+
+    // Kolejki i liczniki obłożenia
+    NOWA_LINIA _Atomic int tourists_in_station;     // Na dolnej stacji
+    _Atomic int tourists_on_platform;   // Na peronie (dolna stacja)
+    _Atomic int tourists_at_top;        // Na górnej stacji (czekający na wyjście/zjazd)
+    _Atomic int tourists_waiting_entry; // Czekający przed bramkami
+    _Atomic int tourists_at_cashier;    // Czekający na bilet przy kasie
+    _Atomic int tourists_descending;    // W trakcie zjazdu trasą
+
+    // Krzesełka w ruchu
+    NOWA_LINIA _Atomic int active_chairs;
+    _Atomic int chair_departures;
+
+    // Statystyki - shard na proces piszący (sumowane przy odczycie)
+    StatystykiShard stat_shardy[STAT_SHARDS];
+
+    // Kolejne ID (SEM_TICKETS / main)
+    NOWA_LINIA int next_ticket_id;
     int next_tourist_id;
-    int next_ticket_id;
     int next_chair_id;
-    
-    // Liczniki do zakończenia
-    int total_tourists_created;
-    int total_tourists_finished;
-    
+    int vip_queue_size;         // rozmiar kolejki VIP
+
+    // Pierścień deskryptorów turystów (tryb puli) - SEM_POOL_*
+    NOWA_LINIA int tourist_ring_head;       // Indeks do odczytu (gospodarze)
+    int tourist_ring_tail;      // Indeks do zapisu (main)
+    NOWA_LINIA TouristDescriptor tourist_ring[TOURIST_POOL_RING];
+
+    // === Dane zimne - duże tablice poza nagłówkiem ===
+
+    // Tablice karnetów leżą za stałą częścią segmentu (przejazdy_karnetow, przejscia_bramek),
+    // rozmiary z TOTAL_TOURISTS konfiguracji - ustala je main przy tworzeniu
+    NOWA_LINIA int max_tickets;         // Pojemność przejazdów per karnet (ID 1..max_tickets-1)
+    int max_gate_entries;               // Pojemność rejestru przejść przez bramki
+    int gate_entries_count;             // SEM_GATES
+    int gate_entries_dropped;           // Przejścia poza rejestrem (pełny) - SEM_GATES
+
     // Krzesełka
-    Chair chairs[MAX_CHAIRS];
-    
-    // rozmiar kolejki VIP
-    int vip_queue_size;
+    NOWA_LINIA Chair chairs[MAX_CHAIRS];
 } SharedMemory;
 
-// Struktura komunikatu
+// Wpis rejestru przejść przez bramki (id karnetu - godzina)
+typedef struct {
+    int ticket_id;
+    time_t entry_time;
+    int gate_number;
+} WpisBramki;
+
+// Spójna kopia liczników (statystyki_migawka) - raport i zamykanie symulacji
+typedef struct {
+    int tourists_in_station;
+    int tourists_on_platform;
+    int tourists_at_top;
+    int tourists_waiting_entry;
+    int tourists_at_cashier;
+    int tourists_descending;
+    int active_chairs;
+    int chair_departures;
+    int total_tourists_created;
+    int total_tourists_finished;
+    int tickets_sold[TICKET_TYPE_COUNT];
+    int total_revenue;
+    int passengers_transported;
+    int cyclists_transported;
+    int pedestrians_transported;
+    int vip_served;
+    int children_with_guardian;
+    int rejected_expired;
+    int trail_usage[TRAIL_COUNT];
+    int chair_occupancy[CHAIR_CAPACITY + 1];
+    int platform_boarded;
+    long long platform_wait_total_ms;
+    long long platform_wait_max_ms;
+    int packing_skips;
+    int czas_do_wsiadania[HIST_KOSZYKI];
+    int czas_na_szczyt[HIST_KOSZYKI];
+} MigawkaStatystyk;
+
+// Komunikat: wspólny nagłówek + ładunek zależny od typu (MSG_*). Kanały i skrzynki
+// przenoszą tylko nagłówek i ładunek swojego typu (KOMUNIKAT_ROZMIAR), nie całą unię.
+
+typedef struct {
+    unsigned char age;
+    unsigned char tourist_type;     // TouristType
+    unsigned char is_vip;
+    unsigned char children_count;
+    unsigned char child_ages[2];
+    unsigned char ticket_type;      // Żądany typ biletu (TicketType)
+} ZadanieBiletu;
+
+typedef struct {
+    int ticket_id;                  // -1 - odmowa
+    unsigned char ticket_type;      // TicketType
+} PrzydzialBiletu;
+
+typedef struct {
+    unsigned char tourist_type;     // TouristType
+    unsigned char children_count;
+} ZgloszenieNaPeron;
+
+typedef struct {
+    signed char trail;              // TrailType, -1 - pieszy wychodzi bez zjazdu
+} ProsbaWyjscia;
+
 typedef struct {
-    long mtype;
-    pid_t sender_pid;
     int tourist_id;
-    int data;           // Różne dane w zależności od typu
-    int data2;          // Dodatkowe dane
-    TouristType tourist_type;
-    int age;
-    bool is_vip;
-    int children_count;
-    int child_ids[CHAIR_CAPACITY];
-    TicketType ticket_type;  // Żądany typ biletu
-} Message;
+    int reply_box;
+} PasazerKrzeselka;
+
+typedef struct {
+    int chair_id;
+    int grupa;                      // Grupa powiadomień (skrzynki.c), -1 - odpowiedzi do skrzynek
+    unsigned char count;
+    PasazerKrzeselka pasazerowie[CHAIR_CAPACITY];
+} PrzyjazdKrzeselka;
+
+typedef struct {
+    int tourist_id;
+    int reply_box;                  // Skrzynka odpowiedzi turysty (skrzynki.c)
+    unsigned char typ;              // MSG_*
+    union {
+        ZadanieBiletu zadanie;      // MSG_TOURIST_TO_CASHIER
+        PrzydzialBiletu bilet;      // MSG_CASHIER_TO_TOURIST
+        ZgloszenieNaPeron peron;    // MSG_TOURIST_TO_PLATFORM
+        PrzyjazdKrzeselka przyjazd; // MSG_CHAIR_ARRIVAL
+        ProsbaWyjscia wyjscie;      // MSG_TOURIST_EXIT
+    } u;
+} Komunikat;
 
-#define MSG_SIZE (sizeof(Message) - sizeof(long))
+// Rozmiar nagłówka z jednym ładunkiem unii; komunikat bez ładunku ma KOMUNIKAT_NAGLOWEK
+#define KOMUNIKAT_ROZMIAR(pole)  (offsetof(Komunikat, u) + sizeof(((Komunikat*)0)->u.pole))
+#define KOMUNIKAT_NAGLOWEK       offsetof(Komunikat, u)
 
 // kolory ansi do logów
 #define ANSI_RESET       "\033[0m"
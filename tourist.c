@@ -1,4 +1,8 @@
-// tourist.c - proces turysty korzystającego z kolei linowej
+// tourist.c - turyści korzystający z kolei linowej
+// Każdy turysta to automat stanów (TouristCtx) przesuwany zdarzeniami:
+// przydział semafora, odpowiedź pracownika, timer, zmiana stanu symulacji.
+// Jeden wątek pętli zdarzeń (epoll + eventfd + timerfd) prowadzi wszystkich
+// turystów procesu - w trybie procesu jednego, w trybie puli (--host) tysiące.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,856 +11,1306 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
-#include <sys/msg.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <pthread.h>
 #include "struktury.h"
 #include "utils.h"
 #include "logger.h"
+#include "zdarzenia.h"
+#include "kolo_czasowe.h"
+#include "kanaly.h"
+#include "skrzynki.h"
+#include "harmonogram.h"
+#include "konfig.h"
 
-// Globalne zmienne dla wątków
 static volatile sig_atomic_t shutdown_flag = 0;
-static volatile sig_atomic_t emergency_flag = 0;
 
 static int g_sem_id = -1;
-static int g_msg_id = -1;
 static SharedMemory* g_shm = NULL;
-static int g_tourist_id = -1;
+static StatystykiShard* g_stat = NULL;  // Shard statystyk (nr gospodarza / tourist_id)
 static pid_t g_pid = 0;
 
-// Dane turysty
-static int g_age = 0;
-static TouristType g_type = TOURIST_PEDESTRIAN;
-static bool g_is_vip = false;
-static int g_ticket_id = -1;
-static TicketType g_ticket_type = TICKET_SINGLE;
-static time_t g_ticket_valid_until = 0;
-static int g_children_count = 0;
-static int g_child_ages[2] = {0, 0};
-
-// Struktura dziecka (realizowana wątkiem)
+// Stany automatu turysty (na co turysta czeka)
+typedef enum {
+    ST_CZEKA_WPUSZCZENIE,       // SEM_ACTIVE_TOURISTS (throttling)
+    ST_CZEKA_OTWARCIE_KASY,     // shm->cashier_open
+    ST_CZEKA_MIEJSCE_KASA,      // SEM_CASHIER_QUEUE
+    ST_CZEKA_BILET,             // Odpowiedź kasjera
+    ST_CZEKA_STACJA,            // SEM_STATION (limit N osób)
+    ST_CZEKA_BRAMKA_WEJSCIE,    // SEM_GATE_ENTRY
+    ST_CZEKA_BRAMKA_PERON,      // SEM_GATE_PLATFORM
+    ST_CZEKA_KONIEC_AWARII,     // shm->emergency_stop
+    ST_CZEKA_KOLEJKA_PERON,     // SEM_PLATFORM_QUEUE
+    ST_CZEKA_WSIADANIE,         // Odpowiedź worker1 (1 = wsiadaj, -1 = odmowa)
+    ST_JAZDA,                   // Odpowiedź worker2 (2 = dotarcie na górę)
+    ST_ZJAZD,                   // Timer trasy zjazdowej
+    ST_CZEKA_WYJSCIE,           // Odpowiedź worker2 (3 = wyjście potwierdzone)
+    ST_WYSYLKA,                 // Ponawianie wysyłki przy pełnym kanale (timer)
+    ST_KONIEC
+} TouristState;
+
+typedef enum {
+    EV_SEMAFOR,                 // Semafor, na który czekał turysta, opuszczony
+    EV_ODPOWIEDZ,               // Odpowiedź ze skrzynki turysty
+    EV_TIMER,                   // Minął termin timera turysty
+    EV_STAN                     // Zmiana stanu symulacji (state_seq)
+} TouristEvent;
+
+// Mosty semaforów: wątek mostu opuszcza semafor System V w imieniu pierwszego
+// czekającego turysty i zgłasza przydział pętli zdarzeń (semafor nie ma deskryptora)
+typedef enum {
+    MOST_AKTYWNI,
+    MOST_KASA,
+    MOST_STACJA,
+    MOST_BRAMKA_WEJSCIE,
+    MOST_BRAMKA_PERON,
+    MOST_KOLEJKA_PERON,
+    MOST_COUNT
+} MostId;
+
+static const int most_semafor[MOST_COUNT] = {
+    SEM_ACTIVE_TOURISTS, SEM_CASHIER_QUEUE, SEM_STATION,
+    SEM_GATE_ENTRY, SEM_GATE_PLATFORM, SEM_PLATFORM_QUEUE
+};
+
+typedef struct TouristCtx TouristCtx;
+
 typedef struct {
-    int child_index;
-    int child_age;
-    pthread_t thread;
-    volatile bool on_chair;
-    volatile bool finished;
-} ChildThread;
+    int sem_num;
+    pthread_t watek;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int zadane;                 // Opuszczenia zlecone wątkowi mostu
+    int przyznane;              // Opuszczone, jeszcze nie odebrane przez pętlę
+    TouristCtx* glowa;          // FIFO czekających (tylko wątek pętli)
+    TouristCtx* ogon;
+} MostSemafora;
+
+// Stan jednego turysty
+struct TouristCtx {
+    int tourist_id;
+    int age;
+    TouristType type;
+    bool is_vip;
+    int ticket_id;
+    TicketType ticket_type;
+    long long ticket_valid_until;   // Chwila symulacji (ms), 0 - bez limitu
+    int children_count;
+    int child_ages[2];
+    int entry_gate;                 // Numer bramki wejściowej
+    StrumienLosowy los;             // Strumień decyzji turysty (ziarno główne, tourist_id)
+    int ride_count;
+    long long start_przejazdu_us;   // Wejście do kolejki po przejazd (CLOCK_MONOTONIC) - histogramy opóźnień
+    bool przybyl;                   // Wszedł do systemu (po throttlingu)
+    int skrzynka;                   // Skrzynka odpowiedzi (-1 - brak)
+    bool zglosil_awarie;
+
+    TouristState stan;
+
+    // Zasoby trzymane przez turystę - zwalniane przy przerwaniu wizyty
+    bool trzyma_kase;               // SEM_CASHIER_QUEUE + tourists_at_cashier
+    bool trzyma_stacje;             // SEM_STATION
+    bool liczony_na_stacji;         // tourists_in_station
+    bool trzyma_bramke_peron;       // SEM_GATE_PLATFORM
+    bool trzyma_kolejke_peron;      // SEM_PLATFORM_QUEUE
+
+    // Oczekiwanie na most semafora
+    int most;                       // MostId lub -1
+    TouristCtx* most_nastepny;
+    TouristCtx* most_poprzedni;
+
+    // Wysyłka z ponawianiem
+    KanalId kanal_wysylki;
+    Komunikat do_wyslania;
+    TouristState stan_po_wysylce;
+    bool wysylka_przerywalna;       // Przerwij gdy bramki zamknięte
+
+    TrailType trail;
+    TimerKola timer;
+
+    TouristCtx* nastepny_id;        // Łańcuch w rejestrze (tourist_id)
+    TouristCtx* nastepny;           // Lista wszystkich turystów procesu
+    TouristCtx* poprzedni;
+};
 
-static ChildThread g_children[2];
-static pthread_mutex_t children_mutex = PTHREAD_MUTEX_INITIALIZER;
+// === Pętla zdarzeń - stan wspólny ===
 
-// Licznik bramek wejściowych lokalny
-static int g_entry_gate = 0;
+#define REJESTR_ROZMIAR 4096        // Kubełki rejestru tourist_id -> turysta (potęga 2)
+
+static int g_epoll = -1;
+static int g_eventfd = -1;          // Budzenie pętli przez wątki pomocnicze
+static int g_timerfd = -1;          // Najbliższy termin koła czasowego
+static KoloCzasowe g_kolo;
+static MostSemafora g_mosty[MOST_COUNT];
+static TouristCtx* g_rejestr[REJESTR_ROZMIAR];
+static TouristCtx* g_wszyscy = NULL;
+static unsigned int g_ostatni_stan = 0;
+
+// Wejście pętli - wypełniane przez wątek pobierania, odbierane zamianą buforów
+typedef struct {
+    TouristDescriptor* nowi;
+    int liczba_nowych;
+    int pojemnosc_nowych;
+} WejsciePetli;
+
+static pthread_mutex_t g_wejscie_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wejscie_cond;       // Zwolnienie miejsca (limit gospodarza)
+static WejsciePetli g_wejscie;
+static int g_prowadzeni = 0;                // Turyści w pętli + oczekujący deskryptory
+static bool g_pobieranie_zakonczone = false;
+static pthread_cond_t g_zebrano_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int g_zebrano = 0;          // Obiegi pętli, które opróżniły skrzynki
 
 // Handler sygnałów
 void tourist_signal_handler(int sig) {
     if (sig == SIGTERM) {
         shutdown_flag = 1;
-    } else if (sig == SIGUSR1) {
-        emergency_flag = 1;
-    } else if (sig == SIGUSR2) {
-        emergency_flag = 0;
     }
 }
 
-// Funkcja wątku dziecka - dziecko podąża za rodzicem
-void* child_thread_func(void* arg) {
-    ChildThread* child = (ChildThread*)arg;
+static void obudz_petle(void) {
+    uint64_t jeden = 1;
+    if (write(g_eventfd, &jeden, sizeof(jeden)) == -1 && errno != EAGAIN) {
+        perror("Błąd write eventfd");
+    }
+}
+
+// Drzemka rzeczywista (ms) przeliczona na czas symulacji dla koła czasowego
+static long long ms_na_sim(long ms) {
+    long long sim = (long long)ms * 1000000000LL / g_shm->sim_second_ns;
+    return sim > 0 ? sim : 1;
+}
+
+static void ustaw_timer(TouristCtx* t, long long termin) {
+    kolo_dodaj(&g_kolo, &t->timer, termin);
+}
+
+// === Mosty semaforów ===
+
+static void* watek_mostu(void* arg) {
+    MostSemafora* m = (MostSemafora*)arg;
 
-    logger(LOG_TOURIST, "Dziecko #%d (wiek %d) turysty #%d - podąża z opiekunem",
-           child->child_index, child->child_age, g_tourist_id);
+    pthread_mutex_lock(&m->mutex);
+    while (1) {
+        while (m->zadane == 0) {
+            pthread_cond_wait(&m->cond, &m->mutex);
+        }
+        pthread_mutex_unlock(&m->mutex);
 
-    // Dziecko czeka aż rodzic zakończy - aktywne czekanie
-    while (!child->finished && !shutdown_flag) {
+        int result = sem_opusc_timeout(g_sem_id, m->sem_num, SEM_WAIT_MS);
+        if (result == -1) {
+            return NULL;    // Semafory usunięte
+        }
+
+        pthread_mutex_lock(&m->mutex);
+        if (result == 1) {
+            if (m->zadane > 0) {
+                m->zadane--;
+                m->przyznane++;
+                obudz_petle();
+            } else {
+                // Czekający zrezygnował w trakcie opuszczania
+                sem_podnies(g_sem_id, m->sem_num);
+            }
+        }
     }
+}
 
-    return NULL;
+// Turysta staje w kolejce FIFO mostu (niezmiennik: długość FIFO = zadane + przyznane)
+static void czekaj_most(TouristCtx* t, MostId most, TouristState stan) {
+    MostSemafora* m = &g_mosty[most];
+    t->stan = stan;
+    t->most = most;
+    t->most_nastepny = NULL;
+    t->most_poprzedni = m->ogon;
+    if (m->ogon) {
+        m->ogon->most_nastepny = t;
+    } else {
+        m->glowa = t;
+    }
+    m->ogon = t;
+
+    pthread_mutex_lock(&m->mutex);
+    m->zadane++;
+    pthread_cond_signal(&m->cond);
+    pthread_mutex_unlock(&m->mutex);
 }
 
-// Uruchom wątki dzieci
-void start_children_threads(void) {
-    for (int i = 0; i < g_children_count; i++) {
-        g_children[i].child_index = i;
-        g_children[i].child_age = g_child_ages[i];
-        g_children[i].on_chair = false;
-        g_children[i].finished = false;
-        
-        if (pthread_create(&g_children[i].thread, NULL, child_thread_func, &g_children[i]) != 0) {
-            perror("Błąd tworzenia wątku dziecka");
-        }
+static void odlacz_od_mostu(TouristCtx* t) {
+    MostSemafora* m = &g_mosty[t->most];
+    if (t->most_poprzedni) {
+        t->most_poprzedni->most_nastepny = t->most_nastepny;
+    } else {
+        m->glowa = t->most_nastepny;
+    }
+    if (t->most_nastepny) {
+        t->most_nastepny->most_poprzedni = t->most_poprzedni;
+    } else {
+        m->ogon = t->most_poprzedni;
     }
+    t->most = -1;
 }
 
-// Zakończ wątki dzieci
-void finish_children_threads(void) {
-    // Ustawienie flagi finished dla wszystkich dzieci
-    pthread_mutex_lock(&children_mutex);
-    for (int i = 0; i < g_children_count; i++) {
-        g_children[i].finished = true;
+// Rezygnacja z czekania - jedno zlecenie mniej albo zwrot już opuszczonego semafora
+static void anuluj_most(TouristCtx* t) {
+    if (t->most < 0) return;
+    MostSemafora* m = &g_mosty[t->most];
+    odlacz_od_mostu(t);
+
+    bool zwrot = false;
+    pthread_mutex_lock(&m->mutex);
+    if (m->zadane > 0) {
+        m->zadane--;
+    } else if (m->przyznane > 0) {
+        m->przyznane--;
+        zwrot = true;
     }
-    pthread_mutex_unlock(&children_mutex);
-    
-    // Dołączenie do wątków - flaga finished je wybudzi
-    for (int i = 0; i < g_children_count; i++) {
-        pthread_join(g_children[i].thread, NULL);
+    pthread_mutex_unlock(&m->mutex);
+
+    if (zwrot) {
+        sem_podnies(g_sem_id, m->sem_num);
     }
 }
 
-// Kupno biletu
-bool buy_ticket(void) {
-    Message msg;
+// === Pomocnicze operacje na pamięci dzielonej ===
+
+static void zmien_przy_kasie(int delta) {
+    licznik_dodaj(g_shm->tourists_at_cashier, delta);
+}
 
-    // Czekaj na otwarcie kasy - aktywne czekanie
-    while (!g_shm->cashier_open && !g_shm->gates_closed && !shutdown_flag) {
+static void zmien_na_stacji(int delta) {
+    int na_stacji = licznik_dodaj(g_shm->tourists_in_station, delta) + delta;
+    if (delta > 0) {
+        logger(LOG_SYSTEM, "%d/%d turystów na stacji dolnej", na_stacji,
+               konfig()->station_capacity);
     }
+}
 
-    // Jeśli bramki zamknięte lub kasa nie otwarta
-    if (g_shm->gates_closed || !g_shm->cashier_open) {
-        return false;
+static bool bramki_zamkniete(void) {
+    sem_opusc(g_sem_id, SEM_MAIN);
+    bool gates_closed = g_shm->gates_closed;
+    sem_podnies(g_sem_id, SEM_MAIN);
+    return gates_closed;
+}
+
+static void policz_przejazd(TouristCtx* t) {
+    if (t->ticket_id > 0 && t->ticket_id < g_shm->max_tickets) {
+        licznik_dodaj(przejazdy_karnetow(g_shm)[t->ticket_id], 1);
     }
+}
 
-    // Czekaj na miejsce w kolejce do kasjera (aktywne czekanie)
-    while (1) {
-        int result = sem_probuj_opusc(g_sem_id, SEM_CASHIER_QUEUE);
-        if (result == 1) break; // Sukces
-        if (shutdown_flag || g_shm->gates_closed) {
-            return false;
-        }
+static void odrzuc_wygasly(void) {
+    licznik_dodaj(g_stat->rejected_expired, 1);
+}
+
+// Zwolnienie wszystkich trzymanych zasobów (kolejność jak przy normalnym przejściu)
+static void zwolnij_zasoby(TouristCtx* t) {
+    if (t->trzyma_kase) {
+        zmien_przy_kasie(-1);
+        sem_podnies(g_sem_id, SEM_CASHIER_QUEUE);
+        t->trzyma_kase = false;
+    }
+    if (t->trzyma_kolejke_peron) {
+        sem_podnies(g_sem_id, SEM_PLATFORM_QUEUE);
+        t->trzyma_kolejke_peron = false;
+    }
+    if (t->trzyma_bramke_peron) {
+        sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
+        t->trzyma_bramke_peron = false;
+    }
+    if (t->liczony_na_stacji) {
+        zmien_na_stacji(-1);
+        t->liczony_na_stacji = false;
+    }
+    if (t->trzyma_stacje) {
+        sem_podnies(g_sem_id, SEM_STATION);
+        t->trzyma_stacje = false;
     }
+}
+
+// === Zakończenie wizyty ===
+
+// Licznik zakończonych i zwolnienie miejsca (throttling)
+static void zakoncz_wizyte(TouristCtx* t) {
+    licznik_dodaj(g_stat->total_tourists_finished, 1 + t->children_count);
 
-    // Zwiększ licznik czekających przy kasie (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_at_cashier++;
-    sem_podnies(g_sem_id, SEM_QUEUE);
+    skrzynka_zwolnij(t->skrzynka);
+    t->skrzynka = -1;
 
-    // Wyślij prośbę o bilet (VIP używa innego typu)
-    if (g_is_vip) {
-        msg.mtype = MSG_VIP_PRIORITY + MSG_TOURIST_TO_CASHIER;
+    // Turysta, który nie doczekał się wpuszczenia, nie opuścił SEM_ACTIVE_TOURISTS
+    if (t->przybyl) {
+        sem_podnies(g_sem_id, SEM_ACTIVE_TOURISTS);
+    }
+    t->stan = ST_KONIEC;
+}
+
+static void koniec_wizyty(TouristCtx* t) {
+    logger(LOG_TOURIST, "Turysta #%d kończy wizytę (przejazdy: %d)", t->tourist_id, t->ride_count);
+    zakoncz_wizyte(t);
+}
+
+static void rezygnacja(TouristCtx* t) {
+    logger(LOG_TOURIST, "Turysta #%d nie mógł kupić biletu - rezygnuje", t->tourist_id);
+    zakoncz_wizyte(t);
+}
+
+// Przerwanie wizyty w dowolnym stanie (bramki zamknięte, koniec symulacji, SIGTERM)
+static void przerwij(TouristCtx* t, const char* powod) {
+    if (powod) {
+        logger(LOG_TOURIST, "Turysta #%d - %s", t->tourist_id, powod);
+    }
+    anuluj_most(t);
+    kolo_usun(&g_kolo, &t->timer);
+    zwolnij_zasoby(t);
+
+    if (t->ticket_id > 0) {
+        koniec_wizyty(t);
+    } else if (t->przybyl) {
+        rezygnacja(t);
     } else {
-        msg.mtype = MSG_TOURIST_TO_CASHIER;
-    }
-    msg.sender_pid = g_pid;
-    msg.tourist_id = g_tourist_id;
-    msg.age = g_age;
-    msg.tourist_type = g_type;
-    msg.is_vip = g_is_vip;
-    msg.children_count = g_children_count;
-    msg.child_ids[0] = g_child_ages[0];
-    msg.child_ids[1] = g_child_ages[1];
-    msg.ticket_type = g_ticket_type;
-
-    //próbowanie aż się uda lub shutdown
-    while (!wyslij_komunikat_nowait(g_msg_id, &msg)) {
-        if (shutdown_flag || g_shm->gates_closed) {
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_at_cashier--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_CASHIER_QUEUE);
-            return false;
-        }
+        zakoncz_wizyte(t);
     }
+}
 
-    // Czekaj na odpowiedź (adresowaną do naszego PID) - aktywnie
-    while (!shutdown_flag && g_shm->is_running) {
-        if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-            // Odebrano odpowiedź
-            break;
-        }
-        if (g_shm->gates_closed) {
-            // Bramki zamknięte - ostatnia próba odbioru
-            if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-                break;
-            }
-        }
+// === Wysyłka komunikatów ===
+
+static void po_wysylce(TouristCtx* t) {
+    if (t->stan == ST_CZEKA_WSIADANIE) {
+        // Komunikat do worker1 wysłany - turysta opuszcza stację i przechodzi na peron
+        int platform_gate = (t->tourist_id % konfig()->platform_gates) + 1;
+        zwolnij_zasoby(t);
+        logger(LOG_TOURIST, "Turysta #%d przeszedł na peron (bramka peronowa #%d, bilet #%d)",
+               t->tourist_id, platform_gate, t->ticket_id);
+    }
+}
+
+// Wysyłka bez blokowania pętli - przy pełnym kanale ponowienie po IDLE_WAIT_MS
+static void wyslij(TouristCtx* t, KanalId kanal, Komunikat* msg, TouristState nastepny, bool przerywalna) {
+    if (kanal_wyslij(kanal, msg, 0)) {
+        t->stan = nastepny;
+        po_wysylce(t);
+        return;
+    }
+    t->kanal_wysylki = kanal;
+    t->do_wyslania = *msg;
+    t->stan_po_wysylce = nastepny;
+    t->wysylka_przerywalna = przerywalna;
+    t->stan = ST_WYSYLKA;
+    ustaw_timer(t, zegar_teraz_ms(g_shm) + ms_na_sim(IDLE_WAIT_MS));
+}
+
+// === Kroki wizyty ===
+
+static void enter_station(TouristCtx* t);
+
+// Sprawdź ważność biletu
+bool is_ticket_valid(TouristCtx* t) {
+    if (t->ticket_type == TICKET_SINGLE) {
+        return true; // Jednorazowy - ważny do użycia
+    }
+    if (t->ticket_type == TICKET_DAILY) {
+        return true; // Dzienny - ważny cały dzień
     }
 
-    // Zmniejsz licznik czekających przy kasie (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_at_cashier--;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-    sem_podnies(g_sem_id, SEM_CASHIER_QUEUE);
+    // Czasowe - sprawdź czas
+    if (t->ticket_valid_until == 0) {
+        return true;
+    }
+
+    return (zegar_teraz_ms(g_shm) <= t->ticket_valid_until);
+}
+
+// Obsługa wielokrotnych przejazdów (dla biletów czasowych i dziennych)
+bool can_ride_again(TouristCtx* t) {
+    if (t->ticket_type == TICKET_SINGLE) {
+        return false; // Jednorazowy - tylko jeden przejazd
+    }
 
-    if (shutdown_flag) {
+    if (!is_ticket_valid(t)) {
+        logger(LOG_TOURIST, "Turysta #%d - bilet czasowy wygasł!", t->tourist_id);
+        odrzuc_wygasly();
         return false;
     }
 
-    // Sprawdź czy kasjer nie odmówił (bramki zamknięte)
-    if (msg.data == -1) {
+    if (bramki_zamkniete()) {
         return false;
     }
 
-    g_ticket_id = msg.data;
-    g_ticket_type = (TicketType)msg.data2;
+    // Losowa szansa na kolejny przejazd (50%)
+    return (strumien_zakres(&t->los, 100) < 50);
+}
+
+// Kasa otwarta (lub nie doczeka się otwarcia) - kolejka do kasjera
+static void kasa_dostepna(TouristCtx* t) {
+    if (g_shm->gates_closed || !g_shm->cashier_open) {
+        rezygnacja(t);
+        return;
+    }
+    czekaj_most(t, MOST_KASA, ST_CZEKA_MIEJSCE_KASA);
+}
+
+// Kupno biletu - czekanie na otwarcie kasy
+static void buy_ticket(TouristCtx* t) {
+    if (!g_shm->cashier_open && !g_shm->gates_closed && g_shm->is_running) {
+        t->stan = ST_CZEKA_OTWARCIE_KASY;   // Budzi zmiana stanu
+        return;
+    }
+    kasa_dostepna(t);
+}
+
+// Miejsce przy kasie - prośba o bilet (VIP przez osobny kanał)
+static void wyslij_do_kasjera(TouristCtx* t) {
+    t->trzyma_kase = true;
+    zmien_przy_kasie(+1);
+
+    Komunikat msg;
+    msg.typ = MSG_TOURIST_TO_CASHIER;
+    msg.reply_box = t->skrzynka;
+    msg.tourist_id = t->tourist_id;
+    msg.u.zadanie.age = (unsigned char)t->age;
+    msg.u.zadanie.tourist_type = t->type;
+    msg.u.zadanie.is_vip = t->is_vip;
+    msg.u.zadanie.children_count = t->children_count;
+    msg.u.zadanie.child_ages[0] = t->child_ages[0];
+    msg.u.zadanie.child_ages[1] = t->child_ages[1];
+    msg.u.zadanie.ticket_type = t->ticket_type;
+
+    wyslij(t, t->is_vip ? KANAL_KASA_VIP : KANAL_KASA, &msg, ST_CZEKA_BILET, true);
+}
 
-    // Ustaw czas ważności
-    time_t now = time(NULL);
-    switch (g_ticket_type) {
+// Odpowiedź kasjera (zawsze przychodzi - również odmowa po zamknięciu bramek)
+static void odebrano_bilet(TouristCtx* t, const Komunikat* msg) {
+    zwolnij_zasoby(t);
+
+    if (msg->u.bilet.ticket_id == -1) {
+        rezygnacja(t);
+        return;
+    }
+
+    t->ticket_id = msg->u.bilet.ticket_id;
+    t->ticket_type = (TicketType)msg->u.bilet.ticket_type;
+
+    // Ustaw czas ważności (zegar symulacji)
+    long long now = zegar_teraz_ms(g_shm);
+    switch (t->ticket_type) {
         case TICKET_TK1:
-            g_ticket_valid_until = now + TK1_DURATION;
+            t->ticket_valid_until = now + TK1_DURATION * 1000LL;
             break;
         case TICKET_TK2:
-            g_ticket_valid_until = now + TK2_DURATION;
+            t->ticket_valid_until = now + TK2_DURATION * 1000LL;
             break;
         case TICKET_TK3:
-            g_ticket_valid_until = now + TK3_DURATION;
+            t->ticket_valid_until = now + TK3_DURATION * 1000LL;
             break;
         case TICKET_SINGLE:
         case TICKET_DAILY:
         default:
-            g_ticket_valid_until = 0; // Brak ograniczenia czasowego
+            t->ticket_valid_until = 0; // Brak ograniczenia czasowego
             break;
     }
 
-    return true;
+    enter_station(t);
 }
 
-// Sprawdź ważność biletu
-bool is_ticket_valid(void) {
-    if (g_ticket_type == TICKET_SINGLE) {
-        return true; // Jednorazowy - ważny do użycia
+// Wejście na stację - kontrola biletu i limit N osób
+static void enter_station(TouristCtx* t) {
+    if (bramki_zamkniete()) {
+        logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte, odchodzę", t->tourist_id);
+        koniec_wizyty(t);
+        return;
     }
-    if (g_ticket_type == TICKET_DAILY) {
-        return true; // Dzienny - ważny cały dzień
+
+    if (!is_ticket_valid(t)) {
+        logger(LOG_TOURIST, "Turysta #%d - bilet wygasł! Nie mogę wejść.", t->tourist_id);
+        odrzuc_wygasly();
+        koniec_wizyty(t);
+        return;
     }
-    
-    // Czasowe - sprawdź czas
-    if (g_ticket_valid_until == 0) {
-        return true;
+
+    czekaj_most(t, MOST_STACJA, ST_CZEKA_STACJA);
+}
+
+// Miejsce na stacji - jeszcze raz bramki, potem bramka wejściowa (4 bramki)
+static void wejscie_na_stacje(TouristCtx* t) {
+    t->trzyma_stacje = true;
+
+    if (bramki_zamkniete()) {
+        przerwij(t, "bramki zamknięte, odchodzę");
+        return;
     }
-    
-    return (time(NULL) <= g_ticket_valid_until);
+
+    czekaj_most(t, MOST_BRAMKA_WEJSCIE, ST_CZEKA_BRAMKA_WEJSCIE);
 }
 
+static void go_to_platform(TouristCtx* t);
+
 // Przejście przez bramkę wejściową
-bool enter_station(void) {
+static void przejscie_bramki(TouristCtx* t) {
+    t->entry_gate = (t->tourist_id % konfig()->entry_gates) + 1;
+    t->liczony_na_stacji = true;
+    zmien_na_stacji(+1);
 
-    // Sprawdź czy bramki są otwarte
-    sem_opusc(g_sem_id, SEM_MAIN);
-    bool gates_closed = g_shm->gates_closed;
-    sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (gates_closed) {
-        logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte, odchodzę", g_tourist_id);
-        return false;
-    }
-    
-    // Sprawdź ważność biletu
-    if (!is_ticket_valid()) {
-        logger(LOG_TOURIST, "Turysta #%d - bilet wygasł! Nie mogę wejść.", g_tourist_id);
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->rejected_expired++;
-        sem_podnies(g_sem_id, SEM_STATS);
-        return false;
-    }
-    
-    // Czekaj na semafor stacji (limit N osób) - aktywne czekanie
-    while (1) {
-        int result = sem_probuj_opusc(g_sem_id, SEM_STATION);
-        if (result == 1) break; // Sukces
-        if (shutdown_flag) {
-            return false;
-        }
-        // Sprawdź czy bramki nie zostały zamknięte w międzyczasie
-        sem_opusc(g_sem_id, SEM_MAIN);
-        bool gates_now_closed = g_shm->gates_closed;
-        bool running = g_shm->is_running;
-        sem_podnies(g_sem_id, SEM_MAIN);
-
-        if (gates_now_closed) {
-            logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte podczas oczekiwania, odchodzę", g_tourist_id);
-            return false;
-        }
-        if (!running) return false;
-    }
-    
-    // Jeszcze raz sprawdź bramki po uzyskaniu dostępu do stacji
-    sem_opusc(g_sem_id, SEM_MAIN);
-    gates_closed = g_shm->gates_closed;
-    sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (gates_closed) {
-        // Bramki zamknięte - zwolnienie semaforu i odejście
-        sem_podnies(g_sem_id, SEM_STATION);
-        logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte, odchodzę", g_tourist_id);
-        return false;
-    }
-    
-    // Czekaj na bramkę wejściową (4 bramki) - aktywne czekanie
-    while (1) {
-        int result = sem_probuj_opusc(g_sem_id, SEM_GATE_ENTRY);
-        if (result == 1) break; // Sukces
-        if (shutdown_flag) {
-            sem_podnies(g_sem_id, SEM_STATION); // Zwolnij stację
-            return false;
-        }
-        // Sprawdź czy system jeszcze działa i bramki otwarte
-        sem_opusc(g_sem_id, SEM_MAIN);
-        bool running = g_shm->is_running;
-        bool gates_now_closed = g_shm->gates_closed;
-        sem_podnies(g_sem_id, SEM_MAIN);
-        if (!running || gates_now_closed) {
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
-    }
-    
-    // Przydziel numer bramki wejściowej (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_entry_gate = (g_tourist_id % ENTRY_GATES) + 1;
-    g_shm->tourists_in_station++;
-    logger(LOG_SYSTEM, "%d/50 turystów na stacji dolnej", g_shm->tourists_in_station);
-    sem_podnies(g_sem_id, SEM_QUEUE);
-    
     // Rejestruj przejście przez bramkę (id karnetu - godzina)
-    rejestruj_przejscie_bramki(g_ticket_id, g_entry_gate);
-    
-    if (g_ticket_type >= TICKET_TK1 && g_ticket_type <= TICKET_TK3) {
-        time_t remaining = g_ticket_valid_until - time(NULL);
+    rejestruj_przejscie_bramki(t->ticket_id, t->entry_gate);
+    zapisz_zdarzenie(ZD_BRAMKA_WEJSCIE, t->entry_gate, t->tourist_id, t->ticket_id, 0, 0);
+
+    if (t->ticket_type >= TICKET_TK1 && t->ticket_type <= TICKET_TK3) {
+        long long remaining = (t->ticket_valid_until - zegar_teraz_ms(g_shm)) / 1000;
         if (remaining > 0) {
-            logger(LOG_TOURIST, "Turysta #%d - pozostały czas biletu: %ld sekund", 
-            g_tourist_id, remaining);
+            logger(LOG_TOURIST, "Turysta #%d - pozostały czas biletu: %lld sekund",
+            t->tourist_id, remaining);
         }
     }
 
     // Log przejścia przez bramkę wejściową
-    const char* vip_str = g_is_vip ? " [VIP]" : "";
+    const char* vip_str = t->is_vip ? " [VIP]" : "";
     logger(LOG_TOURIST, "Turysta #%d%s wpuszczony przez bramkę wejściową #%d (bilet #%d)",
-           g_tourist_id, vip_str, g_entry_gate, g_ticket_id);
-    
+           t->tourist_id, vip_str, t->entry_gate, t->ticket_id);
+
     // Zwolnienienie bramki
     sem_podnies(g_sem_id, SEM_GATE_ENTRY);
-    
+
     logger(LOG_TOURIST, "Turysta #%d%s wszedł na stację dolną (bilet #%d, typ: %s)",
-           g_tourist_id, vip_str, g_ticket_id, 
-           g_type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy");
-    
-    return true;
+           t->tourist_id, vip_str, t->ticket_id,
+           t->type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy");
+
+    go_to_platform(t);
 }
 
-// Przejście na peron
-bool go_to_platform(void) {
-    // Sprawdź czy bramki są zamknięte - tak = turysta na stacji dolnej odchodzi
-    sem_opusc(g_sem_id, SEM_MAIN);
-    bool gates_closed = g_shm->gates_closed;
-    sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (gates_closed) {
-        // Bramki zamknięte - opuść stację dolną
-        logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte, opuszczam stację dolną", g_tourist_id);
-        sem_opusc(g_sem_id, SEM_QUEUE);
-        g_shm->tourists_in_station--;
-        sem_podnies(g_sem_id, SEM_QUEUE);
-        sem_podnies(g_sem_id, SEM_STATION);
-        return false;
+// Przejście na peron - bramka peronowa (3 bramki)
+static void go_to_platform(TouristCtx* t) {
+    if (bramki_zamkniete()) {
+        przerwij(t, "bramki zamknięte, opuszczam stację dolną");
+        return;
     }
-    
-    // Czekaj na bramkę na peron (3 bramki) - aktywne czekanie
-    while (1) {
-        int result = sem_probuj_opusc(g_sem_id, SEM_GATE_PLATFORM);
-        if (result == 1) break; // Sukces
-        if (shutdown_flag) {
-            // Zwolnij zasoby - opuszczamy stację bez przejścia na peron
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
-        // Sprawdź czy bramki nie zostały zamknięte lub system wyłączony
-        sem_opusc(g_sem_id, SEM_MAIN);
-        bool running = g_shm->is_running;
-        gates_closed = g_shm->gates_closed;
-        sem_podnies(g_sem_id, SEM_MAIN);
-
-        if (gates_closed) {
-            // Bramki zamknięte - opuść stację dolną
-            logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte podczas oczekiwania na peron, opuszczam stację", g_tourist_id);
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
-        if (!running) {
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
+
+    czekaj_most(t, MOST_BRAMKA_PERON, ST_CZEKA_BRAMKA_PERON);
+}
+
+// Przy bramce peronowej - jeśli jest awaria, czekanie aż się skończy
+static void przy_bramce_peronowej(TouristCtx* t) {
+    if (g_shm->emergency_stop) {
+        t->stan = ST_CZEKA_KONIEC_AWARII;   // Budzi zmiana stanu
+        return;
     }
-    
-    // sprawdzenie czy nie ma awarii przed wysłaniem komunikatu
-    // Jeśli jest awaria - czekanie aż się skończy
+    czekaj_most(t, MOST_KOLEJKA_PERON, ST_CZEKA_KOLEJKA_PERON);
+}
+
+// Miejsce w kolejce do platformy - komunikat do worker1
+static void wyslij_na_peron(TouristCtx* t) {
+    t->trzyma_kolejke_peron = true;
+
+    // Ostateczne sprawdzenie przed wysłaniem komunikatu
     sem_opusc(g_sem_id, SEM_MAIN);
-    bool emergency = g_shm->emergency_stop;
+    bool gates_closed = g_shm->gates_closed;
+    bool is_running = g_shm->is_running;
     sem_podnies(g_sem_id, SEM_MAIN);
 
-    while (emergency && !shutdown_flag) {
-        // Sprawdź czy bramki nie zostały zamknięte podczas czekania na koniec awarii
-        sem_opusc(g_sem_id, SEM_MAIN);
-        gates_closed = g_shm->gates_closed;
-        emergency = g_shm->emergency_stop;
-        bool running = g_shm->is_running;
-        sem_podnies(g_sem_id, SEM_MAIN);
-
-        if (gates_closed || !running) {
-            // Zwolnij bramkę i opuść stację
-            sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
+    if (gates_closed || !is_running) {
+        przerwij(t, "bramki zamknięte przed wejściem na peron, odchodzę");
+        return;
     }
-    
-    if (shutdown_flag) {
-        sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-        sem_opusc(g_sem_id, SEM_QUEUE);
-        g_shm->tourists_in_station--;
-        sem_podnies(g_sem_id, SEM_QUEUE);
-        sem_podnies(g_sem_id, SEM_STATION);
-        return false;
+
+    Komunikat msg;
+    msg.typ = MSG_TOURIST_TO_PLATFORM;
+    msg.reply_box = t->skrzynka;
+    msg.tourist_id = t->tourist_id;
+    msg.u.peron.tourist_type = t->type;
+    msg.u.peron.children_count = t->children_count;
+
+    wyslij(t, KANAL_PERON, &msg, ST_CZEKA_WSIADANIE, true);
+}
+
+// Opuszczenie systemu na górze (dla pieszych) - prośba o wyjście do worker2
+static void exit_at_top(TouristCtx* t) {
+    logger(LOG_TOURIST, "Turysta #%d (pieszy) opuszcza system na górnej stacji", t->tourist_id);
+
+    Komunikat msg;
+    msg.typ = MSG_TOURIST_EXIT;
+    msg.reply_box = t->skrzynka;
+    msg.tourist_id = t->tourist_id;
+    msg.u.wyjscie.trail = -1; // Specjalna wartość: wyjście bez zjazdu
+
+    wyslij(t, KANAL_WYJSCIA, &msg, ST_CZEKA_WYJSCIE, false);
+}
+
+// Zjazd trasą (dla rowerzystów) - wybór trasy i timer przejazdu
+static void descend_trail(TouristCtx* t) {
+    int r = strumien_zakres(&t->los, 100);
+    if (r < 40) {
+        t->trail = TRAIL_T1; // 40% łatwa
+    } else if (r < 75) {
+        t->trail = TRAIL_T2; // 35% średnia
+    } else {
+        t->trail = TRAIL_T3; // 25% trudna
     }
 
-    // Czekaj na miejsce w kolejce do platformy - aktywne czekanie
-    while (1) {
-        int result = sem_probuj_opusc(g_sem_id, SEM_PLATFORM_QUEUE);
-        if (result == 1) break; // Sukces
-        if (shutdown_flag || g_shm->gates_closed) {
-            sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
+    const char* trail_names[] = {"T1 (łatwa)", "T2 (średnia)", "T3 (trudna)"};
+    logger(LOG_TOURIST, "Turysta #%d wybiera trasę zjazdową %s",
+           t->tourist_id, trail_names[t->trail]);
+
+    t->stan = ST_ZJAZD;
+    ustaw_timer(t, zegar_teraz_ms(g_shm) + konfig()->trail_time[t->trail] * 1000LL);
+}
+
+// Koniec trasy - prośba o wyjście do worker2
+static void koniec_trasy(TouristCtx* t) {
+    Komunikat msg;
+    msg.typ = MSG_TOURIST_EXIT;
+    msg.reply_box = t->skrzynka;
+    msg.tourist_id = t->tourist_id;
+    msg.u.wyjscie.trail = (signed char)t->trail;
+
+    wyslij(t, KANAL_WYJSCIA, &msg, ST_CZEKA_WYJSCIE, false);
+}
+
+// Czas rzeczywisty (µs) do histogramów opóźnień w shardzie
+static long long teraz_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Wyjście potwierdzone przez worker2 (lub koniec symulacji)
+static void wyjscie_zakonczone(TouristCtx* t) {
+    policz_przejazd(t);
+
+    if (t->type == TOURIST_PEDESTRIAN) {
+        logger(LOG_TOURIST, "Turysta #%d (pieszy) zakończył wizytę na górnej stacji (bilet #%d)",
+               t->tourist_id, t->ticket_id);
+        koniec_wizyty(t);   // Pieszy kończy po jednym przejeździe
+        return;
     }
 
-    // Ostateczne sprawdzenie przed wysłaniem komunikatu
+    logger(LOG_TOURIST, "Turysta #%d zakończył trasę zjazdową i dotarł na stację dolną (bilet #%d)",
+           t->tourist_id, t->ticket_id);
+
+    if (t->ticket_type != TICKET_SINGLE && can_ride_again(t)) {
+        t->start_przejazdu_us = teraz_us();
+        enter_station(t);
+    } else {
+        koniec_wizyty(t);
+    }
+}
+
+// Wpuszczenie do systemu (throttling) - przybycie turysty
+static void przybycie(TouristCtx* t) {
+    t->przybyl = true;
+
+    // Sprawdź czy symulacja jeszcze trwa
     sem_opusc(g_sem_id, SEM_MAIN);
-    gates_closed = g_shm->gates_closed;
     bool is_running = g_shm->is_running;
+    bool gates_closed = g_shm->gates_closed;
     sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (gates_closed || !is_running) {
-        // Bramki zamknięte
-        logger(LOG_TOURIST, "Turysta #%d - bramki zamknięte przed wejściem na peron, odchodzę", g_tourist_id);
-        sem_podnies(g_sem_id, SEM_PLATFORM_QUEUE);
-        sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-        sem_opusc(g_sem_id, SEM_QUEUE);
-        g_shm->tourists_in_station--;
-        sem_podnies(g_sem_id, SEM_QUEUE);
-        sem_podnies(g_sem_id, SEM_STATION);
-        return false;
+
+    if (!is_running || gates_closed) {
+        zakoncz_wizyte(t);
+        return;
     }
 
-    // Wyślij komunikat do worker1
-    Message msg;
-    msg.mtype = MSG_TOURIST_TO_PLATFORM;
-    msg.sender_pid = g_pid;
-    msg.tourist_id = g_tourist_id;
-    msg.tourist_type = g_type;
-    msg.children_count = g_children_count;
-    msg.child_ids[0] = 0;
-    msg.child_ids[1] = 0;
-
-    //próbuj aż się uda lub shutdown
-    while (!wyslij_komunikat_nowait(g_msg_id, &msg)) {
-        if (shutdown_flag || g_shm->gates_closed) {
-            sem_podnies(g_sem_id, SEM_PLATFORM_QUEUE);
-            sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_in_station--;
-            sem_podnies(g_sem_id, SEM_QUEUE);
-            sem_podnies(g_sem_id, SEM_STATION);
-            return false;
-        }
+    // Skrzynka odpowiedzi na czas wizyty (pula REPLY_MAILBOXES > MAX_ACTIVE_TOURISTS)
+    t->skrzynka = skrzynka_przydziel();
+    if (t->skrzynka < 0) {
+        logger(LOG_SYSTEM, "[ERROR] Brak wolnej skrzynki odpowiedzi dla turysty #%d", t->tourist_id);
+        zakoncz_wizyte(t);
+        return;
     }
 
-    // Zwolnij semafor kolejki
-    sem_podnies(g_sem_id, SEM_PLATFORM_QUEUE);
-    
-    // Zwolnij bramkę na peron
-    sem_podnies(g_sem_id, SEM_GATE_PLATFORM);
-    
-    // Opuściliśmy stację - zwolnij miejsce (SEM_QUEUE)
-    int platform_gate = (g_tourist_id % PLATFORM_GATES) + 1;
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_in_station--;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-    
-    // Zwolnij semafor limitu stacji
-    sem_podnies(g_sem_id, SEM_STATION);
-    
-    logger(LOG_TOURIST, "Turysta #%d przeszedł na peron (bramka peronowa #%d, bilet #%d)", 
-           g_tourist_id, platform_gate, g_ticket_id);
-    
-    return true;
-}
-
-// Czekanie na krzesełko i jazda
-bool ride_chair(void) {
-    Message msg;
-    int wait_counter = 0;
-
-    // Czekaj na komunikat od worker1 (pozwolenie na wsiadanie)
-    // data==1 "wsiadaj"
-    // data==-1 "odmowa"
-    while (!shutdown_flag) {
-        // Sprawdzenie awarii
-        if (emergency_flag) {
-            logger(LOG_TOURIST, "Turysta #%d - awaria! Czekam na wznowienie...", g_tourist_id);
-            while (emergency_flag && !shutdown_flag) {
-                // Czekaj na koniec awarii - aktywnie
-                if (!odbierz_komunikat(g_msg_id, &msg, g_pid, false)) continue;
-                if (msg.data == -1) return false;
-            }
-            if (shutdown_flag) return false;
-        }
+    t->start_przejazdu_us = teraz_us();
 
-        // Sprawdź czy system jeszcze działa
-        if (!g_shm->is_running) {
-            logger(LOG_TOURIST, "Turysta #%d - system zamknięty, opuszczam peron", g_tourist_id);
-            return false;
-        }
-        
-        // Sprawdź czy bramki zamknięte - jeśli tak i czekamy zbyt długo, odejdź
-        wait_counter++;
-        if (wait_counter > 100000) {
-            sem_opusc(g_sem_id, SEM_MAIN);
-            bool gates_closed = g_shm->gates_closed;
-            sem_podnies(g_sem_id, SEM_MAIN);
-            
-            if (gates_closed) {
-                logger(LOG_TOURIST, "Turysta #%d - zbyt długie oczekiwanie przy zamkniętych bramkach, odchodzę", g_tourist_id);
-                return false;
-            }
-            wait_counter = 0;
-        }
+    const char* type_str = t->type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy";
+    const char* vip_str = t->is_vip ? " [VIP]" : "";
 
-        // Odbierz komunikat - aktywnie
-        if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-            if (msg.data == 1) {
-                // Pozwolenie na wsiadanie
-                break;
-            } else if (msg.data == -1) {
-                logger(LOG_TOURIST, "Turysta #%d - odmowa wsiadania (system się zamyka)", g_tourist_id);
-                return false;
-            }
-        }
+    if (t->children_count > 0) {
+        logger(LOG_TOURIST, "Turysta #%d%s przybywa (%s, %d lat, %d dzieci pod opieką)",
+               t->tourist_id, vip_str, type_str, t->age, t->children_count);
+    } else {
+        logger(LOG_TOURIST, "Turysta #%d%s przybywa (%s, %d lat)",
+               t->tourist_id, vip_str, type_str, t->age);
     }
 
-    if (shutdown_flag) return false;
+    // Dzieci podążają za opiekunem - dzielą jego stan, bez osobnych wątków
+    for (int i = 0; i < t->children_count; i++) {
+        logger(LOG_TOURIST, "Dziecko #%d (wiek %d) turysty #%d - podąża z opiekunem",
+               i, t->child_ages[i], t->tourist_id);
+    }
 
-    // Czekaj na komunikat o dotarciu na górę (data == 2)
-    while (!shutdown_flag) {
-        if (emergency_flag) {
-            logger(LOG_TOURIST, "Turysta #%d - awaria w trakcie jazdy!", g_tourist_id);
-            while (emergency_flag && !shutdown_flag) {
-                if (!odbierz_komunikat(g_msg_id, &msg, g_pid, false)) continue;
-            }
-            if (shutdown_flag) return false;
-        }
+    // Turyści nie korzystający z kolei 5% szans
+    if (strumien_zakres(&t->los, 100) < TOURIST_NO_RIDE_PERCENT) {
+        logger(LOG_TOURIST, "Turysta #%d tylko ogląda i odchodzi", t->tourist_id);
+        zakoncz_wizyte(t);
+        return;
+    }
 
-        // Sprawdź czy system jeszcze działa
-        if (!g_shm->is_running) {
-            return false;
-        }
+    buy_ticket(t);
+}
+
+// === Automat stanów ===
+
+// Reakcja na zmianę stanu symulacji w danym stanie turysty
+static void zmiana_stanu(TouristCtx* t) {
+    bool gates_closed = g_shm->gates_closed;
+    bool running = g_shm->is_running;
 
-        // Odbierz komunikat - aktywnie
-        if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-            if (msg.data == 2) {
-                // Dotarcie na górę
-                break;
+    switch (t->stan) {
+        case ST_CZEKA_WPUSZCZENIE:
+            if (gates_closed || !running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_OTWARCIE_KASY:
+            if (g_shm->cashier_open || gates_closed || !running) kasa_dostepna(t);
+            break;
+        case ST_CZEKA_MIEJSCE_KASA:
+            if (gates_closed || !running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_BILET:
+            if (!running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_STACJA:
+            if (gates_closed) przerwij(t, "bramki zamknięte podczas oczekiwania, odchodzę");
+            else if (!running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_BRAMKA_WEJSCIE:
+        case ST_CZEKA_KOLEJKA_PERON:
+            if (gates_closed || !running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_BRAMKA_PERON:
+            if (gates_closed) przerwij(t, "bramki zamknięte podczas oczekiwania na peron, opuszczam stację");
+            else if (!running) przerwij(t, NULL);
+            break;
+        case ST_CZEKA_KONIEC_AWARII:
+            if (gates_closed || !running) przerwij(t, NULL);
+            else if (!g_shm->emergency_stop) przy_bramce_peronowej(t);
+            break;
+        case ST_CZEKA_WSIADANIE:
+            if (!running) {
+                logger(LOG_TOURIST, "Turysta #%d - system zamknięty, opuszczam peron", t->tourist_id);
+                koniec_wizyty(t);
+            } else if (g_shm->emergency_stop && !t->zglosil_awarie) {
+                logger(LOG_TOURIST, "Turysta #%d - awaria! Czekam na wznowienie...", t->tourist_id);
             }
-        }
+            break;
+        case ST_JAZDA:
+            if (!running) {
+                koniec_wizyty(t);
+            } else if (g_shm->emergency_stop && !t->zglosil_awarie) {
+                logger(LOG_TOURIST, "Turysta #%d - awaria w trakcie jazdy!", t->tourist_id);
+            }
+            break;
+        case ST_CZEKA_WYJSCIE:
+            if (!running) wyjscie_zakonczone(t);
+            break;
+        case ST_WYSYLKA:
+            if (t->wysylka_przerywalna && gates_closed) przerwij(t, NULL);
+            break;
+        case ST_ZJAZD:
+        case ST_KONIEC:
+            break;
     }
 
-    return !shutdown_flag;
+    if (t->stan != ST_KONIEC) {
+        t->zglosil_awarie = g_shm->emergency_stop;
+    }
 }
 
-// Opuśczenie systemu na górze (dla pieszych)
-void exit_at_top(void) {
-    logger(LOG_TOURIST, "Turysta #%d (pieszy) opuszcza system na górnej stacji", g_tourist_id);
+// Przesunięcie automatu turysty zdarzeniem
+static void krok(TouristCtx* t, TouristEvent ev, const Komunikat* msg) {
+    if (ev == EV_STAN) {
+        zmiana_stanu(t);
+        return;
+    }
+
+    switch (t->stan) {
+        case ST_CZEKA_WPUSZCZENIE:
+            if (ev == EV_SEMAFOR) przybycie(t);
+            break;
+        case ST_CZEKA_MIEJSCE_KASA:
+            if (ev == EV_SEMAFOR) wyslij_do_kasjera(t);
+            break;
+        case ST_CZEKA_BILET:
+            if (ev == EV_ODPOWIEDZ && msg->typ == MSG_CASHIER_TO_TOURIST) odebrano_bilet(t, msg);
+            break;
+        case ST_CZEKA_STACJA:
+            if (ev == EV_SEMAFOR) wejscie_na_stacje(t);
+            break;
+        case ST_CZEKA_BRAMKA_WEJSCIE:
+            if (ev == EV_SEMAFOR) przejscie_bramki(t);
+            break;
+        case ST_CZEKA_BRAMKA_PERON:
+            if (ev == EV_SEMAFOR) {
+                t->trzyma_bramke_peron = true;
+                przy_bramce_peronowej(t);
+            }
+            break;
+        case ST_CZEKA_KOLEJKA_PERON:
+            if (ev == EV_SEMAFOR) wyslij_na_peron(t);
+            break;
+        case ST_CZEKA_WSIADANIE:
+            if (ev != EV_ODPOWIEDZ) break;
+            if (msg->typ == MSG_PLATFORM_TO_TOURIST) {
+                t->stan = ST_JAZDA;     // Pozwolenie na wsiadanie
+                histogram_dodaj(g_stat->czas_do_wsiadania, teraz_us() - t->start_przejazdu_us);
+            } else if (msg->typ == MSG_PLATFORM_REFUSED) {
+                logger(LOG_TOURIST, "Turysta #%d - odmowa wsiadania (system się zamyka)", t->tourist_id);
+                koniec_wizyty(t);
+            }
+            break;
+        case ST_JAZDA:
+            if (ev == EV_ODPOWIEDZ && msg->typ == MSG_TOP_ARRIVAL) {
+                // Dotarcie na górę - piesi wychodzą, rowerzyści zjeżdżają trasą
+                t->ride_count++;
+                histogram_dodaj(g_stat->czas_na_szczyt, teraz_us() - t->start_przejazdu_us);
+                if (t->type == TOURIST_PEDESTRIAN) {
+                    exit_at_top(t);
+                } else {
+                    descend_trail(t);
+                }
+            }
+            break;
+        case ST_ZJAZD:
+            if (ev == EV_TIMER) koniec_trasy(t);
+            break;
+        case ST_CZEKA_WYJSCIE:
+            if (ev == EV_ODPOWIEDZ && msg->typ == MSG_EXIT_DONE) wyjscie_zakonczone(t);
+            break;
+        case ST_WYSYLKA:
+            if (ev == EV_TIMER) wyslij(t, t->kanal_wysylki, &t->do_wyslania, t->stan_po_wysylce,
+                                       t->wysylka_przerywalna);
+            break;
+        case ST_CZEKA_OTWARCIE_KASY:
+        case ST_CZEKA_KONIEC_AWARII:
+        case ST_KONIEC:
+            break;
+    }
+}
 
-    // Wyślij prośbę o wyjście do worker2 (trasa = -1 wyjście bez zjazdu)
-    Message msg;
-    msg.mtype = MSG_TOURIST_EXIT;
-    msg.sender_pid = g_pid;
-    msg.tourist_id = g_tourist_id;
-    msg.data = -1; // Specjalna wartość: wyjście bez zjazdu
+// === Rejestr turystów pętli ===
 
-    wyslij_komunikat(g_msg_id, &msg);
+static TouristCtx* znajdz_turyste(int tourist_id) {
+    TouristCtx* t = g_rejestr[tourist_id & (REJESTR_ROZMIAR - 1)];
+    while (t && t->tourist_id != tourist_id) {
+        t = t->nastepny_id;
+    }
+    return t;
+}
 
-    // Czekaj na potwierdzenie wyjścia (aktywne czekanie)
-    while (!shutdown_flag && g_shm->is_running) {
-        if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-            if (msg.data == 3) {
-                break;
-            }
-        }
+static void usun_turyste(TouristCtx* t) {
+    TouristCtx** p = &g_rejestr[t->tourist_id & (REJESTR_ROZMIAR - 1)];
+    while (*p && *p != t) {
+        p = &(*p)->nastepny_id;
+    }
+    if (*p) {
+        *p = t->nastepny_id;
     }
 
-    // Rejestruj zjazd - wyjście na górze dla pieszego (SEM_STATS)
-    sem_opusc(g_sem_id, SEM_STATS);
-    if (g_ticket_id > 0 && g_ticket_id < MAX_TICKETS) {
-        g_shm->ticket_rides[g_ticket_id]++;
+    if (t->poprzedni) {
+        t->poprzedni->nastepny = t->nastepny;
+    } else {
+        g_wszyscy = t->nastepny;
     }
-    sem_podnies(g_sem_id, SEM_STATS);
+    if (t->nastepny) {
+        t->nastepny->poprzedni = t->poprzedni;
+    }
+
+    free(t);
 
-    logger(LOG_TOURIST, "Turysta #%d (pieszy) zakończył wizytę na górnej stacji (bilet #%d)",
-           g_tourist_id, g_ticket_id);
+    pthread_mutex_lock(&g_wejscie_mutex);
+    g_prowadzeni--;
+    pthread_cond_signal(&g_wejscie_cond);
+    pthread_mutex_unlock(&g_wejscie_mutex);
 }
 
-// Zjazd trasą i powrót na stację dolną (dla rowerzystów)
-void descend_trail(void) {
-    // Wybierz trasę
-    TrailType trail;
-    int r = rand() % 100;
-    if (r < 40) {
-        trail = TRAIL_T1; // 40% łatwa
-    } else if (r < 75) {
-        trail = TRAIL_T2; // 35% średnia
-    } else {
-        trail = TRAIL_T3; // 25% trudna
+// Zdarzenie dla turysty + sprzątanie po zakończonej wizycie
+static void zdarzenie(TouristCtx* t, TouristEvent ev, const Komunikat* msg) {
+    krok(t, ev, msg);
+    if (t->stan == ST_KONIEC) {
+        usun_turyste(t);
     }
-    
-    const char* trail_names[] = {"T1 (łatwa)", "T2 (średnia)", "T3 (trudna)"};
-    logger(LOG_TOURIST, "Turysta #%d wybiera trasę zjazdową %s",
-           g_tourist_id, trail_names[trail]);
-
-    int trail_times[] = {TRAIL_T1_TIME, TRAIL_T2_TIME, TRAIL_T3_TIME};
-    int waited_intervals = 0;
-    int required_intervals = trail_times[trail] * 10; // 10 x 100ms = 1 sekunda
-    while (waited_intervals < required_intervals && !shutdown_flag) {
-        waited_intervals++;
-    }
-    if (shutdown_flag) return;
-
-
-    // Wyślij prośbę o wyjście do worker2
-    Message msg;
-    msg.mtype = MSG_TOURIST_EXIT;
-    msg.sender_pid = g_pid;
-    msg.tourist_id = g_tourist_id;
-    msg.data = trail;
-    
-    wyslij_komunikat(g_msg_id, &msg);
-
-    // Czekaj na potwierdzenie zjazdu (aktywne czekanie)
-    while (!shutdown_flag && g_shm->is_running) {
-        if (odbierz_komunikat(g_msg_id, &msg, g_pid, false)) {
-            if (msg.data == 3) {
-                break;
-            }
-        }
+}
+
+// Nowy turysta - stan początkowy to czekanie na wpuszczenie (throttling)
+static void dodaj_turyste(const TouristDescriptor* d) {
+    TouristCtx* t = calloc(1, sizeof(TouristCtx));
+    if (!t) {
+        perror("Błąd alokacji turysty");
+        exit(1);
     }
+    t->tourist_id = d->tourist_id;
+    t->age = d->age;
+    t->type = d->type;
+    t->is_vip = d->is_vip;
+    t->ticket_id = -1;
+    t->skrzynka = -1;
+    strumien_init(&t->los, g_shm->ziarno, STRUMIEN_TURYSTA, d->tourist_id);
+    t->most = -1;
+    timer_init(&t->timer, t);
 
-    // Rejestruj zjazd dla tego biletu (SEM_STATS)
-    sem_opusc(g_sem_id, SEM_STATS);
-    if (g_ticket_id > 0 && g_ticket_id < MAX_TICKETS) {
-        g_shm->ticket_rides[g_ticket_id]++;
+    // Ogranicz dzieci do max 2
+    t->children_count = d->children_count > 2 ? 2 : d->children_count;
+
+    // Wygeneruj wiek dzieci (4-7 lat - wymagają opieki)
+    for (int i = 0; i < t->children_count; i++) {
+        t->child_ages[i] = 4 + strumien_zakres(&t->los, 4); // 4-7 lat
     }
-    sem_podnies(g_sem_id, SEM_STATS);
 
-    logger(LOG_TOURIST, "Turysta #%d zakończył trasę zjazdową i dotarł na stację dolną (bilet #%d)",
-           g_tourist_id, g_ticket_id);
+    // Typ biletu z harmonogramu przybyć lub losowany przez turystę
+    t->ticket_type = d->ticket_type >= 0 ? (TicketType)d->ticket_type
+                                         : (TicketType)strumien_zakres(&t->los, TICKET_TYPE_COUNT);
+
+    int kubelek = t->tourist_id & (REJESTR_ROZMIAR - 1);
+    t->nastepny_id = g_rejestr[kubelek];
+    g_rejestr[kubelek] = t;
+    t->nastepny = g_wszyscy;
+    if (g_wszyscy) {
+        g_wszyscy->poprzedni = t;
+    }
+    g_wszyscy = t;
+
+    // Opuść semafor aktywnych turystów - podniesiony na końcu wizyty
+    czekaj_most(t, MOST_AKTYWNI, ST_CZEKA_WPUSZCZENIE);
 }
 
-// Obsługa wielokrotnych przejazdów (dla biletów czasowych i dziennych)
-bool can_ride_again(void) {
-    if (g_ticket_type == TICKET_SINGLE) {
-        return false; // Jednorazowy - tylko jeden przejazd
+// === Wątki pomocnicze ===
+
+// Miejsce na kolejny element bufora wejścia (podwajanie pojemności)
+static void* zapewnij_miejsce(void* bufor, int liczba, int* pojemnosc, size_t rozmiar) {
+    if (liczba < *pojemnosc) return bufor;
+    *pojemnosc = *pojemnosc ? *pojemnosc * 2 : 64;
+    bufor = realloc(bufor, (size_t)*pojemnosc * rozmiar);
+    if (!bufor) {
+        perror("Błąd alokacji bufora pętli zdarzeń");
+        exit(1);
     }
-    
-    if (!is_ticket_valid()) {
-        logger(LOG_TOURIST, "Turysta #%d - bilet czasowy wygasł!", g_tourist_id);
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->rejected_expired++;
-        sem_podnies(g_sem_id, SEM_STATS);
-        return false;
+    return bufor;
+}
+
+// Sen na dzwonku skrzynek procesu - obudzenie pętli, która sama opróżnia skrzynki
+// (ten sam wątek je zwalnia). Do ponownego snu dopiero po opróżnieniu przez pętlę.
+static void* watek_odbioru(void* arg) {
+    (void)arg;
+
+    while (1) {
+        skrzynki_czekaj(-1);
+
+        pthread_mutex_lock(&g_wejscie_mutex);
+        unsigned int zebrano = g_zebrano;
+        pthread_mutex_unlock(&g_wejscie_mutex);
+        obudz_petle();
+
+        pthread_mutex_lock(&g_wejscie_mutex);
+        while (g_zebrano == zebrano) {
+            pthread_cond_wait(&g_zebrano_cond, &g_wejscie_mutex);
+        }
+        pthread_mutex_unlock(&g_wejscie_mutex);
     }
-    
-    // Sprawdź czy bramki są otwarte
-    sem_opusc(g_sem_id, SEM_MAIN);
-    bool gates_closed = g_shm->gates_closed;
-    sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (gates_closed) {
-        return false;
+    return NULL;
+}
+
+// Zmiana state_seq (futex) - obudzenie pętli
+static void* watek_stanu(void* arg) {
+    (void)arg;
+    while (1) {
+        unsigned int seq = stan_odczytaj(g_shm);
+        stan_czekaj(g_shm, seq, -1);
+        obudz_petle();
     }
-    
-    // Losowa szansa na kolejny przejazd (50%)
-    return (rand() % 100 < 50);
+    return NULL;
 }
 
-int main(int argc, char* argv[]) {
-    // Inicjalizacja loggera dla procesu potomnego
-    logger_init_child();
-    
-    // Konfiguracja sygnałów
-    struct sigaction sa;
-    sa.sa_handler = tourist_signal_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGTERM, &sa, NULL);
-    sigaction(SIGUSR1, &sa, NULL);
-    sigaction(SIGUSR2, &sa, NULL);
-    
-    g_pid = getpid();
-    srand(time(NULL) ^ g_pid);
-    
-    // Parsuj argumenty
-    if (argc < 2) {
-        fprintf(stderr, "Użycie: %s <tourist_id> [age] [type] [is_vip] [children_count]\n", argv[0]);
-        return 1;
+// Pobieranie deskryptorów turystów z pierścienia w pamięci dzielonej (tryb puli)
+static void* watek_pobierania(void* arg) {
+    (void)arg;
+
+    while (!shutdown_flag) {
+        // Limit turystów prowadzonych przez gospodarza
+        pthread_mutex_lock(&g_wejscie_mutex);
+        while (g_prowadzeni >= TOURIST_HOST_MAX_ACTIVE && !shutdown_flag) {
+            struct timespec termin;
+            termin_za_ms(&termin, SEM_WAIT_MS);
+            pthread_cond_timedwait(&g_wejscie_cond, &g_wejscie_mutex, &termin);
+        }
+        pthread_mutex_unlock(&g_wejscie_mutex);
+
+        TouristDescriptor d;
+        int result = pula_pobierz(g_sem_id, g_shm, &d, SEM_WAIT_MS);
+        if (result == -1) break;
+        if (result == 0) {
+            // Po zamknięciu bramek main nic już nie wstawia - pusty pierścień kończy pobieranie
+            if (g_shm->gates_closed || !g_shm->is_running) break;
+            continue;
+        }
+
+        pthread_mutex_lock(&g_wejscie_mutex);
+        g_wejscie.nowi = zapewnij_miejsce(g_wejscie.nowi, g_wejscie.liczba_nowych,
+                                          &g_wejscie.pojemnosc_nowych, sizeof(TouristDescriptor));
+        g_wejscie.nowi[g_wejscie.liczba_nowych++] = d;
+        g_prowadzeni++;
+        pthread_mutex_unlock(&g_wejscie_mutex);
+        obudz_petle();
     }
-    
-    g_tourist_id = atoi(argv[1]);
-    g_age = (argc > 2) ? atoi(argv[2]) : (18 + rand() % 50);
-    g_type = (argc > 3) ? (TouristType)atoi(argv[3]) : (TouristType)(rand() % 2);
-    g_is_vip = (argc > 4) ? (atoi(argv[4]) != 0) : false;
-    g_children_count = (argc > 5) ? atoi(argv[5]) : 0;
-    
-    // Ogranicz dzieci do max 2
-    if (g_children_count > 2) g_children_count = 2;
-    
-    // Wygeneruj wiek dzieci (4-7 lat - wymagają opieki)
-    for (int i = 0; i < g_children_count; i++) {
-        g_child_ages[i] = 4 + rand() % 4; // 4-7 lat
+
+    pthread_mutex_lock(&g_wejscie_mutex);
+    g_pobieranie_zakonczone = true;
+    pthread_mutex_unlock(&g_wejscie_mutex);
+    obudz_petle();
+    return NULL;
+}
+
+// Wątki pomocnicze nie przyjmują sygnałów - SIGTERM przerywa epoll_wait pętli
+static void uruchom_watek(pthread_t* watek, void* (*funkcja)(void*), void* arg) {
+    sigset_t maska, stara;
+    sigfillset(&maska);
+    pthread_sigmask(SIG_BLOCK, &maska, &stara);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(watek, &attr, funkcja, arg) != 0) {
+        perror("Błąd tworzenia wątku pomocniczego turysty");
+        exit(1);
     }
-    
-    // Losuj typ biletu
-    g_ticket_type = rand() % TICKET_TYPE_COUNT;
-    
-    // Połącz z zasobami IPC
-    g_msg_id = polacz_kolejke();
-    g_sem_id = polacz_semafory();
-    int shm_id = polacz_pamiec();
-    g_shm = dolacz_pamiec(shm_id);
+    pthread_attr_destroy(&attr);
 
-    // Opuść semafor aktywnych turystów (throttling) - czekaj jeśli za dużo turystów
-    // Będzie podniesiony na końcu życia turysty
-    sem_opusc(g_sem_id, SEM_ACTIVE_TOURISTS);
+    pthread_sigmask(SIG_SETMASK, &stara, NULL);
+}
 
-    // Sprawdź czy symulacja jeszcze trwa
-    sem_opusc(g_sem_id, SEM_MAIN);
-    bool is_running = g_shm->is_running;
-    bool gates_closed = g_shm->gates_closed;
-    sem_podnies(g_sem_id, SEM_MAIN);
-    
-    if (!is_running || gates_closed) {
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->total_tourists_finished += 1 + g_children_count;
-        sem_podnies(g_sem_id, SEM_STATS);
-        sem_podnies(g_sem_id, SEM_ACTIVE_TOURISTS);
-        odlacz_pamiec(g_shm);
-        return 0;
-    }
-    
-    // Uruchom wątki dzieci
-    if (g_children_count > 0) {
-        start_children_threads();
-    }
-    
-    const char* type_str = g_type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy";
-    const char* vip_str = g_is_vip ? " [VIP]" : "";
-    
-    if (g_children_count > 0) {
-        logger(LOG_TOURIST, "Turysta #%d%s przybywa (%s, %d lat, %d dzieci pod opieką)",
-               g_tourist_id, vip_str, type_str, g_age, g_children_count);
-    } else {
-        logger(LOG_TOURIST, "Turysta #%d%s przybywa (%s, %d lat)",
-               g_tourist_id, vip_str, type_str, g_age);
+// === Pętla zdarzeń ===
+
+static void obsluga_timera(TimerKola* timer, void* arg) {
+    (void)arg;
+    zdarzenie((TouristCtx*)timer->dane, EV_TIMER, NULL);
+}
+
+static void petla_init(void) {
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+    g_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    g_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_epoll == -1 || g_eventfd == -1 || g_timerfd == -1) {
+        perror("Błąd tworzenia pętli zdarzeń");
+        exit(1);
     }
-    
-    // Turyści nie korzystający z kolei 5% szans
-    if (rand() % 100 < TOURIST_NO_RIDE_PERCENT) {
-        logger(LOG_TOURIST, "Turysta #%d tylko ogląda i odchodzi", g_tourist_id);
 
-        if (g_children_count > 0) {
-            finish_children_threads();
-        }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = g_eventfd;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, g_eventfd, &ev);
+    ev.data.fd = g_timerfd;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, g_timerfd, &ev);
+
+    kolo_init(&g_kolo, zegar_teraz_ms(g_shm));
+    g_ostatni_stan = stan_odczytaj(g_shm);
+
+    // Czekanie warunkowe z terminem z termin_za_ms (CLOCK_MONOTONIC)
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_wejscie_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    for (int i = 0; i < MOST_COUNT; i++) {
+        g_mosty[i].sem_num = most_semafor[i];
+        pthread_mutex_init(&g_mosty[i].mutex, NULL);
+        pthread_cond_init(&g_mosty[i].cond, NULL);
+        uruchom_watek(&g_mosty[i].watek, watek_mostu, &g_mosty[i]);
+    }
 
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->total_tourists_finished += 1 + g_children_count;
-        sem_podnies(g_sem_id, SEM_STATS);
-        sem_podnies(g_sem_id, SEM_ACTIVE_TOURISTS);
+    pthread_t watek;
+    uruchom_watek(&watek, watek_odbioru, NULL);
+    uruchom_watek(&watek, watek_stanu, NULL);
+}
 
-        odlacz_pamiec(g_shm);
-        return 0;
+// Ustawienie timerfd na najbliższy termin koła (lub wyłączenie)
+static void uzbroj_timerfd(void) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    long long najblizszy = kolo_najblizszy(&g_kolo);
+    if (najblizszy >= 0) {
+        zegar_termin(g_shm, najblizszy, &its.it_value);
     }
-    
-    // 1. Kupno biletu
-    if (!buy_ticket()) {
-        logger(LOG_TOURIST, "Turysta #%d nie mógł kupić biletu - rezygnuje", g_tourist_id);
+    timerfd_settime(g_timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
 
-        if (g_children_count > 0) {
-            finish_children_threads();
+// Przejście po wszystkich turystach (zmiana stanu symulacji lub SIGTERM)
+static void dla_wszystkich(bool przerwanie) {
+    TouristCtx* t = g_wszyscy;
+    while (t) {
+        TouristCtx* nastepny = t->nastepny;
+        if (przerwanie) {
+            przerwij(t, NULL);
+            usun_turyste(t);
+        } else {
+            zdarzenie(t, EV_STAN, NULL);
         }
+        t = nastepny;
+    }
+}
 
-        sem_opusc(g_sem_id, SEM_STATS);
-        g_shm->total_tourists_finished += 1 + g_children_count;
-        sem_podnies(g_sem_id, SEM_STATS);
-        sem_podnies(g_sem_id, SEM_ACTIVE_TOURISTS);
+// Odpowiedzi zebrane ze skrzynek w jednym obiegu pętli
+typedef struct {
+    Komunikat* odpowiedzi;
+    int liczba;
+    int pojemnosc;
+} BuforOdpowiedzi;
+
+static void dopisz_odpowiedz(const Komunikat* msg, void* arg) {
+    BuforOdpowiedzi* bufor = (BuforOdpowiedzi*)arg;
+    bufor->odpowiedzi = zapewnij_miejsce(bufor->odpowiedzi, bufor->liczba,
+                                         &bufor->pojemnosc, sizeof(Komunikat));
+    bufor->odpowiedzi[bufor->liczba++] = *msg;
+}
 
-        odlacz_pamiec(g_shm);
-        return 0;
-    }
-    
-    int ride_count = 0;
-    
-    do {
-        // 2. Wejście na stację
-        if (!enter_station()) {
+// Pętla zdarzeń - kończy się gdy nie ma turystów i nie przyjdą nowi
+static void prowadz_petle(void) {
+    WejsciePetli wejscie;
+    memset(&wejscie, 0, sizeof(wejscie));
+    BuforOdpowiedzi bufor;
+    memset(&bufor, 0, sizeof(bufor));
+
+    while (1) {
+        if (shutdown_flag) {
+            dla_wszystkich(true);
             break;
         }
-        
-        // 3. Przejście na peron
-        if (!go_to_platform()) {
-            break;
+
+        // Odebranie wejścia od wątków pomocniczych - zamiana na opróżnione bufory
+        pthread_mutex_lock(&g_wejscie_mutex);
+        WejsciePetli odebrane = g_wejscie;
+        g_wejscie = wejscie;
+        g_wejscie.liczba_nowych = 0;
+        pthread_mutex_unlock(&g_wejscie_mutex);
+        wejscie = odebrane;
+
+        // Odpowiedzi ze skrzynek turystów procesu
+        bufor.liczba = 0;
+        skrzynki_zbierz(dopisz_odpowiedz, &bufor);
+        pthread_mutex_lock(&g_wejscie_mutex);
+        g_zebrano++;
+        pthread_cond_signal(&g_zebrano_cond);
+        pthread_mutex_unlock(&g_wejscie_mutex);
+
+        for (int i = 0; i < wejscie.liczba_nowych; i++) {
+            dodaj_turyste(&wejscie.nowi[i]);
         }
-        
-        // 4. Jazda krzesełkiem
-        if (!ride_chair()) {
-            break;
+
+        // Spóźniona odpowiedź do turysty, który już skończył, nie ma adresata
+        for (int i = 0; i < bufor.liczba; i++) {
+            TouristCtx* t = znajdz_turyste(bufor.odpowiedzi[i].tourist_id);
+            if (t) {
+                zdarzenie(t, EV_ODPOWIEDZ, &bufor.odpowiedzi[i]);
+            }
         }
-        
-        ride_count++;
-        
-        // 5. Piesi opuszczają system na górze, rowerzyści zjeżdżają trasą
-        if (g_type == TOURIST_PEDESTRIAN) {
-            exit_at_top();
-            break; // Pieszy kończy po jednym przejeździe
-        } else {
-            // Rowerzysta zjeżdża trasą
-            descend_trail();
+
+        // Przydziały semaforów - kolejno pierwszym czekającym
+        for (int i = 0; i < MOST_COUNT; i++) {
+            MostSemafora* m = &g_mosty[i];
+            pthread_mutex_lock(&m->mutex);
+            int przyznane = m->przyznane;
+            m->przyznane = 0;
+            pthread_mutex_unlock(&m->mutex);
+
+            for (int j = 0; j < przyznane; j++) {
+                TouristCtx* t = m->glowa;
+                odlacz_od_mostu(t);
+                zdarzenie(t, EV_SEMAFOR, NULL);
+            }
+        }
+
+        // Zmiana stanu symulacji
+        unsigned int seq = stan_odczytaj(g_shm);
+        if (seq != g_ostatni_stan) {
+            g_ostatni_stan = seq;
+            dla_wszystkich(false);
         }
-        
-        // Dla biletów jednorazowych - koniec
-        if (g_ticket_type == TICKET_SINGLE) {
+
+        kolo_przesun(&g_kolo, zegar_teraz_ms(g_shm), obsluga_timera, NULL);
+
+        pthread_mutex_lock(&g_wejscie_mutex);
+        bool koniec = (g_prowadzeni == 0 && g_pobieranie_zakonczone);
+        pthread_mutex_unlock(&g_wejscie_mutex);
+        if (koniec) break;
+
+        uzbroj_timerfd();
+
+        struct epoll_event zdarzenia[2];
+        int n = epoll_wait(g_epoll, zdarzenia, 2, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("Błąd epoll_wait");
             break;
         }
-        
-    } while (can_ride_again() && !shutdown_flag);
-    
-    // Zakończ wątki dzieci
-    if (g_children_count > 0) {
-        finish_children_threads();
+        for (int i = 0; i < n; i++) {
+            uint64_t licznik;
+            if (read(zdarzenia[i].data.fd, &licznik, sizeof(licznik)) == -1 && errno != EAGAIN) {
+                perror("Błąd read pętli zdarzeń");
+            }
+        }
     }
-    
-    logger(LOG_TOURIST, "Turysta #%d kończy wizytę (przejazdy: %d)", g_tourist_id, ride_count);
 
-    // Aktualizuj licznik (SEM_STATS)
-    sem_opusc(g_sem_id, SEM_STATS);
-    g_shm->total_tourists_finished += 1 + g_children_count;
-    sem_podnies(g_sem_id, SEM_STATS);
+    free(bufor.odpowiedzi);
+    free(wejscie.nowi);
+}
+
+int main(int argc, char* argv[]) {
+    // Inicjalizacja loggera dla procesu potomnego
+    logger_init_child();
+
+    // Konfiguracja sygnałów (bez SA_RESTART - SIGTERM przerywa epoll_wait)
+    struct sigaction sa;
+    sa.sa_handler = tourist_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGUSR1, SIG_IGN);
+    signal(SIGUSR2, SIG_IGN);
+
+    g_pid = getpid();
+
+    // Parsuj argumenty
+    if (argc < 2) {
+        fprintf(stderr, "Użycie: %s <tourist_id> [age] [type] [is_vip] [children_count] [ticket_type]\n", argv[0]);
+        fprintf(stderr, "        %s --host [nr]\n", argv[0]);
+        return 1;
+    }
+
+    // Połącz z zasobami IPC
+    g_sem_id = polacz_semafory();
+    int shm_id = polacz_pamiec();
+    g_shm = dolacz_pamiec(shm_id);
+    konfig_dolacz();
+    kanaly_dolacz(g_shm);
+    skrzynki_dolacz();
+    skrzynki_zarejestruj();
+
+    petla_init();
+
+    if (strcmp(argv[1], "--host") == 0) {
+        // Gospodarz: turyści z pierścienia w pamięci dzielonej
+        g_stat = statystyki_shard_turysty(g_shm, (argc > 2) ? atoi(argv[2]) : (int)g_pid);
+        pthread_t pobieranie;
+        uruchom_watek(&pobieranie, watek_pobierania, NULL);
+        logger(LOG_SYSTEM, "Gospodarz turystów PID %d gotowy", g_pid);
+    } else {
+        // Pojedynczy turysta z argumentów (brakujące - ze strumienia przybyć)
+        TouristDescriptor d;
+        przybycie_losuj(g_shm->ziarno, atoi(argv[1]), &d);
+        if (argc > 2) d.age = atoi(argv[2]);
+        if (argc > 3) d.type = (TouristType)atoi(argv[3]);
+        d.is_vip = (argc > 4) ? (atoi(argv[4]) != 0) : false;
+        d.children_count = (argc > 5) ? atoi(argv[5]) : 0;
+        if (argc > 6) d.ticket_type = atoi(argv[6]);
+        g_stat = statystyki_shard_turysty(g_shm, d.tourist_id);
+
+        g_prowadzeni = 1;
+        g_pobieranie_zakonczone = true;
+        dodaj_turyste(&d);
+    }
 
-    // Zwolnij miejsce dla następnego turysty (throttling)
-    sem_podnies(g_sem_id, SEM_ACTIVE_TOURISTS);
+    prowadz_petle();
 
+    skrzynki_wyrejestruj();
     odlacz_pamiec(g_shm);
     return 0;
 }
@@ -6,23 +6,88 @@
 #include <sys/ipc.h>
 #include <sys/sem.h>
 #include <sys/shm.h>
-#include <sys/msg.h>
 #include <unistd.h>
 #include <time.h>
 #include <signal.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "utils.h"
 #include "struktury.h"
+#include "konfig.h"
 
+#ifndef KOLEJ_SEM_FUTEX
 // Union dla semctl
 union semun {
     int val;
     struct semid_ds *buf;
     unsigned short *array;
 };
+#endif
+
+// instancja (-1 - jeszcze nie odczytana z ENV_INSTANCJA)
+static int g_instancja = -1;
+
+static int parsuj_instancje(const char* tekst) {
+    char* koniec;
+    errno = 0;
+    long nr = strtol(tekst, &koniec, 10);
+    if (errno != 0 || koniec == tekst || *koniec != '\0' || nr < 0 || nr > MAX_INSTANCJA) return -1;
+    return (int)nr;
+}
+
+int ustaw_instancje(const char* tekst) {
+    int nr = parsuj_instancje(tekst);
+    if (nr < 0) {
+        fprintf(stderr, "Instancja '%s' poza zakresem 0..%d\n", tekst, MAX_INSTANCJA);
+        return -1;
+    }
+    // Procesy potomne odczytują instancję ze środowiska
+    char bufor[16];
+    snprintf(bufor, sizeof(bufor), "%d", nr);
+    setenv(ENV_INSTANCJA, bufor, 1);
+    g_instancja = nr;
+    return 0;
+}
+
+int instancja(void) {
+    if (g_instancja < 0) {
+        const char* tekst = getenv(ENV_INSTANCJA);
+        if (tekst == NULL || *tekst == '\0') {
+            g_instancja = 0;
+        } else if (ustaw_instancje(tekst) != 0) {
+            exit(1);
+        }
+    }
+    return g_instancja;
+}
+
+// Nazwa pliku instancji: "kolej_log.txt" -> "kolej_log_N.txt" (instancja 0 - bez zmian)
+void plik_instancji(const char* nazwa, char* bufor, size_t rozmiar) {
+    int nr = instancja();
+    const char* kropka = strrchr(nazwa, '.');
+    if (nr == 0) {
+        snprintf(bufor, rozmiar, "%s", nazwa);
+    } else if (kropka == NULL) {
+        snprintf(bufor, rozmiar, "%s_%d", nazwa, nr);
+    } else {
+        snprintf(bufor, rozmiar, "%.*s_%d%s", (int)(kropka - nazwa), nazwa, nr, kropka);
+    }
+}
 
 // klucze
+// Instancja N > 0 zmienia 24 młodsze bity klucza ftok (urządzenie i i-węzeł) - XOR z
+// rozproszonym numerem, żeby kolejne instancje nie trafiały w klucze sąsiednich i-węzłów
+// (np. katalogów utworzonych jeden po drugim); bajt id (rodzaj zasobu) bez zmian
+key_t klucz_ipc(const char* sciezka, int id, int nr_instancji) {
+    key_t klucz = ftok(sciezka, id);
+    if (klucz == -1 || nr_instancji == 0) return klucz;
+    return klucz ^ (key_t)(((unsigned)nr_instancji * 2654435761u) & 0x00FFFFFFu);
+}
+
 key_t utworz_klucz(int id) {
-    key_t klucz = ftok(IPC_KEY_PATH, id);
+    key_t klucz = klucz_ipc(IPC_KEY_PATH, id, instancja());
     if (klucz == -1) {
         perror("Błąd ftok");
         exit(1);
@@ -30,7 +95,55 @@ key_t utworz_klucz(int id) {
     return klucz;
 }
 
-// funkcje semaforów
+// Wartości początkowe semaforów (wspólne dla System V i KOLEJ_SEM_FUTEX)
+// Limity z konfiguracji uruchomienia (-1 w tabeli) odczytuje sem_wartosc_poczatkowa
+typedef struct {
+    const char* nazwa;
+    int wartosc;
+} OpisSemafora;
+
+static const OpisSemafora opisy_semaforow[SEM_COUNT] = {
+    [SEM_MAIN]            = {"SEM_MAIN", 1},                        // mutex główny
+    [SEM_STATION]         = {"SEM_STATION", -1},                    // limit osób na stacji (N)
+    [SEM_PLATFORM]        = {"SEM_PLATFORM", 1},                    // mutex peronu
+    [SEM_CHAIRS]          = {"SEM_CHAIRS", -1},                     // dostępne krzesełka
+    [SEM_GATE_ENTRY]      = {"SEM_GATE_ENTRY", -1},                 // bramki wejściowe
+    [SEM_GATE_PLATFORM]   = {"SEM_GATE_PLATFORM", -1},              // bramki na peron
+    [SEM_GATE_EXIT]       = {"SEM_GATE_EXIT", -1},                  // wyjścia górna stacja
+    [SEM_EMERGENCY]       = {"SEM_EMERGENCY", 1},                   // flaga awarii (1 = normalnie, 0 = stop)
+    [SEM_WORKER_SYNC]     = {"SEM_WORKER_SYNC", 0},                 // synchronizacja pracowników
+    [SEM_LOG_FILE]        = {"SEM_LOG_FILE", 1},                    // mutex pliku logów
+    [SEM_REPORT]          = {"SEM_REPORT", 1},                      // mutex raportu
+    [SEM_CASHIER_QUEUE]   = {"SEM_CASHIER_QUEUE", -1},              // limit czekających na kasę
+    [SEM_PLATFORM_QUEUE]  = {"SEM_PLATFORM_QUEUE", -1},             // limit czekających na peron
+    [SEM_QUEUE]           = {"SEM_QUEUE", 1},                       // zarezerwowany
+    [SEM_STATS]           = {"SEM_STATS", 1},                       // zarezerwowany
+    [SEM_GATES]           = {"SEM_GATES", 1},                       // mutex rejestru przejść przez bramki
+    [SEM_TICKETS]         = {"SEM_TICKETS", 1},                     // mutex generowania ID biletów
+    [SEM_CHAIR_OPS]       = {"SEM_CHAIR_OPS", 1},                   // zarezerwowany
+    [SEM_ACTIVE_TOURISTS] = {"SEM_ACTIVE_TOURISTS", MAX_ACTIVE_TOURISTS},   // limit aktywnych turystów
+    [SEM_POOL_MUTEX]      = {"SEM_POOL_MUTEX", 1},                  // mutex pierścienia deskryptorów
+    [SEM_POOL_ITEMS]      = {"SEM_POOL_ITEMS", 0},                  // deskryptory w pierścieniu
+    [SEM_POOL_SPACE]      = {"SEM_POOL_SPACE", TOURIST_POOL_RING},  // wolne miejsca w pierścieniu
+};
+
+int sem_wartosc_poczatkowa(int sem_num, const char** nazwa) {
+    if (nazwa) *nazwa = opisy_semaforow[sem_num].nazwa;
+    const Konfiguracja* k = konfig();
+    switch (sem_num) {
+        case SEM_STATION:        return k->station_capacity;
+        case SEM_CHAIRS:         return k->max_active_chairs;
+        case SEM_GATE_ENTRY:     return k->entry_gates;
+        case SEM_GATE_PLATFORM:  return k->platform_gates;
+        case SEM_GATE_EXIT:      return k->exit_gates;
+        case SEM_CASHIER_QUEUE:  return k->cashier_queue_limit;
+        case SEM_PLATFORM_QUEUE: return k->platform_queue_limit;
+        default:                 return opisy_semaforow[sem_num].wartosc;
+    }
+}
+
+#ifndef KOLEJ_SEM_FUTEX
+// funkcje semaforów (System V) - wersja futeksowa w semafory_futex.c
 int utworz_semafory(void) {
     key_t klucz = utworz_klucz(IPC_KEY_SEM);
     int sem_id = semget(klucz, SEM_COUNT, IPC_CREAT | IPC_EXCL | 0600);
@@ -51,138 +164,13 @@ int utworz_semafory(void) {
     }
 
     union semun arg;
-
-    // SEM_MAIN - mutex główny (1)
-    arg.val = 1;
-    if (semctl(sem_id, SEM_MAIN, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_MAIN");
-        exit(1);
-    }
-
-    // SEM_STATION - limit osób na stacji (N)
-    arg.val = STATION_CAPACITY;
-    if (semctl(sem_id, SEM_STATION, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_STATION");
-        exit(1);
-    }
-
-    // SEM_PLATFORM - mutex peronu
-    arg.val = 1;
-    if (semctl(sem_id, SEM_PLATFORM, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_PLATFORM");
-        exit(1);
-    }
-
-    // SEM_CHAIRS - dostępne krzesełka
-    arg.val = MAX_ACTIVE_CHAIRS;
-    if (semctl(sem_id, SEM_CHAIRS, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_CHAIRS");
-        exit(1);
-    }
-
-    // SEM_GATE_ENTRY - bramki wejściowe
-    arg.val = ENTRY_GATES;
-    if (semctl(sem_id, SEM_GATE_ENTRY, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_GATE_ENTRY");
-        exit(1);
-    }
-
-    // SEM_GATE_PLATFORM - bramki na peron
-    arg.val = PLATFORM_GATES;
-    if (semctl(sem_id, SEM_GATE_PLATFORM, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_GATE_PLATFORM");
-        exit(1);
-    }
-
-    // SEM_GATE_EXIT - wyjścia górna stacja
-    arg.val = EXIT_GATES;
-    if (semctl(sem_id, SEM_GATE_EXIT, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_GATE_EXIT");
-        exit(1);
-    }
-
-    // SEM_EMERGENCY - flaga awarii (1 = normalnie, 0 = stop)
-    arg.val = 1;
-    if (semctl(sem_id, SEM_EMERGENCY, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_EMERGENCY");
-        exit(1);
-    }
-
-    // SEM_WORKER_SYNC - synchronizacja pracowników
-    arg.val = 0;
-    if (semctl(sem_id, SEM_WORKER_SYNC, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_WORKER_SYNC");
-        exit(1);
-    }
-
-    // SEM_LOG_FILE - mutex pliku logów
-    arg.val = 1;
-    if (semctl(sem_id, SEM_LOG_FILE, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_LOG_FILE");
-        exit(1);
-    }
-
-    // SEM_REPORT - mutex raportu
-    arg.val = 1;
-    if (semctl(sem_id, SEM_REPORT, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_REPORT");
-        exit(1);
-    }
-
-    // SEM_CASHIER_QUEUE - limit turystów czekających na kasę
-    arg.val = CASHIER_QUEUE_LIMIT;
-    if (semctl(sem_id, SEM_CASHIER_QUEUE, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_CASHIER_QUEUE");
-        exit(1);
-    }
-
-    // SEM_PLATFORM_QUEUE - limit turystów czekających na peron
-    arg.val = PLATFORM_QUEUE_LIMIT;
-    if (semctl(sem_id, SEM_PLATFORM_QUEUE, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_PLATFORM_QUEUE");
-        exit(1);
-    }
-
-    // SEM_QUEUE - mutex dla liczników kolejek
-    arg.val = 1;
-    if (semctl(sem_id, SEM_QUEUE, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_QUEUE");
-        exit(1);
-    }
-
-    // SEM_STATS - mutex dla statystyk
-    arg.val = 1;
-    if (semctl(sem_id, SEM_STATS, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_STATS");
-        exit(1);
-    }
-
-    // SEM_GATES - mutex dla rejestrowania przejść przez bramki
-    arg.val = 1;
-    if (semctl(sem_id, SEM_GATES, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_GATES");
-        exit(1);
-    }
-
-    // SEM_TICKETS - mutex dla sprzedaży biletów i generowania ID
-    arg.val = 1;
-    if (semctl(sem_id, SEM_TICKETS, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_TICKETS");
-        exit(1);
-    }
-
-    // SEM_CHAIR_OPS - mutex dla operacji krzesełek
-    arg.val = 1;
-    if (semctl(sem_id, SEM_CHAIR_OPS, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_CHAIR_OPS");
-        exit(1);
-    }
-
-    // SEM_ACTIVE_TOURISTS - limit aktywnych turystów (throttling)
-    arg.val = MAX_ACTIVE_TOURISTS;
-    if (semctl(sem_id, SEM_ACTIVE_TOURISTS, SETVAL, arg) == -1) {
-        perror("Błąd semctl SETVAL SEM_ACTIVE_TOURISTS");
-        exit(1);
+    for (int i = 0; i < SEM_COUNT; i++) {
+        const char* nazwa;
+        arg.val = sem_wartosc_poczatkowa(i, &nazwa);
+        if (semctl(sem_id, i, SETVAL, arg) == -1) {
+            fprintf(stderr, "Błąd semctl SETVAL %s: %s\n", nazwa, strerror(errno));
+            exit(1);
+        }
     }
 
     return sem_id;
@@ -305,17 +293,39 @@ int sem_opusc_timeout(int sem_id, int sem_num, int timeout_ms) {
             return 1; // Sukces - semafor opuszczony
         }
 
-        if (errno == EINTR) {
-            continue; // Przerwane przez sygnał - powtórz
-        }
-        if (errno == EAGAIN) {
-            return 0; // Timeout
+        if (errno == EAGAIN || errno == EINTR) {
+            return 0; // Timeout lub sygnał - wołający sprawdza flagi i ponawia
         }
         perror("Błąd semtimedop");
         return -1;
     }
 }
 
+// Jak sem_opusc_timeout, ale bez SEM_UNDO
+// Zwraca: 1 = sukces, 0 = timeout, -1 = błąd
+int sem_opusc_timeout_bez_undo(int sem_id, int sem_num, int timeout_ms) {
+    struct sembuf op;
+    op.sem_num = sem_num;
+    op.sem_op = -1;
+    op.sem_flg = 0;         // BEZ SEM_UNDO - licznik przekazywany między procesami
+
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    while (1) {
+        if (semtimedop(sem_id, &op, 1, &ts) == 0) {
+            return 1; // Sukces - semafor opuszczony
+        }
+
+        if (errno == EAGAIN || errno == EINTR) {
+            return 0; // Timeout lub sygnał - wołający sprawdza flagi i ponawia
+        }
+        perror("Błąd semtimedop (bez undo)");
+        return -1;
+    }
+}
+
 void sem_czekaj_na_zero(int sem_id, int sem_num) {
     struct sembuf op;
     op.sem_num = sem_num;
@@ -345,18 +355,47 @@ void sem_ustaw_wartosc(int sem_id, int sem_num, int value) {
     }
 }
 
+// Zwrot semaforów procesu zabitego sygnałem - przy System V robi to jądro (SEM_UNDO)
+void sem_odzyskaj_proces(int sem_id, pid_t pid) {
+    (void)sem_id;
+    (void)pid;
+}
+#endif // KOLEJ_SEM_FUTEX
+
 // funkcje pamięci dzielonej
+
+// Tablice karnetów za stałą częścią segmentu, rozmiary z konfiguracji uruchomienia:
+// przejazdy dla karnetów 1..TOTAL_TOURISTS (karnet na turystę), rejestr bramek
+// GATE_ENTRIES_PER_TOURIST wpisów na turystę
+static int limit_karnetow(void) {
+    return konfig()->total_tourists + 1;
+}
+
+static int limit_przejsc(void) {
+    return konfig()->total_tourists * GATE_ENTRIES_PER_TOURIST;
+}
+
+static size_t do_linii(size_t rozmiar) {
+    return (rozmiar + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+}
+
+static size_t rozmiar_pamieci(void) {
+    return do_linii(sizeof(SharedMemory)) + do_linii((size_t)limit_karnetow() * sizeof(_Atomic int)) +
+           (size_t)limit_przejsc() * sizeof(WpisBramki);
+}
+
 int utworz_pamiec(void) {
     key_t klucz = utworz_klucz(IPC_KEY_SHM);
-    int shm_id = shmget(klucz, sizeof(SharedMemory), IPC_CREAT | IPC_EXCL | 0600);
+    size_t rozmiar = rozmiar_pamieci();
+    int shm_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
     
     if (shm_id == -1) {
         if (errno == EEXIST) {
-            shm_id = shmget(klucz, sizeof(SharedMemory), 0600);
+            shm_id = shmget(klucz, 0, 0600);
             if (shm_id != -1) {
                 shmctl(shm_id, IPC_RMID, NULL);
             }
-            shm_id = shmget(klucz, sizeof(SharedMemory), IPC_CREAT | IPC_EXCL | 0600);
+            shm_id = shmget(klucz, rozmiar, IPC_CREAT | IPC_EXCL | 0600);
         }
         if (shm_id == -1) {
             perror("Błąd shmget (tworzenie)");
@@ -367,9 +406,24 @@ int utworz_pamiec(void) {
     return shm_id;
 }
 
+// Rozmiary tablic karnetów w nagłówku - main po wyzerowaniu stałej części
+void pamiec_ustaw_tablice(SharedMemory* shm) {
+    shm->max_tickets = limit_karnetow();
+    shm->max_gate_entries = limit_przejsc();
+}
+
+_Atomic int* przejazdy_karnetow(SharedMemory* shm) {
+    return (_Atomic int*)((unsigned char*)shm + do_linii(sizeof(SharedMemory)));
+}
+
+WpisBramki* przejscia_bramek(SharedMemory* shm) {
+    return (WpisBramki*)((unsigned char*)przejazdy_karnetow(shm) +
+                         do_linii((size_t)shm->max_tickets * sizeof(_Atomic int)));
+}
+
 int polacz_pamiec(void) {
     key_t klucz = utworz_klucz(IPC_KEY_SHM);
-    int shm_id = shmget(klucz, sizeof(SharedMemory), 0600);
+    int shm_id = shmget(klucz, 0, 0600);
     if (shm_id == -1) {
         perror("Błąd shmget (połączenie)");
         exit(1);
@@ -398,131 +452,349 @@ void odlacz_pamiec(SharedMemory* shm) {
     }
 }
 
-// funkcje kolejek komunikatów
-int utworz_kolejke(void) {
-    key_t klucz = utworz_klucz(IPC_KEY_MSG);
-    int msg_id = msgget(klucz, IPC_CREAT | IPC_EXCL | 0600);
-    
-    if (msg_id == -1) {
-        if (errno == EEXIST) {
-            msg_id = msgget(klucz, 0600);
-            if (msg_id != -1) {
-                msgctl(msg_id, IPC_RMID, NULL);
-            }
-            msg_id = msgget(klucz, IPC_CREAT | IPC_EXCL | 0600);
-        }
-        if (msg_id == -1) {
-            perror("Błąd msgget (tworzenie)");
-            exit(1);
-        }
+// funkcje oczekiwania blokującego (futex w pamięci dzielonej)
+
+// Termin bezwzględny (CLOCK_MONOTONIC) za ms milisekund
+void termin_za_ms(struct timespec* termin, long ms) {
+    clock_gettime(CLOCK_MONOTONIC, termin);
+    termin->tv_sec += ms / 1000;
+    termin->tv_nsec += (ms % 1000) * 1000000L;
+    if (termin->tv_nsec >= 1000000000L) {
+        termin->tv_sec++;
+        termin->tv_nsec -= 1000000000L;
     }
-    
-    return msg_id;
 }
 
-int utworz_kolejke_worker(void) {
-    key_t klucz = utworz_klucz(IPC_KEY_MSG_WORKER);
-    int msg_id = msgget(klucz, IPC_CREAT | IPC_EXCL | 0600);
-    
-    if (msg_id == -1) {
-        if (errno == EEXIST) {
-            msg_id = msgget(klucz, 0600);
-            if (msg_id != -1) {
-                msgctl(msg_id, IPC_RMID, NULL);
-            }
-            msg_id = msgget(klucz, IPC_CREAT | IPC_EXCL | 0600);
-        }
-        if (msg_id == -1) {
-            perror("Błąd msgget worker (tworzenie)");
-            exit(1);
-        }
+// Czy termin już minął
+bool termin_minal(const struct timespec* termin) {
+    struct timespec teraz;
+    clock_gettime(CLOCK_MONOTONIC, &teraz);
+    if (teraz.tv_sec != termin->tv_sec) return teraz.tv_sec > termin->tv_sec;
+    return teraz.tv_nsec >= termin->tv_nsec;
+}
+
+// Uśpienie do terminu bezwzględnego
+// Zwraca: 0 = termin osiągnięty, -1 = przerwane sygnałem
+int uspij_do(const struct timespec* termin) {
+    int ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, termin, NULL);
+    if (ret == 0) return 0;
+    if (ret != EINTR) {
+        errno = ret;
+        perror("Błąd clock_nanosleep");
     }
-    
-    return msg_id;
+    return -1;
 }
 
-int polacz_kolejke(void) {
-    key_t klucz = utworz_klucz(IPC_KEY_MSG);
-    int msg_id = msgget(klucz, 0600);
-    if (msg_id == -1) {
-        perror("Błąd msgget (połączenie)");
-        exit(1);
+unsigned int odczytaj_slowo(volatile unsigned int* slowo) {
+    return __atomic_load_n(slowo, __ATOMIC_ACQUIRE);
+}
+
+// Blokujące czekanie aż słowo przestanie mieć wartość oczekiwana
+// termin == NULL - bez limitu czasu
+// Zwraca: 1 = zmiana/wybudzenie, 0 = minął termin, -1 = przerwane sygnałem
+int czekaj_na_zmiane(volatile unsigned int* slowo, unsigned int oczekiwana, const struct timespec* termin) {
+    if (termin != NULL && termin_minal(termin)) {
+        return 0;
     }
-    return msg_id;
+
+    // FUTEX_WAIT_BITSET przyjmuje termin bezwzględny na CLOCK_MONOTONIC
+    long ret = syscall(SYS_futex, slowo, FUTEX_WAIT_BITSET, oczekiwana,
+                       termin, NULL, FUTEX_BITSET_MATCH_ANY);
+    if (ret == 0) return 1;
+    if (errno == EAGAIN) return 1;      // Wartość zmieniła się przed zaśnięciem
+    if (errno == ETIMEDOUT) return 0;
+    if (errno == EINTR) return -1;
+    perror("Błąd futex (czekanie)");
+    return -1;
 }
 
-int polacz_kolejke_worker(void) {
-    key_t klucz = utworz_klucz(IPC_KEY_MSG_WORKER);
-    int msg_id = msgget(klucz, 0600);
-    if (msg_id == -1) {
-        perror("Błąd msgget worker (połączenie)");
-        exit(1);
+// Zmiana słowa i wybudzenie wszystkich czekających (również w innych procesach)
+void powiadom_o_zmianie(volatile unsigned int* slowo) {
+    __atomic_add_fetch(slowo, 1, __ATOMIC_RELEASE);
+    if (syscall(SYS_futex, slowo, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) == -1) {
+        perror("Błąd futex (wybudzenie)");
     }
-    return msg_id;
 }
 
-void usun_kolejke(int msg_id) {
-    if (msgctl(msg_id, IPC_RMID, NULL) == -1) {
-        perror("Błąd msgctl IPC_RMID");
+// Odczyt licznika zmian stanu symulacji - wołać PRZED sprawdzeniem warunku
+unsigned int stan_odczytaj(SharedMemory* shm) {
+    return odczytaj_slowo(&shm->state_seq);
+}
+
+// Czekanie na zmianę stanu symulacji (flagi is_running, emergency_stop,
+// gates_closed, cashier_open, gotowość pracowników)
+// timeout_ms < 0 - bez limitu czasu
+// Zwraca: 1 = zmiana stanu, 0 = timeout, -1 = przerwane sygnałem
+int stan_czekaj(SharedMemory* shm, unsigned int seq, int timeout_ms) {
+    if (timeout_ms < 0) {
+        return czekaj_na_zmiane(&shm->state_seq, seq, NULL);
     }
+    struct timespec termin;
+    termin_za_ms(&termin, timeout_ms);
+    return czekaj_na_zmiane(&shm->state_seq, seq, &termin);
 }
 
-bool wyslij_komunikat(int msg_id, Message* msg) {
-    while (msgsnd(msg_id, msg, MSG_SIZE, 0) == -1) {
-        if (errno == EINTR) continue;
-        perror("Błąd msgsnd");
-        return false;
+// Czekanie na zmianę stanu symulacji do terminu bezwzględnego
+int stan_czekaj_do(SharedMemory* shm, unsigned int seq, const struct timespec* termin) {
+    return czekaj_na_zmiane(&shm->state_seq, seq, termin);
+}
+
+// Powiadomienie wszystkich procesów o zmianie stanu symulacji
+// Odbiorcy kanałów (kanaly.c) śpią na własnych dzwonkach - budzone są te śpiące
+void stan_powiadom(SharedMemory* shm) {
+    powiadom_o_zmianie(&shm->state_seq);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < ODBIORCA_COUNT; i++) {
+        if (__atomic_load_n(&shm->dzwonki[i].spi, __ATOMIC_RELAXED)) {
+            powiadom_o_zmianie(&shm->dzwonki[i].slowo);
+        }
     }
-    return true;
 }
 
-bool wyslij_komunikat_nowait(int msg_id, Message* msg) {
-    while (msgsnd(msg_id, msg, MSG_SIZE, IPC_NOWAIT) == -1) {
-        if (errno == EINTR) continue;
-        if (errno == EAGAIN) return false; // Kolejka pełna
-        perror("Błąd msgsnd nowait");
-        return false;
+// zegar symulacji (monotoniczny, ze skalą czasu)
+
+// Start zegara - wywoływane raz przez proces główny
+void zegar_start(SharedMemory* shm, long second_ns) {
+    clock_gettime(CLOCK_MONOTONIC, &shm->sim_clock_origin);
+    shm->sim_second_ns = second_ns > 0 ? second_ns : SIM_SECOND_NS;
+}
+
+// Aktualny czas symulacji w milisekundach symulacji od startu
+long long zegar_teraz_ms(SharedMemory* shm) {
+    struct timespec teraz;
+    clock_gettime(CLOCK_MONOTONIC, &teraz);
+    long long ns = (long long)(teraz.tv_sec - shm->sim_clock_origin.tv_sec) * 1000000000LL +
+                   (teraz.tv_nsec - shm->sim_clock_origin.tv_nsec);
+    return ns * 1000LL / shm->sim_second_ns;
+}
+
+// Termin bezwzględny (CLOCK_MONOTONIC) odpowiadający chwili symulacji sim_ms
+void zegar_termin(SharedMemory* shm, long long sim_ms, struct timespec* termin) {
+    long long ns = sim_ms * shm->sim_second_ns / 1000LL;
+    termin->tv_sec = shm->sim_clock_origin.tv_sec + ns / 1000000000LL;
+    termin->tv_nsec = shm->sim_clock_origin.tv_nsec + ns % 1000000000LL;
+    if (termin->tv_nsec >= 1000000000L) {
+        termin->tv_sec++;
+        termin->tv_nsec -= 1000000000L;
     }
-    return true;
 }
 
-bool odbierz_komunikat(int msg_id, Message* msg, long mtype, bool blocking) {
-    int flags = blocking ? 0 : IPC_NOWAIT;
+// Sen do chwili symulacji sim_ms
+// Zwraca: 0 = osiągnięto, -1 = przerwane sygnałem
+int zegar_uspij_do(SharedMemory* shm, long long sim_ms) {
+    struct timespec termin;
+    zegar_termin(shm, sim_ms, &termin);
+    return uspij_do(&termin);
+}
 
-    while (msgrcv(msg_id, msg, MSG_SIZE, mtype, flags) == -1) {
-        if (errno == EINTR) continue;
-        if (errno == ENOMSG && !blocking) return false;
-        if (errno == EAGAIN) return false;
-        if (errno == EIDRM) return false;
-        perror("Błąd msgrcv");
-        return false;
+// liczniki atomowe i migawka statystyk
+
+// Maksimum atomowe (CAS) - np. najdłuższe czekanie na peronie
+void licznik_max(_Atomic long long* pole, long long wartosc) {
+    long long stara = atomic_load_explicit(pole, memory_order_relaxed);
+    while (stara < wartosc &&
+           !atomic_compare_exchange_weak_explicit(pole, &stara, wartosc,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
     }
-    return true;
 }
 
-// Odbieranie komunikatu z timeoutem (symulowane przez polling + nanosleep)
-// Zwraca: true = odebrano, false = timeout lub błąd
-bool odbierz_komunikat_timeout(int msg_id, Message* msg, long mtype, int timeout_ms) {
-    struct timespec ts;
-    ts.tv_sec = 0;
-    ts.tv_nsec = 10000000L; // 10ms między próbami
+// Histogram log-liniowy (HIST_KOSZYKI): wartości < 2^HIST_BITY we własnych koszykach,
+// dalej 2^HIST_BITY koszyków na potęgę dwójki wg HIST_BITY bitów za najstarszym
+#define HIST_PODZIAL (1 << HIST_BITY)
+
+static int histogram_koszyk(long long v) {
+    if (v < HIST_PODZIAL) return v < 0 ? 0 : (int)v;
+    int e = 63 - __builtin_clzll((unsigned long long)v);
+    int idx = (e - HIST_BITY + 1) * HIST_PODZIAL + (int)((v >> (e - HIST_BITY)) & (HIST_PODZIAL - 1));
+    return idx < HIST_KOSZYKI ? idx : HIST_KOSZYKI - 1;
+}
+
+void histogram_dodaj(_Atomic int* koszyki, long long wartosc) {
+    licznik_dodaj(koszyki[histogram_koszyk(wartosc)], 1);
+}
+
+// Percentyl (0-100) z koszyków migawki - środek koszyka, 0 gdy histogram pusty
+long long histogram_percentyl(const int* koszyki, double percentyl) {
+    long long suma = 0;
+    for (int i = 0; i < HIST_KOSZYKI; i++) suma += koszyki[i];
+    if (suma == 0) return 0;
+
+    long long cel = (long long)(suma * percentyl / 100.0 + 0.5);
+    if (cel < 1) cel = 1;
+    long long narastajaco = 0;
+    for (int i = 0; i < HIST_KOSZYKI; i++) {
+        narastajaco += koszyki[i];
+        if (narastajaco < cel) continue;
+        if (i < HIST_PODZIAL) return i;
+        long long szerokosc = 1LL << (i / HIST_PODZIAL - 1);
+        return (HIST_PODZIAL + i % HIST_PODZIAL) * szerokosc + szerokosc / 2;
+    }
+    return 0;
+}
+
+// Shard statystyk procesu (STAT_SHARD_*)
+StatystykiShard* statystyki_shard(SharedMemory* shm, int nr) {
+    if (nr < 0 || nr >= STAT_SHARDS) nr = STAT_SHARD_MAIN;
+    return &shm->stat_shardy[nr];
+}
+
+// Shard turystów: nr gospodarza puli albo tourist_id pojedynczego procesu
+StatystykiShard* statystyki_shard_turysty(SharedMemory* shm, int nr) {
+    if (nr < 0) nr = -nr;
+    return &shm->stat_shardy[STAT_SHARD_TURYSCI + nr % STAT_SHARDY_TURYSTOW];
+}
+
+// Seqlock shardu dla wielu pisarzy (wątki jednego procesu, turyści o wspólnym shardzie):
+// pisarze > 0 oznacza zapis w toku, wersja rośnie po każdym zakończonym zapisie.
+// Pisarze nie czekają na siebie nawzajem (pola są atomowe), tylko czytelnik
+// migawki powtarza odczyt shardu.
+void statystyki_zapis_start(StatystykiShard* s) {
+    atomic_fetch_add_explicit(&s->pisarze, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void statystyki_zapis_koniec(StatystykiShard* s) {
+    atomic_fetch_add_explicit(&s->wersja, 1, memory_order_release);
+    atomic_fetch_sub_explicit(&s->pisarze, 1, memory_order_release);
+}
 
-    int attempts = timeout_ms / 10;
-    if (attempts < 1) attempts = 1;
+// Dodanie shardu do sumy
+static void dodaj_shard(const StatystykiShard* s, MigawkaStatystyk* m) {
+    m->total_tourists_created += licznik_odczytaj(s->total_tourists_created);
+    m->total_tourists_finished += licznik_odczytaj(s->total_tourists_finished);
+    for (int i = 0; i < TICKET_TYPE_COUNT; i++) {
+        m->tickets_sold[i] += licznik_odczytaj(s->tickets_sold[i]);
+    }
+    m->total_revenue += licznik_odczytaj(s->total_revenue);
+    m->passengers_transported += licznik_odczytaj(s->passengers_transported);
+    m->cyclists_transported += licznik_odczytaj(s->cyclists_transported);
+    m->pedestrians_transported += licznik_odczytaj(s->pedestrians_transported);
+    m->vip_served += licznik_odczytaj(s->vip_served);
+    m->children_with_guardian += licznik_odczytaj(s->children_with_guardian);
+    m->rejected_expired += licznik_odczytaj(s->rejected_expired);
+    for (int i = 0; i < TRAIL_COUNT; i++) {
+        m->trail_usage[i] += licznik_odczytaj(s->trail_usage[i]);
+    }
+    for (int i = 0; i <= CHAIR_CAPACITY; i++) {
+        m->chair_occupancy[i] += licznik_odczytaj(s->chair_occupancy[i]);
+    }
+    m->platform_boarded += licznik_odczytaj(s->platform_boarded);
+    m->platform_wait_total_ms += licznik_odczytaj(s->platform_wait_total_ms);
+    long long max_ms = licznik_odczytaj(s->platform_wait_max_ms);
+    if (max_ms > m->platform_wait_max_ms) m->platform_wait_max_ms = max_ms;
+    m->packing_skips += licznik_odczytaj(s->packing_skips);
+    for (int i = 0; i < HIST_KOSZYKI; i++) {
+        m->czas_do_wsiadania[i] += licznik_odczytaj(s->czas_do_wsiadania[i]);
+        m->czas_na_szczyt[i] += licznik_odczytaj(s->czas_na_szczyt[i]);
+    }
+}
 
-    for (int i = 0; i < attempts; i++) {
-        if (msgrcv(msg_id, msg, MSG_SIZE, mtype, IPC_NOWAIT) != -1) {
-            return true; // Sukces
+// Spójny odczyt shardu - powtarzany, gdy w trakcie trwał zapis.
+// Po wielu nieudanych próbach (ciągły ruch) przyjmowana jest ostatnia kopia.
+static void odczytaj_shard(StatystykiShard* s, MigawkaStatystyk* m) {
+    MigawkaStatystyk czesc;
+    for (int proba = 0; proba < 1000; proba++) {
+        unsigned int wersja = atomic_load_explicit(&s->wersja, memory_order_acquire);
+        if (atomic_load_explicit(&s->pisarze, memory_order_acquire) != 0) {
+            sched_yield();
+            continue;
         }
-        if (errno != ENOMSG && errno != EAGAIN && errno != EINTR) {
-            return false; // Prawdziwy błąd
+        memset(&czesc, 0, sizeof(czesc));
+        dodaj_shard(s, &czesc);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->pisarze, memory_order_relaxed) == 0 &&
+            atomic_load_explicit(&s->wersja, memory_order_relaxed) == wersja) {
+            dodaj_shard(s, m);
+            return;
         }
-        nanosleep(&ts, NULL);
     }
-    return false; // Timeout
+    dodaj_shard(s, m);
+}
+
+// Migawka liczników: obłożenie z pól globalnych, statystyki jako suma shardów
+// (każdy shard spójny - np. bilety i przychód jednej sprzedaży razem)
+void statystyki_migawka(SharedMemory* shm, MigawkaStatystyk* m) {
+    memset(m, 0, sizeof(*m));
+    m->tourists_in_station = licznik_odczytaj(shm->tourists_in_station);
+    m->tourists_on_platform = licznik_odczytaj(shm->tourists_on_platform);
+    m->tourists_at_top = licznik_odczytaj(shm->tourists_at_top);
+    m->tourists_waiting_entry = licznik_odczytaj(shm->tourists_waiting_entry);
+    m->tourists_at_cashier = licznik_odczytaj(shm->tourists_at_cashier);
+    m->tourists_descending = licznik_odczytaj(shm->tourists_descending);
+    m->active_chairs = licznik_odczytaj(shm->active_chairs);
+    m->chair_departures = licznik_odczytaj(shm->chair_departures);
+    for (int i = 0; i < STAT_SHARDS; i++) {
+        odczytaj_shard(&shm->stat_shardy[i], m);
+    }
+}
+
+// strumienie liczb losowych
+
+// Funkcja mieszająca splitmix64 - bijekcja 64 bitów o dobrej lawinowości
+static unsigned long long mieszaj64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void strumien_init(StrumienLosowy* s, unsigned long long ziarno, RodzajStrumienia rodzaj, long long id) {
+    unsigned long long podmiot = ((unsigned long long)rodzaj << 48) ^ (unsigned long long)id;
+    s->klucz = mieszaj64(ziarno ^ mieszaj64(podmiot + 0x9e3779b97f4a7c15ULL));
+    s->licznik = 0;
+}
+
+// Kolejna liczba: mieszanie (klucz + licznik * złota stała) - bez stanu poza licznikiem
+unsigned int strumien_losuj(StrumienLosowy* s) {
+    unsigned long long x = mieszaj64(s->klucz + (++s->licznik) * 0x9e3779b97f4a7c15ULL);
+    return (unsigned int)(x >> 32);
+}
+
+// Zakres przez mnożenie zamiast modulo (bez faworyzowania małych wartości)
+int strumien_zakres(StrumienLosowy* s, int n) {
+    return (int)(((unsigned long long)strumien_losuj(s) * (unsigned int)n) >> 32);
 }
 
 // funkcje pomocnicze
+// pierścień deskryptorów turystów (tryb puli)
+
+// Wstawienie deskryptora (main) - czeka maks. timeout_ms na wolne miejsce
+// Zwraca: 1 = wstawiono, 0 = brak miejsca (timeout/sygnał), -1 = błąd
+int pula_wstaw(int sem_id, SharedMemory* shm, const TouristDescriptor* d, int timeout_ms) {
+    int result = sem_opusc_timeout_bez_undo(sem_id, SEM_POOL_SPACE, timeout_ms);
+    if (result != 1) return result;
+
+    sem_opusc(sem_id, SEM_POOL_MUTEX);
+    shm->tourist_ring[shm->tourist_ring_tail] = *d;
+    shm->tourist_ring_tail = (shm->tourist_ring_tail + 1) % TOURIST_POOL_RING;
+    sem_podnies(sem_id, SEM_POOL_MUTEX);
+
+    sem_podnies_bez_undo(sem_id, SEM_POOL_ITEMS);
+    return 1;
+}
+
+// Pobranie deskryptora (gospodarz) - czeka maks. timeout_ms, 0 = bez czekania
+// Zwraca: 1 = pobrano, 0 = pierścień pusty (timeout/sygnał), -1 = błąd
+int pula_pobierz(int sem_id, SharedMemory* shm, TouristDescriptor* d, int timeout_ms) {
+    int result;
+    if (timeout_ms > 0) {
+        result = sem_opusc_timeout_bez_undo(sem_id, SEM_POOL_ITEMS, timeout_ms);
+    } else {
+        result = sem_probuj_opusc_bez_undo(sem_id, SEM_POOL_ITEMS);
+    }
+    if (result != 1) return result;
+
+    sem_opusc(sem_id, SEM_POOL_MUTEX);
+    *d = shm->tourist_ring[shm->tourist_ring_head];
+    shm->tourist_ring_head = (shm->tourist_ring_head + 1) % TOURIST_POOL_RING;
+    sem_podnies(sem_id, SEM_POOL_MUTEX);
+
+    sem_podnies_bez_undo(sem_id, SEM_POOL_SPACE);
+    return 1;
+}
+
 const char* nazwa_biletu(TicketType type) {
     switch (type) {
         case TICKET_SINGLE: return "JEDNORAZOWY";
@@ -534,6 +806,15 @@ const char* nazwa_biletu(TicketType type) {
     }
 }
 
+const char* nazwa_polityki_pakowania(PackingPolicy policy) {
+    switch (policy) {
+        case PACKING_GREEDY_FIFO: return "zachlanna FIFO";
+        case PACKING_BEST_FIT:    return "best-fit z wyprzedzeniem";
+        case PACKING_AGING:       return "best-fit ze starzeniem";
+        default:                  return "NIEZNANA";
+    }
+}
+
 const char* nazwa_trasy(TrailType trail) {
     switch (trail) {
         case TRAIL_T1: return "T1 (łatwa)";
@@ -571,35 +852,56 @@ int czas_waznosci(TicketType type) {
     }
 }
 
+// Zasoby bieżącej instancji - klucze innych instancji pozostają nietknięte
 void czysc_zasoby(void) {
     key_t klucz;
     int id;
+    int nr = instancja();
     
-    // Semafory
-    klucz = ftok(IPC_KEY_PATH, IPC_KEY_SEM);
+    // Semafory (KOLEJ_SEM_FUTEX - segment pamięci dzielonej z tablicą semaforów)
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_SEM, nr);
     if (klucz != -1) {
+#ifdef KOLEJ_SEM_FUTEX
+        id = shmget(klucz, 0, 0);
+        if (id != -1) shmctl(id, IPC_RMID, NULL);
+#else
         id = semget(klucz, 0, 0);
         if (id != -1) semctl(id, 0, IPC_RMID);
+#endif
     }
     
     // Pamięć dzielona
-    klucz = ftok(IPC_KEY_PATH, IPC_KEY_SHM);
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_SHM, nr);
     if (klucz != -1) {
         id = shmget(klucz, 0, 0);
         if (id != -1) shmctl(id, IPC_RMID, NULL);
     }
     
-    // Kolejka główna
-    klucz = ftok(IPC_KEY_PATH, IPC_KEY_MSG);
+    // Kanały komunikatów
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_CHANNELS, nr);
     if (klucz != -1) {
-        id = msgget(klucz, 0);
-        if (id != -1) msgctl(id, IPC_RMID, NULL);
+        id = shmget(klucz, 0, 0);
+        if (id != -1) shmctl(id, IPC_RMID, NULL);
     }
-    
-    // Kolejka pracowników
-    klucz = ftok(IPC_KEY_PATH, IPC_KEY_MSG_WORKER);
+
+    // Skrzynki odpowiedzi
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_MAILBOXES, nr);
     if (klucz != -1) {
-        id = msgget(klucz, 0);
-        if (id != -1) msgctl(id, IPC_RMID, NULL);
+        id = shmget(klucz, 0, 0);
+        if (id != -1) shmctl(id, IPC_RMID, NULL);
+    }
+
+    // Pierścień loggera
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_LOG, nr);
+    if (klucz != -1) {
+        id = shmget(klucz, 0, 0);
+        if (id != -1) shmctl(id, IPC_RMID, NULL);
+    }
+
+    // Konfiguracja uruchomienia
+    klucz = klucz_ipc(IPC_KEY_PATH, IPC_KEY_CONFIG, nr);
+    if (klucz != -1) {
+        id = shmget(klucz, 0, 0);
+        if (id != -1) shmctl(id, IPC_RMID, NULL);
     }
 }
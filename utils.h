@@ -4,6 +4,7 @@
 #include "struktury.h"
 #include <sys/types.h>
 #include <stdbool.h>
+#include <time.h>
 
 // funkcje semaforów
 int utworz_semafory(void);
@@ -17,9 +18,12 @@ void sem_opusc_bez_undo(int sem_id, int sem_num);
 int sem_probuj_opusc(int sem_id, int sem_num);
 int sem_probuj_opusc_bez_undo(int sem_id, int sem_num);
 int sem_opusc_timeout(int sem_id, int sem_num, int timeout_ms);
+int sem_opusc_timeout_bez_undo(int sem_id, int sem_num, int timeout_ms);
 void sem_czekaj_na_zero(int sem_id, int sem_num);
 int sem_pobierz_wartosc(int sem_id, int sem_num);
 void sem_ustaw_wartosc(int sem_id, int sem_num, int value);
+void sem_odzyskaj_proces(int sem_id, pid_t pid);
+int sem_wartosc_poczatkowa(int sem_num, const char** nazwa);
 
 // funkcje pamięci dzielonej
 int utworz_pamiec(void);
@@ -27,23 +31,59 @@ int polacz_pamiec(void);
 void usun_pamiec(int shm_id);
 SharedMemory* dolacz_pamiec(int shm_id);
 void odlacz_pamiec(SharedMemory* shm);
+// Tablice karnetów za stałą częścią segmentu (rozmiary: shm->max_tickets, shm->max_gate_entries)
+void pamiec_ustaw_tablice(SharedMemory* shm);
+_Atomic int* przejazdy_karnetow(SharedMemory* shm);
+WpisBramki* przejscia_bramek(SharedMemory* shm);
 
-// funkcje kolejek komunikatów
-int utworz_kolejke(void);
-int utworz_kolejke_worker(void);
-int polacz_kolejke(void);
-int polacz_kolejke_worker(void);
-void usun_kolejke(int msg_id);
+// funkcje oczekiwania blokującego (futex w pamięci dzielonej)
+void termin_za_ms(struct timespec* termin, long ms);
+bool termin_minal(const struct timespec* termin);
+int uspij_do(const struct timespec* termin);
+unsigned int odczytaj_slowo(volatile unsigned int* slowo);
+int czekaj_na_zmiane(volatile unsigned int* slowo, unsigned int oczekiwana, const struct timespec* termin);
+void powiadom_o_zmianie(volatile unsigned int* slowo);
+unsigned int stan_odczytaj(SharedMemory* shm);
+int stan_czekaj(SharedMemory* shm, unsigned int seq, int timeout_ms);
+int stan_czekaj_do(SharedMemory* shm, unsigned int seq, const struct timespec* termin);
+void stan_powiadom(SharedMemory* shm);
 
-bool wyslij_komunikat(int msg_id, Message* msg);
-bool wyslij_komunikat_nowait(int msg_id, Message* msg);
-bool odbierz_komunikat(int msg_id, Message* msg, long mtype, bool blocking);
-bool odbierz_komunikat_timeout(int msg_id, Message* msg, long mtype, int timeout_ms);
+// zegar symulacji (sekunda symulacji = shm->sim_second_ns ns rzeczywistych)
+void zegar_start(SharedMemory* shm, long second_ns);
+long long zegar_teraz_ms(SharedMemory* shm);
+void zegar_termin(SharedMemory* shm, long long sim_ms, struct timespec* termin);
+int zegar_uspij_do(SharedMemory* shm, long long sim_ms);
+
+// liczniki atomowe w pamięci dzielonej (obłożenie i statystyki - bez semaforów)
+#define licznik_dodaj(pole, n)  atomic_fetch_add_explicit(&(pole), (n), memory_order_relaxed)
+#define licznik_odczytaj(pole)  atomic_load_explicit(&(pole), memory_order_relaxed)
+void licznik_max(_Atomic long long* pole, long long wartosc);
+void histogram_dodaj(_Atomic int* koszyki, long long wartosc);
+long long histogram_percentyl(const int* koszyki, double percentyl);
+StatystykiShard* statystyki_shard(SharedMemory* shm, int nr);
+StatystykiShard* statystyki_shard_turysty(SharedMemory* shm, int nr);
+void statystyki_zapis_start(StatystykiShard* s);
+void statystyki_zapis_koniec(StatystykiShard* s);
+void statystyki_migawka(SharedMemory* shm, MigawkaStatystyk* m);
+
+// strumienie liczb losowych (powtarzalne przy tym samym ziarnie głównym)
+void strumien_init(StrumienLosowy* s, unsigned long long ziarno, RodzajStrumienia rodzaj, long long id);
+unsigned int strumien_losuj(StrumienLosowy* s);
+int strumien_zakres(StrumienLosowy* s, int n);     // Równomiernie 0..n-1
+
+// pierścień deskryptorów turystów (tryb puli)
+int pula_wstaw(int sem_id, SharedMemory* shm, const TouristDescriptor* d, int timeout_ms);
+int pula_pobierz(int sem_id, SharedMemory* shm, TouristDescriptor* d, int timeout_ms);
 
 // funkcje pomocnicze
 key_t utworz_klucz(int id);
+key_t klucz_ipc(const char* sciezka, int id, int nr_instancji);     // -1 przy błędzie ftok
+int instancja(void);
+int ustaw_instancje(const char* tekst);     // 0 lub -1 (spoza 0..MAX_INSTANCJA)
+void plik_instancji(const char* nazwa, char* bufor, size_t rozmiar);
 void czysc_zasoby(void);
 const char* nazwa_biletu(TicketType type);
+const char* nazwa_polityki_pakowania(PackingPolicy policy);
 const char* nazwa_trasy(TrailType trail);
 int cena_biletu(TicketType type, bool discount);
 int czas_waznosci(TicketType type);
@@ -5,11 +5,15 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
-#include <sys/msg.h>
 #include <pthread.h>
 #include "struktury.h"
 #include "utils.h"
 #include "logger.h"
+#include "zdarzenia.h"
+#include "kolo_czasowe.h"
+#include "kanaly.h"
+#include "skrzynki.h"
+#include "konfig.h"
 
 // Flagi sygnałów
 static volatile sig_atomic_t shutdown_flag = 0;
@@ -17,9 +21,9 @@ static volatile sig_atomic_t emergency_stop = 0;
 static volatile sig_atomic_t emergency_resume = 0;
 
 static int g_sem_id = -1;
-static int g_msg_id = -1;
-static int g_msg_worker_id = -1;
 static SharedMemory* g_shm = NULL;
+static StrumienLosowy g_los;           // Losowanie awarii (STRUMIEN_WORKER*)
+static StatystykiShard* g_stat = NULL;
 
 // Handler sygnałów
 void worker1_signal_handler(int sig) {
@@ -38,48 +42,132 @@ void worker1_signal_handler(int sig) {
 // Struktura grupy na krzesełko
 typedef struct {
     int tourist_ids[CHAIR_CAPACITY];
-    pid_t tourist_pids[CHAIR_CAPACITY];
+    int reply_boxes[CHAIR_CAPACITY];        // Skrzynki odpowiedzi pasażerów
     TouristType tourist_types[CHAIR_CAPACITY];
     int children_counts[CHAIR_CAPACITY];
     int count;
     int cyclists;
     int pedestrians;
+    int grupa;                              // Grupa powiadomień pasażerów (-1 - odpowiedzi do skrzynek)
 } ChairGroup;
 
 // Kolejka oczekujących na peron
 typedef struct {
-    pid_t pid;
+    int reply_box;
     int tourist_id;
     TouristType type;
     int children_count;
-    int child_ids[2];
 } PlatformWaiter;
 
+// Peron: oczekujący w pasach FIFO wg składu (typ + dzieci), węzły z puli MAX_WAITERS.
+// Dzieci liczone są jak opiekun (rowerzysta ma maks. 1 dziecko).
+typedef enum {
+    PAS_ROWERZYSTA,             // 1 rowerzysta
+    PAS_ROWERZYSTA_DZIECKO,     // rowerzysta + dziecko (2 rowerzystów)
+    PAS_PIESZY,                 // 1 pieszy
+    PAS_PIESZY_DZIECKO,         // pieszy + dziecko (2 pieszych)
+    PAS_PIESZY_DWOJE_DZIECI,    // pieszy + 2 dzieci (3 pieszych)
+    PAS_COUNT
+} PasPeronu;
+
+static const int pas_rowerzystow[PAS_COUNT] = {1, 2, 0, 0, 0};
+static const int pas_pieszych[PAS_COUNT]    = {0, 0, 1, 2, 3};
+
+typedef struct {
+    PlatformWaiter w;
+    unsigned long kolejnosc;    // Numer przybycia - sprawiedliwość między pasami
+    long long przybycie_ms;     // Czas wejścia na peron (ms symulacji)
+    int pominiecia;             // Ile odjazdów zabrało później przybyłych
+    int nastepny;               // Następny węzeł w pasie / na liście wolnych (-1 koniec)
+} WezelPeronu;
+
 #define MAX_WAITERS 15000
-static PlatformWaiter waiters[MAX_WAITERS];
+static WezelPeronu waiter_pool[MAX_WAITERS];
+static int waiter_free = -1;
+static int lane_head[PAS_COUNT];
+static int lane_tail[PAS_COUNT];
 static int waiter_count = 0;
+static unsigned long waiter_seq = 0;
 static pthread_mutex_t waiter_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Licznik bramek na peron
 static int g_platform_gate_counter = 0;
 static pthread_mutex_t g_platform_gate_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Pobierz następny numer bramki na peron (1-3)
+// Pobierz następny numer bramki na peron (1..PLATFORM_GATES)
 int get_next_platform_gate(void) {
     pthread_mutex_lock(&g_platform_gate_mutex);
-    int gate = (g_platform_gate_counter % PLATFORM_GATES) + 1;
+    int gate = (g_platform_gate_counter % konfig()->platform_gates) + 1;
     g_platform_gate_counter++;
     pthread_mutex_unlock(&g_platform_gate_mutex);
     return gate;
 }
 
+// Odpowiedź peronu bez ładunku: MSG_PLATFORM_TO_TOURIST (wsiadaj) lub MSG_PLATFORM_REFUSED
+static void odpowiedz_peronu(int reply_box, int tourist_id, unsigned char typ) {
+    Komunikat msg;
+    msg.typ = typ;
+    msg.reply_box = reply_box;
+    msg.tourist_id = tourist_id;
+    skrzynka_wyslij(reply_box, &msg);
+}
+
+// Pusty peron - wszystkie węzły na liście wolnych (wołane pod waiter_mutex lub przed wątkami)
+static void reset_waiters(void) {
+    for (int i = 0; i < MAX_WAITERS; i++) {
+        waiter_pool[i].nastepny = (i + 1 < MAX_WAITERS) ? i + 1 : -1;
+    }
+    waiter_free = 0;
+    for (int p = 0; p < PAS_COUNT; p++) {
+        lane_head[p] = -1;
+        lane_tail[p] = -1;
+    }
+    waiter_count = 0;
+}
+
+static PasPeronu waiter_lane(const PlatformWaiter* w) {
+    if (w->type == TOURIST_CYCLIST) {
+        return w->children_count > 0 ? PAS_ROWERZYSTA_DZIECKO : PAS_ROWERZYSTA;
+    }
+    if (w->children_count >= 2) return PAS_PIESZY_DWOJE_DZIECI;
+    return w->children_count == 1 ? PAS_PIESZY_DZIECKO : PAS_PIESZY;
+}
+
+// Zdjęcie pierwszego oczekującego z pasa (pod waiter_mutex)
+static void pop_lane(PasPeronu pas, PlatformWaiter* w) {
+    int idx = lane_head[pas];
+    *w = waiter_pool[idx].w;
+    lane_head[pas] = waiter_pool[idx].nastepny;
+    if (lane_head[pas] < 0) {
+        lane_tail[pas] = -1;
+    }
+    waiter_pool[idx].nastepny = waiter_free;
+    waiter_free = idx;
+    waiter_count--;
+}
+
 //  Dodaj oczekującego 
 //  true - dodano 
 //  false - kolejka pełna
 bool add_waiter(PlatformWaiter* w) {
     pthread_mutex_lock(&waiter_mutex);
-    if (waiter_count < MAX_WAITERS) {
-        waiters[waiter_count++] = *w;
+    if (waiter_free >= 0) {
+        int idx = waiter_free;
+        waiter_free = waiter_pool[idx].nastepny;
+        waiter_pool[idx].w = *w;
+        waiter_pool[idx].kolejnosc = waiter_seq++;
+        waiter_pool[idx].przybycie_ms = zegar_teraz_ms(g_shm);
+        waiter_pool[idx].pominiecia = 0;
+        waiter_pool[idx].nastepny = -1;
+
+        PasPeronu pas = waiter_lane(w);
+        if (lane_tail[pas] >= 0) {
+            waiter_pool[lane_tail[pas]].nastepny = idx;
+        } else {
+            lane_head[pas] = idx;
+        }
+        lane_tail[pas] = idx;
+        waiter_count++;
         pthread_mutex_unlock(&waiter_mutex);
         return true;
     }
@@ -99,7 +187,219 @@ bool is_valid_combination(int cyclists, int pedestrians) {
     return true;
 }
 
-// Spróbuj utworzyć grupę na krzesełko
+// === Polityki pakowania krzesełek (PACKING_POLICY) ===
+// Polityka wybiera pasy, z których kolejno zdejmowani są pierwsi oczekujący
+// (wołana pod waiter_mutex, peron niepusty). Wynik zbiera czas czekania i numer
+// najpóźniej przybyłego pasażera - z niego liczone są wyprzedzenia.
+typedef struct {
+    long long teraz_ms;
+    long long czekanie_suma_ms;
+    long long czekanie_max_ms;
+    unsigned long max_kolejnosc;
+} WynikPakowania;
+
+typedef void (*PolitykaPakowania)(ChairGroup* group, WynikPakowania* wynik);
+
+// Dozwolony skład krzesełka - liczba oczekujących z każdego pasa
+typedef struct {
+    int z_pasa[PAS_COUNT];
+    int osoby;
+} SkladKrzeselka;
+
+#define MAX_SKLADOW 64
+static SkladKrzeselka sklady[MAX_SKLADOW];
+static int sklady_count = 0;
+
+// Zdjęcie pierwszego z pasa do grupy (dzieci liczone jak opiekun)
+static void wsadz_z_pasa(ChairGroup* group, PasPeronu pas, WynikPakowania* wynik) {
+    WezelPeronu* wezel = &waiter_pool[lane_head[pas]];
+    long long czekanie = wynik->teraz_ms - wezel->przybycie_ms;
+    if (czekanie < 0) czekanie = 0;
+    wynik->czekanie_suma_ms += czekanie;
+    if (czekanie > wynik->czekanie_max_ms) wynik->czekanie_max_ms = czekanie;
+    if (group->count == 0 || wezel->kolejnosc > wynik->max_kolejnosc) {
+        wynik->max_kolejnosc = wezel->kolejnosc;
+    }
+
+    PlatformWaiter w;
+    pop_lane(pas, &w);
+
+    group->tourist_ids[group->count] = w.tourist_id;
+    group->reply_boxes[group->count] = w.reply_box;
+    group->tourist_types[group->count] = w.type;
+    group->children_counts[group->count] = w.children_count;
+    group->count++;
+    group->cyclists += pas_rowerzystow[pas];
+    group->pedestrians += pas_pieszych[pas];
+}
+
+// Wszystkie dozwolone składy (wg is_valid_combination) - raz przy starcie
+static void init_sklady(void) {
+    int n[PAS_COUNT];
+    sklady_count = 0;
+    for (n[0] = 0; n[0] <= CHAIR_CAPACITY; n[0]++)
+    for (n[1] = 0; n[1] <= CHAIR_CAPACITY; n[1]++)
+    for (n[2] = 0; n[2] <= CHAIR_CAPACITY; n[2]++)
+    for (n[3] = 0; n[3] <= CHAIR_CAPACITY; n[3]++)
+    for (n[4] = 0; n[4] <= CHAIR_CAPACITY; n[4]++) {
+        int dorosli = 0, rowerzysci = 0, piesi = 0;
+        for (int p = 0; p < PAS_COUNT; p++) {
+            dorosli += n[p];
+            rowerzysci += n[p] * pas_rowerzystow[p];
+            piesi += n[p] * pas_pieszych[p];
+        }
+        if (dorosli == 0 || dorosli > CHAIR_CAPACITY) continue;
+        if (!is_valid_combination(rowerzysci, piesi)) continue;
+        if (sklady_count == MAX_SKLADOW) break;
+        memcpy(sklady[sklady_count].z_pasa, n, sizeof(n));
+        sklady[sklady_count].osoby = rowerzysci + piesi;
+        sklady_count++;
+    }
+}
+
+// Zachłanna FIFO: kolejno najwcześniej przybyły spośród pierwszych w pasach, który
+// jeszcze się mieści - ten sam wybór co przegląd całego peronu w kolejności przybycia
+// (dozwolone składy tylko się zawężają), w maks. CHAIR_CAPACITY x PAS_COUNT krokach
+static void pakuj_zachlannie(ChairGroup* group, WynikPakowania* wynik) {
+    while (group->count < CHAIR_CAPACITY) {
+        int wybrany = -1;
+        for (int p = 0; p < PAS_COUNT; p++) {
+            int idx = lane_head[p];
+            if (idx < 0) continue;
+            if (!is_valid_combination(group->cyclists + pas_rowerzystow[p],
+                                      group->pedestrians + pas_pieszych[p])) {
+                continue;
+            }
+            if (wybrany < 0 || waiter_pool[idx].kolejnosc < waiter_pool[lane_head[wybrany]].kolejnosc) {
+                wybrany = p;
+            }
+        }
+        if (wybrany < 0) break;
+        wsadz_z_pasa(group, (PasPeronu)wybrany, wynik);
+    }
+}
+
+// Numer przybycia najdłużej czekającego na peronie (peron niepusty)
+static unsigned long najstarszy_na_peronie(void) {
+    unsigned long najstarszy = 0;
+    bool jest = false;
+    for (int p = 0; p < PAS_COUNT; p++) {
+        int idx = lane_head[p];
+        if (idx >= 0 && (!jest || waiter_pool[idx].kolejnosc < najstarszy)) {
+            najstarszy = waiter_pool[idx].kolejnosc;
+            jest = true;
+        }
+    }
+    return najstarszy;
+}
+
+// Best-fit: spośród PACKING_LOOKAHEAD kolejnych przybyłych (licząc od najstarszego)
+// skład o największej liczbie osób, remis - mniejsza suma numerów przybycia.
+// Ze starzeniem: pierwsi w pasach pominięci PACKING_MAX_SKIPS razy muszą wsiąść -
+// najstarszy z nich zawsze, pozostali w miarę możliwości.
+static void pakuj_dopasowanie(ChairGroup* group, WynikPakowania* wynik, bool starzenie) {
+    unsigned long okno = najstarszy_na_peronie() + PACKING_LOOKAHEAD;
+    int dostepni[PAS_COUNT];
+    unsigned long suma_kolejnosci[PAS_COUNT][CHAIR_CAPACITY + 1];
+    bool wymuszony[PAS_COUNT];
+    int najstarszy_wymuszony = -1;
+
+    for (int p = 0; p < PAS_COUNT; p++) {
+        dostepni[p] = 0;
+        suma_kolejnosci[p][0] = 0;
+        for (int idx = lane_head[p];
+             idx >= 0 && dostepni[p] < CHAIR_CAPACITY && waiter_pool[idx].kolejnosc < okno;
+             idx = waiter_pool[idx].nastepny) {
+            suma_kolejnosci[p][dostepni[p] + 1] = suma_kolejnosci[p][dostepni[p]] + waiter_pool[idx].kolejnosc;
+            dostepni[p]++;
+        }
+
+        int glowa = lane_head[p];
+        wymuszony[p] = starzenie && dostepni[p] > 0 &&
+                       waiter_pool[glowa].pominiecia >= PACKING_MAX_SKIPS;
+        if (wymuszony[p] && (najstarszy_wymuszony < 0 ||
+            waiter_pool[glowa].kolejnosc < waiter_pool[lane_head[najstarszy_wymuszony]].kolejnosc)) {
+            najstarszy_wymuszony = p;
+        }
+    }
+
+    int najlepszy = -1;
+    int najlepszy_wymuszeni = 0;
+    unsigned long najlepsza_suma = 0;
+    for (int s = 0; s < sklady_count; s++) {
+        const SkladKrzeselka* sklad = &sklady[s];
+        int wymuszeni = 0;
+        unsigned long suma = 0;
+        bool mozliwy = true;
+        for (int p = 0; p < PAS_COUNT; p++) {
+            if (sklad->z_pasa[p] > dostepni[p]) {
+                mozliwy = false;
+                break;
+            }
+            if (wymuszony[p] && sklad->z_pasa[p] > 0) wymuszeni++;
+            suma += suma_kolejnosci[p][sklad->z_pasa[p]];
+        }
+        if (!mozliwy) continue;
+        if (najstarszy_wymuszony >= 0 && sklad->z_pasa[najstarszy_wymuszony] == 0) continue;
+
+        if (najlepszy >= 0) {
+            const SkladKrzeselka* obecny = &sklady[najlepszy];
+            if (wymuszeni != najlepszy_wymuszeni) {
+                if (wymuszeni < najlepszy_wymuszeni) continue;
+            } else if (sklad->osoby != obecny->osoby) {
+                if (sklad->osoby < obecny->osoby) continue;
+            } else if (suma >= najlepsza_suma) {
+                continue;
+            }
+        }
+        najlepszy = s;
+        najlepszy_wymuszeni = wymuszeni;
+        najlepsza_suma = suma;
+    }
+
+    if (najlepszy < 0) {
+        // Nie powinno wystąpić (najstarszy zawsze mieści się sam) - awaryjnie FIFO
+        pakuj_zachlannie(group, wynik);
+        return;
+    }
+    for (int p = 0; p < PAS_COUNT; p++) {
+        for (int k = 0; k < sklady[najlepszy].z_pasa[p]; k++) {
+            wsadz_z_pasa(group, (PasPeronu)p, wynik);
+        }
+    }
+}
+
+static void pakuj_best_fit(ChairGroup* group, WynikPakowania* wynik) {
+    pakuj_dopasowanie(group, wynik, false);
+}
+
+static void pakuj_ze_starzeniem(ChairGroup* group, WynikPakowania* wynik) {
+    pakuj_dopasowanie(group, wynik, true);
+}
+
+static const PolitykaPakowania polityki_pakowania[PACKING_POLICY_COUNT] = {
+    [PACKING_GREEDY_FIFO] = pakuj_zachlannie,
+    [PACKING_BEST_FIT]    = pakuj_best_fit,
+    [PACKING_AGING]       = pakuj_ze_starzeniem,
+};
+
+// Oczekujący w oknie przybyli przed ostatnim pasażerem odjazdu zostali wyprzedzeni
+static int zlicz_pominiecia(unsigned long max_kolejnosc) {
+    if (waiter_count == 0) return 0;
+    unsigned long okno = najstarszy_na_peronie() + PACKING_LOOKAHEAD;
+    int pominieci = 0;
+    for (int p = 0; p < PAS_COUNT; p++) {
+        for (int idx = lane_head[p];
+             idx >= 0 && waiter_pool[idx].kolejnosc < max_kolejnosc && waiter_pool[idx].kolejnosc < okno;
+             idx = waiter_pool[idx].nastepny) {
+            waiter_pool[idx].pominiecia++;
+            pominieci++;
+        }
+    }
+    return pominieci;
+}
+
+// Spróbuj utworzyć grupę na krzesełko wg PACKING_POLICY
 bool try_create_group(ChairGroup* group) {
     pthread_mutex_lock(&waiter_mutex);
     
@@ -109,72 +409,91 @@ bool try_create_group(ChairGroup* group) {
     }
     
     memset(group, 0, sizeof(ChairGroup));
-    
-    // Próba zabrania grupy (Max 4 osoby)
-    int indices_to_remove[CHAIR_CAPACITY];
-    int remove_count = 0;
-    
-    for (int i = 0; i < waiter_count && group->count < CHAIR_CAPACITY; i++) {
-        PlatformWaiter* w = &waiters[i];
-        
-        int new_cyclists = group->cyclists + (w->type == TOURIST_CYCLIST ? 1 : 0);
-        int new_pedestrians = group->pedestrians + (w->type == TOURIST_PEDESTRIAN ? 1 : 0);
-        
-        // Dodaj dzieci jako pieszych
-        if (w->type == TOURIST_CYCLIST) {
-            new_cyclists += w->children_count;
-        } else {
-            new_pedestrians += w->children_count;
-        }
+    WynikPakowania wynik = {0};
+    wynik.teraz_ms = zegar_teraz_ms(g_shm);
 
-        
-        if (is_valid_combination(new_cyclists, new_pedestrians)) {
-            // Dodaj do grupy
-            group->tourist_ids[group->count] = w->tourist_id;
-            group->tourist_pids[group->count] = w->pid;
-            group->tourist_types[group->count] = w->type;
-            group->children_counts[group->count] = w->children_count;
-            group->count++;
-            
-            if (w->type == TOURIST_CYCLIST) {
-                group->cyclists++;
-            } else {
-                group->pedestrians++;
-            }
-            
-            // Dodaj dzieci
-            if (w->type == TOURIST_CYCLIST) {
-                // Dzieci rowerzysty też są rowerzystami
-                group->cyclists += w->children_count;
-            } else {
-                // Dzieci pieszego też są pieszymi
-                group->pedestrians += w->children_count;
-            }
-            
-            indices_to_remove[remove_count++] = i;
-        }
-    }
-    
-    // Usuń dodanych z kolejki (od końca)
-    for (int i = remove_count - 1; i >= 0; i--) {
-        int idx = indices_to_remove[i];
-        for (int j = idx; j < waiter_count - 1; j++) {
-            waiters[j] = waiters[j + 1];
-        }
-        waiter_count--;
-    }
+    polityki_pakowania[PACKING_POLICY](group, &wynik);
+    int pominieci = zlicz_pominiecia(wynik.max_kolejnosc);
     
     pthread_mutex_unlock(&waiter_mutex);
+
+    if (group->count > 0) {
+        statystyki_zapis_start(g_stat);
+        licznik_dodaj(g_stat->platform_boarded, group->count);
+        licznik_dodaj(g_stat->platform_wait_total_ms, wynik.czekanie_suma_ms);
+        licznik_max(&g_stat->platform_wait_max_ms, wynik.czekanie_max_ms);
+        licznik_dodaj(g_stat->packing_skips, pominieci);
+        statystyki_zapis_koniec(g_stat);
+    }
     
     return (group->count > 0);
 }
 
-// Wątek obsługi krzesełka
-void* chair_thread(void* arg) {
-    ChairGroup* group = (ChairGroup*)arg;
-    
-    int travel_time = CHAIR_TRAVEL_TIME;
-    int time_traveled = 0;
+// === Linia krzesełek ===
+// Krzesełka w ruchu to sloty liny (MAX_ACTIVE_CHAIRS z konfiguracji, przydzielone raz przy
+// starcie liny) z grupami - SEM_CHAIRS
+// gwarantuje wolny slot przy odjeździe. Przyjazdy planuje koło czasowe w czasie liny
+// (czas symulacji minus postoje awaryjne), obsługiwane przez jeden wątek liny.
+typedef struct {
+    ChairGroup grupa;
+    TimerKola przyjazd;         // Termin przyjazdu na górę (czas liny)
+    int chair_id;
+    long long odjazd_ms;        // Chwila odjazdu (czas liny)
+    int nastepny_wolny;         // Lista wolnych slotów (-1 koniec)
+} SlotLiny;
+
+static SlotLiny* lina_sloty = NULL;
+static int lina_liczba = 0;
+static int lina_wolne = -1;
+static KoloCzasowe lina_kolo;
+static long long lina_postoje_ms = 0;       // Suma postojów awaryjnych (ms symulacji)
+static pthread_mutex_t lina_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile unsigned int lina_dzwonek = 0;  // Budzi wątek liny czekający przy pustym kole
+static volatile bool lina_koniec = false;
+static pthread_t lina_watek;
+
+static void lina_init(void) {
+    lina_liczba = konfig()->max_active_chairs;
+    lina_sloty = calloc(lina_liczba, sizeof(SlotLiny));
+    if (lina_sloty == NULL) {
+        perror("Błąd calloc (sloty liny)");
+        exit(1);
+    }
+    for (int i = 0; i < lina_liczba; i++) {
+        timer_init(&lina_sloty[i].przyjazd, &lina_sloty[i]);
+        lina_sloty[i].nastepny_wolny = (i + 1 < lina_liczba) ? i + 1 : -1;
+    }
+    lina_wolne = 0;
+    lina_postoje_ms = 0;
+    kolo_init(&lina_kolo, 0);
+}
+
+// Czas liny - stoi podczas awarii (pod lina_mutex)
+static long long lina_teraz(void) {
+    return zegar_teraz_ms(g_shm) - lina_postoje_ms;
+}
+
+static SlotLiny* lina_zajmij_slot(void) {
+    pthread_mutex_lock(&lina_mutex);
+    SlotLiny* slot = NULL;
+    if (lina_wolne >= 0) {
+        slot = &lina_sloty[lina_wolne];
+        lina_wolne = slot->nastepny_wolny;
+    }
+    pthread_mutex_unlock(&lina_mutex);
+    return slot;
+}
+
+static void lina_zwolnij_slot(SlotLiny* slot) {
+    pthread_mutex_lock(&lina_mutex);
+    slot->nastepny_wolny = lina_wolne;
+    lina_wolne = (int)(slot - lina_sloty);
+    pthread_mutex_unlock(&lina_mutex);
+}
+
+// Odjazd krzesełka ze stacji dolnej - statystyki, log i termin przyjazdu na kole
+static void krzeselko_odjezdza(SlotLiny* slot) {
+    ChairGroup* group = &slot->grupa;
 
     // Obliczanie liczby pasażerów z dziećmi
     int total_children = 0;
@@ -183,19 +502,19 @@ void* chair_thread(void* arg) {
     }
     int total_passengers = group->count + total_children;
 
-    // Aktualizuj statystyki transportu (SEM_STATS)
-    sem_opusc(g_sem_id, SEM_STATS);
-    g_shm->passengers_transported += total_passengers;
-    g_shm->cyclists_transported += group->cyclists;
-    g_shm->pedestrians_transported += group->pedestrians;
-    sem_podnies(g_sem_id, SEM_STATS);
+    // Aktualizuj statystyki transportu (shard worker1, jedna sekcja migawki)
+    statystyki_zapis_start(g_stat);
+    licznik_dodaj(g_stat->passengers_transported, total_passengers);
+    licznik_dodaj(g_stat->cyclists_transported, group->cyclists);
+    licznik_dodaj(g_stat->pedestrians_transported, group->pedestrians);
+    if (total_passengers <= CHAIR_CAPACITY) {
+        licznik_dodaj(g_stat->chair_occupancy[total_passengers], 1);
+    }
+    statystyki_zapis_koniec(g_stat);
 
-    // Aktualizuj operacje krzesełek (SEM_CHAIR_OPS)
-    sem_opusc(g_sem_id, SEM_CHAIR_OPS);
-    g_shm->chair_departures++;
-    g_shm->active_chairs++;
-    int chair_id = g_shm->chair_departures;
-    sem_podnies(g_sem_id, SEM_CHAIR_OPS);
+    // Liczniki krzesełek (wspólne - numer krzesełka z licznika odjazdów)
+    slot->chair_id = licznik_dodaj(g_shm->chair_departures, 1) + 1;
+    licznik_dodaj(g_shm->active_chairs, 1);
     
     // Log odjazdu
     char passengers_str[256] = "";
@@ -217,70 +536,188 @@ void* chair_thread(void* arg) {
     }
     
     logger(LOG_CHAIR, "Krzesełko #%d odjeżdża z pasażerami: [%s] (R:%d, P:%d)",
-           chair_id, passengers_str, group->cyclists, group->pedestrians);
+           slot->chair_id, passengers_str, group->cyclists, group->pedestrians);
+    zapisz_zdarzenie(ZD_KRZESELKO_ODJAZD, total_passengers, slot->chair_id, 0,
+              group->cyclists, group->pedestrians);
+
+    // Wszystkie krzesełka jadą tyle samo - nowy termin nigdy nie jest bliższy niż
+    // już zaplanowane, więc wątek liny trzeba budzić tylko przy pustym kole
+    pthread_mutex_lock(&lina_mutex);
+    long long teraz = lina_teraz();
+    bool bylo_puste = (lina_kolo.liczba == 0);
+    if (bylo_puste) {
+        kolo_przesun(&lina_kolo, teraz, NULL, NULL);   // Przeskok pustego koła
+    }
+    slot->odjazd_ms = teraz;
+    kolo_dodaj(&lina_kolo, &slot->przyjazd, teraz + CHAIR_TRAVEL_TIME * 1000LL);
+    pthread_mutex_unlock(&lina_mutex);
+
+    if (bylo_puste) {
+        powiadom_o_zmianie(&lina_dzwonek);
+    }
+}
+
+// Przyjazd na górę - komunikat do worker2 (KANAL_PRZYJAZDY) i zwolnienie slotu
+static void krzeselko_przyjezdza(SlotLiny* slot) {
+    ChairGroup* group = &slot->grupa;
+
+    Komunikat msg;
+    msg.typ = MSG_CHAIR_ARRIVAL;
+    msg.tourist_id = -1;
+    msg.reply_box = -1;
+    msg.u.przyjazd.chair_id = slot->chair_id;
+    msg.u.przyjazd.grupa = group->grupa;
+    msg.u.przyjazd.count = (unsigned char)group->count;
+    
+    // kopiowanie danych pasażerów do wiadomości
+    for (int i = 0; i < group->count; i++) {
+        msg.u.przyjazd.pasazerowie[i].tourist_id = group->tourist_ids[i];
+        msg.u.przyjazd.pasazerowie[i].reply_box = group->reply_boxes[i];
+    }
+    
+    kanal_wyslij(KANAL_PRZYJAZDY, &msg, -1);
     
-    while (time_traveled < travel_time && !shutdown_flag) {
-        // Sprawdzenie awarii na początku sekundy (bez busy loop!)
-        bool emergency = g_shm->emergency_stop;
+    // Aktualizacja statystyk krzesełek
+    licznik_dodaj(g_shm->active_chairs, -1);
+    
+    lina_zwolnij_slot(slot);
 
-        if (emergency) {
-            // Zatrzymanie krzesełka
-            logger(LOG_CHAIR, "Krzesełko #%d ZATRZYMANE w trakcie jazdy! (przejechane: %d/%d s)",
-                   chair_id, time_traveled, travel_time);
+    // Zwolnienie semafora krzesełka - śpiący wątek główny może od razu wysłać następne
+    sem_podnies_bez_undo(g_sem_id, SEM_CHAIRS);
+    kanaly_zadzwon(ODBIORCA_WORKER1);
+}
 
-            // Czekanie na koniec awarii - aktywne czekanie
-            while (g_shm->emergency_stop && !shutdown_flag) {
-            }
+typedef struct {
+    SlotLiny** sloty;           // lina_liczba wskaźników
+    int liczba;
+} ListaPrzyjazdow;
 
-            if (!shutdown_flag) {
-                logger(LOG_CHAIR, "Krzesełko #%d WZNAWIA jazdę (pozostało: %d s)",
-                       chair_id, travel_time - time_traveled);
-            }
-        } else {
-            // Normalny ruch - aktywne czekanie
-            for (int i = 0; i < 10 && !shutdown_flag; i++) {
-                if (g_shm->emergency_stop) {
-                    break; // Przerwij i wróć do sprawdzenia awarii
+static void zbierz_przyjazd(TimerKola* timer, void* arg) {
+    ListaPrzyjazdow* lista = (ListaPrzyjazdow*)arg;
+    lista->sloty[lista->liczba++] = (SlotLiny*)timer->dane;
+}
+
+// Awaria - lina stoi, czas liny nie płynie aż do wznowienia
+static void lina_postoj(unsigned int seq) {
+    long long start = zegar_teraz_ms(g_shm);
+
+    pthread_mutex_lock(&lina_mutex);
+    for (int i = 0; i < lina_liczba; i++) {
+        SlotLiny* slot = &lina_sloty[i];
+        if (!timer_aktywny(&slot->przyjazd)) continue;
+        long long przejechane = (start - lina_postoje_ms - slot->odjazd_ms) / 1000;
+        if (przejechane > CHAIR_TRAVEL_TIME) przejechane = CHAIR_TRAVEL_TIME;
+        logger(LOG_CHAIR, "Krzesełko #%d ZATRZYMANE w trakcie jazdy! (przejechane: %lld/%d s)",
+               slot->chair_id, przejechane, CHAIR_TRAVEL_TIME);
+    }
+    pthread_mutex_unlock(&lina_mutex);
+
+    // Czekanie na koniec awarii - blokujące (budzi zmiana stanu)
+    while (g_shm->emergency_stop && g_shm->is_running && !shutdown_flag && !lina_koniec) {
+        stan_czekaj(g_shm, seq, SEM_WAIT_MS);
+        seq = stan_odczytaj(g_shm);
+    }
+
+    pthread_mutex_lock(&lina_mutex);
+    lina_postoje_ms += zegar_teraz_ms(g_shm) - start;
+    if (!shutdown_flag) {
+        long long teraz = lina_teraz();
+        for (int i = 0; i < lina_liczba; i++) {
+            SlotLiny* slot = &lina_sloty[i];
+            if (!timer_aktywny(&slot->przyjazd)) continue;
+            long long pozostalo = (slot->przyjazd.termin - teraz + 999) / 1000;
+            if (pozostalo < 0) pozostalo = 0;
+            logger(LOG_CHAIR, "Krzesełko #%d WZNAWIA jazdę (pozostało: %lld s)",
+                   slot->chair_id, pozostalo);
+        }
+    }
+    pthread_mutex_unlock(&lina_mutex);
+}
+
+// Wątek liny - przesuwa koło i obsługuje przyjazdy. Przy zamknięciu (koniec pracy,
+// shutdown) krzesełka w drodze dojeżdżają natychmiast, jak dawniej wątki krzesełek.
+void* watek_liny(void* arg) {
+    (void)arg;
+    ListaPrzyjazdow przyjazdy;
+    przyjazdy.sloty = calloc(lina_liczba, sizeof(SlotLiny*));
+    if (przyjazdy.sloty == NULL) {
+        perror("Błąd calloc (przyjazdy liny)");
+        exit(1);
+    }
+
+    while (true) {
+        unsigned int dzwonek = odczytaj_slowo(&lina_dzwonek);
+        unsigned int seq = stan_odczytaj(g_shm);
+        bool zamkniecie = lina_koniec || shutdown_flag || !g_shm->is_running;
+
+        pthread_mutex_lock(&lina_mutex);
+        if (!zamkniecie && g_shm->emergency_stop && lina_kolo.liczba > 0) {
+            pthread_mutex_unlock(&lina_mutex);
+            lina_postoj(seq);
+            continue;
+        }
+
+        przyjazdy.liczba = 0;
+        if (zamkniecie) {
+            for (int i = 0; i < lina_liczba; i++) {
+                if (timer_aktywny(&lina_sloty[i].przyjazd)) {
+                    kolo_usun(&lina_kolo, &lina_sloty[i].przyjazd);
+                    przyjazdy.sloty[przyjazdy.liczba++] = &lina_sloty[i];
                 }
             }
+        } else {
+            kolo_przesun(&lina_kolo, lina_teraz(), zbierz_przyjazd, &przyjazdy);
+        }
+        long long najblizszy = kolo_najblizszy(&lina_kolo);
+        long long postoje = lina_postoje_ms;
+        pthread_mutex_unlock(&lina_mutex);
 
-            // Jeśli nie było awarii - dolicz sekundę
-            if (!g_shm->emergency_stop && !shutdown_flag) {
-                time_traveled++;
-            }
+        for (int i = 0; i < przyjazdy.liczba; i++) {
+            krzeselko_przyjezdza(przyjazdy.sloty[i]);
         }
-    }
 
-    // Przyjazd na górę - wysłanie komunikatu do worker2
-    Message msg;
-    msg.mtype = MSG_CHAIR_ARRIVAL;
-    msg.sender_pid = getpid();
-    msg.data = chair_id;
-    msg.data2 = group->count;
-    
-    // kopiowanie danych pasażerów do wiadomości
-    for (int i = 0; i < CHAIR_CAPACITY; i++) {
-        if (i < group->count) {
-            msg.child_ids[i] = group->tourist_pids[i];
+        if (lina_koniec) break;
+        if (przyjazdy.liczba > 0) continue;
+
+        if (zamkniecie) {
+            // Czekanie na lina_koniec od wątku głównego
+            struct timespec termin;
+            termin_za_ms(&termin, SEM_WAIT_MS);
+            czekaj_na_zmiane(&lina_dzwonek, dzwonek, &termin);
+        } else if (najblizszy < 0) {
+            // Puste koło - sen do odjazdu (dzwonek)
+            czekaj_na_zmiane(&lina_dzwonek, dzwonek, NULL);
         } else {
-            msg.child_ids[i] = 0;
+            // Sen do najbliższego przyjazdu lub zmiany stanu (awaria, koniec)
+            struct timespec termin;
+            zegar_termin(g_shm, najblizszy + postoje, &termin);
+            stan_czekaj_do(g_shm, seq, &termin);
         }
     }
-    
-    wyslij_komunikat(g_msg_worker_id, &msg);
-    
-    // Aktualizacja statystyk krzesełek (SEM_CHAIR_OPS)
-    sem_opusc(g_sem_id, SEM_CHAIR_OPS);
-    g_shm->active_chairs--;
-    sem_podnies(g_sem_id, SEM_CHAIR_OPS);
-    
-    // Zwolnienie semafora krzesełka
-    sem_podnies_bez_undo(g_sem_id, SEM_CHAIRS);
-    
-    free(group);
+    free(przyjazdy.sloty);
     return NULL;
 }
 
+// Start wątku liny z zablokowanymi sygnałami - SIGTERM/SIGUSR obsługuje wątek główny
+static void lina_uruchom(void) {
+    sigset_t maska, stara;
+    sigfillset(&maska);
+    pthread_sigmask(SIG_BLOCK, &maska, &stara);
+
+    if (pthread_create(&lina_watek, NULL, watek_liny, NULL) != 0) {
+        perror("Błąd tworzenia wątku liny");
+        exit(1);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &stara, NULL);
+}
+
+static void lina_zatrzymaj(void) {
+    lina_koniec = true;
+    powiadom_o_zmianie(&lina_dzwonek);
+    pthread_join(lina_watek, NULL);
+}
+
 // Wysyłanie sygnału awaryjnego do worker2
 void send_emergency_to_worker2(bool stop) {
     sem_opusc(g_sem_id, SEM_MAIN);
@@ -294,18 +731,24 @@ void send_emergency_to_worker2(bool stop) {
 
 // Inicjowanie zatrzymania awaryjnego
 void initiate_emergency_stop(void) {
-    logger(LOG_EMERGENCY, "PRACOWNIK1: Inicjuję AWARYJNE ZATRZYMANIE kolei!");
-    
     // Ustaw lokalną flagę
     emergency_stop = 1;
     emergency_resume = 0;
     
     sem_opusc(g_sem_id, SEM_MAIN);
+    if (g_shm->emergency_stop) {
+        // Awaria worker2 już trwa (sygnał jeszcze nie dotarł) - obsługa jako druga strona
+        sem_podnies(g_sem_id, SEM_MAIN);
+        return;
+    }
+    logger(LOG_EMERGENCY, "PRACOWNIK1: Inicjuję AWARYJNE ZATRZYMANIE kolei!");
+    zapisz_zdarzenie(ZD_AWARIA_STOP, 1, 0, 0, 0, 0);
     g_shm->emergency_stop = true;
     g_shm->emergency_initiator = 1;
     g_shm->worker1_ready = false;
     g_shm->worker2_ready = false;
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
     
     // Powiadomienie worker2
     send_emergency_to_worker2(true);
@@ -321,9 +764,11 @@ void resume_from_emergency(void) {
     g_shm->worker1_ready = true;
     bool worker2_ready = g_shm->worker2_ready;
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
 
-    // Czekaj na worker2 - sprawdzaj co 50ms zamiast busy loop
+    // Czekaj na worker2 - blokująco, budzi zmiana stanu
     while (!worker2_ready && !shutdown_flag) {
+        stan_czekaj(g_shm, stan_odczytaj(g_shm), SEM_WAIT_MS);
         sem_opusc(g_sem_id, SEM_MAIN);
         worker2_ready = g_shm->worker2_ready;
         sem_podnies(g_sem_id, SEM_MAIN);
@@ -336,6 +781,7 @@ void resume_from_emergency(void) {
     g_shm->emergency_stop = false;
     g_shm->emergency_initiator = 0;
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
     
     // Odblokuj semafor awaryjny
     sem_ustaw_wartosc(g_sem_id, SEM_EMERGENCY, 1);
@@ -343,63 +789,54 @@ void resume_from_emergency(void) {
     // Powiadom worker2
     send_emergency_to_worker2(false);
     
-    emergency_stop = 0;
+    // Nowa awaria worker2 zaraz po wznowieniu - jej SIGUSR1 mógł przyjść przed tym miejscem
+    sem_opusc(g_sem_id, SEM_MAIN);
+    emergency_stop = g_shm->emergency_stop;
+    sem_podnies(g_sem_id, SEM_MAIN);
     emergency_resume = 0;
     
     logger(LOG_EMERGENCY, "PRACOWNIK1: Kolej WZNOWIONA - normalny ruch!");
+    zapisz_zdarzenie(ZD_AWARIA_WZNOWIENIE, 1, 0, 0, 0, 0);
 }
 
 // Odbierz i dodaj turystów do kolejki waiters
 // Zwraca liczbę odebranych komunikatów
-int receive_platform_messages(Message* msg) {
+int receive_platform_messages(Komunikat* msg) {
     int received = 0;
     
     sem_opusc(g_sem_id, SEM_MAIN);
     bool gates_closed = g_shm->gates_closed;
     sem_podnies(g_sem_id, SEM_MAIN);
     
-    while (odbierz_komunikat(g_msg_id, msg, MSG_TOURIST_TO_PLATFORM, false)) {
+    while (kanal_odbierz(KANAL_PERON, msg)) {
         if (shutdown_flag) break;
         
         PlatformWaiter w;
-        w.pid = msg->sender_pid;
+        w.reply_box = msg->reply_box;
         w.tourist_id = msg->tourist_id;
-        w.type = msg->tourist_type;
-        w.children_count = msg->children_count;
-        w.child_ids[0] = msg->child_ids[0];
-        w.child_ids[1] = msg->child_ids[1];
+        w.type = (TouristType)msg->u.peron.tourist_type;
+        w.children_count = msg->u.peron.children_count;
     
         int gate_num = get_next_platform_gate();
 
         // Jeśli bramki zamknięte - odmowa dla nowych turystów
         if (gates_closed) {
             logger(LOG_WORKER1, "Turysta #%d - ODMOWA wejścia na peron (bramki zamknięte)", w.tourist_id);
-            Message refuse;
-            refuse.mtype = w.pid;
-            refuse.sender_pid = getpid();
-            refuse.data = -1;
-            refuse.tourist_id = w.tourist_id;
-            wyslij_komunikat(g_msg_id, &refuse);
+            odpowiedz_peronu(w.reply_box, w.tourist_id, MSG_PLATFORM_REFUSED);
             received++;
             continue;
         }
 
         if (add_waiter(&w)) {
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_on_platform++;
-            sem_podnies(g_sem_id, SEM_QUEUE);
+            licznik_dodaj(g_shm->tourists_on_platform, 1);
 
             logger(LOG_WORKER1, "Turysta #%d wpuszczony przez bramkę peronową #%d (typ: %s, dzieci: %d)",
                    w.tourist_id, gate_num,
                    w.type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy",
                    w.children_count);
+            zapisz_zdarzenie(ZD_PERON_WPUSZCZONY, gate_num, w.tourist_id, 0, w.type, w.children_count);
         } else {
-            Message refuse;
-            refuse.mtype = w.pid;
-            refuse.sender_pid = getpid();
-            refuse.data = -1;
-            refuse.tourist_id = w.tourist_id;
-            wyslij_komunikat(g_msg_id, &refuse);
+            odpowiedz_peronu(w.reply_box, w.tourist_id, MSG_PLATFORM_REFUSED);
         }
 
         received++;
@@ -423,21 +860,35 @@ bool dispatch_one_chair(void) {
     int result = sem_probuj_opusc_bez_undo(g_sem_id, SEM_CHAIRS);
     if (result != 1) return false;
     
-    ChairGroup* group = malloc(sizeof(ChairGroup));
+    SlotLiny* slot = lina_zajmij_slot();
+    if (slot == NULL) {
+        sem_podnies_bez_undo(g_sem_id, SEM_CHAIRS);
+        return false;
+    }
+
+    ChairGroup* group = &slot->grupa;
     if (!try_create_group(group)) {
-        free(group);
+        lina_zwolnij_slot(slot);
         sem_podnies_bez_undo(g_sem_id, SEM_CHAIRS);
         return false;
     }
     
-    // Powiadom turystów o wsiadaniu
+    // Powiadom turystów o wsiadaniu - jedno powiadomienie grupy na krzesełko
+    PasazerKrzeselka pasazerowie[CHAIR_CAPACITY];
     for (int i = 0; i < group->count; i++) {
-        Message notify;
-        notify.mtype = group->tourist_pids[i];
-        notify.sender_pid = getpid();
-        notify.data = 1; // OK wsiadaj
-        notify.tourist_id = group->tourist_ids[i];
-        wyslij_komunikat(g_msg_id, &notify);
+        pasazerowie[i].tourist_id = group->tourist_ids[i];
+        pasazerowie[i].reply_box = group->reply_boxes[i];
+    }
+    group->grupa = grupa_utworz(pasazerowie, group->count);
+    if (group->grupa >= 0) {
+        grupa_powiadom(group->grupa, MSG_PLATFORM_TO_TOURIST);
+    }
+
+    for (int i = 0; i < group->count; i++) {
+        if (group->grupa < 0) {
+            // Brak wolnego rekordu grupy - odpowiedź do każdej skrzynki
+            odpowiedz_peronu(group->reply_boxes[i], group->tourist_ids[i], MSG_PLATFORM_TO_TOURIST);
+        }
         if (shutdown_flag) break;
         
         // Log wpuszczenia turysty
@@ -453,26 +904,11 @@ bool dispatch_one_chair(void) {
         }
     }
     
-    // Aktualizuj licznik na peronie (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_on_platform -= group->count;
-    sem_podnies(g_sem_id, SEM_QUEUE);
+    // Aktualizuj licznik na peronie
+    licznik_dodaj(g_shm->tourists_on_platform, -group->count);
     
-    // Uruchom wątek krzesełka
-    pthread_t thread;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-    
-    if (pthread_create(&thread, &attr, chair_thread, group) != 0) {
-        perror("Błąd tworzenia wątku krzesełka");
-        free(group);
-        sem_podnies_bez_undo(g_sem_id, SEM_CHAIRS);
-        pthread_attr_destroy(&attr);
-        return false;
-    }
-
-    pthread_attr_destroy(&attr);
+    // Krzesełko rusza - przyjazd obsłuży wątek liny
+    krzeselko_odjezdza(slot);
     return true;
 }
 
@@ -491,30 +927,29 @@ int main(void) {
     sigaction(SIGUSR2, &sa, NULL);
     
     // Połącz z zasobami IPC
-    g_msg_id = polacz_kolejke();
-    g_msg_worker_id = polacz_kolejke_worker();
     g_sem_id = polacz_semafory();
     int shm_id = polacz_pamiec();
     g_shm = dolacz_pamiec(shm_id);
+    konfig_dolacz();
+    g_stat = statystyki_shard(g_shm, STAT_SHARD_WORKER1);
+    kanaly_dolacz(g_shm);
+    skrzynki_dolacz();
     
     // Zapisz PID
     sem_opusc(g_sem_id, SEM_MAIN);
     g_shm->worker1_pid = getpid();
-    time_t sim_start = g_shm->simulation_start;
     sem_podnies(g_sem_id, SEM_MAIN);
     
-    srand(time(NULL) ^ getpid());
+    strumien_init(&g_los, g_shm->ziarno, STRUMIEN_WORKER1, 0);
+    reset_waiters();
+    init_sklady();
+    g_shm->packing_policy = PACKING_POLICY;
     
     // Opóźnienie rozpoczęcia pracy pracownika o WORK_START_TIME sekund
     logger(LOG_WORKER1, "Czekam %d sekund przed rozpoczęciem pracy...", WORK_START_TIME);
     
-    while (!shutdown_flag) {
-        time_t now = time(NULL);
-        time_t elapsed = now - sim_start;
-        
-        if (elapsed >= WORK_START_TIME) {
-            break;
-        }
+    // Blokujący sen do czasu Tp na zegarze symulacji (SIGTERM przerywa sen)
+    while (!shutdown_flag && zegar_uspij_do(g_shm, WORK_START_TIME * 1000LL) != 0) {
     }
     
     if (shutdown_flag) {
@@ -524,44 +959,43 @@ int main(void) {
     }
     
     logger(LOG_WORKER1, "Rozpoczynam pracę na stacji dolnej!");
+    lina_init();
+    lina_uruchom();
     
-    Message msg;
+    Komunikat msg;
     bool should_trigger_emergency = false;
     
     // System awarii
-    time_t last_emergency_check = time(NULL);
-    int next_emergency_delay = 3 + (rand() % 3);  // 3-5 sekund
+    long long last_emergency_check = zegar_teraz_ms(g_shm);
+    int next_emergency_delay = 3 + strumien_zakres(&g_los, 3);  // 3-5 sekund symulacji
     
     while (!shutdown_flag) {
+        unsigned int seq = stan_odczytaj(g_shm);
+
         // Sprawdź czy bramki zamknięte (koniec dnia) - osobne semafory dla różnych zasobów
         sem_opusc(g_sem_id, SEM_MAIN);
         bool gates_closed = g_shm->gates_closed;
         sem_podnies(g_sem_id, SEM_MAIN);
 
-        sem_opusc(g_sem_id, SEM_QUEUE);
-        int on_platform = g_shm->tourists_on_platform;
-        sem_podnies(g_sem_id, SEM_QUEUE);
+        int on_platform = licznik_odczytaj(g_shm->tourists_on_platform);
 
-        sem_opusc(g_sem_id, SEM_CHAIR_OPS);
-        int active_chairs = g_shm->active_chairs;
-        sem_podnies(g_sem_id, SEM_CHAIR_OPS);
+        int active_chairs = licznik_odczytaj(g_shm->active_chairs);
         
         // === OBSŁUGA AWARII ===
         if (!gates_closed) {
-            time_t now = time(NULL);
-            time_t elapsed_since_start = now - sim_start;
-            time_t time_to_end = WORK_END_TIME - elapsed_since_start;
+            long long now = zegar_teraz_ms(g_shm);
+            long long time_to_end = WORK_END_TIME * 1000LL - now;
             
             // Sprawdź czy minął czas od ostatniej próby awarii
-            if (!emergency_stop && (now - last_emergency_check) >= next_emergency_delay) {
+            if (!emergency_stop && (now - last_emergency_check) >= next_emergency_delay * 1000LL) {
                 // Nie inicjuj awarii jeśli zostało mniej niż EMERGENCY_SAFETY_MARGIN sekund do końca
-                if (time_to_end > EMERGENCY_SAFETY_MARGIN) {
-                    if (rand() % 100 < EMERGENCY_CHANCE) {
+                if (time_to_end > EMERGENCY_SAFETY_MARGIN * 1000LL) {
+                    if (strumien_zakres(&g_los, 100) < konfig()->emergency_chance) {
                         should_trigger_emergency = true;
                     }
                 }
                 last_emergency_check = now;
-                next_emergency_delay = 3 + (rand() % 3);
+                next_emergency_delay = 3 + strumien_zakres(&g_los, 3);
             }
             
             if (should_trigger_emergency && !emergency_stop) {
@@ -583,7 +1017,10 @@ int main(void) {
             if (initiator == 1) {
                 // My zainicjowaliśmy - czekaj na worker2
                 while (!w2_ready && !shutdown_flag) {
-                    receive_platform_messages(&msg);
+                    if (receive_platform_messages(&msg) == 0) {
+                        kanaly_czekaj(ODBIORCA_WORKER1, seq, IDLE_WAIT_MS);
+                    }
+                    seq = stan_odczytaj(g_shm);
                     sem_opusc(g_sem_id, SEM_MAIN);
                     w2_ready = g_shm->worker2_ready;
                     sem_podnies(g_sem_id, SEM_MAIN);
@@ -592,10 +1029,13 @@ int main(void) {
                 if (w2_ready && !shutdown_flag) {
                     logger(LOG_EMERGENCY, "PRACOWNIK1: Worker2 gotowy - Zatrzymanie ruchu kolei...");
 
-                    int waited_intervals = 0;
-                    int required_intervals = EMERGENCY_DURATION * 10; // 10 x 100ms = 1 sekunda
-                    while (waited_intervals < required_intervals && !shutdown_flag) {
-                        waited_intervals++;
+                    // Postój kolei - nadal przyjmujemy turystów na peron
+                    struct timespec termin;
+                    zegar_termin(g_shm, zegar_teraz_ms(g_shm) + EMERGENCY_DURATION * 1000LL, &termin);
+                    while (!shutdown_flag && !termin_minal(&termin)) {
+                        if (receive_platform_messages(&msg) == 0) {
+                            kanaly_czekaj(ODBIORCA_WORKER1, stan_odczytaj(g_shm), IDLE_WAIT_MS);
+                        }
                     }
 
                     resume_from_emergency();
@@ -607,15 +1047,28 @@ int main(void) {
                 sem_opusc(g_sem_id, SEM_MAIN);
                 g_shm->worker1_ready = true;
                 sem_podnies(g_sem_id, SEM_MAIN);
+                stan_powiadom(g_shm);
 
                 logger(LOG_EMERGENCY, "PRACOWNIK1: Potwierdzam gotowość (awaria od worker2)");
 
-                while (emergency_stop && !emergency_resume && !shutdown_flag) {
-                    receive_platform_messages(&msg);
+                // Czekanie na SIGUSR2 - przyjmowanie turystów, sen gdy brak komunikatów.
+                // Koniec awarii rozpoznaje też stan w pamięci dzielonej (nakładające się
+                // SIGUSR1/SIGUSR2 przy nowej awarii tuż po wznowieniu - jak w worker2)
+                bool trwa = true;
+                while (trwa && !emergency_resume && !shutdown_flag) {
+                    seq = stan_odczytaj(g_shm);
+                    sem_opusc(g_sem_id, SEM_MAIN);
+                    trwa = g_shm->emergency_stop && g_shm->worker1_ready;
+                    sem_podnies(g_sem_id, SEM_MAIN);
+                    if (trwa && receive_platform_messages(&msg) == 0 && !emergency_resume) {
+                        kanaly_czekaj(ODBIORCA_WORKER1, seq, IDLE_WAIT_MS);
+                    }
                 }
 
-                if (emergency_resume) {
-                    emergency_stop = 0;
+                if (!shutdown_flag) {
+                    sem_opusc(g_sem_id, SEM_MAIN);
+                    emergency_stop = g_shm->emergency_stop;
+                    sem_podnies(g_sem_id, SEM_MAIN);
                     emergency_resume = 0;
                     logger(LOG_EMERGENCY, "Otrzymano sygnał wznowienia od worker2");
                 }
@@ -626,36 +1079,26 @@ int main(void) {
         // Sprawdź czy zakończyć pracę
         if (shutdown_flag) {
             // Wymuszony shutdown - wyślij odmowy do wszystkich czekających
-            Message cleanup_msg;
-            while (odbierz_komunikat(g_msg_id, &cleanup_msg, MSG_TOURIST_TO_PLATFORM, false)) {
-                Message refuse;
-                refuse.mtype = cleanup_msg.sender_pid;
-                refuse.sender_pid = getpid();
-                refuse.data = -1;
-                refuse.tourist_id = cleanup_msg.tourist_id;
-                // Używamy blokującego wysyłania - MUSI dotrzeć
-                wyslij_komunikat(g_msg_id, &refuse);
+            Komunikat cleanup_msg;
+            while (kanal_odbierz(KANAL_PERON, &cleanup_msg)) {
+                // Odmowa MUSI dotrzeć - turysta czeka na odpowiedź
+                odpowiedz_peronu(cleanup_msg.reply_box, cleanup_msg.tourist_id, MSG_PLATFORM_REFUSED);
             }
 
             pthread_mutex_lock(&waiter_mutex);
             int waiters_to_clear = waiter_count;
-            for (int i = 0; i < waiter_count; i++) {
-                Message refuse;
-                refuse.mtype = waiters[i].pid;
-                refuse.sender_pid = getpid();
-                refuse.data = -1;
-                refuse.tourist_id = waiters[i].tourist_id;
-                // Używamy blokującego wysyłania - MUSI dotrzeć
-                wyslij_komunikat(g_msg_id, &refuse);
+            for (int p = 0; p < PAS_COUNT; p++) {
+                for (int i = lane_head[p]; i >= 0; i = waiter_pool[i].nastepny) {
+                    // Odmowa MUSI dotrzeć - turysta czeka na odpowiedź
+                    odpowiedz_peronu(waiter_pool[i].w.reply_box, waiter_pool[i].w.tourist_id, MSG_PLATFORM_REFUSED);
+                }
             }
-            waiter_count = 0;
+            reset_waiters();
             pthread_mutex_unlock(&waiter_mutex);
 
             // Zmniejsz licznik turystów na peronie dla wszystkich waiters
             if (waiters_to_clear > 0) {
-                sem_opusc(g_sem_id, SEM_QUEUE);
-                g_shm->tourists_on_platform -= waiters_to_clear;
-                sem_podnies(g_sem_id, SEM_QUEUE);
+                licznik_dodaj(g_shm->tourists_on_platform, -waiters_to_clear);
             }
 
             logger(LOG_WORKER1, "Wymuszony shutdown - zamykam stację dolną (wysłano %d odmów)", waiters_to_clear);
@@ -668,16 +1111,11 @@ int main(void) {
         pthread_mutex_unlock(&waiter_mutex);
         
         if (gates_closed && on_platform == 0 && current_waiters == 0 && active_chairs == 0) {
-            // Przed zakończeniem - opróżnij kolejkę komunikatów i odeślij odmowy
-            Message cleanup_msg;
+            // Przed zakończeniem - opróżnij kanał peronu i odeślij odmowy
+            Komunikat cleanup_msg;
             int refused_count = 0;
-            while (odbierz_komunikat(g_msg_id, &cleanup_msg, MSG_TOURIST_TO_PLATFORM, false)) {
-                Message refuse;
-                refuse.mtype = cleanup_msg.sender_pid;
-                refuse.sender_pid = getpid();
-                refuse.data = -1;
-                refuse.tourist_id = cleanup_msg.tourist_id;
-                wyslij_komunikat(g_msg_id, &refuse);
+            while (kanal_odbierz(KANAL_PERON, &cleanup_msg)) {
+                odpowiedz_peronu(cleanup_msg.reply_box, cleanup_msg.tourist_id, MSG_PLATFORM_REFUSED);
                 refused_count++;
             }
             if (refused_count > 0) {
@@ -689,49 +1127,36 @@ int main(void) {
         
         // Odbieranie komunikatów od turystów
         int received = 0;
-        while (odbierz_komunikat(g_msg_id, &msg, MSG_TOURIST_TO_PLATFORM, false)) {
+        while (kanal_odbierz(KANAL_PERON, &msg)) {
             if (shutdown_flag) break;
 
             PlatformWaiter w;
-            w.pid = msg.sender_pid;
+            w.reply_box = msg.reply_box;
             w.tourist_id = msg.tourist_id;
-            w.type = msg.tourist_type;
-            w.children_count = msg.children_count;
-            w.child_ids[0] = msg.child_ids[0];
-            w.child_ids[1] = msg.child_ids[1];
+            w.type = (TouristType)msg.u.peron.tourist_type;
+            w.children_count = msg.u.peron.children_count;
 
             int gate_num = get_next_platform_gate();
 
             // Jeśli bramki zamknięte - odmowa dla nowych turystów
             if (gates_closed) {
                 logger(LOG_WORKER1, "Turysta #%d - ODMOWA wejścia na peron (bramki zamknięte)", w.tourist_id);
-                Message refuse;
-                refuse.mtype = w.pid;
-                refuse.sender_pid = getpid();
-                refuse.data = -1;
-                refuse.tourist_id = w.tourist_id;
-                wyslij_komunikat(g_msg_id, &refuse);
+                odpowiedz_peronu(w.reply_box, w.tourist_id, MSG_PLATFORM_REFUSED);
                 received++;
                 continue;
             }
 
             if (add_waiter(&w)) {
-                sem_opusc(g_sem_id, SEM_QUEUE);
-                g_shm->tourists_on_platform++;
-                sem_podnies(g_sem_id, SEM_QUEUE);
+                licznik_dodaj(g_shm->tourists_on_platform, 1);
 
                 logger(LOG_WORKER1, "Turysta #%d wpuszczony przez bramkę peronową #%d (typ: %s, dzieci: %d)",
                        w.tourist_id, gate_num,
                        w.type == TOURIST_CYCLIST ? "rowerzysta" : "pieszy",
                        w.children_count);
+                zapisz_zdarzenie(ZD_PERON_WPUSZCZONY, gate_num, w.tourist_id, 0, w.type, w.children_count);
             } else {
-                Message refuse;
-                refuse.mtype = w.pid;
-                refuse.sender_pid = getpid();
-                refuse.data = -1;
-                refuse.tourist_id = w.tourist_id;
-                // Używamy blokującego wysyłania - odmowa MUSI dotrzeć
-                wyslij_komunikat(g_msg_id, &refuse);
+                // Odmowa MUSI dotrzeć - turysta czeka na odpowiedź
+                odpowiedz_peronu(w.reply_box, w.tourist_id, MSG_PLATFORM_REFUSED);
             }
             received++;
         }
@@ -747,16 +1172,19 @@ int main(void) {
         current_waiters = waiter_count;
         pthread_mutex_unlock(&waiter_mutex);
 
-        if (received == 0 && dispatched == 0) {
-        }
-        
         if (received == 0 && current_waiters > 0) {
             dispatch_one_chair();
         }
+
+        // Brak pracy - sen do komunikatu, zwolnienia krzesełka lub zmiany stanu
+        if (received == 0 && dispatched == 0) {
+            kanaly_czekaj(ODBIORCA_WORKER1, seq, IDLE_WAIT_MS);
+        }
     }
     
     logger(LOG_WORKER1, "Kończę pracę na stacji dolnej");
     
+    lina_zatrzymaj();
     odlacz_pamiec(g_shm);
     return 0;
 }
\ No newline at end of file
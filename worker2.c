@@ -5,11 +5,15 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
-#include <sys/msg.h>
 #include <pthread.h>
 #include "struktury.h"
 #include "utils.h"
 #include "logger.h"
+#include "zdarzenia.h"
+#include "kolo_czasowe.h"
+#include "kanaly.h"
+#include "skrzynki.h"
+#include "konfig.h"
 
 // Flagi sygnałów
 static volatile sig_atomic_t shutdown_flag = 0;
@@ -17,9 +21,9 @@ static volatile sig_atomic_t emergency_stop = 0;
 static volatile sig_atomic_t emergency_resume = 0;
 
 static int g_sem_id = -1;
-static int g_msg_id = -1;
-static int g_msg_worker_id = -1;
 static SharedMemory* g_shm = NULL;
+static StrumienLosowy g_los;           // Losowanie awarii (STRUMIEN_WORKER*)
+static StatystykiShard* g_stat = NULL;
 
 // Handler sygnałów
 void worker2_signal_handler(int sig) {
@@ -49,18 +53,24 @@ void send_signal_to_worker1(int sig) {
 
 // Inicjowanie zatrzymania awaryjnego przez worker2
 void initiate_emergency_stop_w2(void) {
-    logger(LOG_EMERGENCY, "PRACOWNIK2: Inicjuję AWARYJNE ZATRZYMANIE kolei!");
-    
     // Ustaw lokalną flagę
     emergency_stop = 1;
     emergency_resume = 0;
     
     sem_opusc(g_sem_id, SEM_MAIN);
+    if (g_shm->emergency_stop) {
+        // Awaria worker1 już trwa (sygnał jeszcze nie dotarł) - obsługa jako druga strona
+        sem_podnies(g_sem_id, SEM_MAIN);
+        return;
+    }
+    logger(LOG_EMERGENCY, "PRACOWNIK2: Inicjuję AWARYJNE ZATRZYMANIE kolei!");
+    zapisz_zdarzenie(ZD_AWARIA_STOP, 2, 0, 0, 0, 0);
     g_shm->emergency_stop = true;
     g_shm->emergency_initiator = 2;
     g_shm->worker1_ready = false;
     g_shm->worker2_ready = false;
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
     
     // Powiadom worker1
     send_signal_to_worker1(SIGUSR1);
@@ -70,10 +80,9 @@ void initiate_emergency_stop_w2(void) {
 void resume_from_emergency_w2(void) {
     logger(LOG_EMERGENCY, "PRACOWNIK2: Worker1 gotowy - Zatrzymanie ruchu kolei");
 
-    int waited_intervals = 0;
-    int required_intervals = EMERGENCY_DURATION * 10;
-    while (waited_intervals < required_intervals && !shutdown_flag) {
-        waited_intervals++;
+    // Postój kolei przez EMERGENCY_DURATION na zegarze symulacji (SIGTERM przerywa sen)
+    long long koniec_postoju = zegar_teraz_ms(g_shm) + EMERGENCY_DURATION * 1000LL;
+    while (!shutdown_flag && zegar_uspij_do(g_shm, koniec_postoju) != 0) {
     }
     if (shutdown_flag) return;
     
@@ -82,134 +91,314 @@ void resume_from_emergency_w2(void) {
     g_shm->emergency_stop = false;
     g_shm->emergency_initiator = 0;
     sem_podnies(g_sem_id, SEM_MAIN);
+    stan_powiadom(g_shm);
     
     // Powiadom worker1
     send_signal_to_worker1(SIGUSR2);
     
-    emergency_stop = 0;
+    // Nowa awaria worker1 zaraz po wznowieniu - jej SIGUSR1 mógł przyjść przed tym miejscem
+    sem_opusc(g_sem_id, SEM_MAIN);
+    emergency_stop = g_shm->emergency_stop;
+    sem_podnies(g_sem_id, SEM_MAIN);
     emergency_resume = 0;
     
     logger(LOG_EMERGENCY, "PRACOWNIK2: Kolej WZNOWIONA - normalny ruch!");
+    zapisz_zdarzenie(ZD_AWARIA_WZNOWIENIE, 2, 0, 0, 0, 0);
 }
 
-// Licznik bramek wyjściowych
-static int g_exit_gate_counter = 0;
-static pthread_mutex_t g_exit_gate_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-// Pobierz następny numer bramki wyjściowej (1-2)
-int get_next_exit_gate(void) {
-    pthread_mutex_lock(&g_exit_gate_mutex);
-    int gate = (g_exit_gate_counter % EXIT_GATES) + 1;
-    g_exit_gate_counter++;
-    pthread_mutex_unlock(&g_exit_gate_mutex);
-    return gate;
-}
-
-// Wątek obsługi turysty na górnej stacji
+// === Bramki wyjściowe i trasy zjazdowe ===
+// EXIT_GATES (konfiguracja) stałych wątków bramek pobiera prośby o wyjście z kolejki FIFO; zjazdy
+// trasą czekają na kole czasowym (ms symulacji), które przesuwa wolna bramka.
+// Węzły próśb pochodzą z puli MAX_EXITS - bez malloc i tworzenia wątków na wyjście.
 typedef struct {
+    TimerKola zjazd;            // Koniec zjazdu trasą
     int tourist_id;
-    pid_t tourist_pid;
-    TrailType trail;
-} TouristExit;
+    int reply_box;              // Skrzynka odpowiedzi turysty
+    TrailType trail;            // -1 - pieszy wychodzi bez zjazdu
+    bool zjezdza;
+    int nastepny;               // Kolejka FIFO / lista wolnych / lista zakończonych (-1 koniec)
+} WyjscieTurysty;
 
-void* tourist_exit_thread(void* arg) {
-    TouristExit* te = (TouristExit*)arg;
+#define MAX_EXITS 15000
+static WyjscieTurysty exit_pool[MAX_EXITS];
+static int exit_free = -1;
+static int exit_head = -1;
+static int exit_tail = -1;
+static KoloCzasowe trail_kolo;
+static bool bramki_koniec = false;
+static pthread_mutex_t bramki_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bramki_cond;
+static pthread_t* bramki_watki = NULL;
+static int bramki_liczba = 0;
+
+static const char* nazwa_trasy_zjazdu(TrailType trail, int* czas) {
+    switch (trail) {
+        case TRAIL_T1:
+            *czas = konfig()->trail_time[TRAIL_T1];
+            return "T1 (łatwa)";
+        case TRAIL_T2:
+            *czas = konfig()->trail_time[TRAIL_T2];
+            return "T2 (średnia)";
+        case TRAIL_T3:
+        default:
+            *czas = konfig()->trail_time[TRAIL_T3];
+            return "T3 (trudna)";
+    }
+}
+
+// Odpowiedź bez ładunku do skrzynki turysty
+static void wyslij_odpowiedz(int tourist_id, int reply_box, unsigned char typ) {
+    Komunikat msg;
+    msg.typ = typ;
+    msg.reply_box = reply_box;
+    msg.tourist_id = tourist_id;
+    skrzynka_wyslij(reply_box, &msg);
+}
+
+// Potwierdzenie zakończenia (MSG_EXIT_DONE) - turysta opuszcza górną stację
+static void wyslij_zakonczenie(int tourist_id, int reply_box) {
+    wyslij_odpowiedz(tourist_id, reply_box, MSG_EXIT_DONE);
+}
+
+// Powiadomienie pasażerów krzesełka o dotarciu na górę (MSG_TOP_ARRIVAL) - jedno
+// powiadomienie grupy, a bez grupy odpowiedź do skrzynki każdego pasażera
+static void powiadom_pasazerow(const PrzyjazdKrzeselka* przyjazd) {
+    if (przyjazd->grupa >= 0) {
+        grupa_powiadom(przyjazd->grupa, MSG_TOP_ARRIVAL);
+        return;
+    }
+    for (int i = 0; i < przyjazd->count && i < CHAIR_CAPACITY; i++) {
+        const PasazerKrzeselka* p = &przyjazd->pasazerowie[i];
+        wyslij_odpowiedz(p->tourist_id, p->reply_box, MSG_TOP_ARRIVAL);
+    }
+}
+
+// Zwrot węzła do puli (pod bramki_mutex)
+static void zwolnij_wyjscie(WyjscieTurysty* w) {
+    w->nastepny = exit_free;
+    exit_free = (int)(w - exit_pool);
+}
+
+// Dodanie prośby o wyjście (wątek główny)
+static void dodaj_wyjscie(int tourist_id, int reply_box, TrailType trail) {
+    pthread_mutex_lock(&bramki_mutex);
+    if (exit_free < 0) {
+        pthread_mutex_unlock(&bramki_mutex);
+        logger(LOG_WORKER2, "[ERROR] Kolejka wyjść pełna! Turysta #%d wypuszczony bez kolejki", tourist_id);
+        licznik_dodaj(g_shm->tourists_at_top, -1);
+        wyslij_zakonczenie(tourist_id, reply_box);
+        return;
+    }
+    int idx = exit_free;
+    WyjscieTurysty* w = &exit_pool[idx];
+    exit_free = w->nastepny;
+    w->tourist_id = tourist_id;
+    w->reply_box = reply_box;
+    w->trail = trail;
+    w->zjezdza = false;
+    w->nastepny = -1;
+    if (exit_tail >= 0) {
+        exit_pool[exit_tail].nastepny = idx;
+    } else {
+        exit_head = idx;
+    }
+    exit_tail = idx;
+    pthread_cond_signal(&bramki_cond);
+    pthread_mutex_unlock(&bramki_mutex);
+}
+
+// Przejście przez bramkę (poza bramki_mutex) - pieszy kończy od razu, rowerzysta rusza trasą
+static void obsluz_wyjscie(WyjscieTurysty* w, int gate_num) {
+    // Zmniejszenie licznika turystów na górnej stacji
+    licznik_dodaj(g_shm->tourists_at_top, -1);
 
-    // Zmniejszenie licznika turystów na górnej stacji (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_at_top--;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-    
     // Sprawdzanie czy to pieszy opuszcza system na górze (trail == -1)
-    if (te->trail == (TrailType)(-1)) {
-        // Pieszy - opuszcza system bez zjazdu trasą
-        int gate_num = get_next_exit_gate();
-        
+    if (w->trail == (TrailType)(-1)) {
         sem_opusc(g_sem_id, SEM_GATE_EXIT);
         logger(LOG_WORKER2, "Pieszy #%d wypuszczony przez bramkę wyjściową #%d (opuszcza system)",
-               te->tourist_id, gate_num);
+               w->tourist_id, gate_num);
         sem_podnies(g_sem_id, SEM_GATE_EXIT);
-        
-        // Wyślij potwierdzenie
-        Message msg;
-        msg.mtype = te->tourist_pid;
-        msg.sender_pid = getpid();
-        msg.data = 3; // Zakończone
-        msg.tourist_id = te->tourist_id;
-        wyslij_komunikat(g_msg_id, &msg);
-
-        free(te);
-        return NULL;
+
+        wyslij_zakonczenie(w->tourist_id, w->reply_box);
+
+        pthread_mutex_lock(&bramki_mutex);
+        zwolnij_wyjscie(w);
+        pthread_mutex_unlock(&bramki_mutex);
+        return;
     }
-    
-    // Rowerzysta - normalny zjazd trasą
-    int gate_num = get_next_exit_gate();
-    
-    // Czekaj na semafor wyjścia (2 bramki)
+
+    // Rowerzysta - bramka zwalniana od razu po przejściu (turysta już jest na trasie)
     sem_opusc(g_sem_id, SEM_GATE_EXIT);
     logger(LOG_WORKER2, "Turysta #%d wypuszczony przez bramkę wyjściową #%d", 
-           te->tourist_id, gate_num);
-    
-    // Zwolnij bramkę od razu po przejściu (turysta już jest na trasie)
+           w->tourist_id, gate_num);
     sem_podnies(g_sem_id, SEM_GATE_EXIT);
-    
-    // Symulacja zjazdu trasą
+
     int trail_time;
-    const char* trail_name;
-    switch (te->trail) {
-        case TRAIL_T1:
-            trail_time = TRAIL_T1_TIME;
-            trail_name = "T1 (łatwa)";
-            break;
-        case TRAIL_T2:
-            trail_time = TRAIL_T2_TIME;
-            trail_name = "T2 (średnia)";
-            break;
-        case TRAIL_T3:
-        default:
-            trail_time = TRAIL_T3_TIME;
-            trail_name = "T3 (trudna)";
-            break;
-    }
-    
+    const char* trail_name = nazwa_trasy_zjazdu(w->trail, &trail_time);
     logger(LOG_WORKER2, "Turysta #%d zjeżdża trasą %s (%ds)", 
-           te->tourist_id, trail_name, trail_time);
+           w->tourist_id, trail_name, trail_time);
+    zapisz_zdarzenie(ZD_ZJAZD_START, w->trail, w->tourist_id, 0, trail_time, 0);
     
-    // Aktualizacja statystyk tras (SEM_STATS)
-    sem_opusc(g_sem_id, SEM_STATS);
-    g_shm->trail_usage[te->trail]++;
-    sem_podnies(g_sem_id, SEM_STATS);
-
-    // Aktualizacja licznika zjeżdżających (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_descending++;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-
-    int waited_intervals = 0;
-    int required_intervals = trail_time * 10;
-    while (waited_intervals < required_intervals) {
-        waited_intervals++;
+    // Aktualizacja statystyk tras
+    licznik_dodaj(g_stat->trail_usage[w->trail], 1);
+
+    // Aktualizacja licznika zjeżdżających
+    licznik_dodaj(g_shm->tourists_descending, 1);
+
+    // Zjazd trasą - termin na kole; śpiąca bramka przelicza swój termin budzenia
+    pthread_mutex_lock(&bramki_mutex);
+    long long teraz = zegar_teraz_ms(g_shm);
+    if (trail_kolo.liczba == 0) {
+        kolo_przesun(&trail_kolo, teraz, NULL, NULL);   // Przeskok pustego koła
     }
+    w->zjezdza = true;
+    kolo_dodaj(&trail_kolo, &w->zjazd, teraz + trail_time * 1000LL);
+    pthread_cond_signal(&bramki_cond);
+    pthread_mutex_unlock(&bramki_mutex);
+}
 
-    // Zmniejsz licznik zjeżdżających (SEM_QUEUE)
-    sem_opusc(g_sem_id, SEM_QUEUE);
-    g_shm->tourists_descending--;
-    sem_podnies(g_sem_id, SEM_QUEUE);
-    
-    // Wyślij powiadomienie do turysty, że zjazd zakończony i może wrócić
-    Message msg;
-    msg.mtype = te->tourist_pid;
-    msg.sender_pid = getpid();
-    msg.data = 3; // Zjazd zakończony (różne od 2 = dotarcie na górę)
-    msg.tourist_id = te->tourist_id;
-    wyslij_komunikat(g_msg_id, &msg);
+// Koniec zjazdu (poza bramki_mutex) - powiadomienie turysty, że może wrócić
+static void zakoncz_zjazd(WyjscieTurysty* w) {
+    // Zmniejsz licznik zjeżdżających
+    licznik_dodaj(g_shm->tourists_descending, -1);
 
+    wyslij_zakonczenie(w->tourist_id, w->reply_box);
+
+    int trail_time;
     logger(LOG_WORKER2, "Turysta #%d zakończył zjazd trasą %s i zjeżdża na dół", 
-           te->tourist_id, trail_name);
-    free(te);
+           w->tourist_id, nazwa_trasy_zjazdu(w->trail, &trail_time));
+    zapisz_zdarzenie(ZD_ZJAZD_KONIEC, w->trail, w->tourist_id, 0, 0, 0);
+}
+
+// Obsługa timera koła - dopięcie do listy zakończonych (pod bramki_mutex)
+static void zbierz_zjazd(TimerKola* timer, void* arg) {
+    int* zakonczone = (int*)arg;
+    WyjscieTurysty* w = (WyjscieTurysty*)timer->dane;
+    w->zjezdza = false;
+    w->nastepny = *zakonczone;
+    *zakonczone = (int)(w - exit_pool);
+}
+
+// Wątek bramki wyjściowej: zakończone zjazdy, potem prośby z kolejki, potem sen do
+// najbliższego końca zjazdu lub nowej prośby
+void* watek_bramki(void* arg) {
+    int gate_num = (int)(long)arg;
+
+    pthread_mutex_lock(&bramki_mutex);
+    while (!bramki_koniec) {
+        int zakonczone = -1;
+        kolo_przesun(&trail_kolo, zegar_teraz_ms(g_shm), zbierz_zjazd, &zakonczone);
+        if (zakonczone >= 0) {
+            pthread_mutex_unlock(&bramki_mutex);
+            for (int i = zakonczone; i >= 0; ) {
+                int nastepny = exit_pool[i].nastepny;
+                zakoncz_zjazd(&exit_pool[i]);
+                i = nastepny;
+            }
+            pthread_mutex_lock(&bramki_mutex);
+            for (int i = zakonczone; i >= 0; ) {
+                int nastepny = exit_pool[i].nastepny;
+                zwolnij_wyjscie(&exit_pool[i]);
+                i = nastepny;
+            }
+            continue;
+        }
+
+        if (exit_head >= 0) {
+            WyjscieTurysty* w = &exit_pool[exit_head];
+            exit_head = w->nastepny;
+            if (exit_head < 0) exit_tail = -1;
+            pthread_mutex_unlock(&bramki_mutex);
+            obsluz_wyjscie(w, gate_num);
+            pthread_mutex_lock(&bramki_mutex);
+            continue;
+        }
+
+        long long najblizszy = kolo_najblizszy(&trail_kolo);
+        if (najblizszy < 0) {
+            pthread_cond_wait(&bramki_cond, &bramki_mutex);
+        } else {
+            struct timespec termin;
+            zegar_termin(g_shm, najblizszy, &termin);
+            pthread_cond_timedwait(&bramki_cond, &bramki_mutex, &termin);
+        }
+    }
+    pthread_mutex_unlock(&bramki_mutex);
     return NULL;
 }
 
+static void bramki_uruchom(void) {
+    for (int i = 0; i < MAX_EXITS; i++) {
+        timer_init(&exit_pool[i].zjazd, &exit_pool[i]);
+        exit_pool[i].nastepny = (i + 1 < MAX_EXITS) ? i + 1 : -1;
+    }
+    exit_free = 0;
+    kolo_init(&trail_kolo, zegar_teraz_ms(g_shm));
+
+    // Termin budzenia z zegara symulacji (CLOCK_MONOTONIC)
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&bramki_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    // Sygnały obsługuje wątek główny
+    sigset_t maska, stara;
+    sigfillset(&maska);
+    pthread_sigmask(SIG_BLOCK, &maska, &stara);
+    bramki_liczba = konfig()->exit_gates;
+    bramki_watki = calloc(bramki_liczba, sizeof(pthread_t));
+    if (bramki_watki == NULL) {
+        perror("Błąd calloc (wątki bramek wyjściowych)");
+        exit(1);
+    }
+    for (int i = 0; i < bramki_liczba; i++) {
+        if (pthread_create(&bramki_watki[i], NULL, watek_bramki, (void*)(long)(i + 1)) != 0) {
+            perror("Błąd tworzenia wątku bramki wyjściowej");
+            exit(1);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &stara, NULL);
+}
+
+// Zatrzymanie bramek - czekający w kolejce i zjeżdżający kończą natychmiast
+// (jak dawniej wątki wyjścia przerwane przez SIGTERM). Zwraca liczbę obsłużonych.
+static int bramki_zatrzymaj(void) {
+    pthread_mutex_lock(&bramki_mutex);
+    bramki_koniec = true;
+    pthread_cond_broadcast(&bramki_cond);
+    pthread_mutex_unlock(&bramki_mutex);
+    for (int i = 0; i < bramki_liczba; i++) {
+        pthread_join(bramki_watki[i], NULL);
+    }
+    free(bramki_watki);
+    bramki_watki = NULL;
+    bramki_liczba = 0;
+
+    int w_kolejce = 0;
+    for (int i = exit_head; i >= 0; i = exit_pool[i].nastepny) {
+        wyslij_zakonczenie(exit_pool[i].tourist_id, exit_pool[i].reply_box);
+        w_kolejce++;
+    }
+    exit_head = exit_tail = -1;
+
+    int zjezdzajacy = 0;
+    for (int i = 0; i < MAX_EXITS; i++) {
+        if (exit_pool[i].zjezdza) {
+            kolo_usun(&trail_kolo, &exit_pool[i].zjazd);
+            exit_pool[i].zjezdza = false;
+            wyslij_zakonczenie(exit_pool[i].tourist_id, exit_pool[i].reply_box);
+            zjezdzajacy++;
+        }
+    }
+
+    if (w_kolejce > 0 || zjezdzajacy > 0) {
+        licznik_dodaj(g_shm->tourists_at_top, -w_kolejce);
+        licznik_dodaj(g_shm->tourists_descending, -zjezdzajacy);
+    }
+    return w_kolejce + zjezdzajacy;
+}
+
 int main(void) {
     // Inicjalizacja loggera dla procesu potomnego
     logger_init_child();
@@ -224,30 +413,26 @@ int main(void) {
     sigaction(SIGUSR2, &sa, NULL);
     
     // Połącz z zasobami IPC
-    g_msg_id = polacz_kolejke();
-    g_msg_worker_id = polacz_kolejke_worker();
     g_sem_id = polacz_semafory();
     int shm_id = polacz_pamiec();
     g_shm = dolacz_pamiec(shm_id);
+    konfig_dolacz();
+    g_stat = statystyki_shard(g_shm, STAT_SHARD_WORKER2);
+    kanaly_dolacz(g_shm);
+    skrzynki_dolacz();
     
     // Zapisz PID
     sem_opusc(g_sem_id, SEM_MAIN);
     g_shm->worker2_pid = getpid();
-    time_t sim_start = g_shm->simulation_start;
     sem_podnies(g_sem_id, SEM_MAIN);
     
-    srand(time(NULL) ^ getpid());
+    strumien_init(&g_los, g_shm->ziarno, STRUMIEN_WORKER2, 0);
     
     // Opóźnienie rozpoczęcia pracy pracownika o WORK_START_TIME sekund
     logger(LOG_WORKER2, "Czekam %d sekund przed rozpoczęciem pracy...", WORK_START_TIME);
     
-    while (!shutdown_flag) {
-        time_t now = time(NULL);
-        time_t elapsed = now - sim_start;
-        
-        if (elapsed >= WORK_START_TIME) {
-            break;
-        }
+    // Blokujący sen do czasu Tp na zegarze symulacji (SIGTERM przerywa sen)
+    while (!shutdown_flag && zegar_uspij_do(g_shm, WORK_START_TIME * 1000LL) != 0) {
     }
     
     if (shutdown_flag) {
@@ -257,15 +442,18 @@ int main(void) {
     }
     
     logger(LOG_WORKER2, "Rozpoczynam pracę na stacji górnej!");
+    bramki_uruchom();
     
-    Message msg;
+    Komunikat msg;
     bool should_trigger_emergency = false;
     
     // System awarii oparty na rzeczywistym czasie
-    time_t last_emergency_check = time(NULL);
-    int next_emergency_delay = 3 + (rand() % 9);  // 3-11 sekund
+    long long last_emergency_check = zegar_teraz_ms(g_shm);
+    int next_emergency_delay = 3 + strumien_zakres(&g_los, 9);  // 3-11 sekund symulacji
     
     while (!shutdown_flag) {
+        unsigned int seq = stan_odczytaj(g_shm);
+
         // Sprawdź czy bramki zamknięte (koniec dnia)
         sem_opusc(g_sem_id, SEM_MAIN);
         bool gates_closed = g_shm->gates_closed;
@@ -273,21 +461,20 @@ int main(void) {
         
         // Obsługa awarii - sprawdź czy trzeba zainicjować
         if (!gates_closed) {
-            time_t now = time(NULL);
-            time_t elapsed_since_start = now - sim_start;
-            time_t time_to_end = WORK_END_TIME - elapsed_since_start;
+            long long now = zegar_teraz_ms(g_shm);
+            long long time_to_end = WORK_END_TIME * 1000LL - now;
             
             // Sprawdź czy minął czas od ostatniej próby awarii
-            if (!emergency_stop && (now - last_emergency_check) >= next_emergency_delay) {
+            if (!emergency_stop && (now - last_emergency_check) >= next_emergency_delay * 1000LL) {
                 // Nie inicjuj awarii jeśli zostało mniej niż EMERGENCY_SAFETY_MARGIN sekund do końca
-                if (time_to_end > EMERGENCY_SAFETY_MARGIN) {
+                if (time_to_end > EMERGENCY_SAFETY_MARGIN * 1000LL) {
                     // Losowa szansa na awarię
-                    if (rand() % 100 < EMERGENCY_CHANCE) {
+                    if (strumien_zakres(&g_los, 100) < konfig()->emergency_chance) {
                         should_trigger_emergency = true;
                     }
                 }
                 last_emergency_check = now;
-                next_emergency_delay = 3 + (rand() % 9);  // Reset na 3-11 sekund
+                next_emergency_delay = 3 + strumien_zakres(&g_los, 9);  // Reset na 3-11 sekund
             }
             
             if (should_trigger_emergency && !emergency_stop) {
@@ -305,8 +492,10 @@ int main(void) {
             sem_podnies(g_sem_id, SEM_MAIN);
             
             if (initiator == 2) {
-                // Czekaj aż worker1 potwierdzi gotowość
+                // Czekaj aż worker1 potwierdzi gotowość (blokująco)
                 while (!w1_ready && !shutdown_flag) {
+                    stan_czekaj(g_shm, seq, SEM_WAIT_MS);
+                    seq = stan_odczytaj(g_shm);
                     sem_opusc(g_sem_id, SEM_MAIN);
                     w1_ready = g_shm->worker1_ready;
                     sem_podnies(g_sem_id, SEM_MAIN);
@@ -322,15 +511,30 @@ int main(void) {
                 sem_opusc(g_sem_id, SEM_MAIN);
                 g_shm->worker2_ready = true;
                 sem_podnies(g_sem_id, SEM_MAIN);
+                stan_powiadom(g_shm);
 
                 logger(LOG_EMERGENCY, "PRACOWNIK2: Potwierdzam gotowość (awaria od worker1)");
 
-                // Czekaj na sygnał wznowienia - aktywne czekanie
-                while (emergency_stop && !emergency_resume && !shutdown_flag) {
+                // Czekaj na wznowienie - blokująco (SIGUSR2 lub zmiana stanu budzi).
+                // Koniec awarii rozpoznaje też stan w pamięci dzielonej: przy nowej awarii
+                // tuż po wznowieniu SIGUSR1 nadpisuje flagę wznowienia (albo SIGUSR2 kasuje
+                // nowe zatrzymanie), a worker1 czeka już na gotowość do kolejnej awarii
+                bool trwa = true;
+                while (trwa && !emergency_resume && !shutdown_flag) {
+                    unsigned int seq_awarii = stan_odczytaj(g_shm);
+                    sem_opusc(g_sem_id, SEM_MAIN);
+                    trwa = g_shm->emergency_stop && g_shm->worker2_ready;
+                    sem_podnies(g_sem_id, SEM_MAIN);
+                    if (trwa && !emergency_resume) {
+                        stan_czekaj(g_shm, seq_awarii, SEM_WAIT_MS);
+                    }
                 }
 
-                if (emergency_resume) {
-                    emergency_stop = 0;
+                if (!shutdown_flag) {
+                    // Nowa awaria (worker2_ready skasowane) - obsługa w następnym obiegu
+                    sem_opusc(g_sem_id, SEM_MAIN);
+                    emergency_stop = g_shm->emergency_stop;
+                    sem_podnies(g_sem_id, SEM_MAIN);
                     emergency_resume = 0;
                     logger(LOG_EMERGENCY, "PRACOWNIK2: Otrzymano sygnał WZNOWIENIA od worker1!");
                 }
@@ -345,93 +549,62 @@ int main(void) {
         // Obsłużenie wszystkich turystów którzy są jeszcze w systemie
         if (shutdown_flag) {
             //Obsłużenie wszystkich pozostałych komunikatów MSG_CHAIR_ARRIVAL
-            Message cleanup_msg;
-            while (odbierz_komunikat(g_msg_worker_id, &cleanup_msg, MSG_CHAIR_ARRIVAL, false)) {
-                int passenger_count = cleanup_msg.data2;
-                for (int i = 0; i < passenger_count && i < CHAIR_CAPACITY; i++) {
-                    pid_t tourist_pid = cleanup_msg.child_ids[i];
-                    if (tourist_pid <= 0) continue;
-                    Message reply;
-                    reply.mtype = tourist_pid;
-                    reply.sender_pid = getpid();
-                    reply.data = 2; // Dotarłeś na górę
-                    wyslij_komunikat(g_msg_id, &reply);
-                }
+            Komunikat cleanup_msg;
+            while (kanal_odbierz(KANAL_PRZYJAZDY, &cleanup_msg)) {
+                powiadom_pasazerow(&cleanup_msg.u.przyjazd);
             }
             
             // Wyślij odpowiedzi do turystów czekających na wyjście (MSG_TOURIST_EXIT)
             int exit_count = 0;
-            while (odbierz_komunikat(g_msg_id, &cleanup_msg, MSG_TOURIST_EXIT, false)) {
-                Message reply;
-                reply.mtype = cleanup_msg.sender_pid;
-                reply.sender_pid = getpid();
-                reply.data = 3; // Zakończone
-                reply.tourist_id = cleanup_msg.tourist_id;
-                wyslij_komunikat(g_msg_id, &reply);
+            while (kanal_odbierz(KANAL_WYJSCIA, &cleanup_msg)) {
+                wyslij_zakonczenie(cleanup_msg.tourist_id, cleanup_msg.reply_box);
                 exit_count++;
             }
 
             // Zmniejsz licznik turystów na górze dla wszystkich obsłużonych
             if (exit_count > 0) {
-                sem_opusc(g_sem_id, SEM_QUEUE);
-                g_shm->tourists_at_top -= exit_count;
-                sem_podnies(g_sem_id, SEM_QUEUE);
+                licznik_dodaj(g_shm->tourists_at_top, -exit_count);
             }
 
+            exit_count += bramki_zatrzymaj();
             logger(LOG_WORKER2, "Symulacja zakończona (obsłużono %d wyjść)", exit_count);
             break;
         }
         
+        int handled = 0;
+
         // Odbieraj krzesełka przyjeżdżające na górną stację
-        while (odbierz_komunikat(g_msg_worker_id, &msg, MSG_CHAIR_ARRIVAL, false)) {
-            int chair_id = msg.data;
-            int passenger_count = msg.data2;
+        while (kanal_odbierz(KANAL_PRZYJAZDY, &msg)) {
+            int chair_id = msg.u.przyjazd.chair_id;
+            int passenger_count = msg.u.przyjazd.count;
+            handled++;
             
-            // Zwiększ licznik turystów na górnej stacji (SEM_QUEUE)
-            sem_opusc(g_sem_id, SEM_QUEUE);
-            g_shm->tourists_at_top += passenger_count;
-            sem_podnies(g_sem_id, SEM_QUEUE);
+            // Zwiększ licznik turystów na górnej stacji
+            licznik_dodaj(g_shm->tourists_at_top, passenger_count);
             
             logger(LOG_CHAIR, "Krzesełko #%d dotarło na górną stację z %d pasażerami",
                    chair_id, passenger_count);
+            zapisz_zdarzenie(ZD_KRZESELKO_PRZYJAZD, passenger_count, chair_id, 0, 0, 0);
             
-            // Wyślij powiadomienie do pasażerów że dotarli (data == 2)
-            for (int i = 0; i < passenger_count && i < CHAIR_CAPACITY; i++) {
-                pid_t tourist_pid = msg.child_ids[i];
-                if (tourist_pid <= 0) continue;
-
-                Message reply;
-                reply.mtype = tourist_pid;
-                reply.sender_pid = getpid();
-                reply.data = 2; // Dotarłeś na górę
-                reply.tourist_id = chair_id * 100 + i;
-                wyslij_komunikat(g_msg_id, &reply);
-                if (shutdown_flag) break;
-            }
+            // Powiadomienie pasażerów że dotarli - gospodarz puli rozdziela odpowiedzi po ID
+            powiadom_pasazerow(&msg.u.przyjazd);
         }
         
         // Odbieranie próśb turystów o wyjście
-        while (odbierz_komunikat(g_msg_id, &msg, MSG_TOURIST_EXIT, false)) {
-            TouristExit* te = malloc(sizeof(TouristExit));
-            te->tourist_pid = msg.sender_pid;
-            te->tourist_id = msg.tourist_id;
-            te->trail = (TrailType)msg.data;
-            
-            pthread_t thread;
-            pthread_attr_t attr;
-            pthread_attr_init(&attr);
-            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-            
-            if (pthread_create(&thread, &attr, tourist_exit_thread, te) != 0) {
-                perror("Błąd tworzenia wątku wyjścia turysty");
-                free(te);
-            }
-            
-            pthread_attr_destroy(&attr);
+        while (kanal_odbierz(KANAL_WYJSCIA, &msg)) {
+            handled++;
+            dodaj_wyjscie(msg.tourist_id, msg.reply_box, (TrailType)msg.u.wyjscie.trail);
+        }
+
+        // Brak pracy - sen do przyjazdu, prośby o wyjście lub zmiany stanu
+        if (handled == 0) {
+            kanaly_czekaj(ODBIORCA_WORKER2, seq, IDLE_WAIT_MS);
         }
-        
     }
     
+    if (!bramki_koniec) {
+        bramki_zatrzymaj();
+    }
     logger(LOG_WORKER2, "Kończę pracę na stacji górnej");
     
     odlacz_pamiec(g_shm);
@@ -0,0 +1,157 @@
+// zdarzenia.c - binarny dziennik zdarzeń (rekordy stałej długości, buforowane w procesie)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include "struktury.h"
+#include "zdarzenia.h"
+#include "utils.h"
+
+static int zd_fd = -1;
+static pid_t zd_pid = 0;
+static pthread_mutex_t zd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ZdarzenieBin zd_bufor[EVENT_BUFFER];
+static int zd_liczba = 0;
+static int64_t zd_najstarszy_ns = 0;    // Czas pierwszego rekordu w buforze
+static bool zd_atexit = false;
+
+typedef struct {
+    const char* nazwa;
+    const char* pola[5];    // nr, id, id2, wartosc, wartosc2
+} OpisZdarzenia;
+
+static const OpisZdarzenia opisy[ZD_LICZBA_TYPOW] = {
+    [ZD_BILET_SPRZEDANY]    = {"BILET_SPRZEDANY",    {"typ_biletu", "turysta", "bilet", "cena", "dzieci"}},
+    [ZD_BRAMKA_WEJSCIE]     = {"BRAMKA_WEJSCIE",     {"bramka", "turysta", "bilet", NULL, NULL}},
+    [ZD_PERON_WPUSZCZONY]   = {"PERON_WPUSZCZONY",   {"bramka", "turysta", NULL, "typ_turysty", "dzieci"}},
+    [ZD_KRZESELKO_ODJAZD]   = {"KRZESELKO_ODJAZD",   {"osoby", "krzeselko", NULL, "rowerzysci", "piesi"}},
+    [ZD_KRZESELKO_PRZYJAZD] = {"KRZESELKO_PRZYJAZD", {"osoby", "krzeselko", NULL, NULL, NULL}},
+    [ZD_ZJAZD_START]        = {"ZJAZD_START",        {"trasa", "turysta", NULL, "czas_s", NULL}},
+    [ZD_ZJAZD_KONIEC]       = {"ZJAZD_KONIEC",       {"trasa", "turysta", NULL, NULL, NULL}},
+    [ZD_AWARIA_STOP]        = {"AWARIA_STOP",        {"pracownik", NULL, NULL, NULL, NULL}},
+    [ZD_AWARIA_WZNOWIENIE]  = {"AWARIA_WZNOWIENIE",  {"pracownik", NULL, NULL, NULL, NULL}},
+};
+
+const char* nazwa_zdarzenia(int typ) {
+    if (typ <= 0 || typ >= ZD_LICZBA_TYPOW) return "NIEZNANE";
+    return opisy[typ].nazwa;
+}
+
+const char* nazwa_pola_zdarzenia(int typ, int pole) {
+    if (typ <= 0 || typ >= ZD_LICZBA_TYPOW || pole < 0 || pole > 4) return NULL;
+    return opisy[typ].pola[pole];
+}
+
+static int64_t czas_ns(clockid_t zegar) {
+    struct timespec ts;
+    clock_gettime(zegar, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Zapis bufora jednym write - O_APPEND dopisuje całość atomowo względem innych procesów
+// Wywoływane pod zd_mutex
+static void zapisz_bufor(void) {
+    size_t len = zd_liczba * sizeof(ZdarzenieBin);
+    const char* dane = (const char*)zd_bufor;
+    size_t zapisane = 0;
+    while (zapisane < len) {
+        ssize_t ret = write(zd_fd, dane + zapisane, len - zapisane);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        zapisane += ret;
+    }
+    zd_liczba = 0;
+}
+
+void zdarzenia_flush(void) {
+    if (zd_fd < 0) return;
+    pthread_mutex_lock(&zd_mutex);
+    if (zd_liczba > 0) {
+        zapisz_bufor();
+    }
+    pthread_mutex_unlock(&zd_mutex);
+}
+
+void zdarzenia_init(bool glowny) {
+    if (!EVENT_LOG) return;
+
+    if (zd_fd >= 0) {
+        close(zd_fd);
+        zd_fd = -1;
+    }
+    zd_liczba = 0;
+    zd_pid = getpid();
+
+    char plik[64];
+    plik_instancji(EVENT_LOG_FILE, plik, sizeof(plik));
+
+    if (glowny) {
+        zd_fd = open(plik, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (zd_fd < 0) {
+            perror("Nie można otworzyć pliku zdarzeń");
+            return;
+        }
+        NaglowekZdarzen nag;
+        memset(&nag, 0, sizeof(nag));
+        memcpy(nag.magia, ZDARZENIA_MAGIA, sizeof(nag.magia));
+        nag.wersja = ZDARZENIA_WERSJA;
+        nag.rozmiar_rekordu = sizeof(ZdarzenieBin);
+        nag.start_realtime_ns = czas_ns(CLOCK_REALTIME);
+        nag.start_monotonic_ns = czas_ns(CLOCK_MONOTONIC);
+        if (write(zd_fd, &nag, sizeof(nag)) != (ssize_t)sizeof(nag)) {
+            perror("Błąd zapisu nagłówka zdarzeń");
+        }
+    } else {
+        zd_fd = open(plik, O_WRONLY | O_APPEND);
+        if (zd_fd < 0) {
+            perror("Nie można otworzyć pliku zdarzeń (child)");
+            return;
+        }
+    }
+
+    // Bufor zapisywany przy normalnym zakończeniu procesu
+    if (!zd_atexit) {
+        atexit(zdarzenia_flush);
+        zd_atexit = true;
+    }
+}
+
+void zdarzenia_zamknij(void) {
+    if (zd_fd < 0) return;
+    zdarzenia_flush();
+    close(zd_fd);
+    zd_fd = -1;
+}
+
+void zapisz_zdarzenie(TypZdarzenia typ, int nr, int id, int id2, int wartosc, int wartosc2) {
+    if (zd_fd < 0) return;
+
+    int64_t teraz = czas_ns(CLOCK_MONOTONIC);
+
+    pthread_mutex_lock(&zd_mutex);
+    if (zd_liczba == 0) {
+        zd_najstarszy_ns = teraz;
+    }
+    ZdarzenieBin* z = &zd_bufor[zd_liczba++];
+    z->czas_ns = teraz;
+    z->pid = zd_pid;
+    z->typ = (uint16_t)typ;
+    z->nr = (uint16_t)nr;
+    z->id = id;
+    z->id2 = id2;
+    z->wartosc = wartosc;
+    z->wartosc2 = wartosc2;
+
+    // Pełny bufor albo zbyt stary rekord - zapis (żeby dziennik nie zostawał w tyle)
+    if (zd_liczba == EVENT_BUFFER || teraz - zd_najstarszy_ns >= EVENT_FLUSH_MS * 1000000LL) {
+        zapisz_bufor();
+    }
+    pthread_mutex_unlock(&zd_mutex);
+}
@@ -0,0 +1,63 @@
+#ifndef ZDARZENIA_H
+#define ZDARZENIA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Binarny dziennik zdarzeń (EVENT_LOG)
+// Każdy proces buforuje rekordy stałej długości i dopisuje je do EVENT_LOG_FILE
+// jednym write (O_APPEND). Plik zaczyna się nagłówkiem; kolejność rekordów
+// różnych procesów przywraca dekoder (sortowanie po czas_ns).
+
+#define ZDARZENIA_MAGIA    "KOLEJZD1"
+#define ZDARZENIA_WERSJA   1
+
+typedef enum {
+    ZD_BILET_SPRZEDANY = 1,     // id: turysta, id2: bilet, nr: typ biletu, wartosc: cena, wartosc2: dzieci
+    ZD_BRAMKA_WEJSCIE,          // id: turysta, id2: bilet, nr: bramka
+    ZD_PERON_WPUSZCZONY,        // id: turysta, nr: bramka peronowa, wartosc: typ turysty, wartosc2: dzieci
+    ZD_KRZESELKO_ODJAZD,        // id: krzesełko, nr: osoby, wartosc: rowerzyści, wartosc2: piesi
+    ZD_KRZESELKO_PRZYJAZD,      // id: krzesełko, nr: osoby
+    ZD_ZJAZD_START,             // id: turysta, nr: trasa, wartosc: czas zjazdu (s)
+    ZD_ZJAZD_KONIEC,            // id: turysta, nr: trasa
+    ZD_AWARIA_STOP,             // nr: pracownik inicjujący (1/2)
+    ZD_AWARIA_WZNOWIENIE,       // nr: pracownik (1/2)
+    ZD_LICZBA_TYPOW
+} TypZdarzenia;
+
+// Nagłówek pliku (32 B)
+typedef struct {
+    char magia[8];
+    uint32_t wersja;
+    uint32_t rozmiar_rekordu;
+    int64_t start_realtime_ns;  // Chwila startu - przeliczenie czasu monotonicznego na zegar ścienny
+    int64_t start_monotonic_ns;
+} NaglowekZdarzen;
+
+// Rekord zdarzenia (32 B)
+typedef struct {
+    int64_t czas_ns;            // CLOCK_MONOTONIC
+    int32_t pid;
+    uint16_t typ;               // TypZdarzenia
+    uint16_t nr;
+    int32_t id;
+    int32_t id2;
+    int32_t wartosc;
+    int32_t wartosc2;
+} ZdarzenieBin;
+
+// Otwarcie pliku (glowny - utworzenie z nagłówkiem, potomny - dopisywanie)
+void zdarzenia_init(bool glowny);
+
+// Zapis bufora procesu (wywoływany też przy exit)
+void zdarzenia_flush(void);
+void zdarzenia_zamknij(void);
+
+// Dodanie rekordu - bez formatowania tekstu; przy EVENT_LOG 0 natychmiastowy powrót
+void zapisz_zdarzenie(TypZdarzenia typ, int nr, int id, int id2, int wartosc, int wartosc2);
+
+// Nazwa typu i opis pól rekordu (dla dekodera); NULL - pole nieużywane
+const char* nazwa_zdarzenia(int typ);
+const char* nazwa_pola_zdarzenia(int typ, int pole);   // pole: 0 nr, 1 id, 2 id2, 3 wartosc, 4 wartosc2
+
+#endif // ZDARZENIA_H